@@ -12,6 +12,8 @@
 #include "stdafx.h"
 #include "D3D12HelloTriangle.h"
 #include <stdexcept>
+#include <algorithm>
+#include <chrono>
 
 // # DXR - Raytracing
 #include "DXRHelper.h"
@@ -20,6 +22,8 @@
 // # DXR - Raytracing pipeline
 #include "nv_helpers_dx12/RaytracingPipelineGenerator.h"
 #include "nv_helpers_dx12/RootSignatureGenerator.h"
+// # DXR Extra - Batched BLAS builds
+#include "nv_helpers_dx12/ASBuildScheduler.h"
 // # DXR Extras - Perspective camera
 #include "glm/gtc/type_ptr.hpp" 
 #include "manipulator.h" 
@@ -42,6 +46,27 @@ void D3D12HelloTriangle::OnInit()
 	nv_helpers_dx12::CameraManip.setWindowSize(GetWidth(), GetHeight()); 
 	nv_helpers_dx12::CameraManip.setLookat(glm::vec3(1.5f, 1.5f, 1.5f), glm::vec3(0, 0, 0), glm::vec3(0, 1, 0));
 
+	// # DXR Extra: Placed resources
+	if (m_runTlsfBenchmark)
+		RunTlsfBenchmark();
+	// # DXR Extra: Parallel recording
+	if (m_runRecordingBenchmark)
+		RunRecordingBenchmark();
+	// # DXR Extra: Async acceleration structure builds
+	if (m_runAsyncBuildSimulation)
+		RunAsyncBuildSimulation();
+	// # DXR Extra: Parallel shader compilation
+	if (m_runShaderCompileBenchmark)
+		RunShaderCompileBenchmark();
+
+	// # DXR Extra: Parallel shader compilation
+	// The shaders compile in the background of the rest of the initialization
+	CompileShaders();
+
+	// # DXR Extra: Pipeline cache
+	m_pipelineCache = std::make_unique<nv_helpers_dx12::PipelineCache>(
+		m_usePipelineCache ? kPipelineCacheDirectory : "");
+
 	LoadPipeline();
 	LoadAssets();
 
@@ -54,10 +79,22 @@ void D3D12HelloTriangle::OnInit()
 	// geometry, each bottom-level AS has its own transform matrix. 
 	CreateAccelerationStructures(); 
 
+	// # DXR Extra: Staging uploads
+	// The geometry is in the default heaps, and the staging buffer can be released
+	FinishStaticUploads();
+
 	// Command lists are created in the recording state, but there is 
 	// nothing to record yet. The main loop expects it to be closed, so 
 	// close it now. 
 	ThrowIfFailed(m_commandList->Close());
+
+	// # DXR Extra: Parallel recording
+	// The command list becomes the first one of the pool recording the frames
+	CreateCommandRecorder();
+
+	// # DXR Extra: Async acceleration structure builds
+	// The TLAS built above is the first version, the other ones are refitted from it
+	CreateAsyncBuilds();
 	
 	// # DXR - Raytracing Pipeline 
 	// 
@@ -66,6 +103,15 @@ void D3D12HelloTriangle::OnInit()
 	// rays (ray payload)
 	CreateRaytracingPipeline();
 
+	// # DXR Extra: Shader cache
+	// All the shaders are compiled or loaded at this point
+	ReportShaderCache();
+	// # DXR Extra: Parallel shader compilation
+	// The results outlive the queue, whose workers are no longer needed
+	m_shaderCompileQueue.reset();
+	// # DXR Extra: Pipeline cache
+	ReportPipelineCache();
+
 	// #DXR Extra: Per-Instance Data
 	// ʵ
 	CreatePerInstanceConstantBuffers();
@@ -78,10 +124,24 @@ void D3D12HelloTriangle::OnInit()
 	// 洢׷壬άĿimageһ
 	CreateRaytracingOutputBuffer();
 
+	// # DXR Extra: Upload ring
+	CreateUploadRing();
+
+	// # DXR Extra: Descriptor allocation
+	CreateDescriptorHeaps();
+
 	// # DXR Extra - Perspective Camera
 	// ڴ洢 modelview  perspective camera matrices Ļ
 	CreateCameraBuffer();
 
+	// # DXR Extra: Parallel recording
+	CreateRasterDraws();
+
+	// # DXR Extra: Render graph
+	// Describe the frame of each rendering mode, and create the transient depth buffer and
+	// raytracing output in the memory placed by the graphs
+	CreateFrameGraphs();
+
 	// Create the buffer containing the raytracing result (always output in a
 	// UAV), and create the heap referencing the resources used by the raytracing,
 	// such as the acceleration structure
@@ -91,6 +151,11 @@ void D3D12HelloTriangle::OnInit()
 	// Create the shader binding table and indicating which shaders
     // are invoked for each instance in the AS
 	CreateShaderBindingTable();
+
+	// # DXR Extra: Placed resources
+	ReportResourceHeaps();
+	// # DXR Extra: Render graph
+	ReportFrameGraphs();
 }
 
 // Load the rendering pipeline dependencies.
@@ -139,6 +204,11 @@ void D3D12HelloTriangle::LoadPipeline()
 			));
 	}
 
+	// # DXR Extra: Placed resources
+	// With -committed, a heap size of 0 creates all the buffers as committed resources
+	m_resourceAllocator = std::make_unique<nv_helpers_dx12::ResourceHeapAllocator>(m_device.Get(),
+		m_placeResources ? nv_helpers_dx12::ResourceHeapAllocator::kDefaultHeapSize : 0);
+
 	// Describe and create the command queue.
 	D3D12_COMMAND_QUEUE_DESC queueDesc = {};
 	queueDesc.Flags = D3D12_COMMAND_QUEUE_FLAG_NONE;
@@ -192,12 +262,18 @@ void D3D12HelloTriangle::LoadPipeline()
 		for (UINT n = 0; n < FrameCount; n++)
 		{
 			ThrowIfFailed(m_swapChain->GetBuffer(n, IID_PPV_ARGS(&m_renderTargets[n])));
+			// # DXR Extra: Resource state tracking
+			m_stateTracker.Register(m_renderTargets[n].Get(), D3D12_RESOURCE_STATE_PRESENT);
 			m_device->CreateRenderTargetView(m_renderTargets[n].Get(), nullptr, rtvHandle);
 			rtvHandle.Offset(1, m_rtvDescriptorSize);
 		}
 	}
 
-	ThrowIfFailed(m_device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&m_commandAllocator)));
+	// # DXR Extra: Frame pipelining
+	for (UINT n = 0; n < FrameCount; n++)
+	{
+		ThrowIfFailed(m_device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&m_commandAllocators[n])));
+	}
 
 	// #DXR Extra: Depth Buffering
 	// The original sample does not support depth buffering, so we need to allocate a depth buffer,
@@ -218,43 +294,46 @@ void D3D12HelloTriangle::LoadAssets()
 		CD3DX12_DESCRIPTOR_RANGE range;
 		range.Init(D3D12_DESCRIPTOR_RANGE_TYPE_CBV, 1, 0);
 		constantParameter.InitAsDescriptorTable(1, &range, D3D12_SHADER_VISIBILITY_ALL);
+		// # DXR Extra: Compact vertex formats
+		// The decoding of the positions of each draw is passed as root constants in b1
+		CD3DX12_ROOT_PARAMETER parameters[2];
+		parameters[0] = constantParameter;
+		// # DXR Extra: Parallel recording
+		// along with the transform of the instance drawn
+		parameters[1].InitAsConstants(sizeof(DrawConstants) / sizeof(UINT), 1, 0, D3D12_SHADER_VISIBILITY_VERTEX);
 		CD3DX12_ROOT_SIGNATURE_DESC rootSignatureDesc;
-		rootSignatureDesc.Init(1, &constantParameter, 0, nullptr, D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
+		rootSignatureDesc.Init(_countof(parameters), parameters, 0, nullptr, D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
 
 		ComPtr<ID3DBlob> signature;
 		ComPtr<ID3DBlob> error;
 		ThrowIfFailed(D3D12SerializeRootSignature(&rootSignatureDesc, D3D_ROOT_SIGNATURE_VERSION_1, &signature, &error));
 		ThrowIfFailed(m_device->CreateRootSignature(0, signature->GetBufferPointer(), signature->GetBufferSize(), IID_PPV_ARGS(&m_rootSignature)));
+		// # DXR Extra: Pipeline cache
+		// The root signature is part of the description of the pipeline state
+		nv_helpers_dx12::RootSignatureGenerator::SetKey(m_rootSignature.Get(), signature->GetBufferPointer(), signature->GetBufferSize());
 	}
 
 	// Create the pipeline state, which includes compiling and loading shaders.
 	{
-		ComPtr<ID3DBlob> vertexShader;
-		ComPtr<ID3DBlob> pixelShader;
-
-#if defined(_DEBUG)
-		// Enable better shader debugging with the graphics debugging tools.
-		UINT compileFlags = D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
-#else
-		UINT compileFlags = 0;
-#endif
-
-		ThrowIfFailed(D3DCompileFromFile(GetAssetFullPath(L"shaders.hlsl").c_str(), nullptr, nullptr, "VSMain", "vs_5_0", compileFlags, 0, &vertexShader, nullptr));
-		ThrowIfFailed(D3DCompileFromFile(GetAssetFullPath(L"shaders.hlsl").c_str(), nullptr, nullptr, "PSMain", "ps_5_0", compileFlags, 0, &pixelShader, nullptr));
+		// # DXR Extra: Parallel shader compilation
+		// The shaders were submitted by CompileShaders
+		const std::vector<uint8_t>& vertexShader = m_vertexShader.get();
+		const std::vector<uint8_t>& pixelShader = m_pixelShader.get();
 
 		// Define the vertex input layout.
+		// # DXR Extra: Compact vertex formats
 		D3D12_INPUT_ELEMENT_DESC inputElementDescs[] =
 		{
-			{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-			{ "COLOR", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 }
+			{ "POSITION", 0, GetPositionFormat(), 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+			{ "COLOR", 0, GetColorFormat(), 0, m_vertexLayout.GetColorOffset(), D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 }
 		};
 
 		// Describe and create the graphics pipeline state object (PSO).
 		D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDesc = {};
 		psoDesc.InputLayout = { inputElementDescs, _countof(inputElementDescs) };
 		psoDesc.pRootSignature = m_rootSignature.Get();
-		psoDesc.VS = CD3DX12_SHADER_BYTECODE(vertexShader.Get());
-		psoDesc.PS = CD3DX12_SHADER_BYTECODE(pixelShader.Get());
+		psoDesc.VS = CD3DX12_SHADER_BYTECODE(vertexShader.data(), vertexShader.size());
+		psoDesc.PS = CD3DX12_SHADER_BYTECODE(pixelShader.data(), pixelShader.size());
 		psoDesc.RasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
 		psoDesc.BlendState = CD3DX12_BLEND_DESC(D3D12_DEFAULT);
 		psoDesc.DepthStencilState.DepthEnable = FALSE;
@@ -269,25 +348,30 @@ void D3D12HelloTriangle::LoadAssets()
 		psoDesc.DepthStencilState = CD3DX12_DEPTH_STENCIL_DESC(D3D12_DEFAULT);
 		psoDesc.DSVFormat = DXGI_FORMAT_D32_FLOAT;
 
-		ThrowIfFailed(m_device->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&m_pipelineState)));
+		// # DXR Extra: Pipeline cache
+		m_pipelineState = CreateCachedPipelineState(psoDesc);
 	}
 
 	// Create the command list.
-	ThrowIfFailed(m_device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, m_commandAllocator.Get(), m_pipelineState.Get(), IID_PPV_ARGS(&m_commandList)));
+	ThrowIfFailed(m_device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, m_commandAllocators[0].Get(), m_pipelineState.Get(), IID_PPV_ARGS(&m_commandList)));
 
 	// 㻺
 	{
+		// # DXR Extra: Staging uploads
+		CreateUploadBatcher();
 		// CreateTriangleVB();	// ζ㻺
 		//---DXR Extra: Indexed Geometry
 		CreateTetrahedronVB();
 		// #DXR - Per Instance
 		CreatePlaneVB();    // ƽ涥㻺, λ
+		// # Benchmark scenes
+		if (m_useGeneratedScene)
+			CreateGeneratedSceneBuffers();
 	}
 
 	// Create synchronization objects and wait until assets have been uploaded to the GPU.
 	{
 		ThrowIfFailed(m_device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&m_fence)));
-		m_fenceValue = 1;
 
 		// Create an event handle to use for frame synchronization.
 		m_fenceEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
@@ -296,187 +380,1054 @@ void D3D12HelloTriangle::LoadAssets()
 			ThrowIfFailed(HRESULT_FROM_WIN32(GetLastError()));
 		}
 
+		// # DXR Extra: Frame pipelining
+		m_queueFence.queue = m_commandQueue.Get();
+		m_queueFence.fence = m_fence.Get();
+		m_queueFence.event = m_fenceEvent;
+		m_framePacer = std::make_unique<nv_helpers_dx12::FramePacer>(&m_queueFence, FrameCount);
+
 		// Wait for the command list to execute; we are reusing the same command 
 		// list in our main loop but for now, we just want to wait for setup to 
 		// complete before continuing.
-		WaitForPreviousFrame();
+		WaitForGpu();
 	}
 }
 
 // Update frame-based values.
 void D3D12HelloTriangle::OnUpdate()
 {
-	// #DXR Extra: Perspective Camera 
-	// ÿһ֡ҪӦ camera matrix
-	UpdateCameraBuffer();
+	// # DXR Extra: Meshlet culling
+	if (!m_sceneMeshlets.empty())
+		CullSceneMeshlets();
 }
 
 // Render the scene.
 void D3D12HelloTriangle::OnRender()
 {
+	// # DXR Extra: Frame pipelining
+	// Only wait for the GPU to release the resources of the frame slot, the other frames in flight
+	// keeping it busy
+	m_framePacer->BeginFrame();
+	// # DXR Extra: Upload ring
+	m_uploadRing.Retire(m_queueFence.GetCompletedValue());
+	// # DXR Extra: Descriptor allocation
+	m_descriptorAllocator.Retire(m_queueFence.GetCompletedValue());
+	// # DXR Extra: Deferred release
+	m_deferredReleases.Retire(m_queueFence.GetCompletedValue());
+
+	// #DXR Extra: Perspective Camera 
+	// ÿһ֡ҪӦ camera matrix
+	UpdateCameraBuffer();
+
+	// # DXR Extra: Async acceleration structure builds
+	// The build is submitted to the compute queue before the frame using it
+	if (m_asBuildScheduler && !m_raster)
+		BuildTopLevelASAsync();
+
 	// Record all the commands we need to render the scene into the command list.
+	// # DXR Extra: Parallel recording
+	// The command lists of the frame are executed by a single call at the end of the recording
 	PopulateCommandList();
 
-	// Execute the command list.
-	ID3D12CommandList* ppCommandLists[] = { m_commandList.Get() };
-	m_commandQueue->ExecuteCommandLists(_countof(ppCommandLists), ppCommandLists);
-
 	// Present the frame.
 	ThrowIfFailed(m_swapChain->Present(1, 0));
 
-	WaitForPreviousFrame();
+	MoveToNextFrame();
 }
 
 void D3D12HelloTriangle::OnDestroy()
 {
 	// Ensure that the GPU is no longer referencing resources that are about to be
 	// cleaned up by the destructor.
-	WaitForPreviousFrame();
+	WaitForGpu();
+	// # DXR Extra: Deferred release
+	m_deferredReleases.ReleaseAll();
 
 	CloseHandle(m_fenceEvent);
 }
 
 void D3D12HelloTriangle::PopulateCommandList() {
-	// Command list allocators ֻ command lists  GPU ϵִкã
-	// Ӧʹ fence ȷ GPU ִнȡ
-	ThrowIfFailed(m_commandAllocator->Reset());
+	// # DXR Extra: Parallel recording
+	// The frame pacer guarantees that the GPU is done with the allocators of the frame slot, reset
+	// when each command list is opened
+	m_commandRecorder->BeginFrame(m_framePacer->GetFrameSlot());
+	OpenSerialCommandList();
+
+	// # DXR Extra: Async acceleration structure builds
+	// The direct queue waits for the build of the version traced by the frame, on the GPU. The
+	// wait applies to the command lists executed at the end of the recording
+	if (m_asBuildScheduler && !m_raster)
+	{
+		const nv_helpers_dx12::AsyncBuildScheduler::Use use = m_asBuildScheduler->BeginUse();
+		if (use.computeWaitValue)
+			ThrowIfFailed(m_commandQueue->Wait(m_computeFence.Get(), use.computeWaitValue));
+		m_topLevelASVersion = use.version;
+		m_topLevelASInUse = true;
+	}
+
+	// # DXR Extra: Render graph
+	// The passes of the graph of the current mode record the commands, and the graph declares
+	// the states of their resources to the tracker. The depth buffer and the raytracing output
+	// share their memory, hence switching modes starts with an aliasing barrier
+	FrameGraph& frameGraph = m_raster ? m_rasterGraph : m_raytracingGraph;
+	if (m_raster != m_previousFrameRaster && m_transientHeap)
+		m_stateTracker.AliasingBarrier(nullptr, nullptr);
+	m_previousFrameRaster = m_raster;
+	frameGraph.graph.SetResource(frameGraph.backBuffer, m_renderTargets[m_frameIndex].Get());
+	frameGraph.graph.Execute(&m_stateTracker, [this]() { FlushBarriers(); });
+
+	m_commandRecorder->EndFrame();
+}
 
-	// ȻExecuteCommandList() ض command list ʱcommand list 
-	// re-recording ֮ǰʱ
-	ThrowIfFailed(m_commandList->Reset(m_commandAllocator.Get(), m_pipelineState.Get()));
+// # DXR Extra: Parallel recording
+//---OpenSerialCommandList------------------------------------------------------
+//
+// Continue the recording on the main thread, into the next command list of the frame
+//
+void D3D12HelloTriangle::OpenSerialCommandList() {
+	m_commandList = m_commandListPool.lists[m_commandRecorder->OpenSerialList()];
+	SetFrameState(m_commandList.Get());
+}
 
+//---SetFrameState--------------------------------------------------------------
+//
+// Set the state shared by all the command lists of the frame
+//
+void D3D12HelloTriangle::SetFrameState(ID3D12GraphicsCommandList4* commandList) {
 	// ñҪ״̬.
-	m_commandList->SetGraphicsRootSignature(m_rootSignature.Get());
-	m_commandList->RSSetViewports(1, &m_viewport);
-	m_commandList->RSSetScissorRects(1, &m_scissorRect);
+	commandList->SetGraphicsRootSignature(m_rootSignature.Get());
+	commandList->RSSetViewports(1, &m_viewport);
+	commandList->RSSetScissorRects(1, &m_scissorRect);
+	// # DXR Extra: Descriptor allocation
+	// The single shader-visible heap serves both the rasterization and the raytracing
+	ID3D12DescriptorHeap* descriptorHeaps[] = { m_descriptorHeap.Get() };
+	commandList->SetDescriptorHeaps(_countof(descriptorHeaps), descriptorHeaps);
+}
+
+// # DXR Extra: Resource state tracking
+//---FlushBarriers--------------------------------------------------------------
+//
+// Issue the barriers accumulated by the state tracker with a single ResourceBarrier call
+//
+void D3D12HelloTriangle::FlushBarriers()
+{
+	m_trackedBarriers.clear();
+	if (m_stateTracker.Flush(&m_trackedBarriers) == 0)
+		return;
+	m_barriers.clear();
+	for (const nv_helpers_dx12::ResourceBarrierDesc& barrier : m_trackedBarriers)
+	{
+		ID3D12Resource* resource = static_cast<ID3D12Resource*>(barrier.resource);
+		if (barrier.type == nv_helpers_dx12::ResourceBarrierDesc::Type::UAV)
+		{
+			m_barriers.push_back(CD3DX12_RESOURCE_BARRIER::UAV(resource));
+			continue;
+		}
+		// # DXR Extra: Render graph
+		if (barrier.type == nv_helpers_dx12::ResourceBarrierDesc::Type::Aliasing)
+		{
+			m_barriers.push_back(CD3DX12_RESOURCE_BARRIER::Aliasing(static_cast<ID3D12Resource*>(barrier.resourceBefore), resource));
+			continue;
+		}
+		D3D12_RESOURCE_BARRIER_FLAGS flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
+		if (barrier.split == nv_helpers_dx12::ResourceBarrierDesc::Split::BeginOnly)
+			flags = D3D12_RESOURCE_BARRIER_FLAG_BEGIN_ONLY;
+		else if (barrier.split == nv_helpers_dx12::ResourceBarrierDesc::Split::EndOnly)
+			flags = D3D12_RESOURCE_BARRIER_FLAG_END_ONLY;
+		m_barriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition(resource, static_cast<D3D12_RESOURCE_STATES>(barrier.stateBefore),
+			static_cast<D3D12_RESOURCE_STATES>(barrier.stateAfter), barrier.subresource, flags));
+	}
+	m_commandList->ResourceBarrier(static_cast<UINT>(m_barriers.size()), m_barriers.data());
+}
 
-	// ָʾ backbuffer ΪȾĿ걻ʹ
-	m_commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(m_renderTargets[m_frameIndex].Get(), D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET));
+// # DXR Extra: Render graph
+//---CreateFrameGraphs----------------------------------------------------------
+//
+// Build and compile the graph of each rendering mode, and create the transient resources at the
+// offsets computed by the graphs, in a heap large enough for either mode
+//
+void D3D12HelloTriangle::CreateFrameGraphs() {
+	BuildFrameGraph(&m_rasterGraph, true);
+	BuildFrameGraph(&m_raytracingGraph, false);
+
+	// Depth buffers and UAV textures can only share a heap from resource heap tier 2
+	D3D12_FEATURE_DATA_D3D12_OPTIONS options = {};
+	ThrowIfFailed(m_device->CheckFeatureSupport(D3D12_FEATURE_D3D12_OPTIONS, &options, sizeof(options)));
+	if (m_placeResources && options.ResourceHeapTier >= D3D12_RESOURCE_HEAP_TIER_2)
+	{
+		D3D12_HEAP_DESC heapDesc = {};
+		heapDesc.SizeInBytes = (std::max)(m_rasterGraph.graph.GetHeapSize(), m_raytracingGraph.graph.GetHeapSize());
+		heapDesc.Properties = nv_helpers_dx12::kDefaultHeapProps;
+		heapDesc.Alignment = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+		heapDesc.Flags = D3D12_HEAP_FLAG_ALLOW_ALL_BUFFERS_AND_TEXTURES;
+		ThrowIfFailed(m_device->CreateHeap(&heapDesc, IID_PPV_ARGS(&m_transientHeap)));
+	}
 
-	
+	// The depth values will be initialized to 1 
+	CD3DX12_CLEAR_VALUE depthOptimizedClearValue(DXGI_FORMAT_D32_FLOAT, 1.0f, 0);
+	m_depthStencil = CreateTransientTexture(&m_rasterGraph, m_rasterGraph.depthStencil, m_depthStencilDesc, &depthOptimizedClearValue);
+	m_outputResource = CreateTransientTexture(&m_raytracingGraph, m_raytracingGraph.output, m_outputDesc, nullptr);
+
+	// Write the depth buffer view into the depth buffer heap 
+	D3D12_DEPTH_STENCIL_VIEW_DESC dsvDesc = {};
+	dsvDesc.Format = DXGI_FORMAT_D32_FLOAT;
+	dsvDesc.ViewDimension = D3D12_DSV_DIMENSION_TEXTURE2D;
+	dsvDesc.Flags = D3D12_DSV_FLAG_NONE;
+	m_device->CreateDepthStencilView(m_depthStencil.Get(), &dsvDesc, m_dsvHeap->GetCPUDescriptorHandleForHeapStart());
+}
+
+//---BuildFrameGraph------------------------------------------------------------
+//
+// Declare the passes of a frame. The raytracing pass is declared in both graphs: the graph of the
+// rasterization never reads its output, and culls it along with the output itself
+//
+void D3D12HelloTriangle::BuildFrameGraph(FrameGraph* frameGraph, bool raster) {
+	nv_helpers_dx12::RenderGraph& graph = frameGraph->graph;
+	frameGraph->backBuffer = graph.ImportResource("back buffer", nullptr);
+	const uint32_t camera = graph.ImportResource("camera", m_cameraBuffer.Get());
+	const D3D12_RESOURCE_ALLOCATION_INFO depthInfo = m_device->GetResourceAllocationInfo(0, 1, &m_depthStencilDesc);
+	frameGraph->depthStencil = graph.CreateTransientResource("depth buffer", depthInfo.SizeInBytes, depthInfo.Alignment);
+	const D3D12_RESOURCE_ALLOCATION_INFO outputInfo = m_device->GetResourceAllocationInfo(0, 1, &m_outputDesc);
+	frameGraph->output = graph.CreateTransientResource("raytracing output", outputInfo.SizeInBytes, outputInfo.Alignment);
+
+	// # DXR Extra: Frame pipelining
+	// Copy the camera matrices of the frame, the previous frames in flight having read the
+	// camera buffer before the copy on the GPU timeline
+	uint32_t pass = graph.AddPass("camera upload", [this]() {
+		m_commandList->CopyBufferRegion(m_cameraBuffer.Get(), 0, m_uploadRingBuffer.Get(), m_cameraUploadOffset, m_cameraBufferSize);
+	});
+	graph.Write(pass, camera, D3D12_RESOURCE_STATE_COPY_DEST);
+
+	if (raster)
+	{
+		pass = graph.AddPass("rasterization", [this]() { RecordRasterization(); });
+		graph.Read(pass, camera, D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER);
+		graph.Write(pass, frameGraph->depthStencil, D3D12_RESOURCE_STATE_DEPTH_WRITE);
+		graph.Write(pass, frameGraph->backBuffer, D3D12_RESOURCE_STATE_RENDER_TARGET);
+	}
+
+	pass = graph.AddPass("raytracing", [this]() { RecordRaytracing(); });
+	graph.Read(pass, camera, D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER);
+	graph.Write(pass, frameGraph->output, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+
+	if (!raster)
+	{
+		// ׷ҪƵʵʾȾĿ
+		pass = graph.AddPass("output copy", [this]() {
+			m_commandList->CopyResource(m_renderTargets[m_frameIndex].Get(), m_outputResource.Get());
+		});
+		graph.Read(pass, frameGraph->output, D3D12_RESOURCE_STATE_COPY_SOURCE);
+		graph.Write(pass, frameGraph->backBuffer, D3D12_RESOURCE_STATE_COPY_DEST);
+	}
+
+	// Indicate that the back buffer will now be used to present.
+	pass = graph.AddPass("present", nullptr, true);
+	graph.Read(pass, frameGraph->backBuffer, D3D12_RESOURCE_STATE_PRESENT);
+
+	graph.Compile();
+}
+
+//---CreateTransientTexture-----------------------------------------------------
+//
+// Create a transient resource of a graph in the state of its first use, at its offset in the
+// transient heap or as a committed resource if there is no such heap
+//
+ComPtr<ID3D12Resource> D3D12HelloTriangle::CreateTransientTexture(FrameGraph* frameGraph, uint32_t resource,
+	const D3D12_RESOURCE_DESC& desc, const D3D12_CLEAR_VALUE* clearValue) {
+	const D3D12_RESOURCE_STATES state = static_cast<D3D12_RESOURCE_STATES>(frameGraph->graph.GetFirstState(resource));
+	ComPtr<ID3D12Resource> texture;
+	if (m_transientHeap)
+		ThrowIfFailed(m_device->CreatePlacedResource(m_transientHeap.Get(), frameGraph->graph.GetHeapOffset(resource),
+			&desc, state, clearValue, IID_PPV_ARGS(&texture)));
+	else
+		ThrowIfFailed(m_device->CreateCommittedResource(&nv_helpers_dx12::kDefaultHeapProps, D3D12_HEAP_FLAG_NONE,
+			&desc, state, clearValue, IID_PPV_ARGS(&texture)));
+	frameGraph->graph.SetResource(resource, texture.Get());
+	m_stateTracker.Register(texture.Get(), state);
+	return texture;
+}
+
+//---RecordRasterization--------------------------------------------------------
+//
+// Commands of the rasterization pass
+//
+void D3D12HelloTriangle::RecordRasterization() {
 	CD3DX12_CPU_DESCRIPTOR_HANDLE rtvHandle(m_rtvHeap->GetCPUDescriptorHandleForHeapStart(), m_frameIndex, m_rtvDescriptorSize);
-	// #DXR Extra: Depth Buffering
-	// Bind the depth buffer as a render target
 	CD3DX12_CPU_DESCRIPTOR_HANDLE dsvHandle(m_dsvHeap->GetCPUDescriptorHandleForHeapStart());
-	m_commandList->OMSetRenderTargets(1, &rtvHandle, FALSE, &dsvHandle);
-	//m_commandList->OMSetRenderTargets(1, &rtvHandle, FALSE, nullptr);
 
+	// #DXR Extra: Depth Buffering 
+	// The depth buffer shares its memory with the raytracing output, and the clear also
+	// initializes it after the aliasing barrier
+	m_commandList->ClearDepthStencilView(dsvHandle, D3D12_CLEAR_FLAG_DEPTH, 1.0f, 0, 0, nullptr);
+	// ڹդִ
+	const float clearColor[] = { 0.0f, 0.2f, 0.4f, 1.0f };
+	m_commandList->ClearRenderTargetView(rtvHandle, clearColor, 0, nullptr);
+
+	// #DXR Extra: Perspective Camera 
+	// set the root descriptor table 0 to the constant buffer descriptor
+	// # DXR Extra: Descriptor allocation
+	// The table is copied on bind from the staging heap into the transient region, once for all
+	// the command lists as the transient ring is not thread-safe
+	const D3D12_GPU_DESCRIPTOR_HANDLE cameraTable = BindStagingDescriptor(m_cameraStagingDescriptor);
+
+	// # DXR Extra: Parallel recording
+	// Each range of draws is recorded into its own command list, which starts without any state
+	m_commandRecorder->RecordParallel(static_cast<uint32_t>(m_rasterDraws.size()), [&](uint32_t list, uint32_t first, uint32_t count) {
+		ID3D12GraphicsCommandList4* commandList = m_commandListPool.lists[list].Get();
+		SetFrameState(commandList);
+		// #DXR Extra: Depth Buffering
+		// Bind the depth buffer as a render target
+		commandList->OMSetRenderTargets(1, &rtvHandle, FALSE, &dsvHandle);
+		commandList->SetGraphicsRootDescriptorTable(0, cameraTable);
+		commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+		for (uint32_t i = first; i < first + count; i++)
+		{
+			const RasterDraw& draw = m_rasterDraws[i];
+			commandList->IASetVertexBuffers(0, 1, &draw.vertexBufferView);
+			commandList->IASetIndexBuffer(&draw.indexBufferView);
+			commandList->SetGraphicsRoot32BitConstants(1, sizeof(DrawConstants) / sizeof(UINT), &draw.constants, 0);
+			commandList->DrawIndexedInstanced(draw.indexCount, 1, 0, 0, 0);
+		}
+	}, kMinDrawsPerList);
+
+	// The next passes record on the main thread again
+	OpenSerialCommandList();
+}
+
+//---RecordRaytracing-----------------------------------------------------------
+//
+// Commands of the raytracing pass, writing the raytracing output
+//
+void D3D12HelloTriangle::RecordRaytracing() {
+	// ù׷
+	D3D12_DISPATCH_RAYS_DESC desc = {};
+
+	// SBT ṹ£ray generation, miss shaders, hit groups.
+	// The layout of the SBT is as follows: ray generation shader, miss
+	// shaders, hit groups.  SBT ͬĴС̶ stride.
+	
+	// Ray generation shader ǴSBTĿͷ
+	// # DXR Extra: Async acceleration structure builds
+	// The section holds one record per TLAS version, each referencing the descriptors of its version
+	uint32_t rayGenerationSectionSizeInBytes = m_sbtHelper.GetRayGenSectionSize();
+	desc.RayGenerationShaderRecord.StartAddress = m_sbtStorage->GetGPUVirtualAddress() + m_topLevelASVersion * m_sbtHelper.GetRayGenEntrySize();
+	desc.RayGenerationShaderRecord.SizeInBytes = m_sbtHelper.GetRayGenEntrySize();
+
+	// Miss shaders  SBTĵڶ֣ generation shaderһ miss shader 
+	// camera rays һ shadow rays. ˣҪ 2*m_sbtEntrySize Сͬʱ
+	// ָ miss shaders  strideһ SBT entry
+	uint32_t missSectionSizeInBytes = m_sbtHelper.GetMissSectionSize();
+	desc.MissShaderTable.StartAddress = m_sbtStorage->GetGPUVirtualAddress() + rayGenerationSectionSizeInBytes;
+	desc.MissShaderTable.SizeInBytes = missSectionSizeInBytes;
+	desc.MissShaderTable.StrideInBytes = m_sbtHelper.GetMissEntrySize();
+
+	// Hit groups  miss shaders ʼ. һ hit group  triangle
+	uint32_t hitGroupsSectionSize = m_sbtHelper.GetHitGroupSectionSize();
+	desc.HitGroupTable.StartAddress = m_sbtStorage->GetGPUVirtualAddress() + rayGenerationSectionSizeInBytes + missSectionSizeInBytes;
+	desc.HitGroupTable.SizeInBytes = hitGroupsSectionSize;
+	desc.HitGroupTable.StrideInBytes = m_sbtHelper.GetHitGroupEntrySize();
+
+	// ȾͼƬά, ͬںά
+	desc.Width = GetWidth();
+	desc.Height = GetHeight();
+	desc.Depth = 1;
+
+	// 󶨹׷
+	m_commandList->SetPipelineState1(m_rtStateObject.Get());
+	// ׷
+	m_commandList->DispatchRays(&desc);
+}
 
-	// ¼.
-	if (m_raster)
+//---ReportFrameGraphs----------------------------------------------------------
+//
+// Report the passes culled by each graph, and the memory of the transient resources saved by
+// aliasing, within each graph and across the two modes
+//
+void D3D12HelloTriangle::ReportFrameGraphs() {
+	const FrameGraph* frameGraphs[] = { &m_rasterGraph, &m_raytracingGraph };
+	const char* names[] = { "rasterization", "raytracing" };
+	uint64_t transientSize = 0;
+	for (size_t i = 0; i < _countof(frameGraphs); i++)
+	{
+		const nv_helpers_dx12::RenderGraphStatistics& statistics = frameGraphs[i]->graph.GetStatistics();
+		OutputDebugStringA(("Render graph, " + std::string(names[i]) + ": " + std::to_string(statistics.passCount) +
+			" passes, " + std::to_string(statistics.culledPassCount) + " culled, " +
+			std::to_string(statistics.transientResourceCount) + " transient resources (" +
+			std::to_string(statistics.culledResourceCount) + " unused) in " + std::to_string(statistics.heapSize / 1024) +
+			" KB instead of " + std::to_string(statistics.transientSize / 1024) + " KB\n").c_str());
+		transientSize += statistics.transientSize;
+	}
+	if (!m_transientHeap)
 	{
-		// #DXR Extra: Depth Buffering 
-		m_commandList->ClearDepthStencilView(dsvHandle, D3D12_CLEAR_FLAG_DEPTH, 1.0f, 0, 0, nullptr);
-		// #DXR Extra: Perspective Camera 
-		std::vector<ID3D12DescriptorHeap*> heaps = { m_constHeap.Get() }; 
-		m_commandList->SetDescriptorHeaps(static_cast<UINT>(heaps.size()), heaps.data()); 
-		// set the root descriptor table 0 to the constant buffer descriptor heap 
-		m_commandList->SetGraphicsRootDescriptorTable( 0, m_constHeap->GetGPUDescriptorHandleForHeapStart());
-
-		// ڹդִ
-		const float clearColor[] = { 0.0f, 0.2f, 0.4f, 1.0f };
-		m_commandList->ClearRenderTargetView(rtvHandle, clearColor, 0, nullptr);
-		m_commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-		// m_commandList->IASetVertexBuffers(0, 1, &m_vertexBufferView);
-		// m_commandList->DrawInstanced(3, 1, 0, 0);
+		OutputDebugStringA(("Render graph: " + std::to_string(transientSize / 1024) +
+			" KB of committed transient resources, no aliasing\n").c_str());
+		return;
+	}
+	const uint64_t heapSize = m_transientHeap->GetDesc().SizeInBytes;
+	OutputDebugStringA(("Render graph: transient heap of " + std::to_string(heapSize / 1024) + " KB instead of " +
+		std::to_string(transientSize / 1024) + " KB, " + std::to_string((transientSize - heapSize) / 1024) +
+		" KB saved by aliasing\n").c_str());
+}
+
+// # DXR Extra: Frame pipelining
+//---WaitForGpu-----------------------------------------------------------------
+//
+// Wait for the GPU to complete all the submitted work
+//
+void D3D12HelloTriangle::WaitForGpu()
+{
+	m_framePacer->Flush();
+	// # DXR Extra: Async acceleration structure builds
+	if (m_computeFence)
+		m_computeQueueFence.Wait(m_computeQueueFence.value);
+	m_frameIndex = m_swapChain->GetCurrentBackBufferIndex();
+}
 
+//---MoveToNextFrame------------------------------------------------------------
+//
+// Mark the end of the frame without waiting for the GPU, and periodically report how often the
+// CPU had to wait for a frame slot
+//
+void D3D12HelloTriangle::MoveToNextFrame()
+{
+	// # DXR Extra: Upload ring
+	const UINT64 fenceValue = m_framePacer->EndFrame();
+	m_uploadRing.EndFrame(fenceValue);
+	// # DXR Extra: Descriptor allocation
+	m_descriptorAllocator.EndFrame(fenceValue);
+	// # DXR Extra: Async acceleration structure builds
+	if (m_topLevelASInUse)
+		m_asBuildScheduler->EndUse(fenceValue);
+	m_topLevelASInUse = false;
+	// # DXR Extra: Deferred release
+	m_deferredReleases.EndFrame(fenceValue);
+	m_frameIndex = m_swapChain->GetCurrentBackBufferIndex();
+
+	const nv_helpers_dx12::FramePacingStatistics& statistics = m_framePacer->GetStatistics();
+	if (statistics.frameCount < kFramePacingReportInterval)
+		return;
+	OutputDebugStringA(("Frame pacing: " + std::to_string(FrameCount) + " frames in flight, " +
+		std::to_string(100.f * statistics.GetStallRate()) + "% of the frames waited for the GPU, " +
+		std::to_string(1000. * statistics.stallSeconds / statistics.frameCount) + " ms per frame\n").c_str());
+	// # DXR Extra: Resource state tracking
+	const nv_helpers_dx12::ResourceStateStatistics& barrierStatistics = m_stateTracker.GetStatistics();
+	OutputDebugStringA(("Resource states: " + std::to_string(barrierStatistics.emittedBarrierCount / static_cast<double>(statistics.frameCount)) +
+		" barriers per frame in " + std::to_string(barrierStatistics.batchCount / static_cast<double>(statistics.frameCount)) + " batches, " +
+		std::to_string(barrierStatistics.droppedTransitionCount + barrierStatistics.mergedTransitionCount) + " of " +
+		std::to_string(barrierStatistics.requestedTransitionCount) + " transitions dropped or merged, " +
+		std::to_string(barrierStatistics.splitBarrierCount) + " split barriers\n").c_str());
+	m_stateTracker.ResetStatistics();
+	// # DXR Extra: Parallel recording
+	const nv_helpers_dx12::CommandRecordingStatistics& recordingStatistics = m_commandRecorder->GetStatistics();
+	OutputDebugStringA(("Command recording: " + std::to_string(recordingStatistics.GetListsPerFrame()) +
+		" command lists per frame, " + std::to_string(recordingStatistics.parallelItemCount / statistics.frameCount) +
+		" draws per frame recorded in parallel at " + std::to_string(recordingStatistics.GetItemsPerSecond() / 1e6) +
+		" M draws/s\n").c_str());
+	m_commandRecorder->ResetStatistics();
+	// # DXR Extra: Async acceleration structure builds
+	if (m_asBuildScheduler)
+	{
+		const nv_helpers_dx12::AsyncBuildStatistics& buildStatistics = m_asBuildScheduler->GetStatistics();
+		OutputDebugStringA(("Async TLAS builds: " + std::to_string(buildStatistics.buildCount) + " builds on the compute queue, " +
+			std::to_string(100.f * buildStatistics.GetRefitRate()) + "% refits, " +
+			std::to_string(buildStatistics.computeWaitCount) + " waits for the direct queue, " +
+			std::to_string(buildStatistics.directWaitCount) + " waits for the compute queue\n").c_str());
+		m_asBuildScheduler->ResetStatistics();
+	}
+	m_framePacer->ResetStatistics();
+}
+
+//---CommandQueueFence----------------------------------------------------------
+//
+// Queue of the frame pacer, on top of the command queue and its fence
+//
+uint64_t D3D12HelloTriangle::CommandQueueFence::Signal()
+{
+	ThrowIfFailed(queue->Signal(fence, ++value));
+	return value;
+}
+
+uint64_t D3D12HelloTriangle::CommandQueueFence::GetCompletedValue()
+{
+	return fence->GetCompletedValue();
+}
+
+void D3D12HelloTriangle::CommandQueueFence::Wait(uint64_t waitValue)
+{
+	if (fence->GetCompletedValue() >= waitValue)
+		return;
+	ThrowIfFailed(fence->SetEventOnCompletion(waitValue, event));
+	WaitForSingleObject(event, INFINITE);
+}
+
+// # DXR Extra: Parallel recording
+//---CreateCommandRecorder------------------------------------------------------
+//
+// Create the command lists recording the frames, and their allocators. Two lists recorded on the
+// main thread frame the parallel ranges of the rasterization
+//
+void D3D12HelloTriangle::CreateCommandRecorder() {
+	UINT workerCount = m_recordingWorkerCount;
+	if (workerCount == 0)
+		workerCount = (std::min)((std::max)(std::thread::hardware_concurrency(), 1u), kMaxRecordingWorkers);
+	const UINT listCount = workerCount + 2;
+
+	m_commandListPool.queue = m_commandQueue.Get();
+	m_commandListPool.initialState = m_pipelineState.Get();
+	for (UINT list = 0; list < listCount; list++)
+	{
+		// The first list is the one used upon initialization, along with its allocators
+		for (UINT n = 0; n < FrameCount; n++)
+		{
+			ComPtr<ID3D12CommandAllocator> allocator = m_commandAllocators[n];
+			if (list > 0)
+				ThrowIfFailed(m_device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&allocator)));
+			m_commandListPool.allocators.push_back(allocator);
+		}
+		ComPtr<ID3D12GraphicsCommandList4> commandList = m_commandList;
+		if (list > 0)
+		{
+			ThrowIfFailed(m_device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, m_commandListPool.allocators.back().Get(),
+				m_pipelineState.Get(), IID_PPV_ARGS(&commandList)));
+			ThrowIfFailed(commandList->Close());
+		}
+		m_commandListPool.lists.push_back(commandList);
+	}
+	m_commandRecorder = std::make_unique<nv_helpers_dx12::CommandRecorder>(&m_commandListPool, workerCount, listCount);
+	OutputDebugStringA(("Command recording: " + std::to_string(workerCount) + " workers, " +
+		std::to_string(listCount) + " command lists\n").c_str());
+}
+
+//---CreateRasterDraws----------------------------------------------------------
+//
+// List the draws of the rasterization, in the order of the TLAS instances: the tetrahedron or the
+// instances of the scene, each with its level of detail, then the plane
+//
+void D3D12HelloTriangle::CreateRasterDraws() {
+	const float identity[3][4] = { {1.f, 0.f, 0.f, 0.f}, {0.f, 1.f, 0.f, 0.f}, {0.f, 0.f, 1.f, 0.f} };
+	auto addDraw = [this](const D3D12_VERTEX_BUFFER_VIEW& vertexBufferView, const D3D12_INDEX_BUFFER_VIEW& indexBufferView,
+		UINT indexCount, const PositionDecode& decode, const float(*transform)[4]) {
+		RasterDraw draw = { vertexBufferView, indexBufferView, indexCount };
+		draw.constants.decode = decode;
+		for (int row = 0; row < 3; row++)
+			draw.constants.transform[row] = XMFLOAT4(transform[row]);
+		m_rasterDraws.push_back(draw);
+	};
+
+	if (!m_useGeneratedScene)
+	{
 		// #DXR Extra: Indexed Geometry
 		// 
-		m_commandList->IASetVertexBuffers(0, 1, &m_vertexBufferView);
-		m_commandList->IASetIndexBuffer(&m_indexBufferView);
-		m_commandList->DrawIndexedInstanced(12, 1, 0, 0, 0);
-
-		// #DXR Extra: Per-Instance Data
-		// ׷ƣӻƽ
-		m_commandList->IASetVertexBuffers(0, 1, &m_planeBufferView);
-		m_commandList->DrawInstanced(6, 1, 0, 0);
+		addDraw(m_vertexBufferView, m_indexBufferView, 12, m_tetrahedronDecode, identity);
 	}
-	else 
+	for (size_t i = 0; m_useGeneratedScene && i < m_scene.instances.size(); i++)
 	{
-		// ڹ׷, òһɫ buffer
-		const float clearColor[] = { 0.6f,0.8f,0.4f,1.0f };
-		m_commandList->ClearRenderTargetView(rtvHandle, clearColor, 0, nullptr);
-		//  descriptor heap Է TLAS  ׷
-		std::vector<ID3D12DescriptorHeap*> heaps = { m_srvUavHeap.Get() };
-		m_commandList->SetDescriptorHeaps(static_cast<UINT>(heaps.size()), heaps.data());
-		// һ֡׷ΪԴʹãݵȾĿꡣҪתΪ
-		// UAVԱ shader д
-		CD3DX12_RESOURCE_BARRIER transition = CD3DX12_RESOURCE_BARRIER::Transition(m_outputResource.Get(), D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
-		m_commandList->ResourceBarrier(1, &transition);
-
-		// ù׷
-		D3D12_DISPATCH_RAYS_DESC desc = {};
-
-		// SBT ṹ£ray generation, miss shaders, hit groups.
-		// The layout of the SBT is as follows: ray generation shader, miss
-		// shaders, hit groups.  SBT ͬĴС̶ stride.
-		
-		// Ray generation shader ǴSBTĿͷ
-		uint32_t rayGenerationSectionSizeInBytes = m_sbtHelper.GetRayGenSectionSize();
-		desc.RayGenerationShaderRecord.StartAddress = m_sbtStorage->GetGPUVirtualAddress();
-		desc.RayGenerationShaderRecord.SizeInBytes = rayGenerationSectionSizeInBytes;
-
-		// Miss shaders  SBTĵڶ֣ generation shaderһ miss shader 
-		// camera rays һ shadow rays. ˣҪ 2*m_sbtEntrySize Сͬʱ
-		// ָ miss shaders  strideһ SBT entry
-		uint32_t missSectionSizeInBytes = m_sbtHelper.GetMissSectionSize();
-		desc.MissShaderTable.StartAddress = m_sbtStorage->GetGPUVirtualAddress() + rayGenerationSectionSizeInBytes;
-		desc.MissShaderTable.SizeInBytes = missSectionSizeInBytes;
-		desc.MissShaderTable.StrideInBytes = m_sbtHelper.GetMissEntrySize();
-
-		// Hit groups  miss shaders ʼ. һ hit group  triangle
-		uint32_t hitGroupsSectionSize = m_sbtHelper.GetHitGroupSectionSize();
-		desc.HitGroupTable.StartAddress = m_sbtStorage->GetGPUVirtualAddress() + rayGenerationSectionSizeInBytes + missSectionSizeInBytes;
-		desc.HitGroupTable.SizeInBytes = hitGroupsSectionSize;
-		desc.HitGroupTable.StrideInBytes = m_sbtHelper.GetHitGroupEntrySize();
-
-		// ȾͼƬά, ͬںά
-		desc.Width = GetWidth();
-		desc.Height = GetHeight();
-		desc.Depth = 1;
-
-		// 󶨹׷
-		m_commandList->SetPipelineState1(m_rtStateObject.Get());
-		// ׷
-		m_commandList->DispatchRays(&desc);
-
-		// ׷ҪƵʵʾȾĿꡣΪˣҪ׷һ UAV ת
-		// һԴȾĿ껺嵽յ㡣ǄwתȾĿ껺嵽ȾĿǰִиơ
-		transition = CD3DX12_RESOURCE_BARRIER::Transition(m_outputResource.Get(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COPY_SOURCE);
-		m_commandList->ResourceBarrier(1, &transition);
-		transition = CD3DX12_RESOURCE_BARRIER::Transition(m_renderTargets[m_frameIndex].Get(), D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_COPY_DEST);
-		m_commandList->ResourceBarrier(1, &transition);
-		m_commandList->CopyResource(m_renderTargets[m_frameIndex].Get(), m_outputResource.Get());
-		transition = CD3DX12_RESOURCE_BARRIER::Transition(m_renderTargets[m_frameIndex].Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_RENDER_TARGET);
-		m_commandList->ResourceBarrier(1, &transition);
+		const auto& instance = m_scene.instances[i];
+		if (instance.meshIndex >= m_sceneVertexBuffers.size() || !m_sceneVertexBuffers[instance.meshIndex])
+			continue;
+		const auto& mesh = m_scene.meshes[instance.meshIndex];
+		D3D12_VERTEX_BUFFER_VIEW vertexBufferView;
+		vertexBufferView.BufferLocation = m_sceneVertexBuffers[instance.meshIndex]->GetGPUVirtualAddress();
+		vertexBufferView.StrideInBytes = m_vertexLayout.GetStride();
+		vertexBufferView.SizeInBytes = static_cast<UINT>(mesh.vertices.size() * m_vertexLayout.GetStride());
+		// # DXR Extra: Levels of detail
+		const UINT lod = m_instanceLods.empty() ? 0 : m_instanceLods[i];
+		ID3D12Resource* indexBuffer = lod == 0 ? m_sceneIndexBuffers[instance.meshIndex].Get() : m_sceneLodIndexBuffers[instance.meshIndex][lod - 1].Get();
+		D3D12_INDEX_BUFFER_VIEW indexBufferView;
+		indexBufferView.BufferLocation = indexBuffer->GetGPUVirtualAddress();
+		indexBufferView.Format = GetIndexFormat(indexBuffer);
+		indexBufferView.SizeInBytes = static_cast<UINT>(indexBuffer->GetDesc().Width);
+		const size_t indexCount = lod == 0 ? mesh.indices.size() : m_sceneLods[instance.meshIndex].lods[lod].indices.size();
+		addDraw(vertexBufferView, indexBufferView, static_cast<UINT>(indexCount), m_sceneDecodes[instance.meshIndex], instance.transform);
 	}
+	// #DXR Extra: Per-Instance Data
+	// ׷ƣӻƽ
+	addDraw(m_planeBufferView, m_planeIndexBufferView, m_planeIndexCount, m_planeDecode, identity);
+}
 
-	// Indicate that the back buffer will now be used to present.
-	m_commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(m_renderTargets[m_frameIndex].Get(), D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT));
+//---RunRecordingBenchmark------------------------------------------------------
+//
+// Record frames of draws with the mock backend and an increasing number of workers, and report
+// the recording throughput
+//
+void D3D12HelloTriangle::RunRecordingBenchmark() {
+	for (UINT workerCount = 1; workerCount <= kMaxRecordingWorkers; workerCount *= 2)
+	{
+		const nv_helpers_dx12::CommandRecordingBenchmarkResult result = nv_helpers_dx12::RunCommandRecordingBenchmark(workerCount, 100000, 20);
+		OutputDebugStringA(("Recording benchmark, " + std::to_string(workerCount) + " workers: " +
+			std::to_string(result.GetDrawsPerSecond() / 1e6) + " M draws/s" +
+			(result.ordered ? "" : ", commands out of order") + "\n").c_str());
+	}
+}
 
-	ThrowIfFailed(m_commandList->Close());
+//---CommandListPool------------------------------------------------------------
+//
+// Backend of the command recorder, on top of the command lists of the pool and the command queue
+//
+void D3D12HelloTriangle::CommandListPool::Open(uint32_t list, uint32_t frameSlot)
+{
+	ID3D12CommandAllocator* allocator = allocators[list * FrameCount + frameSlot].Get();
+	ThrowIfFailed(allocator->Reset());
+	ThrowIfFailed(lists[list]->Reset(allocator, initialState));
+}
+
+void D3D12HelloTriangle::CommandListPool::Close(uint32_t list)
+{
+	ThrowIfFailed(lists[list]->Close());
 }
 
-void D3D12HelloTriangle::WaitForPreviousFrame()
+void D3D12HelloTriangle::CommandListPool::Execute(const uint32_t* order, uint32_t count)
 {
-	// WAITING FOR THE FRAME TO COMPLETE BEFORE CONTINUING IS NOT BEST PRACTICE.
-	// This is code implemented as such for simplicity. The D3D12HelloFrameBuffering
-	// sample illustrates how to use fences for efficient resource usage and to
-	// maximize GPU utilization.
-
-	// Signal and increment the fence value.
-	const UINT64 fence = m_fenceValue;
-	ThrowIfFailed(m_commandQueue->Signal(m_fence.Get(), fence));
-	m_fenceValue++;
-
-	// Wait until the previous frame is finished.
-	if (m_fence->GetCompletedValue() < fence)
+	executedLists.clear();
+	for (uint32_t i = 0; i < count; i++)
+		executedLists.push_back(lists[order[i]].Get());
+	queue->ExecuteCommandLists(count, executedLists.data());
+}
+
+// # DXR Extra: Async acceleration structure builds
+//---CreateAsyncBuilds----------------------------------------------------------
+//
+// Create the compute queue, its fence and command list, and the versions of the TLAS refitted on
+// it. Without -asynctlas, the TLAS built upon initialization is the only version
+//
+void D3D12HelloTriangle::CreateAsyncBuilds() {
+	m_topLevelASVersions = { m_topLevelASBuffers.pResult };
+	m_topLevelASInstanceDescs = { m_topLevelASBuffers.pInstanceDesc };
+	if (!m_asyncTopLevelAS)
+		return;
+
+	D3D12_COMMAND_QUEUE_DESC queueDesc = {};
+	queueDesc.Flags = D3D12_COMMAND_QUEUE_FLAG_NONE;
+	queueDesc.Type = D3D12_COMMAND_LIST_TYPE_COMPUTE;
+	ThrowIfFailed(m_device->CreateCommandQueue(&queueDesc, IID_PPV_ARGS(&m_computeQueue)));
+	ThrowIfFailed(m_device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&m_computeFence)));
+	m_computeQueueFence.queue = m_computeQueue.Get();
+	m_computeQueueFence.fence = m_computeFence.Get();
+	m_computeQueueFence.event = m_fenceEvent;
+	for (UINT n = 0; n < FrameCount; n++)
+		ThrowIfFailed(m_device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_COMPUTE, IID_PPV_ARGS(&m_computeAllocators[n])));
+	ThrowIfFailed(m_device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_COMPUTE, m_computeAllocators[0].Get(), nullptr,
+		IID_PPV_ARGS(&m_computeCommandList)));
+	ThrowIfFailed(m_computeCommandList->Close());
+
+	// The instance descriptors of a version are rewritten by the CPU when it is built again. With
+	// one version per frame in flight, the frame which traced the previous build of the version
+	// has completed once the frame pacer releases its slot, and that frame waited for the build
+	UINT64 scratchSize, resultSize, instanceDescsSize;
+	m_topLevelASGenerator.ComputeASBufferSizes(m_device.Get(), true, &scratchSize, &resultSize, &instanceDescsSize);
+	for (UINT version = 1; version < FrameCount; version++)
 	{
-		ThrowIfFailed(m_fence->SetEventOnCompletion(fence, m_fenceEvent));
-		WaitForSingleObject(m_fenceEvent, INFINITE);
+		m_topLevelASVersions.push_back(m_resourceAllocator->CreateBuffer(resultSize, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS,
+			D3D12_RESOURCE_STATE_RAYTRACING_ACCELERATION_STRUCTURE, nv_helpers_dx12::kDefaultHeapProps));
+		m_topLevelASInstanceDescs.push_back(m_resourceAllocator->CreateBuffer(instanceDescsSize, D3D12_RESOURCE_FLAG_NONE,
+			D3D12_RESOURCE_STATE_GENERIC_READ, nv_helpers_dx12::kUploadHeapProps));
 	}
+	m_asBuildScheduler = std::make_unique<nv_helpers_dx12::AsyncBuildScheduler>(FrameCount);
+}
 
-	m_frameIndex = m_swapChain->GetCurrentBackBufferIndex();
+//---BuildTopLevelASAsync-------------------------------------------------------
+//
+// Refit the next version of the TLAS from the latest one on the compute queue, after the direct
+// queue is done with the frame which last traced that version. The scratch buffer is shared by
+// the builds, which the compute queue executes one after the other
+//
+void D3D12HelloTriangle::BuildTopLevelASAsync() {
+	const nv_helpers_dx12::AsyncBuildScheduler::Build build =
+		m_asBuildScheduler->BeginBuild(m_asBuildScheduler->GetLatestVersion() != nv_helpers_dx12::AsyncBuildScheduler::kNoVersion);
+	if (build.directWaitValue)
+		ThrowIfFailed(m_computeQueue->Wait(m_fence.Get(), build.directWaitValue));
+
+	ID3D12CommandAllocator* allocator = m_computeAllocators[m_framePacer->GetFrameSlot()].Get();
+	ThrowIfFailed(allocator->Reset());
+	ThrowIfFailed(m_computeCommandList->Reset(allocator, nullptr));
+	const bool refit = build.sourceVersion != nv_helpers_dx12::AsyncBuildScheduler::kNoVersion;
+	m_topLevelASGenerator.Generate(
+		m_computeCommandList.Get(),
+		m_topLevelASBuffers.pScratch.Get(),
+		m_topLevelASVersions[build.version].Get(),
+		m_topLevelASInstanceDescs[build.version].Get(),
+		refit,
+		refit ? m_topLevelASVersions[build.sourceVersion].Get() : nullptr);
+	ThrowIfFailed(m_computeCommandList->Close());
+	ID3D12CommandList* ppCommandLists[] = { m_computeCommandList.Get() };
+	m_computeQueue->ExecuteCommandLists(1, ppCommandLists);
+	m_asBuildScheduler->EndBuild(m_computeQueueFence.Signal());
+}
+
+//---RunAsyncBuildSimulation----------------------------------------------------
+//
+// Simulate frames whose TLAS build takes a fraction of the rendering, serialized with it on the
+// direct queue or scheduled on the compute queue, and report the frame times and the overlap
+//
+void D3D12HelloTriangle::RunAsyncBuildSimulation() {
+	const double renderDuration = 1.;
+	const double buildFractions[] = { 0.25, 1., 1.5 };
+	for (double buildFraction : buildFractions)
+	{
+		const double buildDuration = buildFraction * renderDuration;
+		const nv_helpers_dx12::AsyncBuildSimulationResult serial =
+			nv_helpers_dx12::RunAsyncBuildSimulation(100, buildDuration, renderDuration, FrameCount, false);
+		OutputDebugStringA(("Async build simulation, build of " + std::to_string(buildFraction) + " frame: serial frame time " +
+			std::to_string(serial.GetFrameTime()) + "\n").c_str());
+		for (uint32_t versionCount = 1; versionCount <= FrameCount; versionCount++)
+		{
+			const nv_helpers_dx12::AsyncBuildSimulationResult async =
+				nv_helpers_dx12::RunAsyncBuildSimulation(100, buildDuration, renderDuration, versionCount, true);
+			OutputDebugStringA(("Async build simulation, build of " + std::to_string(buildFraction) + " frame, " +
+				std::to_string(versionCount) + " versions: frame time " + std::to_string(async.GetFrameTime()) + ", " +
+				std::to_string(100. * async.GetOverlapRate()) + "% of the builds overlapped\n").c_str());
+		}
+	}
+}
+
+// # DXR Extra: Deferred release
+//---DeferRelease---------------------------------------------------------------
+//
+// Stop using a resource from the current frame on, and release it once the GPU completes the
+// frame. Placed buffers return their range to the heap at that point only
+//
+void D3D12HelloTriangle::DeferRelease(ComPtr<ID3D12Resource>& resource) {
+	m_stateTracker.Unregister(resource.Get());
+	ComPtr<ID3D12Resource> released = resource;
+	resource.Reset();
+	m_deferredReleases.Release([this, released]() { m_resourceAllocator->Free(released.Get()); });
+}
+
+// # DXR Extra: Staging uploads
+//---CreateUploadBatcher--------------------------------------------------------
+//
+// Create the staging buffer, persistently mapped, and the command list and fence of the batches
+//
+void D3D12HelloTriangle::CreateUploadBatcher() {
+	m_stagingBuffer = m_resourceAllocator->CreateBuffer(kStagingBufferSize, D3D12_RESOURCE_FLAG_NONE,
+		D3D12_RESOURCE_STATE_GENERIC_READ, nv_helpers_dx12::kUploadHeapProps);
+	m_stagingUploads.stagingBuffer = m_stagingBuffer.Get();
+	ThrowIfFailed(m_stagingBuffer->Map(0, nullptr, reinterpret_cast<void**>(&m_stagingUploads.stagingData)));
+
+	for (UINT n = 0; n < FrameCount; n++)
+		ThrowIfFailed(m_device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&m_stagingUploads.allocators[n])));
+	ThrowIfFailed(m_device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, m_stagingUploads.allocators[0].Get(), nullptr,
+		IID_PPV_ARGS(&m_stagingUploads.commandList)));
+	ThrowIfFailed(m_stagingUploads.commandList->Close());
+
+	ThrowIfFailed(m_device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&m_uploadFence)));
+	m_stagingUploads.fence.queue = m_commandQueue.Get();
+	m_stagingUploads.fence.fence = m_uploadFence.Get();
+	m_stagingUploads.fence.event = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+	if (m_stagingUploads.fence.event == nullptr)
+		ThrowIfFailed(HRESULT_FROM_WIN32(GetLastError()));
+	m_uploadBatcher = std::make_unique<nv_helpers_dx12::UploadBatcher>(&m_stagingUploads, kStagingBufferSize);
+}
+
+//---FinishStaticUploads--------------------------------------------------------
+//
+// Wait for the last batches, report how the uploads were batched, and release the staging buffer
+//
+void D3D12HelloTriangle::FinishStaticUploads() {
+	m_uploadBatcher->WaitForAll();
+	const nv_helpers_dx12::UploadBatchStatistics& statistics = m_uploadBatcher->GetStatistics();
+	OutputDebugStringA(("Staging uploads: " + std::to_string(statistics.uploadCount) + " buffers, " +
+		std::to_string(statistics.uploadedBytes / 1024) + " KB in " + std::to_string(statistics.batchCount) + " batches of " +
+		std::to_string(statistics.GetCopiesPerBatch()) + " copies, " + std::to_string(m_uploadBatcher->GetPeakStagingSize() / 1024) +
+		" KB of staging memory at most, " + std::to_string(statistics.stallCount) + " waits for the GPU\n").c_str());
+	m_uploadBatcher.reset();
+
+	m_stagingBuffer->Unmap(0, nullptr);
+	m_resourceAllocator->Free(m_stagingBuffer.Get());
+	m_stagingBuffer.Reset();
+	m_stagingUploads.stagingBuffer = nullptr;
+	m_stagingUploads.stagingData = nullptr;
+	CloseHandle(m_stagingUploads.fence.event);
+	m_stagingUploads.fence.event = nullptr;
+}
+
+//---StagingUploadQueue---------------------------------------------------------
+//
+// Backend of the upload batcher, on top of the staging buffer and the command queue. The
+// destinations leave the copy state once their last copy is done, for the states of static
+// geometry: vertex and index buffer, and input of the AS builds and of the hit shaders
+//
+void D3D12HelloTriangle::StagingUploadQueue::WriteStaging(uint64_t stagingOffset, const void* data, uint64_t size)
+{
+	memcpy(stagingData + stagingOffset, data, size);
+}
+
+uint64_t D3D12HelloTriangle::StagingUploadQueue::Submit(const nv_helpers_dx12::UploadCopy* copies, uint32_t count)
+{
+	const D3D12_RESOURCE_STATES staticState = D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER |
+		D3D12_RESOURCE_STATE_INDEX_BUFFER | D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE;
+	const UINT64 n = batchCount++ % FrameCount;
+	fence.Wait(allocatorFenceValues[n]);
+	ThrowIfFailed(allocators[n]->Reset());
+	ThrowIfFailed(commandList->Reset(allocators[n].Get(), nullptr));
+	barriers.clear();
+	for (uint32_t i = 0; i < count; i++)
+	{
+		ID3D12Resource* destination = static_cast<ID3D12Resource*>(copies[i].destination);
+		commandList->CopyBufferRegion(destination, copies[i].destinationOffset, stagingBuffer, copies[i].stagingOffset, copies[i].size);
+		if (copies[i].last)
+			barriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition(destination, D3D12_RESOURCE_STATE_COPY_DEST, staticState));
+	}
+	if (!barriers.empty())
+		commandList->ResourceBarrier(static_cast<UINT>(barriers.size()), barriers.data());
+	ThrowIfFailed(commandList->Close());
+	ID3D12CommandList* ppCommandLists[] = { commandList.Get() };
+	fence.queue->ExecuteCommandLists(1, ppCommandLists);
+	allocatorFenceValues[n] = fence.Signal();
+	return allocatorFenceValues[n];
+}
+
+// # DXR Extra: Parallel shader compilation
+//---CompileShaders-------------------------------------------------------------
+//
+// Submit all the shaders of the application. The cache directory is relative to the working
+// directory, like the DXIL library sources
+//
+void D3D12HelloTriangle::CompileShaders() {
+	m_shaderCache = std::make_unique<nv_helpers_dx12::ShaderCache>(nullptr,
+		m_useShaderCache ? kShaderCacheDirectory : "");
+	m_shaderCompileQueue = std::make_unique<nv_helpers_dx12::ShaderCompileQueue>(m_shaderCache.get(),
+		[]() { return std::unique_ptr<nv_helpers_dx12::ShaderCache::Compiler>(new ShaderCompiler()); },
+		m_shaderWorkerCount);
+
+	// The libraries are the longest to compile, and are submitted first
+	m_rayGenLibrary = m_shaderCompileQueue->Submit("RayGen.hlsl", "", "lib_6_3");
+	m_missLibrary = m_shaderCompileQueue->Submit("Miss.hlsl", "", "lib_6_3");
+	m_hitLibrary = m_shaderCompileQueue->Submit("Hit.hlsl", "", "lib_6_3");
+
+#if defined(_DEBUG)
+	// Enable better shader debugging with the graphics debugging tools.
+	UINT compileFlags = D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
+#else
+	UINT compileFlags = 0;
+#endif
+	const std::wstring shaderPath = GetAssetFullPath(L"shaders.hlsl");
+	const std::string shaderFile(shaderPath.begin(), shaderPath.end());
+	m_vertexShader = m_shaderCompileQueue->Submit(shaderFile, "VSMain", "vs_5_0", compileFlags);
+	m_pixelShader = m_shaderCompileQueue->Submit(shaderFile, "PSMain", "ps_5_0", compileFlags);
+}
+
+//---RunShaderCompileBenchmark--------------------------------------------------
+//
+// Compile as many mock shaders as the application has, and a larger set, with a latency of the
+// order of a DXIL library compilation
+//
+void D3D12HelloTriangle::RunShaderCompileBenchmark() {
+	const uint32_t taskCounts[] = { 5, 64 };
+	for (uint32_t taskCount : taskCounts)
+	{
+		for (uint32_t workerCount = 1; workerCount <= nv_helpers_dx12::GetWorkerCount(); workerCount *= 2)
+		{
+			const nv_helpers_dx12::ShaderCompileBenchmarkResult result =
+				nv_helpers_dx12::RunShaderCompileBenchmark(workerCount, taskCount, 0.05);
+			OutputDebugStringA(("Shader compile benchmark, " + std::to_string(taskCount) + " shaders, " +
+				std::to_string(result.workerCount) + " workers: " + std::to_string(result.seconds * 1000.) + " ms, speedup " +
+				std::to_string(result.GetSpeedup()) + ", " + std::to_string(result.peakRunningCount) + " at once" +
+				(result.matched ? "" : ", MISMATCHED RESULTS") + "\n").c_str());
+		}
+	}
+}
+
+// # DXR Extra: Shader cache
+//---ReportShaderCache----------------------------------------------------------
+//
+// On a warm start every shader is a hit, and the saved time is the compilation time recorded when
+// the entries were stored
+//
+void D3D12HelloTriangle::ReportShaderCache() {
+	const nv_helpers_dx12::ShaderCacheStatistics stats = m_shaderCache->GetStatistics();
+	OutputDebugStringA(("Shader cache: " + std::to_string(stats.hitCount) + " hits, " +
+		std::to_string(stats.missCount) + " compiled in " + std::to_string(stats.compileSeconds * 1000.) + " ms, " +
+		std::to_string(stats.loadSeconds * 1000.) + " ms loading, " +
+		std::to_string(stats.savedSeconds * 1000.) + " ms of startup saved\n").c_str());
+	if (stats.storeFailureCount > 0)
+		OutputDebugStringA(("Shader cache: " + std::to_string(stats.storeFailureCount) + " entries could not be written to " +
+			kShaderCacheDirectory + "\n").c_str());
+
+	// # DXR Extra: Parallel shader compilation
+	const nv_helpers_dx12::ShaderCompileStatistics compileStats = m_shaderCompileQueue->GetStatistics();
+	OutputDebugStringA(("Shader compilation: " + std::to_string(compileStats.taskCount) + " shaders on " +
+		std::to_string(m_shaderCompileQueue->GetWorkerCount()) + " workers in " + std::to_string(compileStats.elapsedSeconds * 1000.) +
+		" ms, " + std::to_string(compileStats.GetParallelism()) + " at once on average\n").c_str());
+}
+
+// # DXR Extra: Pipeline cache
+//---DescribeGraphicsPipeline---------------------------------------------------
+//
+// Every field of the pipeline state is part of the description. The rasterizer state is made of
+// 32-bit fields and is described by its bytes, while the blend and depth-stencil states have
+// 8-bit fields followed by padding, and are described field by field
+//
+nv_helpers_dx12::PipelineDescription D3D12HelloTriangle::DescribeGraphicsPipeline(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& psoDesc) {
+	nv_helpers_dx12::PipelineDescription description("graphics");
+	description.AddValue("rootSignature", nv_helpers_dx12::RootSignatureGenerator::GetKey(psoDesc.pRootSignature));
+	const std::pair<const char*, D3D12_SHADER_BYTECODE> shaders[] = {
+		{ "vs", psoDesc.VS }, { "ps", psoDesc.PS }, { "ds", psoDesc.DS }, { "hs", psoDesc.HS }, { "gs", psoDesc.GS } };
+	for (const auto& shader : shaders)
+	{
+		if (shader.second.BytecodeLength > 0)
+			description.AddBytes(shader.first, shader.second.pShaderBytecode, shader.second.BytecodeLength);
+	}
+	description.AddValue("streamOutputEntries", psoDesc.StreamOutput.NumEntries);
+
+	for (UINT i = 0; i < psoDesc.InputLayout.NumElements; i++)
+	{
+		const D3D12_INPUT_ELEMENT_DESC& element = psoDesc.InputLayout.pInputElementDescs[i];
+		description.AddValue("input" + std::to_string(i), std::string(element.SemanticName) + " " +
+			std::to_string(element.SemanticIndex) + " " + std::to_string(element.Format) + " " +
+			std::to_string(element.InputSlot) + " " + std::to_string(element.AlignedByteOffset) + " " +
+			std::to_string(element.InputSlotClass) + " " + std::to_string(element.InstanceDataStepRate));
+	}
+
+	description.AddBytes("rasterizer", &psoDesc.RasterizerState, sizeof(psoDesc.RasterizerState));
+	description.AddValue("alphaToCoverage", psoDesc.BlendState.AlphaToCoverageEnable);
+	description.AddValue("independentBlend", psoDesc.BlendState.IndependentBlendEnable);
+	for (UINT i = 0; i < D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT; i++)
+	{
+		const D3D12_RENDER_TARGET_BLEND_DESC& blend = psoDesc.BlendState.RenderTarget[i];
+		description.AddValue("blend" + std::to_string(i), std::to_string(blend.BlendEnable) + " " +
+			std::to_string(blend.LogicOpEnable) + " " + std::to_string(blend.SrcBlend) + " " +
+			std::to_string(blend.DestBlend) + " " + std::to_string(blend.BlendOp) + " " +
+			std::to_string(blend.SrcBlendAlpha) + " " + std::to_string(blend.DestBlendAlpha) + " " +
+			std::to_string(blend.BlendOpAlpha) + " " + std::to_string(blend.LogicOp) + " " +
+			std::to_string(blend.RenderTargetWriteMask));
+		description.AddValue("rtvFormat" + std::to_string(i), psoDesc.RTVFormats[i]);
+	}
+
+	const D3D12_DEPTH_STENCIL_DESC& depthStencil = psoDesc.DepthStencilState;
+	const auto describeFace = [](const D3D12_DEPTH_STENCILOP_DESC& face) {
+		return std::to_string(face.StencilFailOp) + " " + std::to_string(face.StencilDepthFailOp) + " " +
+			std::to_string(face.StencilPassOp) + " " + std::to_string(face.StencilFunc);
+	};
+	description.AddValue("depth", std::to_string(depthStencil.DepthEnable) + " " +
+		std::to_string(depthStencil.DepthWriteMask) + " " + std::to_string(depthStencil.DepthFunc));
+	description.AddValue("stencil", std::to_string(depthStencil.StencilEnable) + " " +
+		std::to_string(depthStencil.StencilReadMask) + " " + std::to_string(depthStencil.StencilWriteMask));
+	description.AddValue("stencilFrontFace", describeFace(depthStencil.FrontFace));
+	description.AddValue("stencilBackFace", describeFace(depthStencil.BackFace));
+
+	description.AddValue("sampleMask", psoDesc.SampleMask);
+	description.AddValue("stripCut", psoDesc.IBStripCutValue);
+	description.AddValue("topology", psoDesc.PrimitiveTopologyType);
+	description.AddValue("renderTargets", psoDesc.NumRenderTargets);
+	description.AddValue("dsvFormat", psoDesc.DSVFormat);
+	description.AddValue("sampleCount", psoDesc.SampleDesc.Count);
+	description.AddValue("sampleQuality", psoDesc.SampleDesc.Quality);
+	description.AddValue("nodeMask", psoDesc.NodeMask);
+	description.AddValue("flags", psoDesc.Flags);
+	return description;
+}
+
+//---CreateCachedPipelineState--------------------------------------------------
+//
+// A cached blob is only valid for the adapter and driver which created it. If the creation from
+// the blob fails, the entry is rejected and the pipeline state is created from scratch, and its new
+// blob stored
+//
+ComPtr<ID3D12PipelineState> D3D12HelloTriangle::CreateCachedPipelineState(D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDesc) {
+	const auto start = std::chrono::steady_clock::now();
+	const nv_helpers_dx12::PipelineDescription description = DescribeGraphicsPipeline(psoDesc);
+	ComPtr<ID3D12PipelineState> pipelineState;
+	std::vector<uint8_t> blob;
+	bool fromCache = false;
+	if (m_pipelineCache->Find(description, &blob) && !blob.empty())
+	{
+		psoDesc.CachedPSO = { blob.data(), blob.size() };
+		fromCache = SUCCEEDED(m_device->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&pipelineState)));
+		if (!fromCache)
+			m_pipelineCache->Reject(description);
+		psoDesc.CachedPSO = {};
+	}
+	if (!fromCache)
+	{
+		ThrowIfFailed(m_device->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&pipelineState)));
+		ComPtr<ID3DBlob> cachedBlob;
+		if (m_pipelineCache->IsEnabled() && SUCCEEDED(pipelineState->GetCachedBlob(&cachedBlob)))
+		{
+			const uint8_t* data = static_cast<const uint8_t*>(cachedBlob->GetBufferPointer());
+			m_pipelineCache->Store(description, std::vector<uint8_t>(data, data + cachedBlob->GetBufferSize()));
+		}
+	}
+	const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	OutputDebugStringA(("Pipeline cache: graphics pipeline " + description.GetKey() +
+		(fromCache ? " created from its cached blob in " : " created from scratch in ") +
+		std::to_string(seconds * 1000.) + " ms\n").c_str());
+	return pipelineState;
+}
+
+//---ReportPipelineCache--------------------------------------------------------
+//
+// A blob rejected by the driver is replaced by the one of the new pipeline state, hence the
+// rejections only happen on the first launch after a driver update
+//
+void D3D12HelloTriangle::ReportPipelineCache() {
+	const nv_helpers_dx12::PipelineCacheStatistics& stats = m_pipelineCache->GetStatistics();
+	OutputDebugStringA(("Pipeline cache: " + std::to_string(stats.hitCount) + " hits, " +
+		std::to_string(stats.missCount) + " misses, " + std::to_string(stats.rejectedCount) +
+		" cached blobs rejected by the driver\n").c_str());
+	if (stats.storeFailureCount > 0)
+		OutputDebugStringA(("Pipeline cache: " + std::to_string(stats.storeFailureCount) + " entries could not be written to " +
+			kPipelineCacheDirectory + "\n").c_str());
+}
+
+//---ShaderCompiler-------------------------------------------------------------
+//
+// Compiler of the shader cache. The library targets go to DXC, the others to D3DCompile, and both
+// compilers are part of the version, so that updating either of them invalidates the cache
+//
+void D3D12HelloTriangle::ShaderCompiler::CreateDxc()
+{
+	if (dxcCompiler)
+		return;
+	ThrowIfFailed(DxcCreateInstance(CLSID_DxcCompiler, IID_PPV_ARGS(&dxcCompiler)));
+	ThrowIfFailed(DxcCreateInstance(CLSID_DxcLibrary, IID_PPV_ARGS(&dxcLibrary)));
+	ThrowIfFailed(dxcLibrary->CreateIncludeHandler(&dxcIncludeHandler));
+}
+
+std::string D3D12HelloTriangle::ShaderCompiler::GetVersion()
+{
+	if (version.empty())
+	{
+		ComPtr<IDxcVersionInfo> versionInfo;
+		UINT32 major = 0, minor = 0;
+		CreateDxc();
+		if (SUCCEEDED(dxcCompiler.As(&versionInfo)))
+			ThrowIfFailed(versionInfo->GetVersion(&major, &minor));
+		version = "dxc " + std::to_string(major) + "." + std::to_string(minor) +
+			", d3dcompiler " + std::to_string(D3D_COMPILER_VERSION);
+	}
+	return version;
+}
+
+bool D3D12HelloTriangle::ShaderCompiler::Compile(const std::string& fileName, const std::string& entryPoint,
+	const std::string& target, uint32_t flags, std::vector<uint8_t>* bytecode, std::string* errors)
+{
+	const std::wstring path(fileName.begin(), fileName.end());
+	if (target.compare(0, 4, "lib_") == 0)
+	{
+		// The libraries are compiled for lib_6_3 without flags
+		CreateDxc();
+		ComPtr<IDxcBlob> library;
+		library.Attach(nv_helpers_dx12::CompileShaderLibrary(dxcCompiler.Get(), dxcLibrary.Get(), dxcIncludeHandler.Get(),
+			path.c_str(), errors));
+		if (!library)
+			return false;
+		const uint8_t* data = static_cast<const uint8_t*>(library->GetBufferPointer());
+		bytecode->assign(data, data + library->GetBufferSize());
+		return true;
+	}
+
+	ComPtr<ID3DBlob> shader;
+	ComPtr<ID3DBlob> error;
+	if (FAILED(D3DCompileFromFile(path.c_str(), nullptr, nullptr, entryPoint.c_str(), target.c_str(), flags, 0, &shader, &error)))
+	{
+		if (error)
+			errors->assign(static_cast<const char*>(error->GetBufferPointer()), error->GetBufferSize());
+		return false;
+	}
+	const uint8_t* data = static_cast<const uint8_t*>(shader->GetBufferPointer());
+	bytecode->assign(data, data + shader->GetBufferSize());
+	return true;
 }
 
 //----- Raytracing -------
@@ -495,6 +1446,14 @@ void D3D12HelloTriangle::OnKeyUp(UINT8 key)
 	{
 		m_raster = !m_raster;
 	}
+	// # DXR Extra: Deferred release
+	// Rebuild the shader binding table, while the frames in flight still read the previous one
+	if (key == 'B')
+	{
+		CreateShaderBindingTable();
+		OutputDebugStringA(("Deferred release: " + std::to_string(m_deferredReleases.GetPendingCount()) +
+			" resources waiting for the GPU\n").c_str());
+	}
 }
 
 // ## Acceleration Structure
@@ -540,8 +1499,43 @@ D3D12HelloTriangle::AccelerationStructureBuffers D3D12HelloTriangle::CreateBotto
 	std::vector<std::pair<ComPtr<ID3D12Resource>, uint32_t>> vVertexBuffers, 
 	std::vector<std::pair<ComPtr<ID3D12Resource>, uint32_t>> vIndexBuffers) {
 
+	// # DXR Extra: Geometry deduplication
+	// Identify the geometry by the content hashes of its buffers, computed upon upload. Buffers
+	// without a registered hash are identified by their address, so that they are shared with the
+	// exact same buffers only, barring a content hash equal to that address. As the contents are
+	// not compared, two different buffers with equal 64-bit hashes would also be shared, which is
+	// improbable. If an identical geometry has already been built, its BLAS is simply returned and
+	// will be referenced by another instance of the TLAS
+	auto contentHash = [this](ID3D12Resource* resource) {
+		auto hash = m_geometryHashes.find(resource);
+		return hash != m_geometryHashes.end() ? hash->second : reinterpret_cast<uint64_t>(resource);
+	};
+	nv_helpers_dx12::GeometryDeduplicator::Key key;
+	uint64_t primitiveCount = 0;
+	for (size_t i = 0; i < vVertexBuffers.size(); i++)
+	{
+		const bool indexed = i < vIndexBuffers.size() && vIndexBuffers[i].second > 0;
+		key.AddGeometry(
+			contentHash(vVertexBuffers[i].first.Get()), vVertexBuffers[i].second, m_vertexLayout.GetStride(),
+			indexed ? contentHash(vIndexBuffers[i].first.Get()) : 0, indexed ? vIndexBuffers[i].second : 0,
+			D3D12_RAYTRACING_GEOMETRY_FLAG_OPAQUE, GetPositionFormat(), indexed ? GetIndexFormat(vIndexBuffers[i].first.Get()) : 0);
+		primitiveCount += (indexed ? vIndexBuffers[i].second : vVertexBuffers[i].second) / 3;
+	}
+	key.AddBuildFlags(D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_NONE);
+
+	size_t blasIndex = 0;
+	if (m_blasDeduplicator.Find(key, &blasIndex))
+	{
+		AccelerationStructureBuffers buffers;
+		buffers.pResult = m_uniqueBottomLevelAS[blasIndex];
+		return buffers;
+	}
+
 	nv_helpers_dx12::BottomLevelASGenerator bottomLevelAS; 
 	// Adding all vertex buffers and not transforming their position. 
+	// # DXR Extra: Compact vertex formats
+	// The vertices are read in the selected layout, the decoding of the normalized positions being
+	// left to the instance transforms
 	for (size_t i = 0; i < vVertexBuffers.size(); i++)
 	{ // 
 		for (const auto& buffer : vVertexBuffers) {
@@ -550,13 +1544,14 @@ D3D12HelloTriangle::AccelerationStructureBuffers D3D12HelloTriangle::CreateBotto
 					vVertexBuffers[i].first.Get(),
 					0,
 					vVertexBuffers[i].second,
-					sizeof(Vertex),
+					m_vertexLayout.GetStride(),
 					vIndexBuffers[i].first.Get(),
 					0,
 					vIndexBuffers[i].second,
-					nullptr, 0, true);
+					nullptr, 0, true, GetPositionFormat(), GetIndexFormat(vIndexBuffers[i].first.Get()));
 			else
-				bottomLevelAS.AddVertexBuffer(vVertexBuffers[i].first.Get(), 0, vVertexBuffers[i].second, sizeof(Vertex), 0, 0);
+				bottomLevelAS.AddVertexBuffer(vVertexBuffers[i].first.Get(), 0, vVertexBuffers[i].second, m_vertexLayout.GetStride(), 0, 0,
+					true, GetPositionFormat());
 		}
 	}
 	/*
@@ -576,15 +1571,65 @@ D3D12HelloTriangle::AccelerationStructureBuffers D3D12HelloTriangle::CreateBotto
 	// the necessary buffers. Since the entire generation will be done on the GPU, 
 	// we can directly allocate those on the default heap
 	AccelerationStructureBuffers buffers;
-	buffers.pScratch = nv_helpers_dx12::CreateBuffer(m_device.Get(), scratchSizeInBytes, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COMMON, nv_helpers_dx12::kDefaultHeapProps); 
-	buffers.pResult = nv_helpers_dx12::CreateBuffer(m_device.Get(), resultSizeInBytes, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_RAYTRACING_ACCELERATION_STRUCTURE, nv_helpers_dx12::kDefaultHeapProps); 
-	// Build the acceleration structure. Note that this call integrates a barrier 
-	// on the generated AS, so that it can be used to compute a top-level AS right 
-	// after this method. 
-	bottomLevelAS.Generate(m_commandList.Get(), buffers.pScratch.Get(), buffers.pResult.Get(), false, nullptr);
+	buffers.pResult = m_resourceAllocator->CreateBuffer(resultSizeInBytes, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_RAYTRACING_ACCELERATION_STRUCTURE, nv_helpers_dx12::kDefaultHeapProps); 
+	// # DXR Extra: Batched BLAS builds
+	// The scratch space is not allocated here: the build is queued, and recorded along with the
+	// other BLAS builds by BuildPendingBottomLevelAS, which suballocates the scratch memory of all
+	// the builds from a single pool
+	m_pendingBottomLevelAS.push_back({ std::move(bottomLevelAS), buffers.pResult, scratchSizeInBytes });
+
+	// # DXR Extra: Geometry deduplication
+	m_blasDeduplicator.Register(key, m_uniqueBottomLevelAS.size(), resultSizeInBytes, scratchSizeInBytes, primitiveCount);
+	m_uniqueBottomLevelAS.push_back(buffers.pResult);
 	return buffers;
 }
 
+// # DXR Extra: Batched BLAS builds
+//---BuildPendingBottomLevelAS--------------------------------------------------
+//
+// Record all the BLAS builds queued by CreateBottomLevelAS. Creating one scratch buffer per BLAS
+// makes the scratch memory grow linearly with the number of meshes. Instead, the builds are packed
+// by ASBuildScheduler into batches: the builds of a batch use disjoint ranges of a single scratch
+// pool, and a UAV barrier after each batch allows the next one to reuse the same ranges. The pool
+// only exceeds m_blasScratchBudget to fit a single BLAS needing more scratch memory, which is then
+// built in a batch of its own.
+//
+ComPtr<ID3D12Resource> D3D12HelloTriangle::BuildPendingBottomLevelAS() {
+	if (m_pendingBottomLevelAS.empty())
+		return nullptr;
+
+	nv_helpers_dx12::ASBuildScheduler scheduler(m_blasScratchBudget, D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BYTE_ALIGNMENT);
+	for (const auto& blas : m_pendingBottomLevelAS)
+		scheduler.AddBuild(blas.scratchSizeInBytes);
+	scheduler.Schedule();
+
+	ComPtr<ID3D12Resource> scratchPool = nv_helpers_dx12::CreateBuffer(m_device.Get(), scheduler.GetScratchPoolSize(), D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COMMON, nv_helpers_dx12::kDefaultHeapProps);
+
+	// Records the scheduled builds on the command list. A single global UAV barrier per batch covers
+	// both the reuse of the scratch pool and the results consumed by the next builds
+	struct CommandListRecorder : public nv_helpers_dx12::ASBuildScheduler::Recorder {
+		ID3D12GraphicsCommandList4* commandList;
+		ID3D12Resource* scratchPool;
+		std::vector<PendingBottomLevelAS>* pending;
+
+		void RecordBuild(size_t buildIndex, uint64_t scratchOffsetInBytes) override {
+			PendingBottomLevelAS& blas = (*pending)[buildIndex];
+			blas.generator.Generate(commandList, scratchPool, blas.pResult.Get(), false, nullptr, scratchOffsetInBytes, false);
+		}
+		void RecordBarrier() override {
+			CD3DX12_RESOURCE_BARRIER uavBarrier = CD3DX12_RESOURCE_BARRIER::UAV(nullptr);
+			commandList->ResourceBarrier(1, &uavBarrier);
+		}
+	} recorder;
+	recorder.commandList = m_commandList.Get();
+	recorder.scratchPool = scratchPool.Get();
+	recorder.pending = &m_pendingBottomLevelAS;
+	scheduler.Execute(recorder);
+
+	m_pendingBottomLevelAS.clear();
+	return scratchPool;
+}
+
 //---CreateTopLevelAS-----------------------------------------------------------
 // 
 // һҪٽṹгеʵ BLAS ƣͨɣ
@@ -640,8 +1685,7 @@ void D3D12HelloTriangle::CreateTopLevelAS(const std::vector<std::pair<ComPtr<ID3
 		D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS,
 		D3D12_RESOURCE_STATE_UNORDERED_ACCESS, 
 		nv_helpers_dx12::kDefaultHeapProps);
-	m_topLevelASBuffers.pResult = nv_helpers_dx12::CreateBuffer( 
-		m_device.Get(), 
+	m_topLevelASBuffers.pResult = m_resourceAllocator->CreateBuffer( 
 		resultSize, 
 		D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS, 
 		D3D12_RESOURCE_STATE_RAYTRACING_ACCELERATION_STRUCTURE, 
@@ -649,8 +1693,7 @@ void D3D12HelloTriangle::CreateTopLevelAS(const std::vector<std::pair<ComPtr<ID3
 	// The buffer describing the instances: ID, shader binding information, 
 	// matrices ... Those will be copied into the buffer by the helper through 
 	// mapping, so the buffer has to be allocated on the upload heap.
-	m_topLevelASBuffers.pInstanceDesc = nv_helpers_dx12::CreateBuffer( m_device.Get(), 
-		instanceDescsSize, 
+	m_topLevelASBuffers.pInstanceDesc = m_resourceAllocator->CreateBuffer(instanceDescsSize, 
 		D3D12_RESOURCE_FLAG_NONE, 
 		D3D12_RESOURCE_STATE_GENERIC_READ, 
 		nv_helpers_dx12::kUploadHeapProps); 
@@ -687,31 +1730,108 @@ void D3D12HelloTriangle::CreateAccelerationStructures() {
 	AccelerationStructureBuffers bottomLevelBuffers = CreateBottomLevelAS({{m_vertexBuffer.Get(), 4} }, { {m_indexBuffer.Get(), 12} });
 
 	//  plan vertex buffer  BLAS
-	AccelerationStructureBuffers planeBottomLevelBuffers = CreateBottomLevelAS({ {m_planeBuffer.Get(), 6} });
+	// # DXR Extra: Vertex welding
+	AccelerationStructureBuffers planeBottomLevelBuffers = CreateBottomLevelAS(
+		{ {m_planeBuffer.Get(), m_planeVertexCount} }, { {m_planeIndexBuffer.Get(), m_planeIndexCount} });
 
 	m_instances = { 
 		// # DXR Extraʵ
-		{bottomLevelBuffers.pResult, XMMatrixIdentity()}, 
+		{bottomLevelBuffers.pResult, GetDecodeMatrix(m_tetrahedronDecode) * XMMatrixIdentity()}, 
 		// DXR Extra: Index Geometry
 		// {bottomLevelBuffers.pResult, XMMatrixTranslation(.6f, 0, 0)}, 
 		// {bottomLevelBuffers.pResult, XMMatrixTranslation(-.6f, 0, 0)}, 
 		// # DXR Extraһƽʵ 
-		{planeBottomLevelBuffers.pResult, XMMatrixTranslation(0, 0, 0)}
+		{planeBottomLevelBuffers.pResult, GetDecodeMatrix(m_planeDecode) * XMMatrixTranslation(0, 0, 0)}
 	};
+
+	// # Benchmark scenes
+	// The generated scene replaces the tetrahedron: one BLAS per mesh, and one TLAS instance per
+	// scene instance, followed by the plane. The instance transforms are stored as 3x4 row-major
+	// matrices, while XMMATRIX uses the row-vector convention, hence the transposition
+	if (m_useGeneratedScene)
+	{
+		std::vector<ComPtr<ID3D12Resource>> sceneBLAS;
+		// # DXR Extra: glTF scenes
+		for (const auto& mesh : m_glb.GetMeshes())
+		{
+			sceneBLAS.push_back(mesh.primitives.empty() ? nullptr : CreateGlbBottomLevelAS(mesh));
+		}
+		for (size_t i = 0; i < m_scene.meshes.size(); i++)
+		{
+			if (!m_sceneVertexBuffers[i])
+			{
+				sceneBLAS.push_back(nullptr);
+				continue;
+			}
+			sceneBLAS.push_back(CreateBottomLevelAS(
+				{ {m_sceneVertexBuffers[i], static_cast<uint32_t>(m_scene.meshes[i].vertices.size())} },
+				{ {m_sceneIndexBuffers[i], static_cast<uint32_t>(m_scene.meshes[i].indices.size())} }).pResult);
+		}
+		// # DXR Extra: Levels of detail
+		// One BLAS per level beyond the first, sharing the vertex buffer of the mesh. Only the
+		// levels used by an instance are built
+		SelectSceneLods();
+		std::vector<std::vector<ComPtr<ID3D12Resource>>> sceneLodBLAS(m_sceneLodIndexBuffers.size());
+		for (size_t i = 0; i < m_instanceLods.size(); i++)
+		{
+			const size_t meshIndex = m_scene.instances[i].meshIndex;
+			const UINT lod = m_instanceLods[i];
+			if (lod == 0)
+				continue;
+			sceneLodBLAS[meshIndex].resize(m_sceneLodIndexBuffers[meshIndex].size());
+			if (!sceneLodBLAS[meshIndex][lod - 1])
+				sceneLodBLAS[meshIndex][lod - 1] = CreateBottomLevelAS(
+					{ {m_sceneVertexBuffers[meshIndex], static_cast<uint32_t>(m_scene.meshes[meshIndex].vertices.size())} },
+					{ {m_sceneLodIndexBuffers[meshIndex][lod - 1], static_cast<uint32_t>(m_sceneLods[meshIndex].lods[lod].indices.size())} }).pResult;
+		}
+		m_instances.clear();
+		for (size_t i = 0; i < m_scene.instances.size(); i++)
+		{
+			const auto& instance = m_scene.instances[i];
+			const UINT lod = m_instanceLods.empty() ? 0 : m_instanceLods[i];
+			const ComPtr<ID3D12Resource>& blas = lod == 0 ? sceneBLAS[instance.meshIndex] : sceneLodBLAS[instance.meshIndex][lod - 1];
+			const float(*t)[4] = instance.transform;
+			// # DXR Extra: Compact vertex formats
+			// The meshes of mapped .glb files are not packed, and do not need decoding
+			const XMMATRIX decode = instance.meshIndex < m_sceneDecodes.size() ? GetDecodeMatrix(m_sceneDecodes[instance.meshIndex]) : XMMatrixIdentity();
+			m_instances.push_back({ blas, decode * XMMatrixSet(
+				t[0][0], t[1][0], t[2][0], 0.f,
+				t[0][1], t[1][1], t[2][1], 0.f,
+				t[0][2], t[1][2], t[2][2], 0.f,
+				t[0][3], t[1][3], t[2][3], 1.f) });
+		}
+		m_instances.push_back({ planeBottomLevelBuffers.pResult, GetDecodeMatrix(m_planeDecode) * XMMatrixTranslation(0, 0, 0) });
+	}
+	// # DXR Extra: Batched BLAS builds
+	// Record the queued BLAS builds. The scratch pool has to live until the command list has been
+	// executed
+	ComPtr<ID3D12Resource> blasScratchPool = BuildPendingBottomLevelAS();
+
+	// # DXR Extra: Geometry deduplication
+	// Report the BLAS memory and build work saved by sharing identical geometries
+	const auto& dedupStats = m_blasDeduplicator.GetStatistics();
+	std::string dedupReport = "BLAS deduplication: " + std::to_string(dedupStats.uniqueGeometries) + " built, " +
+		std::to_string(dedupStats.duplicateGeometries) + " shared, saved " +
+		std::to_string(dedupStats.savedResultBytes) + " result bytes, " +
+		std::to_string(dedupStats.savedScratchBytes) + " scratch bytes and the build of " +
+		std::to_string(dedupStats.savedPrimitives) + " triangles\n";
+	OutputDebugStringA(dedupReport.c_str());
+
 	CreateTopLevelAS(m_instances); 
 
+	// # DXR Extra: Staging uploads
+	// The copies of the geometry are executed before the builds reading it
+	m_uploadBatcher->Flush();
+
 	// ˢ command list ȴ 
 	m_commandList->Close();
 	ID3D12CommandList *ppCommandLists[] = {m_commandList.Get()};
 	m_commandQueue->ExecuteCommandLists(1, ppCommandLists);
-	m_fenceValue++;
-	m_commandQueue->Signal(m_fence.Get(), m_fenceValue);
-
-	m_fence->SetEventOnCompletion(m_fenceValue, m_fenceEvent);
-	WaitForSingleObject(m_fenceEvent, INFINITE);
+	// # DXR Extra: Frame pipelining
+	m_framePacer->Flush();
 
 	//  command list ִУȾ
-	ThrowIfFailed( m_commandList->Reset(m_commandAllocator.Get(), m_pipelineState.Get())); 
+	ThrowIfFailed( m_commandList->Reset(m_commandAllocators[0].Get(), m_pipelineState.Get())); 
 	//  BLAS 塣ʣĻ彫˳̺ͷ
 	m_bottomLevelAS = bottomLevelBuffers.pResult;
 }
@@ -762,6 +1882,9 @@ ComPtr<ID3D12RootSignature> D3D12HelloTriangle::CreateHitSignature() {
 	// root signature ĳ壬ǽ register 0 󶨣 HLSL 
 	// Ϊ register(0) ʡ
 	rsc.AddRootParameter(D3D12_ROOT_PARAMETER_TYPE_CBV, 0 /*b0*/);
+	// # DXR Extra: Compact vertex formats
+	// Layout of the vertices, as 2 root constants in b1
+	rsc.AddRootParameter(D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS, 1 /*b1*/, 0, 2);
 	return rsc.Generate(m_device.Get(), true);
 }
 
@@ -785,18 +1908,17 @@ void D3D12HelloTriangle::CreateRaytracingPipeline() {
 	// pipeline п raytracing  shader  DXIL 롣뽫 HLSL
 	//  DXIL ⼯Ϊ˸ѡ񽫴ͨ (ray generationhit
 	// miss) ɶɸ
-	m_rayGenLibrary = nv_helpers_dx12::CompileShaderLibrary(L"RayGen.hlsl");
-	m_missLibrary = nv_helpers_dx12::CompileShaderLibrary(L"Miss.hlsl");
-	m_hitLibrary = nv_helpers_dx12::CompileShaderLibrary(L"Hit.hlsl");
+	// # DXR Extra: Parallel shader compilation
+	// The libraries were submitted by CompileShaders, and are waited for by Generate
 
 	//  DLL ƣÿɸ exported symbols Ҫʽɡֵעʱһ
 	// ԰ symbols semantic  HLSL ʹ [shader("xxx")] 
 	// [Question] Ϊʲô HLSL symbolsΪСдҲƥ C++ symbols
-	pipeline.AddLibrary(m_rayGenLibrary.Get(), { L"RayGen" });
-	pipeline.AddLibrary(m_missLibrary.Get(), { L"Miss" });
+	pipeline.AddLibrary(m_rayGenLibrary, { L"RayGen" });
+	pipeline.AddLibrary(m_missLibrary, { L"Miss" });
 	// pipeline.AddLibrary(m_hitLibrary.Get(), { L"ClosestHit" });
 	// #DXR Extra: Per-Instance Data
-	pipeline.AddLibrary(m_hitLibrary.Get(), { L"ClosestHit", L"PlaneClosestHit" });
+	pipeline.AddLibrary(m_hitLibrary, { L"ClosestHit", L"PlaneClosestHit" });
 
 	// ҪܹʹЩ shaderÿ DX12 shader Ҫһ root signature Ҫʵ
 	// parameters  buffers
@@ -841,18 +1963,36 @@ void D3D12HelloTriangle::CreateRaytracingPipeline() {
 	// ݹҪֵõܡPath tracing algorithms ׵ ray generation ƽΪһѭ
 	pipeline.SetMaxRecursionDepth(1);
 	
+	// # DXR Extra: Pipeline cache
+	// DXR state objects have no cached blob, hence the entry of the pipeline only records its
+	// description. A hit means a previous launch created the same pipeline, whose shaders the driver
+	// most likely kept in its own cache
+	const nv_helpers_dx12::PipelineDescription description = pipeline.GetDescription();
+	std::vector<uint8_t> unusedBlob;
+	const bool knownPipeline = m_pipelineCache->Find(description, &unusedBlob);
+	const auto start = std::chrono::steady_clock::now();
+
 	//  pipeline GPUִ
 	m_rtStateObject = pipeline.Generate(); 
 
+	const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	if (!knownPipeline)
+		m_pipelineCache->Store(description, {});
+	OutputDebugStringA(("Pipeline cache: raytracing pipeline " + description.GetKey() +
+		(knownPipeline ? " unchanged since a previous launch, created in " : " created for the first time in ") +
+		std::to_string(seconds * 1000.) + " ms\n").c_str());
+
 	//  state object תΪ properties objectԺƷ shader pointers
 	ThrowIfFailed(m_rtStateObject->QueryInterface(IID_PPV_ARGS(&m_rtStateObjectProps)));
 }
 
 //-----------------------------------------------------------------------------
 // ׷ bufferСͼһ 
+// # DXR Extra: Render graph
+// The output is a transient resource of the raytracing graph, created by CreateFrameGraphs
 //
 void D3D12HelloTriangle::CreateRaytracingOutputBuffer() {
-	D3D12_RESOURCE_DESC resDesc = {};
+	D3D12_RESOURCE_DESC& resDesc = m_outputDesc;
 	resDesc.DepthOrArraySize = 1;
 	resDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
 
@@ -866,10 +2006,6 @@ void D3D12HelloTriangle::CreateRaytracingOutputBuffer() {
 	resDesc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
 	resDesc.MipLevels = 1;
 	resDesc.SampleDesc.Count = 1;
-	ThrowIfFailed(m_device->CreateCommittedResource(
-		&nv_helpers_dx12::kDefaultHeapProps, D3D12_HEAP_FLAG_NONE, &resDesc,
-		D3D12_RESOURCE_STATE_COPY_SOURCE, nullptr,
-		IID_PPV_ARGS(&m_outputResource)));
 }
 
 //-----------------------------------------------------------------------------
@@ -889,35 +2025,44 @@ void D3D12HelloTriangle::CreateShaderResourceHeap() {
 	// 1. UAV for the raytracing output 
 	// 2. SRV for the TLAS
 	// 3. CBV for the camera matrices (#DXR Extra: Perspective Camera)
-	m_srvUavHeap = nv_helpers_dx12::CreateDescriptorHeap(m_device.Get(), 3, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, true);
-
-	//  CPU ˻ȡ heap memory  handleֱд descriptors
-	D3D12_CPU_DESCRIPTOR_HANDLE srvHandle = m_srvUavHeap->GetCPUDescriptorHandleForHeapStart();
-
-	//  UAV root signatureǵһ Create*View   view Ϣֱд srvHandle
-	D3D12_UNORDERED_ACCESS_VIEW_DESC uavDesc = {};
-	uavDesc.ViewDimension = D3D12_UAV_DIMENSION_TEXTURE2D;
-	m_device->CreateUnorderedAccessView(m_outputResource.Get(), nullptr, &uavDesc,srvHandle);
-
-	// ż TLAS SRV
-	srvHandle.ptr += m_device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
-
-	D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc;
-	srvDesc.Format = DXGI_FORMAT_UNKNOWN;
-	srvDesc.ViewDimension = D3D12_SRV_DIMENSION_RAYTRACING_ACCELERATION_STRUCTURE;
-	srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-	srvDesc.RaytracingAccelerationStructure.Location = m_topLevelASBuffers.pResult->GetGPUVirtualAddress();
-	//  AS View д Heap
-	m_device->CreateShaderResourceView(nullptr, &srvDesc, srvHandle);
-
-	// #DXR Extra: Perspective Camera
-	//  TLAS  camera constant buffer
-	srvHandle.ptr += m_device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
-	// Ϊ constant buffer view 
-	D3D12_CONSTANT_BUFFER_VIEW_DESC cbvDesc = {};
-	cbvDesc.BufferLocation = m_cameraBuffer->GetGPUVirtualAddress();
-	cbvDesc.SizeInBytes = m_cameraBufferSize;
-	m_device->CreateConstantBufferView(&cbvDesc, srvHandle);
+	// # DXR Extra: Descriptor allocation
+	// The three descriptors form a static range of the shader-visible heap, referenced by the SBT
+	// # DXR Extra: Async acceleration structure builds
+	// One range per TLAS version, which only differ by their TLAS SRV
+	const uint32_t versionCount = static_cast<uint32_t>(m_topLevelASVersions.size());
+	if (!m_descriptorAllocator.AllocateStatic(3 * versionCount, &m_rayGenDescriptors))
+		throw std::logic_error("Could not allocate the raytracing descriptors");
+
+	for (uint32_t version = 0; version < versionCount; version++)
+	{
+		//  CPU ˻ȡ heap memory  handleֱд descriptors
+		D3D12_CPU_DESCRIPTOR_HANDLE srvHandle = GetDescriptorCpuHandle(m_rayGenDescriptors + 3 * version);
+
+		//  UAV root signatureǵһ Create*View   view Ϣֱд srvHandle
+		D3D12_UNORDERED_ACCESS_VIEW_DESC uavDesc = {};
+		uavDesc.ViewDimension = D3D12_UAV_DIMENSION_TEXTURE2D;
+		m_device->CreateUnorderedAccessView(m_outputResource.Get(), nullptr, &uavDesc,srvHandle);
+
+		// ż TLAS SRV
+		srvHandle.ptr += m_descriptorSize;
+
+		D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc;
+		srvDesc.Format = DXGI_FORMAT_UNKNOWN;
+		srvDesc.ViewDimension = D3D12_SRV_DIMENSION_RAYTRACING_ACCELERATION_STRUCTURE;
+		srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+		srvDesc.RaytracingAccelerationStructure.Location = m_topLevelASVersions[version]->GetGPUVirtualAddress();
+		//  AS View д Heap
+		m_device->CreateShaderResourceView(nullptr, &srvDesc, srvHandle);
+
+		// #DXR Extra: Perspective Camera
+		//  TLAS  camera constant buffer
+		srvHandle.ptr += m_descriptorSize;
+		// Ϊ constant buffer view 
+		D3D12_CONSTANT_BUFFER_VIEW_DESC cbvDesc = {};
+		cbvDesc.BufferLocation = m_cameraBuffer->GetGPUVirtualAddress();
+		cbvDesc.SizeInBytes = m_cameraBufferSize;
+		m_device->CreateConstantBufferView(&cbvDesc, srvHandle);
+	}
 }
 
 //---CreateShaderBindingTable---------------------------------------------------
@@ -1037,7 +2182,8 @@ void D3D12HelloTriangle::CreateShaderBindingTable() {
 	m_sbtHelper.Reset();
 
 	// ָѿͷָûиɫΨһҪĲ
-	D3D12_GPU_DESCRIPTOR_HANDLE srvUavHeapHandle = m_srvUavHeap->GetGPUDescriptorHandleForHeapStart();
+	// # DXR Extra: Descriptor allocation
+	D3D12_GPU_DESCRIPTOR_HANDLE srvUavHeapHandle = GetDescriptorGpuHandle(m_rayGenDescriptors);
 
 	// ཫ root parameter pointers  heap pointers Ϊ void* DX12 ʹ
 	// D3D12_GPU_DESCRIPTOR_HANDLE  heap pointers. ṹָ UINT64*
@@ -1045,7 +2191,14 @@ void D3D12HelloTriangle::CreateShaderBindingTable() {
 	auto heapPointer = reinterpret_cast<UINT64*>(srvUavHeapHandle.ptr);
 
 	// ray generation shader ֻҪ
-	m_sbtHelper.AddRayGenerationProgram(L"RayGen", { heapPointer });
+	// # DXR Extra: Async acceleration structure builds
+	// One record per TLAS version, referencing the descriptor range of the version. The records
+	// take 64 bytes, hence each of them satisfies the alignment of DispatchRays
+	for (uint32_t version = 0; version < m_topLevelASVersions.size(); version++)
+	{
+		heapPointer = reinterpret_cast<UINT64*>(GetDescriptorGpuHandle(m_rayGenDescriptors + 3 * version).ptr);
+		m_sbtHelper.AddRayGenerationProgram(L"RayGen", { heapPointer });
+	}
 
 	// miss  hit shader Ҫⲿݣͨ ray payload ͨ
 	m_sbtHelper.AddMissProgram(L"Miss", {});
@@ -1058,11 +2211,42 @@ void D3D12HelloTriangle::CreateShaderBindingTable() {
 	// shadow hit ֻҪpayloadǷɼ˲Ҫⲿݡ
 	// ҪעǣÿinstanceӦ Hit GroupҪÿhitgroupж m_vertexBuffer
 
-	m_sbtHelper.AddHitGroup(L"HitGroup", 
-		{(void*)(m_vertexBuffer->GetGPUVirtualAddress()), 
-		 (void*)(m_indexBuffer->GetGPUVirtualAddress()),
-		 (void*)(m_perInstanceConstantBuffers[0]->GetGPUVirtualAddress())
-		});
+	if (!m_useGeneratedScene)
+	{
+		m_sbtHelper.AddHitGroup(L"HitGroup", 
+			{(void*)(m_vertexBuffer->GetGPUVirtualAddress()), 
+			 (void*)(m_indexBuffer->GetGPUVirtualAddress()),
+			 (void*)(m_perInstanceConstantAddresses[0]),
+			 GetVertexLayoutConstants(GetIndexFormat(m_indexBuffer.Get()))
+			});
+	}
+	else
+	{
+		// # Benchmark scenes
+		// One hit group per scene instance, in the order of the TLAS instances, referencing the
+		// buffers of the instantiated mesh
+		for (size_t i = 0; i < m_scene.instances.size(); i++)
+		{
+			const auto& instance = m_scene.instances[i];
+			// # DXR Extra: glTF scenes
+			// The vertices of the mapped .glb files do not follow the Vertex layout read by the
+			// hit shader, and are shaded with a constant color
+			if (m_glb.GetMeshes().size() > 0)
+			{
+				m_sbtHelper.AddHitGroup(L"PlaneHitGroup", {});
+				continue;
+			}
+			// # DXR Extra: Levels of detail
+			const UINT lod = m_instanceLods.empty() ? 0 : m_instanceLods[i];
+			ID3D12Resource* indexBuffer = lod == 0 ? m_sceneIndexBuffers[instance.meshIndex].Get() : m_sceneLodIndexBuffers[instance.meshIndex][lod - 1].Get();
+			m_sbtHelper.AddHitGroup(L"HitGroup",
+				{(void*)(m_sceneVertexBuffers[instance.meshIndex]->GetGPUVirtualAddress()),
+				 (void*)(indexBuffer->GetGPUVirtualAddress()),
+				 (void*)(m_perInstanceConstantAddresses[0]),
+				 GetVertexLayoutConstants(GetIndexFormat(indexBuffer))
+				});
+		}
+	}
 
 	/*
 	for (int i = 0; i < 3; ++i) 
@@ -1082,10 +2266,14 @@ void D3D12HelloTriangle::CreateShaderBindingTable() {
 	// shaderǵĲSBTĴС
 	uint32_t sbtSize = m_sbtHelper.ComputeSBTSize();
 
+	// # DXR Extra: Deferred release
+	// The frames in flight may still read the previous table
+	if (m_sbtStorage)
+		DeferRelease(m_sbtStorage);
+
 	//  upload heap д SBT. ڰҪʹӳд SBT ݣǱġ
 	//  SBT ԱƵ default heap 
-	m_sbtStorage = nv_helpers_dx12::CreateBuffer(
-		m_device.Get(), 
+	m_sbtStorage = m_resourceAllocator->CreateBuffer(
 		sbtSize, 
 		D3D12_RESOURCE_FLAG_NONE,
 		D3D12_RESOURCE_STATE_GENERIC_READ,
@@ -1101,23 +2289,30 @@ void D3D12HelloTriangle::CreateShaderBindingTable() {
 //----------------------------------------------------------------------------------
 //
 // Camera Buffer һ壬洢任ڹդ͹׷÷˾
-// ҪĻ塣Ϊ˴ͬʱ˽ûĶ rasterization
+// ҪĻ塣The view used by the rasterization is created in the staging descriptor heap.
 // 
 void D3D12HelloTriangle::CreateCameraBuffer() {
 	// view, perspective, viewInv, perspectiveInv 
 	uint32_t nbMatrix = 4;
 	// б任䳣
 	m_cameraBufferSize = nbMatrix * sizeof(XMMATRIX);
-	m_cameraBuffer = nv_helpers_dx12::CreateBuffer(m_device.Get(), m_cameraBufferSize,D3D12_RESOURCE_FLAG_NONE, 
-		D3D12_RESOURCE_STATE_GENERIC_READ, nv_helpers_dx12::kUploadHeapProps); 
-	// ڹդ descriptor heap
-	m_constHeap = nv_helpers_dx12::CreateDescriptorHeap( m_device.Get(), 1, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, true); 
+	// # DXR Extra: Frame pipelining
+	// The camera buffer is only written by the GPU copies of each frame, from the upload ring
+	m_cameraBuffer = m_resourceAllocator->CreateBuffer(m_cameraBufferSize,D3D12_RESOURCE_FLAG_NONE, 
+		D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER, nv_helpers_dx12::kDefaultHeapProps); 
+	// # DXR Extra: Resource state tracking
+	m_stateTracker.Register(m_cameraBuffer.Get(), D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER);
+	// # DXR Extra: Descriptor allocation
+	// The view used by the rasterization is created in the staging heap, and copied on bind
+	if (!m_stagingDescriptors.Allocate(&m_cameraStagingDescriptor))
+		throw std::logic_error("Could not allocate the camera descriptor");
 	// ʹ constant buffer view 
 	D3D12_CONSTANT_BUFFER_VIEW_DESC cbvDesc = {}; 
 	cbvDesc.BufferLocation = m_cameraBuffer->GetGPUVirtualAddress();
 	cbvDesc.SizeInBytes = m_cameraBufferSize; 
 	// ȡһ CPU ĶڴֱӸд descriptor
-	D3D12_CPU_DESCRIPTOR_HANDLE srvHandle = m_constHeap->GetCPUDescriptorHandleForHeapStart(); 
+	D3D12_CPU_DESCRIPTOR_HANDLE srvHandle = m_stagingDescriptorHeap->GetCPUDescriptorHandleForHeapStart();
+	srvHandle.ptr += m_cameraStagingDescriptor * m_descriptorSize;
 	m_device->CreateConstantBufferView(&cbvDesc, srvHandle);
 }
 
@@ -1127,7 +2322,9 @@ void D3D12HelloTriangle::CreateCameraBuffer() {
 // ͸camera viewmodel  perspective 
 //
 void D3D12HelloTriangle::UpdateCameraBuffer() {
-	std::vector<XMMATRIX> matrices(4); 
+	// # DXR Extra: Upload ring
+	// The matrices are computed on the stack, the upload memory being slow to read back
+	XMMATRIX matrices[4]; 
 	// ʼ view matrix¸þûĻڹդ lookat  
 	// perspective matrices 任 [0,1]x[0,1]x[0,1] ռ
 	const glm::mat4& mat = nv_helpers_dx12::CameraManip.getMatrix(); 
@@ -1141,9 +2338,168 @@ void D3D12HelloTriangle::UpdateCameraBuffer() {
 	matrices[2] = XMMatrixInverse(&det, matrices[0]); 
 	matrices[3] = XMMatrixInverse(&det, matrices[1]); 
 	// ƾ 
-	uint8_t *pData; 
-	ThrowIfFailed(m_cameraBuffer->Map(0, nullptr, (void **)&pData)); 
-	memcpy(pData, matrices.data(), m_cameraBufferSize); m_cameraBuffer->Unmap(0, nullptr);
+	// # DXR Extra: Upload ring
+	const UploadAllocation allocation = AllocateUpload(m_cameraBufferSize);
+	memcpy(allocation.data, matrices, m_cameraBufferSize);
+	m_cameraUploadOffset = allocation.offset;
+}
+
+// # DXR Extra: Upload ring
+//---CreateUploadRing-----------------------------------------------------------
+//
+// Allocate and map the upload buffer of the ring, which stays mapped until its release
+//
+void D3D12HelloTriangle::CreateUploadRing() {
+	m_uploadRingBuffer = m_resourceAllocator->CreateBuffer(m_uploadRing.GetSize(), D3D12_RESOURCE_FLAG_NONE,
+		D3D12_RESOURCE_STATE_GENERIC_READ, nv_helpers_dx12::kUploadHeapProps);
+	ThrowIfFailed(m_uploadRingBuffer->Map(0, nullptr, reinterpret_cast<void**>(&m_uploadRingData)));
+}
+
+// # DXR Extra: Placed resources
+//---ReportResourceHeaps--------------------------------------------------------
+//
+// Report the occupancy of the heaps of each pool, and the number of buffers placed in them
+// instead of being committed, ie. the heap allocations saved
+//
+void D3D12HelloTriangle::ReportResourceHeaps() {
+	const char* poolNames[] = { "upload", "default", "acceleration structure" };
+	for (size_t pool = 0; pool < _countof(poolNames); pool++)
+	{
+		const nv_helpers_dx12::ResourceHeapStatistics statistics =
+			m_resourceAllocator->GetStatistics(static_cast<nv_helpers_dx12::ResourceHeapAllocator::Pool>(pool));
+		OutputDebugStringA(("Resource heaps, " + std::string(poolNames[pool]) + " pool: " +
+			std::to_string(statistics.placedBufferCount) + " buffers placed in " + std::to_string(statistics.heapCount) +
+			" heaps, " + std::to_string(statistics.usedSize / 1024) + " KB used of " + std::to_string(statistics.heapSize / 1024) +
+			" KB, fragmentation " + std::to_string(statistics.GetFragmentation()) + ", " +
+			std::to_string(statistics.committedBufferCount) + " committed buffers\n").c_str());
+	}
+}
+
+//---RunTlsfBenchmark-----------------------------------------------------------
+//
+// Stress the allocator core with random allocations and frees in a 256 MB heap, and report its
+// throughput and the resulting fragmentation
+//
+void D3D12HelloTriangle::RunTlsfBenchmark() {
+	const nv_helpers_dx12::TlsfStressResult result = nv_helpers_dx12::RunTlsfStressBenchmark(256ull * 1024 * 1024, 1000000);
+	OutputDebugStringA(("TLSF benchmark: " + std::to_string(result.operationCount) + " operations in " +
+		std::to_string(result.seconds) + " s (" + std::to_string(result.GetThroughput() / 1e6) + " M/s), " +
+		std::to_string(result.failedAllocationCount) + " failed allocations, peak " +
+		std::to_string(result.peakUsedSize / (1024 * 1024)) + " MB, final fragmentation " +
+		std::to_string(result.finalStatistics.GetFragmentation()) + "\n").c_str());
+}
+
+// # DXR Extra: Descriptor allocation
+//---CreateDescriptorHeaps------------------------------------------------------
+//
+// Create the shader-visible CBV/SRV/UAV heap, covering the static, persistent and transient
+// regions of the descriptor allocator, and the CPU-only staging heap the descriptors bound on
+// the fly are copied from
+//
+void D3D12HelloTriangle::CreateDescriptorHeaps() {
+	m_descriptorHeap = nv_helpers_dx12::CreateDescriptorHeap(m_device.Get(), m_descriptorAllocator.GetCount(),
+		D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, true);
+	m_stagingDescriptorHeap = nv_helpers_dx12::CreateDescriptorHeap(m_device.Get(), m_stagingDescriptors.GetCount(),
+		D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, false);
+	m_descriptorSize = m_device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+}
+
+//---GetDescriptorCpuHandle-----------------------------------------------------
+//
+// Handles of a slot of the shader-visible heap
+//
+D3D12_CPU_DESCRIPTOR_HANDLE D3D12HelloTriangle::GetDescriptorCpuHandle(uint32_t slot) const {
+	D3D12_CPU_DESCRIPTOR_HANDLE handle = m_descriptorHeap->GetCPUDescriptorHandleForHeapStart();
+	handle.ptr += static_cast<SIZE_T>(slot) * m_descriptorSize;
+	return handle;
+}
+
+D3D12_GPU_DESCRIPTOR_HANDLE D3D12HelloTriangle::GetDescriptorGpuHandle(uint32_t slot) const {
+	D3D12_GPU_DESCRIPTOR_HANDLE handle = m_descriptorHeap->GetGPUDescriptorHandleForHeapStart();
+	handle.ptr += static_cast<UINT64>(slot) * m_descriptorSize;
+	return handle;
+}
+
+//---BindStagingDescriptor------------------------------------------------------
+//
+// Copy a descriptor of the staging heap into the transient region of the shader-visible heap,
+// and return the GPU handle of the copy. The staging descriptor can then be rewritten at any time,
+// the frames in flight reading their own copies
+//
+D3D12_GPU_DESCRIPTOR_HANDLE D3D12HelloTriangle::BindStagingDescriptor(uint32_t stagingSlot) {
+	uint32_t slot;
+	if (!m_descriptorAllocator.AllocateTransient(1, &slot))
+		throw std::runtime_error("The transient descriptor ring is full");
+	D3D12_CPU_DESCRIPTOR_HANDLE stagingHandle = m_stagingDescriptorHeap->GetCPUDescriptorHandleForHeapStart();
+	stagingHandle.ptr += static_cast<SIZE_T>(stagingSlot) * m_descriptorSize;
+	m_device->CopyDescriptorsSimple(1, GetDescriptorCpuHandle(slot), stagingHandle, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+	return GetDescriptorGpuHandle(slot);
+}
+
+//---AllocateUpload-------------------------------------------------------------
+//
+// Suballocate upload memory for the current frame. A full ring means the frames in flight use
+// more than kUploadRingSize bytes, which is a sizing error rather than a transient condition
+//
+D3D12HelloTriangle::UploadAllocation D3D12HelloTriangle::AllocateUpload(UINT64 sizeInBytes, UINT64 alignment) {
+	UINT64 offset;
+	if (!m_uploadRing.Allocate(sizeInBytes, alignment, &offset))
+		throw std::runtime_error("The upload ring is full, increase kUploadRingSize");
+	return { m_uploadRingData + offset, m_uploadRingBuffer->GetGPUVirtualAddress() + offset, offset };
+}
+
+// # DXR Extra: Meshlet culling
+//---CullSceneMeshlets----------------------------------------------------------
+//
+// Cull the meshlets of the scene instances against the camera of the manipulator, using the
+// projection of UpdateCameraBuffer, and periodically report the accumulated statistics
+//
+void D3D12HelloTriangle::CullSceneMeshlets() {
+	glm::vec3 eye, center, up;
+	nv_helpers_dx12::CameraManip.getLookat(eye, center, up);
+	const nv_helpers_dx12::CullingCamera camera = nv_helpers_dx12::MakeCullingCamera(
+		glm::value_ptr(eye), glm::value_ptr(center), glm::value_ptr(up), 45.0f * XM_PI / 180.0f, m_aspectRatio, 0.1f, 1000.0f);
+	const nv_helpers_dx12::MeshletCullingStatistics statistics =
+		nv_helpers_dx12::CullSceneMeshlets(m_sceneMeshlets, m_scene.instances, camera);
+
+	m_meshletCullingStatistics.meshletCount += statistics.meshletCount;
+	m_meshletCullingStatistics.visibleMeshletCount += statistics.visibleMeshletCount;
+	m_meshletCullingStatistics.triangleCount += statistics.triangleCount;
+	m_meshletCullingStatistics.visibleTriangleCount += statistics.visibleTriangleCount;
+	m_meshletCullingStatistics.seconds += statistics.seconds;
+	if (++m_meshletCullingFrames < kMeshletReportInterval)
+		return;
+	OutputDebugStringA(("Meshlet culling: " + std::to_string(100.f * m_meshletCullingStatistics.GetCulledTriangleFraction()) +
+		"% of the triangles culled, " + std::to_string(m_meshletCullingStatistics.GetThroughput() / 1e6) + " M meshlets/s\n").c_str());
+	m_meshletCullingStatistics = nv_helpers_dx12::MeshletCullingStatistics();
+	m_meshletCullingFrames = 0;
+}
+
+// # DXR Extra: Levels of detail
+//---SelectSceneLods------------------------------------------------------------
+//
+// Select the level of detail of each scene instance from the camera of the manipulator, using
+// the projection of UpdateCameraBuffer, and report the number of triangles in the TLAS
+//
+void D3D12HelloTriangle::SelectSceneLods() {
+	m_instanceLods.clear();
+	if (m_sceneLods.empty())
+		return;
+	glm::vec3 eye, center, up;
+	nv_helpers_dx12::CameraManip.getLookat(eye, center, up);
+	uint64_t fullTriangleCount = 0;
+	uint64_t triangleCount = 0;
+	for (const auto& instance : m_scene.instances)
+	{
+		const nv_helpers_dx12::LodChain& chain = m_sceneLods[instance.meshIndex];
+		const UINT lod = chain.lods.empty() ? 0 : nv_helpers_dx12::SelectLod(
+			chain, instance.transform, glm::value_ptr(eye), static_cast<float>(GetHeight()), 45.0f * XM_PI / 180.0f, kMaxLodPixelError);
+		m_instanceLods.push_back(lod);
+		fullTriangleCount += m_scene.meshes[instance.meshIndex].GetTriangleCount();
+		triangleCount += chain.lods.empty() ? 0 : chain.lods[lod].GetTriangleCount();
+	}
+	OutputDebugStringA(("Levels of detail: " + std::to_string(triangleCount) + " instanced triangles instead of " +
+		std::to_string(fullTriangleCount) + "\n").c_str());
 }
 
 // # DXR Extra - Perspective Camera
@@ -1184,30 +2540,38 @@ void D3D12HelloTriangle::CreatePlaneVB() {
 		{{-1.5f, -.8f, -1.5f}, {1.0f, 1.0f, 1.0f, 1.0f}}, // 1 
 		{{01.5f, -.8f, -1.5f}, {1.0f, 1.0f, 1.0f, 1.0f}}  // 4 
 	}; 
-	const UINT planeBufferSize = sizeof(planeVertices); 
-	// ע⡿ ʹ upload heaps  static data  vert buffer һƼ
-	// ÿ GPU Ҫʱupload heap ᱻ飨marshalled upload head
-	// ڼ򻯴룬ֻкٵ verts ʵתơ
-	CD3DX12_HEAP_PROPERTIES heapProperty =
-		CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
-	CD3DX12_RESOURCE_DESC bufferResource =
-		CD3DX12_RESOURCE_DESC::Buffer(planeBufferSize);
-	ThrowIfFailed(m_device->CreateCommittedResource(
-		&heapProperty, D3D12_HEAP_FLAG_NONE, &bufferResource,
-		D3D12_RESOURCE_STATE_GENERIC_READ, nullptr,
-		IID_PPV_ARGS(&m_planeBuffer)));
-
-	// ݸƵ㻺壨vertex buffer
-	UINT8* pVertexDataBegin;
-	CD3DX12_RANGE readRange(0, 0);	// ǲCPUԴȡݡ
-	ThrowIfFailed(m_planeBuffer->Map(0, &readRange, reinterpret_cast<void**>(&pVertexDataBegin)));
-	memcpy(pVertexDataBegin, planeVertices, sizeof(planeVertices));
-	m_planeBuffer->Unmap(0, nullptr);
+	// # DXR Extra: Vertex welding
+	// The shared vertices of the two triangles are merged, leaving 4 vertices and 6 indices
+	static_assert(sizeof(nv_helpers_dx12::MeshVertex) == sizeof(Vertex), "Welded vertices must match the Vertex layout");
+	const nv_helpers_dx12::Mesh plane = nv_helpers_dx12::WeldVertices(
+		reinterpret_cast<const nv_helpers_dx12::MeshVertex*>(planeVertices), _countof(planeVertices), nullptr, 0);
+	m_planeVertexCount = static_cast<UINT>(plane.vertices.size());
+	m_planeIndexCount = static_cast<UINT>(plane.indices.size());
+	// # DXR Extra: Compact vertex formats
+	nv_helpers_dx12::PackedVertices packedVertices = PackVertices(
+		reinterpret_cast<const Vertex*>(plane.vertices.data()), plane.vertices.size(), &m_planeDecode);
+	const UINT planeBufferSize = static_cast<UINT>(packedVertices.data.size());
+	// # DXR Extra: Staging uploads
+	// The vertices are copied into a default heap buffer, instead of being read from the upload
+	// heap by every draw and build
+	m_planeBuffer = CreateStaticBuffer(packedVertices.data.data(), planeBufferSize);
+
+	// # DXR Extra: Geometry deduplication
+	// Only the positions are seen by the AS builder
+	m_geometryHashes[m_planeBuffer.Get()] = nv_helpers_dx12::GeometryDeduplicator::HashStridedData(
+		packedVertices.data.data(), packedVertices.vertexCount, m_vertexLayout.GetStride(), m_vertexLayout.GetPositionSize());
 
 	// ʼ㻺ͼvertex buffer view.
 	m_planeBufferView.BufferLocation = m_planeBuffer->GetGPUVirtualAddress();
-	m_planeBufferView.StrideInBytes = sizeof(Vertex);
+	m_planeBufferView.StrideInBytes = m_vertexLayout.GetStride();
 	m_planeBufferView.SizeInBytes = planeBufferSize;
+
+	// # DXR Extra: Vertex welding
+	nv_helpers_dx12::PackedIndices packedIndices = nv_helpers_dx12::PackIndices(plane.indices.data(), plane.indices.size(), plane.vertices.size());
+	m_planeIndexBuffer = CreateIndexBuffer(packedIndices);
+	m_planeIndexBufferView.BufferLocation = m_planeIndexBuffer->GetGPUVirtualAddress();
+	m_planeIndexBufferView.Format = GetIndexFormat(m_planeIndexBuffer.Get());
+	m_planeIndexBufferView.SizeInBytes = static_cast<UINT>(packedIndices.GetSizeInBytes());
 }
 
 // #DXR Extra: Per-Instance Data
@@ -1260,49 +2624,32 @@ void D3D12HelloTriangle::CreateTetrahedronVB() {
 		{{0.f, 0.f, 1.f}, {1, 0, 1, 1}} 
 	};
 
-	const UINT vertexBufferSize = sizeof(tetrahedronVertices);
-	// ע⡿ ʹ upload heaps  static data  vert buffer һƼ
-	// ÿ GPU Ҫʱupload heap ᱻ飨marshalled upload head
-	// ڼ򻯴룬ֻкٵ verts ʵתơ
-	ThrowIfFailed(m_device->CreateCommittedResource(
-		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
-		D3D12_HEAP_FLAG_NONE,
-		&CD3DX12_RESOURCE_DESC::Buffer(vertexBufferSize),
-		D3D12_RESOURCE_STATE_GENERIC_READ,
-		nullptr,
-		IID_PPV_ARGS(&m_vertexBuffer)));
+	// # DXR Extra: Compact vertex formats
+	nv_helpers_dx12::PackedVertices packedVertices = PackVertices(tetrahedronVertices, _countof(tetrahedronVertices), &m_tetrahedronDecode);
+	const UINT vertexBufferSize = static_cast<UINT>(packedVertices.data.size());
+	// # DXR Extra: Staging uploads
+	m_vertexBuffer = CreateStaticBuffer(packedVertices.data.data(), vertexBufferSize);
 
-	// ݸƵ㻺
-	UINT8* pVertexDataBegin;
-	CD3DX12_RANGE readRange(0, 0);		// We do not intend to read from this resource on the CPU.
-	ThrowIfFailed(m_vertexBuffer->Map(0, &readRange, reinterpret_cast<void**>(&pVertexDataBegin)));
-	memcpy(pVertexDataBegin, tetrahedronVertices, sizeof(tetrahedronVertices));
-	m_vertexBuffer->Unmap(0, nullptr);
+	// # DXR Extra: Geometry deduplication
+	m_geometryHashes[m_vertexBuffer.Get()] = nv_helpers_dx12::GeometryDeduplicator::HashStridedData(
+		packedVertices.data.data(), packedVertices.vertexCount, m_vertexLayout.GetStride(), m_vertexLayout.GetPositionSize());
 
 	// ʼ㻺ͼ
 	m_vertexBufferView.BufferLocation = m_vertexBuffer->GetGPUVirtualAddress();
-	m_vertexBufferView.StrideInBytes = sizeof(Vertex);
+	m_vertexBufferView.StrideInBytes = m_vertexLayout.GetStride();
 	m_vertexBufferView.SizeInBytes = vertexBufferSize;
 
 	//---DXR Extra: Indexed Geometry------------------------------------------------------------------------
 	// Indices
 	std::vector<UINT> indices = { 0, 1, 2, 0, 3, 1, 0, 2, 3, 1, 3, 2 };
-	const UINT indexBufferSize = static_cast<UINT>(indices.size()) * sizeof(UINT);
-	CD3DX12_HEAP_PROPERTIES heapProperty = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
-	CD3DX12_RESOURCE_DESC bufferResource = CD3DX12_RESOURCE_DESC::Buffer(indexBufferSize);
-	ThrowIfFailed(m_device->CreateCommittedResource(&heapProperty, D3D12_HEAP_FLAG_NONE, &bufferResource, // 
-		D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&m_indexBuffer)));
-
-	// Copy the triangle data to the index buffer.
-	UINT8 * pIndexDataBegin;
-	ThrowIfFailed(m_indexBuffer->Map(0, &readRange, reinterpret_cast<void**>(&pIndexDataBegin)));
-	memcpy(pIndexDataBegin, indices.data(), indexBufferSize);
-	m_indexBuffer->Unmap(0, nullptr);
+	// # DXR Extra: Automatic 16-bit indices
+	nv_helpers_dx12::PackedIndices packedIndices = nv_helpers_dx12::PackIndices(indices.data(), indices.size(), _countof(tetrahedronVertices));
+	m_indexBuffer = CreateIndexBuffer(packedIndices);
 
 	// Initialize the index buffer view.
 	m_indexBufferView.BufferLocation = m_indexBuffer->GetGPUVirtualAddress();
-	m_indexBufferView.Format = DXGI_FORMAT_R32_UINT;
-	m_indexBufferView.SizeInBytes = indexBufferSize;
+	m_indexBufferView.Format = GetIndexFormat(m_indexBuffer.Get());
+	m_indexBufferView.SizeInBytes = static_cast<UINT>(packedIndices.GetSizeInBytes());
 }
 
 // #DXR Extra: Per-Instance Data
@@ -1326,8 +2673,7 @@ void D3D12HelloTriangle::CreateGlobalConstantBuffer()
 		XMVECTOR{0.7f, 0.0f, 0.4f, 1.0f}, 
 	}; 
 	// ȫֳ 
-	m_globalConstantBuffer = nv_helpers_dx12::CreateBuffer( 
-		m_device.Get(),
+	m_globalConstantBuffer = m_resourceAllocator->CreateBuffer( 
 		sizeof(bufferData),
 		D3D12_RESOURCE_FLAG_NONE, 
 		D3D12_RESOURCE_STATE_GENERIC_READ,
@@ -1362,22 +2708,25 @@ void D3D12HelloTriangle::CreatePerInstanceConstantBuffers() {
 		XMVECTOR{0.4f, 0.0f, 1.0f, 1.0f},
 		XMVECTOR{0.7f, 0.0f, 1.0f, 1.0f},
 	};
-	m_perInstanceConstantBuffers.resize(3);
-	int i(0);
-	for (auto& cb : m_perInstanceConstantBuffers) {
-		const uint32_t bufferSize = sizeof(XMVECTOR) * 3;
-		cb = nv_helpers_dx12::CreateBuffer(
-			m_device.Get(), 
-			bufferSize, 
-			D3D12_RESOURCE_FLAG_NONE,
-			D3D12_RESOURCE_STATE_GENERIC_READ, 
-			nv_helpers_dx12::kUploadHeapProps);
-		uint8_t* pData;
-		ThrowIfFailed(cb->Map(0, nullptr, (void**)&pData));
-		memcpy(pData, &bufferData[i * 3], bufferSize);
-		cb->Unmap(0, nullptr);
-		++i;
+	// # DXR Extra: Upload ring
+	// A single buffer holds the constants of all the instances, each in a slice aligned for
+	// constant buffer views, instead of one committed resource per instance
+	const uint32_t instanceCount = 3;
+	const uint32_t bufferSize = sizeof(XMVECTOR) * 3;
+	const UINT64 sliceSize = ROUND_UP(bufferSize, nv_helpers_dx12::UploadRing::kConstantBufferAlignment);
+	m_perInstanceConstantBuffer = m_resourceAllocator->CreateBuffer(
+		instanceCount * sliceSize, 
+		D3D12_RESOURCE_FLAG_NONE,
+		D3D12_RESOURCE_STATE_GENERIC_READ, 
+		nv_helpers_dx12::kUploadHeapProps);
+	uint8_t* pData;
+	ThrowIfFailed(m_perInstanceConstantBuffer->Map(0, nullptr, (void**)&pData));
+	m_perInstanceConstantAddresses.clear();
+	for (uint32_t i = 0; i < instanceCount; ++i) {
+		memcpy(pData + i * sliceSize, &bufferData[i * 3], bufferSize);
+		m_perInstanceConstantAddresses.push_back(m_perInstanceConstantBuffer->GetGPUVirtualAddress() + i * sliceSize);
 	}
+	m_perInstanceConstantBuffer->Unmap(0, nullptr);
 }
 
 //  #DXR Extra: Depth Buffer
@@ -1388,22 +2737,480 @@ void D3D12HelloTriangle::CreateDepthBuffer() {
 	m_dsvHeap = nv_helpers_dx12::CreateDescriptorHeap(m_device.Get(), 1, D3D12_DESCRIPTOR_HEAP_TYPE_DSV, false);
 	// The depth and stencil can be packed into a single 32-bit texture buffer. Since we do not need 
 	// stencil, we use the 32 bits to store depth information (DXGI_FORMAT_D32_FLOAT). 
-	D3D12_HEAP_PROPERTIES depthHeapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT); 
-	D3D12_RESOURCE_DESC depthResourceDesc = CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_D32_FLOAT, m_width, m_height, 1, 1);
-	depthResourceDesc.Flags |= D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL;
-	// The depth values will be initialized to 1 
-	CD3DX12_CLEAR_VALUE depthOptimizedClearValue(DXGI_FORMAT_D32_FLOAT, 1.0f, 0); 
-	// Allocate the buffer itself, with a state allowing depth writes 
-	ThrowIfFailed(m_device->CreateCommittedResource( 
-		&depthHeapProperties, 
-		D3D12_HEAP_FLAG_NONE, 
-		&depthResourceDesc, 
-		D3D12_RESOURCE_STATE_DEPTH_WRITE, 
-		&depthOptimizedClearValue, IID_PPV_ARGS(&m_depthStencil))); 
-	// Write the depth buffer view into the depth buffer heap 
-	D3D12_DEPTH_STENCIL_VIEW_DESC dsvDesc = {}; 
-	dsvDesc.Format = DXGI_FORMAT_D32_FLOAT; 
-	dsvDesc.ViewDimension = D3D12_DSV_DIMENSION_TEXTURE2D; 
-	dsvDesc.Flags = D3D12_DSV_FLAG_NONE; 
-	m_device->CreateDepthStencilView(m_depthStencil.Get(), &dsvDesc, m_dsvHeap->GetCPUDescriptorHandleForHeapStart());
+	// # DXR Extra: Render graph
+	// The buffer itself is a transient resource of the rasterization graph, created along with its
+	// view by CreateFrameGraphs
+	m_depthStencilDesc = CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_D32_FLOAT, m_width, m_height, 1, 1);
+	m_depthStencilDesc.Flags |= D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL;
+}
+
+// # Benchmark scenes
+//---ParseCommandLineArgs-------------------------------------------------------
+//
+// In addition to the arguments of DXSample, parse the description of a procedural benchmark
+// scene. Any scene argument enables the generated scene
+//
+void D3D12HelloTriangle::ParseCommandLineArgs(WCHAR* argv[], int argc) {
+	DXSample::ParseCommandLineArgs(argv, argc);
+
+	auto toString = [](const WCHAR* text) {
+		std::string result;
+		for (; *text; text++)
+			result.push_back(static_cast<char>(*text));
+		return result;
+	};
+
+	for (int i = 1; i < argc; ++i)
+	{
+		if (_wcsicmp(argv[i], L"-glbcopy") == 0)
+			m_glbCopyLoader = true;
+		// # DXR Extra: Mesh optimization
+		else if (_wcsicmp(argv[i], L"-nomeshopt") == 0)
+			m_optimizeMeshes = false;
+		// # DXR Extra: Meshlet culling
+		else if (_wcsicmp(argv[i], L"-meshlets") == 0)
+			m_buildMeshlets = true;
+		// # DXR Extra: Levels of detail
+		else if (_wcsicmp(argv[i], L"-lod") == 0)
+			m_buildLods = true;
+		// # DXR Extra: Vertex welding
+		else if (_wcsicmp(argv[i], L"-noweld") == 0)
+			m_weldMeshes = false;
+		// # DXR Extra: Placed resources
+		else if (_wcsicmp(argv[i], L"-committed") == 0)
+			m_placeResources = false;
+		else if (_wcsicmp(argv[i], L"-tlsfbench") == 0)
+			m_runTlsfBenchmark = true;
+		// # DXR Extra: Parallel recording
+		else if (_wcsicmp(argv[i], L"-recordbench") == 0)
+			m_runRecordingBenchmark = true;
+		// # DXR Extra: Async acceleration structure builds
+		else if (_wcsicmp(argv[i], L"-asynctlas") == 0)
+			m_asyncTopLevelAS = true;
+		else if (_wcsicmp(argv[i], L"-asbuildsim") == 0)
+			m_runAsyncBuildSimulation = true;
+		// # DXR Extra: Shader cache
+		else if (_wcsicmp(argv[i], L"-noshadercache") == 0)
+			m_useShaderCache = false;
+		// # DXR Extra: Pipeline cache
+		else if (_wcsicmp(argv[i], L"-nopipelinecache") == 0)
+			m_usePipelineCache = false;
+		// # DXR Extra: Parallel shader compilation
+		else if (_wcsicmp(argv[i], L"-shaderbench") == 0)
+			m_runShaderCompileBenchmark = true;
+	}
+
+	for (int i = 1; i + 1 < argc; ++i)
+	{
+		const WCHAR* value = argv[i + 1];
+		// # DXR Extra: Compact vertex formats
+		// The vertex formats apply to all the geometry, generated scene or not
+		if (_wcsicmp(argv[i], L"-positionformat") == 0 || _wcsicmp(argv[i], L"-colorformat") == 0)
+		{
+			const bool parsed = _wcsicmp(argv[i], L"-positionformat") == 0
+				? nv_helpers_dx12::ParsePositionFormat(toString(value), &m_vertexLayout.positionFormat)
+				: nv_helpers_dx12::ParseColorFormat(toString(value), &m_vertexLayout.colorFormat);
+			if (!parsed)
+				throw std::invalid_argument("Unknown vertex format, expected float, half or snorm16 for positions, and float or rgba8 for colors");
+			++i;
+			continue;
+		}
+		// # DXR Extra: Vertex welding
+		if (_wcsicmp(argv[i], L"-weldtolerance") == 0)
+		{
+			m_weldTolerance = static_cast<float>(_wtof(value));
+			++i;
+			continue;
+		}
+		// # DXR Extra: Parallel recording
+		if (_wcsicmp(argv[i], L"-recordthreads") == 0)
+		{
+			m_recordingWorkerCount = (std::max)(_wtoi(value), 1);
+			++i;
+			continue;
+		}
+		// # DXR Extra: Parallel shader compilation
+		if (_wcsicmp(argv[i], L"-shaderthreads") == 0)
+		{
+			m_shaderWorkerCount = (std::max)(_wtoi(value), 1);
+			++i;
+			continue;
+		}
+		if (_wcsicmp(argv[i], L"-scene") == 0)
+		{
+			if (!nv_helpers_dx12::ParseSceneLayout(toString(value), &m_sceneDesc.layout))
+				throw std::invalid_argument("Unknown scene layout, expected grid, random or clustered");
+		}
+		else if (_wcsicmp(argv[i], L"-instances") == 0)
+			m_sceneDesc.instanceCount = static_cast<uint32_t>(_wtoi(value));
+		else if (_wcsicmp(argv[i], L"-meshes") == 0)
+			m_sceneDesc.meshCount = static_cast<uint32_t>(_wtoi(value));
+		else if (_wcsicmp(argv[i], L"-triangles") == 0)
+			m_sceneDesc.trianglesPerMesh = static_cast<uint32_t>(_wtoi(value));
+		else if (_wcsicmp(argv[i], L"-seed") == 0)
+			m_sceneDesc.seed = static_cast<uint64_t>(_wtoi64(value));
+		else if (_wcsicmp(argv[i], L"-clusters") == 0)
+			m_sceneDesc.clusterCount = static_cast<uint32_t>(_wtoi(value));
+		else if (_wcsicmp(argv[i], L"-overlap") == 0)
+			m_sceneDesc.overlap = static_cast<float>(_wtof(value));
+		else if (_wcsicmp(argv[i], L"-sceneobj") == 0)
+			m_sceneObjFile = toString(value);
+		else if (_wcsicmp(argv[i], L"-mesh") == 0)
+			m_meshFile = toString(value);
+		else if (_wcsicmp(argv[i], L"-glb") == 0)
+			m_glbFileName = toString(value);
+		else
+			continue;
+		m_useGeneratedScene = true;
+		++i;
+	}
+}
+
+// # Benchmark scenes
+//---CreateGeneratedSceneBuffers------------------------------------------------
+//
+// Generate or load the benchmark scene and upload the vertices and indices of each of its meshes. The
+// vertices of the generated meshes share the layout of Vertex, and are copied as-is
+//
+void D3D12HelloTriangle::CreateGeneratedSceneBuffers() {
+	static_assert(sizeof(nv_helpers_dx12::MeshVertex) == sizeof(Vertex), "Generated vertices must match the Vertex layout");
+
+	if (!m_glbFileName.empty())
+	{
+		// # DXR Extra: glTF scenes
+		// The zero-copy path keeps the file mapped and only uploads its BIN chunk, the copy path
+		// converts it into a scene uploaded as the generated ones. The load time and peak memory
+		// usage of both paths are reported for comparison
+		const auto start = std::chrono::steady_clock::now();
+		bool loaded;
+		if (m_glbCopyLoader)
+		{
+			loaded = nv_helpers_dx12::LoadGlbAsScene(m_glbFileName, &m_scene);
+		}
+		else
+		{
+			loaded = m_glb.Open(m_glbFileName);
+			if (loaded)
+			{
+				m_glbBinaryBuffer = CreateStaticBuffer(m_glb.GetBinaryChunk(), m_glb.GetBinaryChunkSize());
+				m_scene = nv_helpers_dx12::Scene();
+				m_scene.instances = m_glb.GetInstances();
+			}
+		}
+		if (!loaded)
+			throw std::runtime_error("Could not load " + m_glbFileName);
+		const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		OutputDebugStringA(("Loaded " + m_glbFileName + (m_glbCopyLoader ? " (copy)" : " (zero-copy)") + " in " +
+			std::to_string(seconds) + " s, peak memory usage " +
+			std::to_string(nv_helpers_dx12::GetPeakResidentSetSize() / (1024 * 1024)) + " MB\n").c_str());
+
+		// Instances of meshes without any triangle primitive are dropped
+		auto isEmpty = [this](const nv_helpers_dx12::SceneInstance& instance) {
+			return m_glbCopyLoader ? m_scene.meshes[instance.meshIndex].vertices.empty()
+				: m_glb.GetMeshes()[instance.meshIndex].primitives.empty();
+		};
+		m_scene.instances.erase(std::remove_if(m_scene.instances.begin(), m_scene.instances.end(), isEmpty), m_scene.instances.end());
+		if (!m_glbCopyLoader)
+			return;
+	}
+	else if (m_meshFile.empty())
+	{
+		m_scene = nv_helpers_dx12::GenerateScene(m_sceneDesc);
+	}
+	else
+	{
+		// A loaded mesh is instantiated once, untransformed
+		nv_helpers_dx12::Mesh mesh;
+		nv_helpers_dx12::MeshLoadStatistics statistics;
+		if (!nv_helpers_dx12::LoadMesh(m_meshFile, &mesh, &statistics))
+			throw std::runtime_error("Could not load " + m_meshFile);
+		OutputDebugStringA(("Loaded " + m_meshFile + ": " + std::to_string(mesh.GetTriangleCount()) + " triangles, " +
+			std::to_string(statistics.fileSizeInBytes / (1024 * 1024)) + " MB in " + std::to_string(statistics.seconds) + " s (" +
+			std::to_string(statistics.GetThroughput() / (1024. * 1024.)) + " MB/s)\n").c_str());
+
+		m_scene = nv_helpers_dx12::Scene();
+		m_scene.meshes.push_back(std::move(mesh));
+		m_scene.instances.push_back({ 0, {{1.f, 0.f, 0.f, 0.f}, {0.f, 1.f, 0.f, 0.f}, {0.f, 0.f, 1.f, 0.f}} });
+	}
+	if (!m_sceneObjFile.empty() && !nv_helpers_dx12::SaveSceneAsOBJ(m_scene, m_sceneObjFile))
+		throw std::runtime_error("Could not write the generated scene");
+
+	// # DXR Extra: Vertex welding
+	// The generated meshes are already indexed, only the imported ones may duplicate their vertices
+	if (m_weldMeshes && (!m_meshFile.empty() || !m_glbFileName.empty()))
+	{
+		size_t vertexCount = 0;
+		size_t weldedCount = 0;
+		const auto start = std::chrono::steady_clock::now();
+		for (auto& mesh : m_scene.meshes)
+		{
+			vertexCount += mesh.vertices.size();
+			nv_helpers_dx12::WeldMesh(&mesh, m_weldTolerance, m_weldTolerance);
+			weldedCount += mesh.vertices.size();
+		}
+		const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		OutputDebugStringA(("Vertex welding: " + std::to_string(vertexCount) + " -> " + std::to_string(weldedCount) +
+			" vertices in " + std::to_string(seconds) + " s\n").c_str());
+	}
+
+	// # DXR Extra: Mesh optimization
+	// The meshes are optimized in parallel, and the efficiency of a simulated FIFO vertex cache is
+	// reported before and after
+	if (m_optimizeMeshes)
+	{
+		nv_helpers_dx12::VertexCacheStatistics before;
+		nv_helpers_dx12::VertexCacheStatistics after;
+		const auto start = std::chrono::steady_clock::now();
+		nv_helpers_dx12::OptimizeMeshes(&m_scene.meshes, 0, &before, &after);
+		const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		auto describe = [](const nv_helpers_dx12::VertexCacheStatistics& statistics) {
+			return "ACMR " + std::to_string(statistics.GetACMR()) + ", ATVR " + std::to_string(statistics.GetATVR()) +
+				", hit rate " + std::to_string(statistics.GetHitRate());
+		};
+		OutputDebugStringA(("Mesh optimization in " + std::to_string(seconds) + " s: " + describe(before) + " -> " +
+			describe(after) + "\n").c_str());
+	}
+
+	// # DXR Extra: Meshlet culling
+	// The meshlets are built after the optimization, which makes them more compact
+	if (m_buildMeshlets)
+	{
+		const auto start = std::chrono::steady_clock::now();
+		m_sceneMeshlets = nv_helpers_dx12::BuildMeshlets(m_scene.meshes);
+		const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		size_t meshletCount = 0;
+		for (const auto& meshlets : m_sceneMeshlets)
+			meshletCount += meshlets.meshlets.size();
+		OutputDebugStringA(("Built " + std::to_string(meshletCount) + " meshlets in " + std::to_string(seconds) + " s\n").c_str());
+	}
+
+	// # DXR Extra: Levels of detail
+	// The levels are reordered for the vertex cache by the simplifier, the optimization of the
+	// original meshes only benefiting the first level
+	if (m_buildLods)
+	{
+		const auto start = std::chrono::steady_clock::now();
+		m_sceneLods = nv_helpers_dx12::BuildLodChains(m_scene.meshes);
+		const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		size_t lodCount = 0;
+		for (const auto& chain : m_sceneLods)
+			lodCount += chain.lods.size();
+		OutputDebugStringA(("Built " + std::to_string(lodCount) + " levels of detail for " + std::to_string(m_sceneLods.size()) +
+			" meshes in " + std::to_string(seconds) + " s\n").c_str());
+	}
+
+	// # DXR Extra: Compact vertex formats
+	// The memory used by the vertices is reported along with the one they would use in the Vertex
+	// layout
+	uint64_t vertexCount = 0;
+	uint64_t indexCount = 0;
+	uint64_t indexSizeInBytes = 0;
+	for (const auto& mesh : m_scene.meshes)
+	{
+		// Empty meshes are not instantiated, and do not need any buffer
+		m_sceneDecodes.emplace_back();
+		if (mesh.vertices.empty())
+		{
+			m_sceneVertexBuffers.push_back(nullptr);
+			m_sceneIndexBuffers.push_back(nullptr);
+			continue;
+		}
+		nv_helpers_dx12::PackedVertices packedVertices = PackVertices(
+			reinterpret_cast<const Vertex*>(mesh.vertices.data()), mesh.vertices.size(), &m_sceneDecodes.back());
+		m_sceneVertexBuffers.push_back(CreateStaticBuffer(packedVertices.data.data(), packedVertices.data.size()));
+		// # DXR Extra: Automatic 16-bit indices
+		nv_helpers_dx12::PackedIndices packedIndices = nv_helpers_dx12::PackIndices(mesh.indices.data(), mesh.indices.size(), mesh.vertices.size());
+		m_sceneIndexBuffers.push_back(CreateIndexBuffer(packedIndices));
+		vertexCount += mesh.vertices.size();
+		indexSizeInBytes += packedIndices.GetSizeInBytes();
+		indexCount += mesh.indices.size();
+
+		// # DXR Extra: Levels of detail
+		// The first level is the original mesh, already uploaded
+		if (m_buildLods)
+		{
+			const size_t meshIndex = m_sceneIndexBuffers.size() - 1;
+			m_sceneLodIndexBuffers.resize(meshIndex + 1);
+			const auto& lods = m_sceneLods[meshIndex].lods;
+			for (size_t lod = 1; lod < lods.size(); lod++)
+			{
+				nv_helpers_dx12::PackedIndices lodIndices = nv_helpers_dx12::PackIndices(lods[lod].indices.data(), lods[lod].indices.size(), mesh.vertices.size());
+				m_sceneLodIndexBuffers[meshIndex].push_back(CreateIndexBuffer(lodIndices));
+				indexSizeInBytes += lodIndices.GetSizeInBytes();
+				indexCount += lods[lod].indices.size();
+			}
+		}
+
+		// # DXR Extra: Geometry deduplication
+		m_geometryHashes[m_sceneVertexBuffers.back().Get()] = nv_helpers_dx12::GeometryDeduplicator::HashStridedData(
+			packedVertices.data.data(), packedVertices.vertexCount, m_vertexLayout.GetStride(), m_vertexLayout.GetPositionSize());
+	}
+	OutputDebugStringA(("Scene vertices: " + std::to_string(m_vertexLayout.GetStride()) + " bytes per vertex, " +
+		std::to_string(vertexCount * m_vertexLayout.GetStride() / 1024) + " KB instead of " +
+		std::to_string(vertexCount * sizeof(Vertex) / 1024) + " KB\n").c_str());
+	OutputDebugStringA(("Scene indices: " + std::to_string(indexSizeInBytes / 1024) + " KB instead of " +
+		std::to_string(indexCount * sizeof(UINT) / 1024) + " KB\n").c_str());
+}
+
+// # DXR Extra: Automatic 16-bit indices
+//---CreateIndexBuffer----------------------------------------------------------
+//
+// Upload packed indices, and register their format and content hash
+//
+ComPtr<ID3D12Resource> D3D12HelloTriangle::CreateIndexBuffer(const nv_helpers_dx12::PackedIndices& indices) {
+	ComPtr<ID3D12Resource> buffer = CreateStaticBuffer(indices.data.data(), indices.data.size());
+	m_indexFormats[buffer.Get()] = indices.format == nv_helpers_dx12::IndexFormat::UInt16 ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
+	// # DXR Extra: Geometry deduplication
+	m_geometryHashes[buffer.Get()] = nv_helpers_dx12::GeometryDeduplicator::HashData(indices.data.data(), indices.GetSizeInBytes());
+	return buffer;
+}
+
+// # DXR Extra: Automatic 16-bit indices
+//---GetIndexFormat-------------------------------------------------------------
+//
+DXGI_FORMAT D3D12HelloTriangle::GetIndexFormat(ID3D12Resource* indexBuffer) const {
+	auto format = m_indexFormats.find(indexBuffer);
+	return format != m_indexFormats.end() ? format->second : DXGI_FORMAT_R32_UINT;
+}
+
+// # DXR Extra: Compact vertex formats
+//---PackVertices---------------------------------------------------------------
+//
+// Pack vertices in the selected layout, and return the decoding of their positions
+//
+nv_helpers_dx12::PackedVertices D3D12HelloTriangle::PackVertices(const Vertex* vertices, size_t vertexCount, PositionDecode* decode) {
+	static_assert(sizeof(nv_helpers_dx12::MeshVertex) == sizeof(Vertex), "Vertex must match the MeshVertex layout");
+	nv_helpers_dx12::PackedVertices packed = nv_helpers_dx12::PackVertices(
+		reinterpret_cast<const nv_helpers_dx12::MeshVertex*>(vertices), vertexCount, m_vertexLayout);
+	decode->scale = XMFLOAT4(packed.positionScale[0], packed.positionScale[1], packed.positionScale[2], 1.f);
+	decode->offset = XMFLOAT4(packed.positionOffset[0], packed.positionOffset[1], packed.positionOffset[2], 0.f);
+	return packed;
+}
+
+// # DXR Extra: Compact vertex formats
+//---GetPositionFormat----------------------------------------------------------
+//
+// Format of the positions, for the input layout and the BLAS geometries
+//
+DXGI_FORMAT D3D12HelloTriangle::GetPositionFormat() const {
+	switch (m_vertexLayout.positionFormat)
+	{
+	case nv_helpers_dx12::PositionFormat::Half4:
+		return DXGI_FORMAT_R16G16B16A16_FLOAT;
+	case nv_helpers_dx12::PositionFormat::SNorm16x4:
+		return DXGI_FORMAT_R16G16B16A16_SNORM;
+	default:
+		return DXGI_FORMAT_R32G32B32_FLOAT;
+	}
+}
+
+// # DXR Extra: Compact vertex formats
+//---GetColorFormat-------------------------------------------------------------
+//
+DXGI_FORMAT D3D12HelloTriangle::GetColorFormat() const {
+	return m_vertexLayout.colorFormat == nv_helpers_dx12::ColorFormat::UNorm8x4 ? DXGI_FORMAT_R8G8B8A8_UNORM
+		: DXGI_FORMAT_R32G32B32A32_FLOAT;
+}
+
+// # DXR Extra: Compact vertex formats
+//---GetVertexLayoutConstants---------------------------------------------------
+//
+// The hit shaders fetch the vertex colors according to two root constants, stored in a single
+// SBT entry: the stride and color offset in the first one, and the color and index formats in
+// the second
+//
+void* D3D12HelloTriangle::GetVertexLayoutConstants(DXGI_FORMAT indexFormat) const {
+	const UINT64 strideAndOffset = m_vertexLayout.GetStride() | (m_vertexLayout.GetColorOffset() << 16);
+	const UINT64 colorFormat = m_vertexLayout.colorFormat == nv_helpers_dx12::ColorFormat::UNorm8x4 ? 1 : 0;
+	// # DXR Extra: Automatic 16-bit indices
+	const UINT64 shortIndices = indexFormat == DXGI_FORMAT_R16_UINT ? 2 : 0;
+	return reinterpret_cast<void*>(strideAndOffset | ((colorFormat | shortIndices) << 32));
+}
+
+// # DXR Extra: Compact vertex formats
+//---GetDecodeMatrix------------------------------------------------------------
+//
+// Transform from the packed to the actual positions, to be applied before the instance transforms
+//
+XMMATRIX D3D12HelloTriangle::GetDecodeMatrix(const PositionDecode& decode) {
+	return XMMatrixScaling(decode.scale.x, decode.scale.y, decode.scale.z) *
+		XMMatrixTranslation(decode.offset.x, decode.offset.y, decode.offset.z);
+}
+
+// # Benchmark scenes
+// # DXR Extra: Staging uploads
+//---CreateStaticBuffer---------------------------------------------------------
+//
+// Create a buffer in the default heap, initialized with a copy of the data. The buffer is placed in
+// a default heap of the resource allocator, and filled by the upload batcher
+//
+ComPtr<ID3D12Resource> D3D12HelloTriangle::CreateStaticBuffer(const void* data, UINT64 size) {
+	if (!m_uploadBatcher)
+		throw std::logic_error("Static buffers can only be created upon initialization");
+	ComPtr<ID3D12Resource> buffer = m_resourceAllocator->CreateBuffer(size, D3D12_RESOURCE_FLAG_NONE,
+		D3D12_RESOURCE_STATE_COPY_DEST, nv_helpers_dx12::kDefaultHeapProps);
+	m_uploadBatcher->Upload(buffer.Get(), data, size);
+	return buffer;
+}
+
+// # DXR Extra: glTF scenes
+//---CreateGlbBottomLevelAS-----------------------------------------------------
+//
+// Build the BLAS of a mesh of the mapped .glb file. The positions and indices are read in place
+// from the uploaded BIN chunk whenever their layout allows it, and only repacked otherwise. The
+// glTF nodes already share their meshes, so these BLAS bypass the geometry deduplication
+//
+ComPtr<ID3D12Resource> D3D12HelloTriangle::CreateGlbBottomLevelAS(const nv_helpers_dx12::GltfMesh& mesh) {
+	nv_helpers_dx12::BottomLevelASGenerator bottomLevelAS;
+	for (const auto& primitive : mesh.primitives)
+	{
+		const nv_helpers_dx12::GltfAccessor& positions = primitive.positions;
+		ID3D12Resource* vertexBuffer = m_glbBinaryBuffer.Get();
+		UINT64 vertexOffsetInBytes = positions.offsetInBytes;
+		UINT vertexStrideInBytes = positions.strideInBytes;
+		if (!nv_helpers_dx12::GlbFile::IsDirectPositionStream(positions))
+		{
+			std::vector<XMFLOAT3> repacked(positions.count);
+			for (uint32_t v = 0; v < positions.count; v++)
+				repacked[v] = XMFLOAT3(positions.GetFloat(v, 0), positions.GetFloat(v, 1), positions.GetFloat(v, 2));
+			m_glbRepackedBuffers.push_back(CreateStaticBuffer(repacked.data(), repacked.size() * sizeof(XMFLOAT3)));
+			vertexBuffer = m_glbRepackedBuffers.back().Get();
+			vertexOffsetInBytes = 0;
+			vertexStrideInBytes = sizeof(XMFLOAT3);
+		}
+
+		const nv_helpers_dx12::GltfAccessor& indices = primitive.indices;
+		if (!indices.IsValid())
+		{
+			bottomLevelAS.AddVertexBuffer(vertexBuffer, vertexOffsetInBytes, positions.count, vertexStrideInBytes, 0, 0);
+			continue;
+		}
+		ID3D12Resource* indexBuffer = m_glbBinaryBuffer.Get();
+		UINT64 indexOffsetInBytes = indices.offsetInBytes;
+		// # DXR Extra: Automatic 16-bit indices
+		// 16-bit glTF indices are referenced in place as well, and the repacked indices are narrowed
+		// whenever the primitive allows it
+		DXGI_FORMAT indexFormat = indices.GetElementSize() == sizeof(uint16_t) ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
+		if (!nv_helpers_dx12::GlbFile::IsDirectIndexStream(indices))
+		{
+			std::vector<UINT> repacked(indices.count);
+			for (uint32_t i = 0; i < indices.count; i++)
+				repacked[i] = std::min(indices.GetIndex(i), positions.count - 1);
+			m_glbRepackedBuffers.push_back(CreateIndexBuffer(nv_helpers_dx12::PackIndices(repacked.data(), repacked.size(), positions.count)));
+			indexBuffer = m_glbRepackedBuffers.back().Get();
+			indexOffsetInBytes = 0;
+			indexFormat = GetIndexFormat(indexBuffer);
+		}
+		bottomLevelAS.AddVertexBuffer(vertexBuffer, vertexOffsetInBytes, positions.count, vertexStrideInBytes,
+			indexBuffer, indexOffsetInBytes, indices.count, nullptr, 0, true, DXGI_FORMAT_R32G32B32_FLOAT, indexFormat);
+	}
+
+	UINT64 scratchSizeInBytes = 0;
+	UINT64 resultSizeInBytes = 0;
+	bottomLevelAS.ComputeASBufferSizes(m_device.Get(), false, &scratchSizeInBytes, &resultSizeInBytes);
+	ComPtr<ID3D12Resource> result = m_resourceAllocator->CreateBuffer(resultSizeInBytes, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS,
+		D3D12_RESOURCE_STATE_RAYTRACING_ACCELERATION_STRUCTURE, nv_helpers_dx12::kDefaultHeapProps);
+	// # DXR Extra: Batched BLAS builds
+	m_pendingBottomLevelAS.push_back({ std::move(bottomLevelAS), result, scratchSizeInBytes });
+	return result;
 }
@@ -29,10 +29,12 @@
 //---raytracing header---
 #include <dxcapi.h>
 #include <vector>
+#include <unordered_map>
 
 // ## Acceleration Struceture
 #include "nv_helpers_dx12/TopLevelASGenerator.h"
 #include "nv_helpers_dx12/BottomLevelASGenerator.h"
+#include "nv_helpers_dx12/GeometryDeduplicator.h"
 
 // ## Shader Binding Table
 #include "nv_helpers_dx12/ShaderBindingTableGenerator.h"
@@ -40,6 +42,69 @@
 // ## Raytracing pipeline
 #include "nv_helpers_dx12/RaytracingPipelineGenerator.h"
 #include "nv_helpers_dx12/RootSignatureGenerator.h"
+
+// ## Benchmark scenes
+#include "nv_helpers_dx12/GltfLoader.h"
+#include "nv_helpers_dx12/MeshLoader.h"
+#include "nv_helpers_dx12/SceneGenerator.h"
+
+// ## Compact vertex formats
+#include "nv_helpers_dx12/VertexPacking.h"
+
+// ## Automatic 16-bit indices
+#include "nv_helpers_dx12/IndexPacking.h"
+
+// ## Mesh optimization
+#include "nv_helpers_dx12/MeshOptimizer.h"
+
+// ## Meshlet culling
+#include "nv_helpers_dx12/MeshletBuilder.h"
+
+// ## Levels of detail
+#include "nv_helpers_dx12/MeshSimplifier.h"
+
+// ## Vertex welding
+#include "nv_helpers_dx12/VertexWelder.h"
+
+// ## Frame pipelining
+#include "nv_helpers_dx12/FramePacer.h"
+#include <memory>
+
+// ## Upload ring
+#include "nv_helpers_dx12/UploadRing.h"
+
+// # DXR Extra: Placed resources
+#include "nv_helpers_dx12/ResourceHeapAllocator.h"
+
+// # DXR Extra: Descriptor allocation
+#include "nv_helpers_dx12/DescriptorAllocator.h"
+
+// # DXR Extra: Resource state tracking
+#include "nv_helpers_dx12/ResourceStateTracker.h"
+
+// # DXR Extra: Render graph
+#include "nv_helpers_dx12/RenderGraph.h"
+
+// # DXR Extra: Parallel recording
+#include "nv_helpers_dx12/CommandRecorder.h"
+
+// # DXR Extra: Async acceleration structure builds
+#include "nv_helpers_dx12/AsyncBuildScheduler.h"
+
+// # DXR Extra: Deferred release
+#include "nv_helpers_dx12/DeferredReleaseQueue.h"
+
+// # DXR Extra: Staging uploads
+#include "nv_helpers_dx12/UploadBatcher.h"
+
+// # DXR Extra: Shader cache
+#include "nv_helpers_dx12/ShaderCache.h"
+
+// # DXR Extra: Parallel shader compilation
+#include "nv_helpers_dx12/ShaderCompileQueue.h"
+
+// # DXR Extra: Pipeline cache
+#include "nv_helpers_dx12/PipelineCache.h"
 //-----------------------
 
 using namespace DirectX;
@@ -75,8 +140,13 @@ private:
 	CD3DX12_RECT m_scissorRect;
 	ComPtr<IDXGISwapChain3> m_swapChain;
 	ComPtr<ID3D12Device5> m_device;
+	// # DXR Extra: Placed resources
+	// Declared before the buffers, so that its heaps are released after the buffers placed in them
+	std::unique_ptr<nv_helpers_dx12::ResourceHeapAllocator> m_resourceAllocator;
 	ComPtr<ID3D12Resource> m_renderTargets[FrameCount];
-	ComPtr<ID3D12CommandAllocator> m_commandAllocator;
+	// # DXR Extra: Frame pipelining
+	// One allocator per frame slot, reset once the GPU is done with the frame which last used it
+	ComPtr<ID3D12CommandAllocator> m_commandAllocators[FrameCount];
 	ComPtr<ID3D12CommandQueue> m_commandQueue;
 	ComPtr<ID3D12RootSignature> m_rootSignature;
 	ComPtr<ID3D12DescriptorHeap> m_rtvHeap;
@@ -92,12 +162,117 @@ private:
 	UINT m_frameIndex;
 	HANDLE m_fenceEvent;
 	ComPtr<ID3D12Fence> m_fence;
-	UINT64 m_fenceValue;
 
 	void LoadPipeline();
 	void LoadAssets();
 	void PopulateCommandList();
-	void WaitForPreviousFrame();
+
+	// ----------------------------------------------------------------------------------
+	// # DXR Extra: Frame pipelining
+	// The CPU records up to FrameCount frames ahead of the GPU. The frame pacer waits for the fence
+	// of the frame which last used a slot before its command allocator and camera slice are reused
+	struct CommandQueueFence : public nv_helpers_dx12::FramePacer::Queue {
+		ID3D12CommandQueue* queue = nullptr;
+		ID3D12Fence* fence = nullptr;
+		HANDLE event = nullptr;
+		UINT64 value = 0;
+
+		uint64_t Signal() override;
+		uint64_t GetCompletedValue() override;
+		void Wait(uint64_t value) override;
+	};
+	void WaitForGpu();
+	void MoveToNextFrame();
+	static const UINT kFramePacingReportInterval = 100;
+	CommandQueueFence m_queueFence;
+	std::unique_ptr<nv_helpers_dx12::FramePacer> m_framePacer;
+
+	// ----------------------------------------------------------------------------------
+	// # DXR Extra: Upload ring
+	// The data written by the CPU every frame is suballocated from a persistently mapped upload
+	// buffer. The allocations of a frame are released once the GPU reaches the fence of the frame
+	struct UploadAllocation {
+		uint8_t* data;
+		D3D12_GPU_VIRTUAL_ADDRESS address;
+		UINT64 offset;
+	};
+	void CreateUploadRing();
+	UploadAllocation AllocateUpload(UINT64 sizeInBytes, UINT64 alignment = nv_helpers_dx12::UploadRing::kConstantBufferAlignment);
+	static const UINT64 kUploadRingSize = 1024 * 1024;
+	nv_helpers_dx12::UploadRing m_uploadRing{ kUploadRingSize };
+	ComPtr<ID3D12Resource> m_uploadRingBuffer;
+	uint8_t* m_uploadRingData = nullptr;
+
+	// ----------------------------------------------------------------------------------
+	// # DXR Extra: Placed resources
+	// The long-lived buffers are placed in a few large heaps, one pool per heap type, instead of
+	// being committed one by one. The scratch buffers are transient and stay committed.
+	// -committed creates all the buffers as committed resources, for comparison, and -tlsfbench
+	// runs the stress benchmark of the allocator core at startup
+	void ReportResourceHeaps();
+	void RunTlsfBenchmark();
+	bool m_placeResources = true;
+	bool m_runTlsfBenchmark = false;
+
+	// ----------------------------------------------------------------------------------
+	// # DXR Extra: Descriptor allocation
+	// The CBV/SRV/UAV descriptors of the shaders live in a single shader-visible heap, bound once
+	// per command list. The raygen descriptors are a static range referenced by the SBT, and the
+	// rasterization table is copied on bind from a CPU-only staging heap into the transient ring,
+	// whose slots are released along with the frame
+	void CreateDescriptorHeaps();
+	D3D12_CPU_DESCRIPTOR_HANDLE GetDescriptorCpuHandle(uint32_t slot) const;
+	D3D12_GPU_DESCRIPTOR_HANDLE GetDescriptorGpuHandle(uint32_t slot) const;
+	D3D12_GPU_DESCRIPTOR_HANDLE BindStagingDescriptor(uint32_t stagingSlot);
+	static const uint32_t kStaticDescriptorCount = 16;
+	static const uint32_t kPersistentDescriptorCount = 1024;
+	static const uint32_t kTransientDescriptorCount = 1024;
+	static const uint32_t kStagingDescriptorCount = 256;
+	nv_helpers_dx12::DescriptorAllocator m_descriptorAllocator{ kStaticDescriptorCount, kPersistentDescriptorCount, kTransientDescriptorCount };
+	nv_helpers_dx12::DescriptorFreeList m_stagingDescriptors{ 0, kStagingDescriptorCount };
+	ComPtr<ID3D12DescriptorHeap> m_descriptorHeap;
+	ComPtr<ID3D12DescriptorHeap> m_stagingDescriptorHeap;
+	UINT m_descriptorSize = 0;
+	uint32_t m_rayGenDescriptors = 0;
+	uint32_t m_cameraStagingDescriptor = 0;
+
+	// ----------------------------------------------------------------------------------
+	// # DXR Extra: Resource state tracking
+	// The command recording declares the state each resource is used in. The tracker derives the
+	// transitions, drops and merges the redundant ones, and FlushBarriers issues them as a single
+	// ResourceBarrier call before the commands using the resources
+	void FlushBarriers();
+	nv_helpers_dx12::ResourceStateTracker m_stateTracker;
+	std::vector<nv_helpers_dx12::ResourceBarrierDesc> m_trackedBarriers;
+	std::vector<D3D12_RESOURCE_BARRIER> m_barriers;
+
+	// ----------------------------------------------------------------------------------
+	// # DXR Extra: Render graph
+	// The frame is described as passes declaring the resources they use, one graph per rendering
+	// mode, and the graphs record the commands and derive the barriers. The depth buffer and the
+	// raytracing output are transient resources placed in a heap shared by both graphs: each mode
+	// only uses one of them, so they alias each other. With -committed, or on resource heap tier
+	// 1 which cannot mix depth buffers and UAV textures in a heap, they are committed instead
+	struct FrameGraph
+	{
+		nv_helpers_dx12::RenderGraph graph;
+		uint32_t backBuffer = 0;
+		uint32_t depthStencil = 0;
+		uint32_t output = 0;
+	};
+	void CreateFrameGraphs();
+	void BuildFrameGraph(FrameGraph* frameGraph, bool raster);
+	ComPtr<ID3D12Resource> CreateTransientTexture(FrameGraph* frameGraph, uint32_t resource,
+		const D3D12_RESOURCE_DESC& desc, const D3D12_CLEAR_VALUE* clearValue);
+	void RecordRasterization();
+	void RecordRaytracing();
+	void ReportFrameGraphs();
+	FrameGraph m_rasterGraph;
+	FrameGraph m_raytracingGraph;
+	ComPtr<ID3D12Heap> m_transientHeap;
+	D3D12_RESOURCE_DESC m_depthStencilDesc = {};
+	D3D12_RESOURCE_DESC m_outputDesc = {};
+	bool m_previousFrameRaster = true;
 
 	// ----------------------------------------------------------------------------------
 	// # DXR
@@ -106,6 +281,268 @@ private:
 	virtual void OnKeyUp(UINT8 key);
 	bool m_raster = true;
 
+	// ----------------------------------------------------------------------------------
+	// # Benchmark scenes
+	// A procedural scene can replace the tetrahedron, using the command line:
+	//   -scene grid|random|clustered  -instances N  -meshes N  -triangles N  -seed N
+	//   -clusters N  -overlap F  -sceneobj file.obj (also write the flattened scene)
+	// or by a single mesh loaded from an OBJ or binary PLY file with -mesh file.obj|file.ply
+	// or by a glTF scene with -glb file.glb, mapped in place unless -glbcopy is given
+	// The scene is raytraced, one hit group per instance, on top of the ground plane
+	virtual void ParseCommandLineArgs(WCHAR* argv[], int argc);
+	void CreateGeneratedSceneBuffers();
+	// # DXR Extra: Staging uploads
+	ComPtr<ID3D12Resource> CreateStaticBuffer(const void* data, UINT64 size);
+	bool m_useGeneratedScene = false;
+	nv_helpers_dx12::SceneDesc m_sceneDesc;
+	std::string m_sceneObjFile;
+	std::string m_meshFile;
+	nv_helpers_dx12::Scene m_scene;
+	std::vector<ComPtr<ID3D12Resource>> m_sceneVertexBuffers;
+	std::vector<ComPtr<ID3D12Resource>> m_sceneIndexBuffers;
+
+	// # DXR Extra: glTF scenes
+	// With the zero-copy loader, the BLAS reference the geometry directly in the uploaded BIN
+	// chunk, except for the streams whose format requires repacking
+	ComPtr<ID3D12Resource> CreateGlbBottomLevelAS(const nv_helpers_dx12::GltfMesh& mesh);
+	std::string m_glbFileName;
+	bool m_glbCopyLoader = false;
+	nv_helpers_dx12::GlbFile m_glb;
+	ComPtr<ID3D12Resource> m_glbBinaryBuffer;
+	std::vector<ComPtr<ID3D12Resource>> m_glbRepackedBuffers;
+
+	// ----------------------------------------------------------------------------------
+	// # DXR Extra: Compact vertex formats
+	// The vertices can be stored with half-float or 16-bit normalized positions and RGBA8 colors,
+	// using -positionformat float|half|snorm16 and -colorformat float|rgba8. The normalized
+	// positions are decoded with a per-mesh scale and offset, passed to the vertex shader as root
+	// constants and folded into the TLAS instance transforms
+	struct PositionDecode
+	{
+		XMFLOAT4 scale;
+		XMFLOAT4 offset;
+	};
+	nv_helpers_dx12::PackedVertices PackVertices(const Vertex* vertices, size_t vertexCount, PositionDecode* decode);
+	DXGI_FORMAT GetPositionFormat() const;
+	DXGI_FORMAT GetColorFormat() const;
+	void* GetVertexLayoutConstants(DXGI_FORMAT indexFormat) const;
+	static XMMATRIX GetDecodeMatrix(const PositionDecode& decode);
+	nv_helpers_dx12::VertexLayout m_vertexLayout;
+	PositionDecode m_tetrahedronDecode;
+	PositionDecode m_planeDecode;
+	std::vector<PositionDecode> m_sceneDecodes;
+
+	// ----------------------------------------------------------------------------------
+	// # DXR Extra: Automatic 16-bit indices
+	// Meshes with fewer than 65536 vertices use 16-bit indices. The format of each index buffer is
+	// recorded upon upload, buffers without a registered format using 32-bit indices
+	ComPtr<ID3D12Resource> CreateIndexBuffer(const nv_helpers_dx12::PackedIndices& indices);
+	DXGI_FORMAT GetIndexFormat(ID3D12Resource* indexBuffer) const;
+	std::unordered_map<ID3D12Resource*, DXGI_FORMAT> m_indexFormats;
+
+	// ----------------------------------------------------------------------------------
+	// # DXR Extra: Mesh optimization
+	// The triangles and vertices of the scene meshes are reordered for the post-transform vertex
+	// cache and the overdraw upon import, unless -nomeshopt is given
+	bool m_optimizeMeshes = true;
+
+	// ----------------------------------------------------------------------------------
+	// # DXR Extra: Meshlet culling
+	// With -meshlets, the scene meshes are split into meshlets upon import, and the meshlets of all
+	// the instances are culled against the camera on the CPU each frame. The fraction of culled
+	// triangles and the culling throughput are reported every kMeshletReportInterval frames
+	void CullSceneMeshlets();
+	static const UINT kMeshletReportInterval = 100;
+	bool m_buildMeshlets = false;
+	std::vector<nv_helpers_dx12::MeshletMesh> m_sceneMeshlets;
+	nv_helpers_dx12::MeshletCullingStatistics m_meshletCullingStatistics;
+	UINT m_meshletCullingFrames = 0;
+
+	// ----------------------------------------------------------------------------------
+	// # DXR Extra: Levels of detail
+	// With -lod, a chain of simplified index buffers is generated for each scene mesh upon import,
+	// sharing the vertex buffer of the mesh. Each instance then uses the coarsest level whose error
+	// stays below a pixel from the initial camera, with one BLAS per level
+	void SelectSceneLods();
+	static constexpr float kMaxLodPixelError = 1.f;
+	bool m_buildLods = false;
+	std::vector<nv_helpers_dx12::LodChain> m_sceneLods;
+	std::vector<std::vector<ComPtr<ID3D12Resource>>> m_sceneLodIndexBuffers;
+	std::vector<UINT> m_instanceLods;
+
+	// ----------------------------------------------------------------------------------
+	// # DXR Extra: Vertex welding
+	// The vertices of the imported meshes sharing their position and color are merged upon import,
+	// within a tolerance given by -weldtolerance, unless -noweld is given. The plane is always welded
+	bool m_weldMeshes = true;
+	float m_weldTolerance = 0.f;
+	ComPtr<ID3D12Resource> m_planeIndexBuffer;
+	D3D12_INDEX_BUFFER_VIEW m_planeIndexBufferView;
+	UINT m_planeVertexCount = 0;
+	UINT m_planeIndexCount = 0;
+
+	// ----------------------------------------------------------------------------------
+	// # DXR Extra: Parallel recording
+	// The frame is recorded into a sequence of command lists, executed by a single call. The draws
+	// of the rasterization are split into ranges recorded in parallel by -recordthreads N workers,
+	// one per core by default, each with its command list and one allocator per frame slot. The
+	// rasterization draws the tetrahedron or the instances of the scene, except the meshes of
+	// mapped glTF files, and the plane. -recordbench measures the scaling of the recording with
+	// the mock backend at startup
+	struct CommandListPool : public nv_helpers_dx12::CommandRecorder::Backend {
+		std::vector<ComPtr<ID3D12GraphicsCommandList4>> lists;
+		// FrameCount allocators per list
+		std::vector<ComPtr<ID3D12CommandAllocator>> allocators;
+		std::vector<ID3D12CommandList*> executedLists;
+		ID3D12CommandQueue* queue = nullptr;
+		ID3D12PipelineState* initialState = nullptr;
+
+		void Open(uint32_t list, uint32_t frameSlot) override;
+		void Close(uint32_t list) override;
+		void Execute(const uint32_t* order, uint32_t count) override;
+	};
+	// Root constants of a draw: the decoding of the positions, and the rows of the 3x4
+	// object-to-world transform
+	struct DrawConstants {
+		PositionDecode decode;
+		XMFLOAT4 transform[3];
+	};
+	struct RasterDraw {
+		D3D12_VERTEX_BUFFER_VIEW vertexBufferView;
+		D3D12_INDEX_BUFFER_VIEW indexBufferView;
+		UINT indexCount;
+		DrawConstants constants;
+	};
+	void CreateCommandRecorder();
+	void CreateRasterDraws();
+	void OpenSerialCommandList();
+	void SetFrameState(ID3D12GraphicsCommandList4* commandList);
+	void RunRecordingBenchmark();
+	static const UINT kMaxRecordingWorkers = 8;
+	static const UINT kMinDrawsPerList = 64;
+	UINT m_recordingWorkerCount = 0;
+	bool m_runRecordingBenchmark = false;
+	CommandListPool m_commandListPool;
+	std::unique_ptr<nv_helpers_dx12::CommandRecorder> m_commandRecorder;
+	std::vector<RasterDraw> m_rasterDraws;
+
+	// ----------------------------------------------------------------------------------
+	// # DXR Extra: Async acceleration structure builds
+	// With -asynctlas, the TLAS is refitted every raytraced frame on a compute queue, into one
+	// version per frame in flight, so that the build of a frame overlaps the rendering of the
+	// previous one. The queues wait for each other on the GPU, as scheduled by m_asBuildScheduler.
+	// -asbuildsim reports the overlap of the schedule simulated with the mock queues at startup
+	void CreateAsyncBuilds();
+	void BuildTopLevelASAsync();
+	void RunAsyncBuildSimulation();
+	bool m_asyncTopLevelAS = false;
+	bool m_runAsyncBuildSimulation = false;
+	ComPtr<ID3D12CommandQueue> m_computeQueue;
+	ComPtr<ID3D12Fence> m_computeFence;
+	CommandQueueFence m_computeQueueFence;
+	ComPtr<ID3D12CommandAllocator> m_computeAllocators[FrameCount];
+	ComPtr<ID3D12GraphicsCommandList4> m_computeCommandList;
+	std::unique_ptr<nv_helpers_dx12::AsyncBuildScheduler> m_asBuildScheduler;
+	// Results and instance descriptors of each version, the first being the TLAS built upon
+	// initialization
+	std::vector<ComPtr<ID3D12Resource>> m_topLevelASVersions;
+	std::vector<ComPtr<ID3D12Resource>> m_topLevelASInstanceDescs;
+	// Version traced by the current frame, and whether the scheduler has to be told its end
+	uint32_t m_topLevelASVersion = 0;
+	bool m_topLevelASInUse = false;
+
+	// ----------------------------------------------------------------------------------
+	// # DXR Extra: Deferred release
+	// The resources replaced at runtime are released once the GPU completes the frames which may
+	// still reference them, without flushing the queue. The B key rebuilds the shader binding
+	// table into a new buffer, releasing the previous one this way
+	void DeferRelease(ComPtr<ID3D12Resource>& resource);
+	nv_helpers_dx12::DeferredReleaseQueue m_deferredReleases;
+
+	// ----------------------------------------------------------------------------------
+	// # DXR Extra: Staging uploads
+	// The static geometry lives in default heaps. Its initial data is packed into a staging buffer,
+	// and copied by batches executed on the command queue and signaling their own fence. The
+	// staging buffer is released once the initialization is complete
+	struct StagingUploadQueue : public nv_helpers_dx12::UploadBatcher::Backend {
+		ComPtr<ID3D12GraphicsCommandList4> commandList;
+		// The allocator of a batch is reused once the GPU is done with it
+		ComPtr<ID3D12CommandAllocator> allocators[FrameCount];
+		UINT64 allocatorFenceValues[FrameCount] = {};
+		UINT64 batchCount = 0;
+		CommandQueueFence fence;
+		ID3D12Resource* stagingBuffer = nullptr;
+		uint8_t* stagingData = nullptr;
+		std::vector<D3D12_RESOURCE_BARRIER> barriers;
+
+		void WriteStaging(uint64_t stagingOffset, const void* data, uint64_t size) override;
+		uint64_t Submit(const nv_helpers_dx12::UploadCopy* copies, uint32_t count) override;
+		uint64_t GetCompletedValue() override { return fence.GetCompletedValue(); }
+		void Wait(uint64_t value) override { fence.Wait(value); }
+	};
+	void CreateUploadBatcher();
+	void FinishStaticUploads();
+	static const UINT64 kStagingBufferSize = 8 * 1024 * 1024;
+	ComPtr<ID3D12Fence> m_uploadFence;
+	ComPtr<ID3D12Resource> m_stagingBuffer;
+	StagingUploadQueue m_stagingUploads;
+	std::unique_ptr<nv_helpers_dx12::UploadBatcher> m_uploadBatcher;
+
+	// ----------------------------------------------------------------------------------
+	// # DXR Extra: Shader cache
+	// The shaders are compiled through a cache storing their bytecode in kShaderCacheDirectory, so
+	// that the next launches load it instead of compiling. The DXIL libraries are compiled by DXC
+	// and the rasterization shaders by D3DCompile. -noshadercache compiles every shader. The time
+	// saved by the cache is reported once the raytracing pipeline is created
+	// # DXR Extra: Parallel shader compilation
+	// Each compiler has its own DXC instances, and is used by a single thread
+	struct ShaderCompiler : public nv_helpers_dx12::ShaderCache::Compiler {
+		ComPtr<IDxcCompiler> dxcCompiler;
+		ComPtr<IDxcLibrary> dxcLibrary;
+		ComPtr<IDxcIncludeHandler> dxcIncludeHandler;
+		// Versions of both compilers, queried once
+		std::string version;
+
+		void CreateDxc();
+		std::string GetVersion() override;
+		bool Compile(const std::string& fileName, const std::string& entryPoint, const std::string& target,
+			uint32_t flags, std::vector<uint8_t>* bytecode, std::string* errors) override;
+	};
+	void ReportShaderCache();
+	static constexpr const char* kShaderCacheDirectory = "ShaderCache";
+	bool m_useShaderCache = true;
+	std::unique_ptr<nv_helpers_dx12::ShaderCache> m_shaderCache;
+
+	// ----------------------------------------------------------------------------------
+	// # DXR Extra: Parallel shader compilation
+	// All the shaders are submitted at the start of the initialization, one task per library or
+	// entry point, and compiled by -shaderthreads N workers, one per core by default, while the
+	// device and the assets are created. The rasterization shaders are waited for by the pipeline
+	// state, and the libraries by the raytracing pipeline. -shaderbench measures the scaling of the
+	// queue with the mock compiler at startup
+	void CompileShaders();
+	void RunShaderCompileBenchmark();
+	UINT m_shaderWorkerCount = 0;
+	bool m_runShaderCompileBenchmark = false;
+	std::unique_ptr<nv_helpers_dx12::ShaderCompileQueue> m_shaderCompileQueue;
+	nv_helpers_dx12::ShaderCompileQueue::Result m_vertexShader;
+	nv_helpers_dx12::ShaderCompileQueue::Result m_pixelShader;
+
+	// ----------------------------------------------------------------------------------
+	// # DXR Extra: Pipeline cache
+	// The pipelines are identified by their canonical description, and stored in
+	// kPipelineCacheDirectory. The graphics pipeline state is created from the blob cached by the
+	// previous launch, and from scratch if the driver rejects it. DXR state objects have no cached
+	// blob, hence the entry of the raytracing pipeline only records its description, so that a
+	// launch reports whether the pipeline changed. -nopipelinecache creates every pipeline from
+	// scratch
+	nv_helpers_dx12::PipelineDescription DescribeGraphicsPipeline(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& psoDesc);
+	ComPtr<ID3D12PipelineState> CreateCachedPipelineState(D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDesc);
+	void ReportPipelineCache();
+	static constexpr const char* kPipelineCacheDirectory = "PipelineCache";
+	bool m_usePipelineCache = true;
+	std::unique_ptr<nv_helpers_dx12::PipelineCache> m_pipelineCache;
+
 	// ----------------------------------------------------------------------------------
 	// # DXR Acceleration Structure
 	struct AccelerationStructureBuffers {
@@ -132,6 +569,30 @@ private:
 		std::vector<std::pair<ComPtr<ID3D12Resource>, uint32_t>> vIndexBuffers = {});
 
 
+	// # DXR Extra: Batched BLAS builds
+	// CreateBottomLevelAS only allocates the result buffer and queues the build. All the queued
+	// builds are then recorded by BuildPendingBottomLevelAS, sharing a single scratch pool whose
+	// size is capped by m_blasScratchBudget, or by the largest build if it needs more
+	struct PendingBottomLevelAS {
+		nv_helpers_dx12::BottomLevelASGenerator generator;
+		ComPtr<ID3D12Resource> pResult;
+		UINT64 scratchSizeInBytes;
+	};
+	std::vector<PendingBottomLevelAS> m_pendingBottomLevelAS;
+	UINT64 m_blasScratchBudget = 32 * 1024 * 1024;
+
+	/// Record all the queued BLAS builds on the command list
+	/// \return    Scratch pool, to be kept until the command list has been executed
+	ComPtr<ID3D12Resource> BuildPendingBottomLevelAS();
+
+	// # DXR Extra: Geometry deduplication
+	// Content hashes of the geometry buffers are computed upon upload. CreateBottomLevelAS combines
+	// them into a key, so that identical geometries share a single BLAS, referenced by several
+	// instances of the TLAS
+	std::unordered_map<ID3D12Resource*, uint64_t> m_geometryHashes;
+	nv_helpers_dx12::GeometryDeduplicator m_blasDeduplicator;
+	std::vector<ComPtr<ID3D12Resource>> m_uniqueBottomLevelAS;
+
 	/// Create the main acceleration structure that holds all instances of the scene
 	/// \param     instances : pair of BLAS and transform
 	void CreateTopLevelAS(
@@ -149,9 +610,10 @@ private:
 
 	void CreateRaytracingPipeline();
 
-	ComPtr<IDxcBlob> m_rayGenLibrary;
-	ComPtr<IDxcBlob> m_hitLibrary;
-	ComPtr<IDxcBlob> m_missLibrary;
+	// # DXR Extra: Parallel shader compilation
+	nv_helpers_dx12::ShaderCompileQueue::Result m_rayGenLibrary;
+	nv_helpers_dx12::ShaderCompileQueue::Result m_hitLibrary;
+	nv_helpers_dx12::ShaderCompileQueue::Result m_missLibrary;
 
 	ComPtr<ID3D12RootSignature> m_rayGenSignature;
 	ComPtr<ID3D12RootSignature> m_hitSignature;
@@ -168,7 +630,6 @@ private:
 	void CreateRaytracingOutputBuffer();
 	void CreateShaderResourceHeap();
 	ComPtr<ID3D12Resource> m_outputResource;
-	ComPtr<ID3D12DescriptorHeap> m_srvUavHeap;
 	/*Unorderd access view (UAV)*/
 
 	// ----------------------------------------------------------------------------------
@@ -181,11 +642,14 @@ private:
 	// # DXR Extra: Perspective Camera 
 	// 
 	// Ҫ Perspective Camera, camera matrices Ҫͨ m_cameraBuffer ݵ 
-	// shader СΪڹդʹãǸõ camera  m_constHeap 
+	// shader СThe rasterization binds a copy of its view, see Descriptor allocation
 	void CreateCameraBuffer();
 	void UpdateCameraBuffer();
-	ComPtr<ID3D12DescriptorHeap > m_constHeap;	// rasterization
 	ComPtr<ID3D12Resource > m_cameraBuffer;		// raytracing
+	// # DXR Extra: Frame pipelining
+	// The matrices of each frame are written in the upload ring, and copied into the camera buffer
+	// by the command list of the frame
+	UINT64 m_cameraUploadOffset = 0;
 	uint32_t m_cameraBufferSize = 0;
 
 	// Ӧ¼ 
@@ -204,7 +668,10 @@ private:
 	
 	// ʵ壬ʵ壬Ա	
 	void CreatePerInstanceConstantBuffers();
-	std::vector<ComPtr<ID3D12Resource>> m_perInstanceConstantBuffers;
+	// # DXR Extra: Upload ring
+	// The constants of all the instances share a buffer, in slices aligned for constant buffer views
+	ComPtr<ID3D12Resource> m_perInstanceConstantBuffer;
+	std::vector<D3D12_GPU_VIRTUAL_ADDRESS> m_perInstanceConstantAddresses;
 
 	// #DXR
 	// ζ㻺
@@ -13,6 +13,8 @@
 
 #include <vector>
 
+#include "nv_helpers_dx12/ParallelFor.h"
+
 namespace nv_helpers_dx12
 {
 
@@ -57,23 +59,15 @@ static const D3D12_HEAP_PROPERTIES kDefaultHeapProps = {
     D3D12_HEAP_TYPE_DEFAULT, D3D12_CPU_PAGE_PROPERTY_UNKNOWN, D3D12_MEMORY_POOL_UNKNOWN, 0, 0};
 
 //--------------------------------------------------------------------------------------------------
-// Compile a HLSL file into a DXIL library
+// Compile a HLSL file into a DXIL library with the given DXC instances, which must only be used by
+// one thread at a time. Returns nullptr and the messages of the compiler upon failure
 //
-IDxcBlob* CompileShaderLibrary(LPCWSTR fileName)
+IDxcBlob* CompileShaderLibrary(IDxcCompiler* pCompiler, IDxcLibrary* pLibrary,
+                               IDxcIncludeHandler* dxcIncludeHandler, LPCWSTR fileName,
+                               std::string* errors)
 {
-  static IDxcCompiler* pCompiler = nullptr;
-  static IDxcLibrary* pLibrary = nullptr;
-  static IDxcIncludeHandler* dxcIncludeHandler;
-
   HRESULT hr;
 
-  // Initialize the DXC compiler and compiler helper
-  if (!pCompiler)
-  {
-    ThrowIfFailed(DxcCreateInstance(CLSID_DxcCompiler, __uuidof(IDxcCompiler), (void **)&pCompiler));
-    ThrowIfFailed(DxcCreateInstance(CLSID_DxcLibrary, __uuidof(IDxcLibrary), (void **)&pLibrary));
-    ThrowIfFailed(pLibrary->CreateIncludeHandler(&dxcIncludeHandler));
-  }
   // Open and read the file
   std::ifstream shaderFile(fileName);
   if (shaderFile.good() == false)
@@ -89,37 +83,64 @@ IDxcBlob* CompileShaderLibrary(LPCWSTR fileName)
   ThrowIfFailed(pLibrary->CreateBlobWithEncodingFromPinned(
       (LPBYTE)sShader.c_str(), (uint32_t)sShader.size(), 0, &pTextBlob));
 
-  // Compile
+  // Compile. The text blob points to the string, and is released along with it
   IDxcOperationResult* pResult;
-  ThrowIfFailed(pCompiler->Compile(pTextBlob, fileName, L"", L"lib_6_3", nullptr, 0, nullptr, 0,
-                                   dxcIncludeHandler, &pResult));
+  hr = pCompiler->Compile(pTextBlob, fileName, L"", L"lib_6_3", nullptr, 0, nullptr, 0,
+                          dxcIncludeHandler, &pResult);
+  pTextBlob->Release();
+  ThrowIfFailed(hr);
 
   // Verify the result
   HRESULT resultCode;
-  ThrowIfFailed(pResult->GetStatus(&resultCode));
-  if (FAILED(resultCode))
+  IDxcBlob* pBlob = nullptr;
+  hr = pResult->GetStatus(&resultCode);
+  if (SUCCEEDED(hr) && FAILED(resultCode))
   {
     IDxcBlobEncoding* pError;
     hr = pResult->GetErrorBuffer(&pError);
-    if (FAILED(hr))
+    if (SUCCEEDED(hr))
     {
-      throw std::logic_error("Failed to get shader compiler error");
+      // Convert error blob to a string
+      errors->assign(static_cast<const char*>(pError->GetBufferPointer()), pError->GetBufferSize());
+      pError->Release();
     }
+  }
+  else if (SUCCEEDED(hr))
+  {
+    hr = pResult->GetResult(&pBlob);
+  }
+  pResult->Release();
+  ThrowIfFailed(hr);
+  return pBlob;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Compile a HLSL file into a DXIL library
+//
+IDxcBlob* CompileShaderLibrary(LPCWSTR fileName)
+{
+  static IDxcCompiler* pCompiler = nullptr;
+  static IDxcLibrary* pLibrary = nullptr;
+  static IDxcIncludeHandler* dxcIncludeHandler;
 
-    // Convert error blob to a string
-    std::vector<char> infoLog(pError->GetBufferSize() + 1);
-    memcpy(infoLog.data(), pError->GetBufferPointer(), pError->GetBufferSize());
-    infoLog[pError->GetBufferSize()] = 0;
+  // Initialize the DXC compiler and compiler helper
+  if (!pCompiler)
+  {
+    ThrowIfFailed(DxcCreateInstance(CLSID_DxcCompiler, __uuidof(IDxcCompiler), (void **)&pCompiler));
+    ThrowIfFailed(DxcCreateInstance(CLSID_DxcLibrary, __uuidof(IDxcLibrary), (void **)&pLibrary));
+    ThrowIfFailed(pLibrary->CreateIncludeHandler(&dxcIncludeHandler));
+  }
 
+  std::string errors;
+  IDxcBlob* pBlob = CompileShaderLibrary(pCompiler, pLibrary, dxcIncludeHandler, fileName, &errors);
+  if (pBlob == nullptr)
+  {
     std::string errorMsg = "Shader Compiler Error:\n";
-    errorMsg.append(infoLog.data());
+    errorMsg.append(errors);
 
     MessageBoxA(nullptr, errorMsg.c_str(), "Error!", MB_OK);
     throw std::logic_error("Failed compile shader");
   }
-
-  IDxcBlob* pBlob;
-  ThrowIfFailed(pResult->GetResult(&pBlob));
   return pBlob;
 }
 
@@ -305,4 +326,199 @@ void GenerateMengerSponge(int32_t level, float probability, std::vector<Vertex>&
   }
 }
 
+//--------------------------------------------------------------------------------------------------
+// Cube of a Menger sponge, represented by its top-left-front corner and its size
+//
+struct MengerCube
+{
+  float x, y, z;
+  float size;
+};
+
+//--------------------------------------------------------------------------------------------------
+// Counter-based random number, uniform in [0,1]. The value only depends on the seed and the
+// counter, so that each cube draws the same numbers regardless of the thread processing it
+//
+inline float MengerRandom(uint64_t seed, uint64_t counter)
+{
+  // SplitMix64 finalizer applied to the counter offset by the seed
+  uint64_t z = seed + (counter + 1) * 0x9e3779b97f4a7c15ull;
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+  z = z ^ (z >> 31);
+  return static_cast<float>(z >> 40) / static_cast<float>((1 << 24) - 1);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Compute the cubes of a Menger sponge of the given level, in parallel. The cubes of a level are
+// split across workers in two passes: each parent first computes the 27-bit mask of its kept
+// children, then writes them at the offset given by the prefix sum of the child counts. With a
+// negative probability the regular sponge is generated, otherwise each subcube is kept with the
+// given probability, drawn from a counter-based generator indexed by (level, parent, child).
+// The output is therefore deterministic for a given seed, whatever the number of workers
+//
+inline std::vector<MengerCube> ComputeMengerSpongeCubes(int32_t level, float probability,
+                                                        uint64_t seed = 0,
+                                                        uint32_t workerCount = 0)
+{
+  std::vector<MengerCube> previous = {{-0.5f, -0.5f, -0.5f, 1.f}};
+  std::vector<MengerCube> next;
+  std::vector<uint32_t> childMasks;
+  std::vector<size_t> childOffsets;
+
+  // Subcubes of the regular sponge: all but the center of each face and the center of the cube
+  uint32_t regularMask = 0;
+  for (uint32_t child = 0; child < 27; child++)
+  {
+    const uint32_t x = child / 9, y = (child / 3) % 3, z = child % 3;
+    if ((x == 1) + (y == 1) + (z == 1) < 2)
+      regularMask |= 1u << child;
+  }
+
+  for (int32_t l = 0; l < level; l++)
+  {
+    const size_t parentCount = previous.size();
+    childMasks.resize(parentCount);
+    childOffsets.resize(parentCount + 1);
+
+    // Pass 1: select the kept subcubes of each parent
+    ParallelFor(parentCount, workerCount, [&](size_t begin, size_t end) {
+      for (size_t parent = begin; parent < end; parent++)
+      {
+        if (probability < 0.f)
+        {
+          childMasks[parent] = regularMask;
+          continue;
+        }
+        uint32_t mask = 0;
+        const uint64_t counter = (static_cast<uint64_t>(l) << 56) ^ (parent * 27);
+        for (uint32_t child = 0; child < 27; child++)
+        {
+          if (MengerRandom(seed, counter + child) <= probability)
+            mask |= 1u << child;
+        }
+        childMasks[parent] = mask;
+      }
+    });
+
+    // Exclusive prefix sum of the child counts, giving the output offset of each parent
+    childOffsets[0] = 0;
+    for (size_t parent = 0; parent < parentCount; parent++)
+    {
+      uint32_t count = 0;
+      for (uint32_t mask = childMasks[parent]; mask != 0; mask &= mask - 1)
+        count++;
+      childOffsets[parent + 1] = childOffsets[parent] + count;
+    }
+
+    // Pass 2: write the subcubes at their precomputed offsets
+    next.resize(childOffsets[parentCount]);
+    ParallelFor(parentCount, workerCount, [&](size_t begin, size_t end) {
+      for (size_t parent = begin; parent < end; parent++)
+      {
+        const MengerCube& cube = previous[parent];
+        const float size = cube.size / 3.f;
+        size_t output = childOffsets[parent];
+        for (uint32_t child = 0; child < 27; child++)
+        {
+          if ((childMasks[parent] & (1u << child)) == 0)
+            continue;
+          const uint32_t x = child / 9, y = (child / 3) % 3, z = child % 3;
+          next[output++] = {cube.x + static_cast<float>(x) * size,
+                            cube.y + static_cast<float>(y) * size,
+                            cube.z + static_cast<float>(z) * size, size};
+        }
+      }
+    });
+    previous.swap(next);
+  }
+  return previous;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Write the faces of the cubes into preallocated arrays of 24 vertices and 36 indices per cube,
+// in parallel. The cube i writes at vertices[24 * i] and indices[36 * i], its indices being offset
+// by baseVertex, so that the arrays can be suballocated from a larger arena
+//
+template <class Vertex>
+void WriteMengerSpongeCubes(const std::vector<MengerCube>& cubes, Vertex* vertices, UINT* indices,
+                            UINT baseVertex = 0, uint32_t workerCount = 0)
+{
+  // The 6 quads of a cube, as in GenerateMengerSponge: origin corner (0 for the top-left-front
+  // corner, 1 for the opposite one), the two edges and the winding
+  struct Quad
+  {
+    int corner;
+    float dx[3];
+    float dy[3];
+    bool flip;
+  };
+  static const Quad quads[6] = {
+      {0, {1, 0, 0}, {0, 1, 0}, false},  {0, {1, 0, 0}, {0, 0, 1}, true},
+      {0, {0, 1, 0}, {0, 0, 1}, false},  {1, {-1, 0, 0}, {0, -1, 0}, true},
+      {1, {-1, 0, 0}, {0, 0, -1}, false}, {1, {0, -1, 0}, {0, 0, -1}, true}};
+
+  ParallelFor(cubes.size(), workerCount, [&](size_t begin, size_t end) {
+    for (size_t c = begin; c < end; c++)
+    {
+      const MengerCube& cube = cubes[c];
+      Vertex* v = vertices + 24 * c;
+      UINT* idx = indices + 36 * c;
+      const UINT first = baseVertex + static_cast<UINT>(24 * c);
+
+      for (int q = 0; q < 6; q++)
+      {
+        const Quad& quad = quads[q];
+        const float s = cube.size;
+        const float o = quad.corner ? s : 0.f;
+        const float bl[3] = {cube.x + o, cube.y + o, cube.z + o};
+        const float dx[3] = {quad.dx[0] * s, quad.dx[1] * s, quad.dx[2] * s};
+        const float dy[3] = {quad.dy[0] * s, quad.dy[1] * s, quad.dy[2] * s};
+
+        // The edges are axis-aligned unit vectors, hence the normal is their cross product
+        const float sign = quad.flip ? -1.f : 1.f;
+        const DirectX::XMFLOAT4 n = {
+            sign * (quad.dy[1] * quad.dx[2] - quad.dy[2] * quad.dx[1]),
+            sign * (quad.dy[2] * quad.dx[0] - quad.dy[0] * quad.dx[2]),
+            sign * (quad.dy[0] * quad.dx[1] - quad.dy[1] * quad.dx[0]), 0.f};
+
+        const UINT current = first + 4 * q;
+        const UINT order[6] = {0, 1, 2, 2, 1, 3};
+        const UINT flippedOrder[6] = {0, 2, 1, 3, 1, 2};
+        for (int i = 0; i < 6; i++)
+          idx[6 * q + i] = current + (quad.flip ? flippedOrder[i] : order[i]);
+
+        v[4 * q + 0] = {{bl[0], bl[1], bl[2], 1.f}, n, {1.f, 0.f, 0.f, 1.f}};
+        v[4 * q + 1] = {{bl[0] + dx[0], bl[1] + dx[1], bl[2] + dx[2], 1.f}, n, {0.5f, 1.f, 0.f, 1.f}};
+        v[4 * q + 2] = {{bl[0] + dy[0], bl[1] + dy[1], bl[2] + dy[2], 1.f}, n, {0.5f, 0.f, 1.f, 1.f}};
+        v[4 * q + 3] = {{bl[0] + dx[0] + dy[0], bl[1] + dx[1] + dy[1], bl[2] + dx[2] + dy[2], 1.f},
+                        n,
+                        {0.f, 1.f, 0.f, 1.f}};
+      }
+    }
+  });
+}
+
+//--------------------------------------------------------------------------------------------------
+// Parallel and deterministic version of GenerateMengerSponge. The cubes are computed level by
+// level across workers, and the output arrays are sized once before being filled in parallel,
+// so that no reallocation happens during the generation. Contrary to GenerateMengerSponge, the
+// probability parameter is honored, and the random draws only depend on the seed
+//
+template <class Vertex>
+void GenerateMengerSpongeParallel(int32_t level, float probability, uint64_t seed,
+                                  std::vector<Vertex>& outputVertices,
+                                  std::vector<UINT>& outputIndices, uint32_t workerCount = 0)
+{
+  std::vector<MengerCube> cubes = ComputeMengerSpongeCubes(level, probability, seed, workerCount);
+
+  const size_t vertexOffset = outputVertices.size();
+  const size_t indexOffset = outputIndices.size();
+  outputVertices.resize(vertexOffset + 24 * cubes.size());
+  outputIndices.resize(indexOffset + 36 * cubes.size());
+  WriteMengerSpongeCubes(cubes, outputVertices.data() + vertexOffset,
+                         outputIndices.data() + indexOffset, static_cast<UINT>(vertexOffset),
+                         workerCount);
+}
+
 } // namespace nv_helpers_dx12
@@ -16,13 +16,42 @@
 #include "Common.hlsl"
 
 
-struct STriVertex
+// # DXR Extra: Compact vertex formats
+// The vertices are fetched as raw bytes, as their layout depends on the selected formats
+ByteAddressBuffer BTriVertex : register(t0);
+// # DXR Extra: Automatic 16-bit indices
+// The indices are fetched as raw bytes as well, as they can be 16 or 32 bits
+ByteAddressBuffer indices : register(t1);
+
+cbuffer VertexLayout : register(b1)
 {
-    float3 vertex;
-    float4 color;
-};
-StructuredBuffer<STriVertex> BTriVertex : register(t0);
-StructuredBuffer<int> indices : register(t1);
+    // Stride in the low 16 bits, offset of the color in the high 16 bits
+    uint vertexStrideAndColorOffset;
+    // Bit 0 set for RGBA8 colors instead of float4, bit 1 set for 16-bit indices
+    uint formatFlags;
+}
+
+uint LoadIndex(uint index)
+{
+    if (formatFlags & 2)
+    {
+        // Load requires 4-byte aligned addresses, so the word containing the index is read
+        uint packed = indices.Load((index * 2) & ~3);
+        return (index & 1) ? (packed >> 16) : (packed & 0xffff);
+    }
+    return indices.Load(index * 4);
+}
+
+float4 LoadVertexColor(uint index)
+{
+    uint address = index * (vertexStrideAndColorOffset & 0xffff) + (vertexStrideAndColorOffset >> 16);
+    if (formatFlags & 1)
+    {
+        uint packed = BTriVertex.Load(address);
+        return float4(packed & 0xff, (packed >> 8) & 0xff, (packed >> 16) & 0xff, packed >> 24) / 255.f;
+    }
+    return asfloat(BTriVertex.Load4(address));
+}
 
 
 // #DXR Extra: Per-Instance Data
@@ -70,12 +99,14 @@ void ClosestHit(inout HitInfo payload, Attributes attrib)
    
     // #DXR Extra: Indexed Geometry
     
-    if (InstanceID() < 3)
+    // # Benchmark scenes
+    // All the instances using this hit group index their own buffers, generated scenes included
     {
         
-        hitColor = BTriVertex[indices[vertId + 0]].color * barycentrics.x +
-                   BTriVertex[indices[vertId + 1]].color * barycentrics.y +
-                   BTriVertex[indices[vertId + 2]].color * barycentrics.z;
+        // # DXR Extra: Compact vertex formats
+        hitColor = LoadVertexColor(LoadIndex(vertId + 0)).rgb * barycentrics.x +
+                   LoadVertexColor(LoadIndex(vertId + 1)).rgb * barycentrics.y +
+                   LoadVertexColor(LoadIndex(vertId + 2)).rgb * barycentrics.z;
         
         /*
         hitColor = BTriVertex[vertId + 0].color * barycentrics.x +
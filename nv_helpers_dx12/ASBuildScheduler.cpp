@@ -0,0 +1,106 @@
+/*
+
+The acceleration structure build scheduler batches a large number of builds so
+that they share a single scratch buffer. See ASBuildScheduler.h for details.
+
+*/
+
+#include "ASBuildScheduler.h"
+
+#include <algorithm>
+#include <numeric>
+
+// Helper to compute aligned buffer sizes
+#ifndef ROUND_UP
+#define ROUND_UP(v, powerOf2Alignment) (((v) + (powerOf2Alignment)-1) & ~((powerOf2Alignment)-1))
+#endif
+
+namespace nv_helpers_dx12
+{
+
+//--------------------------------------------------------------------------------------------------
+//
+// The scratch budget caps the size of the shared scratch pool, oversized builds aside
+ASBuildScheduler::ASBuildScheduler(uint64_t scratchBudgetInBytes, uint64_t scratchAlignment)
+    : m_scratchBudget(scratchBudgetInBytes), m_scratchAlignment(scratchAlignment)
+{
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Add a build and return its index
+size_t ASBuildScheduler::AddBuild(uint64_t scratchSizeInBytes)
+{
+  const uint64_t alignedSize = ROUND_UP(scratchSizeInBytes, m_scratchAlignment);
+  m_scratchSizes.push_back(alignedSize);
+  m_unbatchedScratchSize += alignedSize;
+  return m_scratchSizes.size() - 1;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Pack the builds into batches using a first-fit decreasing placement
+void ASBuildScheduler::Schedule()
+{
+  m_batches.clear();
+  m_scratchPoolSize = 0;
+
+  // Place the largest builds first, so that the smaller ones fill the remaining
+  // space of the batches. The sort is stable to keep the schedule deterministic
+  std::vector<size_t> order(m_scratchSizes.size());
+  std::iota(order.begin(), order.end(), size_t(0));
+  std::stable_sort(order.begin(), order.end(), [this](size_t a, size_t b) {
+    return m_scratchSizes[a] > m_scratchSizes[b];
+  });
+
+  for (size_t buildIndex : order)
+  {
+    const uint64_t size = m_scratchSizes[buildIndex];
+
+    // Builds within a batch run concurrently, hence each of them gets its own
+    // range, appended after the ones already used by the batch. A build larger
+    // than the budget fits in no batch, and no other build fits in its batch
+    auto batch = std::find_if(m_batches.begin(), m_batches.end(), [&](const Batch& b) {
+      return b.scratchSizeInBytes + size <= m_scratchBudget;
+    });
+    if (batch == m_batches.end())
+    {
+      m_batches.emplace_back();
+      batch = m_batches.end() - 1;
+    }
+
+    batch->builds.push_back({buildIndex, batch->scratchSizeInBytes, size});
+    batch->scratchSizeInBytes += size;
+    m_scratchPoolSize = std::max(m_scratchPoolSize, batch->scratchSizeInBytes);
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Replay the schedule, separating the batches by barriers
+void ASBuildScheduler::Execute(Recorder& recorder) const
+{
+  for (const Batch& batch : m_batches)
+  {
+    for (const Build& build : batch.builds)
+    {
+      recorder.RecordBuild(build.buildIndex, build.scratchOffsetInBytes);
+    }
+    // The next batch reuses the scratch ranges of this one, and the results may
+    // be consumed by a top-level build right after the last batch
+    recorder.RecordBarrier();
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Remove all the builds and batches
+void ASBuildScheduler::Reset()
+{
+  m_scratchSizes.clear();
+  m_batches.clear();
+  m_scratchPoolSize = 0;
+  m_unbatchedScratchSize = 0;
+}
+
+} // namespace nv_helpers_dx12
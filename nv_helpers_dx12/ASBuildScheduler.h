@@ -0,0 +1,111 @@
+/*
+
+The acceleration structure build scheduler batches a large number of builds so
+that they share a single scratch buffer instead of allocating one scratch
+buffer per build. The builds are packed into batches: the builds of a batch run
+concurrently on the GPU and therefore use disjoint ranges of the scratch pool,
+while consecutive batches are separated by a UAV barrier and reuse the same
+ranges. The size of the pool does not exceed the budget given at construction,
+unless a single build needs more scratch memory than the budget: such a build
+gets a batch of its own, and the pool grows to its size.
+
+The scheduler only manipulates sizes and offsets, and does not depend on
+D3D12. The actual recording of the builds is delegated to a Recorder, so that
+the scheduling can be exercised without a device.
+
+Example:
+
+ASBuildScheduler scheduler(32 * 1024 * 1024);
+for (const auto& blas : pendingBLAS)
+  scheduler.AddBuild(blas.scratchSizeInBytes);
+scheduler.Schedule();
+
+scratchPool = nv_helpers_dx12::CreateBuffer(..., scheduler.GetScratchPoolSize(), ...);
+scheduler.Execute(recorder);
+
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace nv_helpers_dx12
+{
+
+/// Helper class packing acceleration structure builds into scratch-sharing batches
+class ASBuildScheduler
+{
+public:
+  /// Build placed in a batch, along with its range in the scratch pool
+  struct Build
+  {
+    size_t buildIndex;             /// Index returned by AddBuild
+    uint64_t scratchOffsetInBytes; /// Offset of the scratch range in the pool
+    uint64_t scratchSizeInBytes;   /// Aligned size of the scratch range
+  };
+
+  /// Set of builds which can be executed without any barrier in between
+  struct Batch
+  {
+    std::vector<Build> builds;
+    uint64_t scratchSizeInBytes = 0; /// Amount of the pool used by the batch
+  };
+
+  /// Receives the scheduled work. The application records the actual builds, and
+  /// a mock implementation can be used to validate the schedule without a device
+  class Recorder
+  {
+  public:
+    virtual ~Recorder() = default;
+    /// Record the build buildIndex using the scratch pool range starting at
+    /// scratchOffsetInBytes
+    virtual void RecordBuild(size_t buildIndex, uint64_t scratchOffsetInBytes) = 0;
+    /// Record a UAV barrier, after which the scratch pool and the results of the
+    /// previous builds can safely be reused
+    virtual void RecordBarrier() = 0;
+  };
+
+  /// The scratch budget is the maximum size of the shared scratch pool, unless a
+  /// single build is larger. The alignment is the one required by DXR for scratch
+  /// addresses
+  ASBuildScheduler(uint64_t scratchBudgetInBytes, uint64_t scratchAlignment = 256);
+
+  /// Add a build requiring scratchSizeInBytes of scratch memory, and return its
+  /// index in the recorder calls
+  size_t AddBuild(uint64_t scratchSizeInBytes);
+
+  /// Pack the builds into batches. Builds are placed by decreasing scratch size in
+  /// the first batch having enough space left, which keeps the number of barriers
+  /// low. A build larger than the budget is alone in its batch
+  void Schedule();
+
+  /// Replay the schedule on the recorder. Each batch is followed by a barrier, so
+  /// that the results are usable as soon as Execute returns
+  void Execute(Recorder& recorder) const;
+
+  /// Size of the scratch pool to allocate, ie. the largest batch footprint
+  uint64_t GetScratchPoolSize() const { return m_scratchPoolSize; }
+
+  /// Scratch memory which would be needed with one scratch buffer per build
+  uint64_t GetUnbatchedScratchSize() const { return m_unbatchedScratchSize; }
+
+  const std::vector<Batch>& GetBatches() const { return m_batches; }
+
+  /// Remove all the builds and batches
+  void Reset();
+
+private:
+  uint64_t m_scratchBudget;
+  uint64_t m_scratchAlignment;
+
+  /// Aligned scratch size of each build, indexed by build index
+  std::vector<uint64_t> m_scratchSizes;
+  std::vector<Batch> m_batches;
+
+  uint64_t m_scratchPoolSize = 0;
+  uint64_t m_unbatchedScratchSize = 0;
+};
+
+} // namespace nv_helpers_dx12
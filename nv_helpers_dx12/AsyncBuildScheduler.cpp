@@ -0,0 +1,260 @@
+/*
+
+Scheduling of the acceleration structure builds on a compute queue. See
+AsyncBuildScheduler.h for details.
+
+*/
+
+#include "AsyncBuildScheduler.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+namespace nv_helpers_dx12
+{
+
+namespace
+{
+// Queues of the simulation
+const uint32_t kDirectQueue = 0;
+const uint32_t kComputeQueue = 1;
+} // namespace
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+AsyncBuildScheduler::AsyncBuildScheduler(uint32_t versionCount) : m_versions(versionCount)
+{
+  if (versionCount == 0)
+  {
+    throw std::logic_error("The async build scheduler requires at least one version");
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// The versions are built in turn, hence the version to build is the least recently built one.
+// The fences increase monotonically, so a queue which waited for a value does not need to wait
+// for the smaller ones
+AsyncBuildScheduler::Build AsyncBuildScheduler::BeginBuild(bool refit)
+{
+  if (m_buildVersion != kNoVersion)
+  {
+    throw std::logic_error("BeginBuild called before the end of the previous build");
+  }
+  Build build;
+  build.version = m_latestVersion == kNoVersion ? 0 : (m_latestVersion + 1) % GetVersionCount();
+  build.sourceVersion = refit ? m_latestVersion : kNoVersion;
+  build.directWaitValue = 0;
+  const uint64_t useValue = m_versions[build.version].useValue;
+  if (useValue > m_computeWaitedValue)
+  {
+    build.directWaitValue = useValue;
+    m_computeWaitedValue = useValue;
+    m_statistics.computeWaitCount++;
+  }
+  if (build.sourceVersion != kNoVersion)
+  {
+    m_statistics.refitCount++;
+  }
+  m_buildVersion = build.version;
+  return build;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+void AsyncBuildScheduler::EndBuild(uint64_t computeFenceValue)
+{
+  if (m_buildVersion == kNoVersion)
+  {
+    throw std::logic_error("EndBuild called without a matching BeginBuild");
+  }
+  m_versions[m_buildVersion].buildValue = computeFenceValue;
+  m_latestVersion = m_buildVersion;
+  m_buildVersion = kNoVersion;
+  m_statistics.buildCount++;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+AsyncBuildScheduler::Use AsyncBuildScheduler::BeginUse()
+{
+  if (m_latestVersion == kNoVersion)
+  {
+    throw std::logic_error("Using an acceleration structure which was never built");
+  }
+  if (m_useVersion != kNoVersion)
+  {
+    throw std::logic_error("BeginUse called before the end of the previous use");
+  }
+  Use use;
+  use.version = m_latestVersion;
+  use.computeWaitValue = 0;
+  const uint64_t buildValue = m_versions[use.version].buildValue;
+  if (buildValue > m_directWaitedValue)
+  {
+    use.computeWaitValue = buildValue;
+    m_directWaitedValue = buildValue;
+    m_statistics.directWaitCount++;
+  }
+  m_useVersion = use.version;
+  return use;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+void AsyncBuildScheduler::EndUse(uint64_t directFenceValue)
+{
+  if (m_useVersion == kNoVersion)
+  {
+    throw std::logic_error("EndUse called without a matching BeginUse");
+  }
+  m_versions[m_useVersion].useValue = directFenceValue;
+  m_useVersion = kNoVersion;
+  m_statistics.useCount++;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+MockQueueTimeline::MockQueueTimeline(uint32_t queueCount) : m_queues(queueCount) {}
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+void MockQueueTimeline::Execute(uint32_t queue, double duration)
+{
+  Queue& q = m_queues.at(queue);
+  q.work.push_back({q.time, q.time + duration});
+  q.time += duration;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+uint64_t MockQueueTimeline::Signal(uint32_t queue)
+{
+  Queue& q = m_queues.at(queue);
+  q.signalTimes.push_back(q.time);
+  return q.signalTimes.size();
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+void MockQueueTimeline::Wait(uint32_t queue, uint32_t signalingQueue, uint64_t value)
+{
+  const Queue& signaling = m_queues.at(signalingQueue);
+  if (value == 0)
+  {
+    return;
+  }
+  if (value > signaling.signalTimes.size())
+  {
+    throw std::logic_error("Waiting for a fence value which was not signaled");
+  }
+  Queue& q = m_queues.at(queue);
+  q.time = std::max(q.time, signaling.signalTimes[value - 1]);
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+double MockQueueTimeline::GetEndTime() const
+{
+  double end = 0.;
+  for (const Queue& q : m_queues)
+  {
+    end = std::max(end, q.time);
+  }
+  return end;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+double MockQueueTimeline::GetBusyTime(uint32_t queue) const
+{
+  double busy = 0.;
+  for (const Interval& interval : m_queues.at(queue).work)
+  {
+    busy += interval.end - interval.begin;
+  }
+  return busy;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// The bounds of the work intervals are swept in time order, counting the queues executing work
+// between two consecutive bounds
+double MockQueueTimeline::GetOverlapTime() const
+{
+  std::vector<std::pair<double, int>> bounds;
+  for (const Queue& q : m_queues)
+  {
+    for (const Interval& interval : q.work)
+    {
+      bounds.push_back({interval.begin, 1});
+      bounds.push_back({interval.end, -1});
+    }
+  }
+  // Ends are sorted before the beginnings at the same time, as -1 < 1
+  std::sort(bounds.begin(), bounds.end());
+  double overlap = 0.;
+  int busyQueues = 0;
+  for (size_t i = 0; i < bounds.size(); i++)
+  {
+    if (busyQueues >= 2)
+    {
+      overlap += bounds[i].first - bounds[i - 1].first;
+    }
+    busyQueues += bounds[i].second;
+  }
+  return overlap;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// The asynchronous frames mirror the submissions of the application: the build is submitted to
+// the compute queue, then the rendering to the direct queue. The first build is from scratch, the
+// next ones refit the previous version
+AsyncBuildSimulationResult RunAsyncBuildSimulation(uint32_t frameCount, double buildDuration,
+                                                   double renderDuration, uint32_t versionCount,
+                                                   bool async)
+{
+  MockQueueTimeline timeline(2);
+  AsyncBuildScheduler scheduler(versionCount);
+  AsyncBuildSimulationResult result;
+  result.frameCount = frameCount;
+  for (uint32_t frame = 0; frame < frameCount; frame++)
+  {
+    if (!async)
+    {
+      timeline.Execute(kDirectQueue, buildDuration);
+      timeline.Execute(kDirectQueue, renderDuration);
+      timeline.Signal(kDirectQueue);
+      continue;
+    }
+    const AsyncBuildScheduler::Build build = scheduler.BeginBuild(frame > 0);
+    timeline.Wait(kComputeQueue, kDirectQueue, build.directWaitValue);
+    timeline.Execute(kComputeQueue, buildDuration);
+    scheduler.EndBuild(timeline.Signal(kComputeQueue));
+
+    const AsyncBuildScheduler::Use use = scheduler.BeginUse();
+    timeline.Wait(kDirectQueue, kComputeQueue, use.computeWaitValue);
+    timeline.Execute(kDirectQueue, renderDuration);
+    scheduler.EndUse(timeline.Signal(kDirectQueue));
+  }
+  result.totalTime = timeline.GetEndTime();
+  result.buildTime = frameCount * buildDuration;
+  result.renderTime = frameCount * renderDuration;
+  result.overlapTime = timeline.GetOverlapTime();
+  result.statistics = scheduler.GetStatistics();
+  return result;
+}
+
+} // namespace nv_helpers_dx12
@@ -0,0 +1,207 @@
+/*
+
+The async build scheduler orders the acceleration structure builds executed on
+a compute queue with the frames rendered on the direct queue, so that the build
+of the structure of a frame overlaps the rendering of the previous frame:
+
+- the structure has several versions, built in turn. A build writes a version
+  while the direct queue may still trace rays against the previous one, and
+  can refit from the previous version instead of building from scratch
+- before writing a version, the compute queue waits on the direct fence value
+  signaled after the last frame which used that version
+- before using the latest version, the direct queue waits on the compute fence
+  value signaled after its build
+
+Those waits are GPU-side waits, ID3D12CommandQueue::Wait: the CPU never blocks
+on a build. The scheduler only returns the fence values to wait for, 0 when
+the queue already waited for a later value, and does not depend on D3D12.
+
+MockQueueTimeline models the execution of several queues and of their fences
+without a device: each queue executes its work in submission order, and a wait
+delays the queue until the signaling queue reaches the value. The time during
+which the queues execute concurrently is the overlap achieved by the schedule.
+RunAsyncBuildSimulation measures it for a sequence of frames, each made of a
+build and of a rendering of given durations.
+
+Example:
+
+nv_helpers_dx12::AsyncBuildScheduler scheduler(2);
+// Each frame
+nv_helpers_dx12::AsyncBuildScheduler::Build build = scheduler.BeginBuild(true);
+if (build.directWaitValue)
+  computeQueue->Wait(directFence, build.directWaitValue);
+// Build versions[build.version], refitting versions[build.sourceVersion] if valid
+scheduler.EndBuild(SignalComputeFence());
+nv_helpers_dx12::AsyncBuildScheduler::Use use = scheduler.BeginUse();
+if (use.computeWaitValue)
+  directQueue->Wait(computeFence, use.computeWaitValue);
+// Render the frame with versions[use.version]
+scheduler.EndUse(SignalDirectFence());
+
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace nv_helpers_dx12
+{
+
+/// Counts of the builds, and of the waits each queue had to issue
+struct AsyncBuildStatistics
+{
+  uint64_t buildCount = 0;
+  /// Builds refitting the previous version
+  uint64_t refitCount = 0;
+  uint64_t useCount = 0;
+  /// Builds waiting for the direct queue to release their version
+  uint64_t computeWaitCount = 0;
+  /// Uses waiting for the compute queue to complete their version
+  uint64_t directWaitCount = 0;
+
+  float GetRefitRate() const
+  {
+    return buildCount > 0 ? refitCount / static_cast<float>(buildCount) : 0.f;
+  }
+};
+
+/// Helper class scheduling the builds of an acceleration structure on a compute queue against
+/// its uses on the direct queue
+class AsyncBuildScheduler
+{
+public:
+  static const uint32_t kNoVersion = ~0u;
+
+  /// Version to build, and direct fence value to wait for on the compute queue beforehand
+  struct Build
+  {
+    uint32_t version;
+    /// Version to refit from, kNoVersion for a build from scratch
+    uint32_t sourceVersion;
+    /// 0 if the compute queue does not need to wait
+    uint64_t directWaitValue;
+  };
+
+  /// Version to use, and compute fence value to wait for on the direct queue beforehand
+  struct Use
+  {
+    uint32_t version;
+    /// 0 if the direct queue does not need to wait
+    uint64_t computeWaitValue;
+  };
+
+  /// versionCount versions of the structure are built in turn. With a single version, the
+  /// builds cannot overlap the uses
+  explicit AsyncBuildScheduler(uint32_t versionCount = 2);
+
+  /// Start the build of the next version. A refit is only possible once a version was built.
+  /// Throws if the previous build was not ended
+  Build BeginBuild(bool refit);
+
+  /// Mark the end of the build once submitted, with the compute fence value signaled after it
+  void EndBuild(uint64_t computeFenceValue);
+
+  /// Start a use of the latest built version. Throws if no version was built, or if the previous
+  /// use was not ended
+  Use BeginUse();
+
+  /// Mark the end of the use once submitted, with the direct fence value signaled after it
+  void EndUse(uint64_t directFenceValue);
+
+  uint32_t GetVersionCount() const { return static_cast<uint32_t>(m_versions.size()); }
+
+  /// Latest built version, kNoVersion if none
+  uint32_t GetLatestVersion() const { return m_latestVersion; }
+
+  const AsyncBuildStatistics& GetStatistics() const { return m_statistics; }
+
+  void ResetStatistics() { m_statistics = AsyncBuildStatistics(); }
+
+private:
+  struct Version
+  {
+    /// Compute fence value signaled after the last build of the version, 0 if none
+    uint64_t buildValue = 0;
+    /// Direct fence value signaled after the last use of the version, 0 if none
+    uint64_t useValue = 0;
+  };
+
+  std::vector<Version> m_versions;
+  uint32_t m_latestVersion = kNoVersion;
+  uint32_t m_buildVersion = kNoVersion;
+  uint32_t m_useVersion = kNoVersion;
+  /// Largest fence values each queue already waited for
+  uint64_t m_computeWaitedValue = 0;
+  uint64_t m_directWaitedValue = 0;
+  AsyncBuildStatistics m_statistics;
+};
+
+/// Timeline of queues executing work of known durations, synchronized by fences. Each queue has
+/// its own fence, whose values are signaled in order
+class MockQueueTimeline
+{
+public:
+  explicit MockQueueTimeline(uint32_t queueCount);
+
+  /// Execute work of the given duration on a queue, after its previous work and waits
+  void Execute(uint32_t queue, double duration);
+
+  /// Signal the fence of the queue once its work submitted so far completes, and return the value
+  uint64_t Signal(uint32_t queue);
+
+  /// Delay the next work of a queue until the fence of another queue reaches value. Throws if
+  /// the value was not signaled yet, as the queues would deadlock
+  void Wait(uint32_t queue, uint32_t signalingQueue, uint64_t value);
+
+  /// Time at which all the submitted work completes
+  double GetEndTime() const;
+
+  /// Total duration of the work executed by a queue
+  double GetBusyTime(uint32_t queue) const;
+
+  /// Time during which at least two queues execute work
+  double GetOverlapTime() const;
+
+private:
+  struct Interval
+  {
+    double begin;
+    double end;
+  };
+
+  struct Queue
+  {
+    double time = 0.;
+    /// Completion time of each signaled value, the first one being value 1
+    std::vector<double> signalTimes;
+    std::vector<Interval> work;
+  };
+
+  std::vector<Queue> m_queues;
+};
+
+/// Results of a simulated sequence of frames
+struct AsyncBuildSimulationResult
+{
+  uint32_t frameCount = 0;
+  double totalTime = 0.;
+  double buildTime = 0.;
+  double renderTime = 0.;
+  double overlapTime = 0.;
+  AsyncBuildStatistics statistics;
+
+  double GetFrameTime() const { return frameCount > 0 ? totalTime / frameCount : 0.; }
+  /// Fraction of the build time hidden behind the rendering
+  double GetOverlapRate() const { return buildTime > 0. ? overlapTime / buildTime : 0.; }
+};
+
+/// Simulate frameCount frames with a MockQueueTimeline, each frame building the structure and
+/// rendering with it. The builds are either executed on a compute queue scheduled by an
+/// AsyncBuildScheduler with versionCount versions, or serialized with the rendering on the
+/// direct queue
+AsyncBuildSimulationResult RunAsyncBuildSimulation(uint32_t frameCount, double buildDuration,
+                                                   double renderDuration, uint32_t versionCount,
+                                                   bool async);
+
+} // namespace nv_helpers_dx12
@@ -56,12 +56,14 @@ void BottomLevelASGenerator::AddVertexBuffer(
                                      // vertices. This buffer cannot be nullptr
     UINT64 transformOffsetInBytes,   // Offset of the transform matrix in the
                                      // transform buffer
-    bool isOpaque /* = true */ // If true, the geometry is considered opaque,
-                               // optimizing the search for a closest hit
+    bool isOpaque /* = true */, // If true, the geometry is considered opaque,
+                                // optimizing the search for a closest hit
+    DXGI_FORMAT vertexFormat /* = DXGI_FORMAT_R32G32B32_FLOAT */ // Format of the
+                                // vertex positions
 ) {
   AddVertexBuffer(vertexBuffer, vertexOffsetInBytes, vertexCount,
                   vertexSizeInBytes, nullptr, 0, 0, transformBuffer,
-                  transformOffsetInBytes, isOpaque);
+                  transformOffsetInBytes, isOpaque, vertexFormat);
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -70,8 +72,8 @@ void BottomLevelASGenerator::AddVertexBuffer(
 // float32 value. This implementation limits the original flexibility of the
 // API:
 //   - triangles (no custom intersector support)
-//   - 3xfloat32 format
-//   - 32-bit indices
+//   - 3xfloat32 format, or any other format supported by the device
+//   - 32-bit or 16-bit indices
 void BottomLevelASGenerator::AddVertexBuffer(
     ID3D12Resource *vertexBuffer, // Buffer containing the vertex coordinates,
                                   // possibly interleaved with other vertex data
@@ -89,23 +91,26 @@ void BottomLevelASGenerator::AddVertexBuffer(
                                      // vertices. This buffer cannot be nullptr
     UINT64 transformOffsetInBytes,   // Offset of the transform matrix in the
                                      // transform buffer
-    bool isOpaque /* = true */ // If true, the geometry is considered opaque,
-                               // optimizing the search for a closest hit
+    bool isOpaque /* = true */, // If true, the geometry is considered opaque,
+                                // optimizing the search for a closest hit
+    DXGI_FORMAT vertexFormat /* = DXGI_FORMAT_R32G32B32_FLOAT */, // Format of the
+                                // vertex positions
+    DXGI_FORMAT indexFormat /* = DXGI_FORMAT_R32_UINT */ // Format of the indices
 ) {
   // Create the DX12 descriptor representing the input data, assumed to be
-  // opaque triangles, with 3xf32 vertex coordinates and 32-bit indices
+  // opaque triangles
   D3D12_RAYTRACING_GEOMETRY_DESC descriptor = {};
   descriptor.Type = D3D12_RAYTRACING_GEOMETRY_TYPE_TRIANGLES;
   descriptor.Triangles.VertexBuffer.StartAddress =
       vertexBuffer->GetGPUVirtualAddress() + vertexOffsetInBytes;
   descriptor.Triangles.VertexBuffer.StrideInBytes = vertexSizeInBytes;
   descriptor.Triangles.VertexCount = vertexCount;
-  descriptor.Triangles.VertexFormat = DXGI_FORMAT_R32G32B32_FLOAT;
+  descriptor.Triangles.VertexFormat = vertexFormat;
   descriptor.Triangles.IndexBuffer =
       indexBuffer ? (indexBuffer->GetGPUVirtualAddress() + indexOffsetInBytes)
                   : 0;
   descriptor.Triangles.IndexFormat =
-      indexBuffer ? DXGI_FORMAT_R32_UINT : DXGI_FORMAT_UNKNOWN;
+      indexBuffer ? indexFormat : DXGI_FORMAT_UNKNOWN;
   descriptor.Triangles.IndexCount = indexCount;
   descriptor.Triangles.Transform3x4 =
       transformBuffer
@@ -184,9 +189,14 @@ void BottomLevelASGenerator::Generate(
         *resultBuffer, // Result buffer storing the acceleration structure
     bool updateOnly,   // If true, simply refit the existing
                        // acceleration structure
-    ID3D12Resource *previousResult // Optional previous acceleration
-                                   // structure, used if an iterative update
-                                   // is requested
+    ID3D12Resource *previousResult, // Optional previous acceleration
+                                    // structure, used if an iterative update
+                                    // is requested
+    UINT64 scratchOffsetInBytes, // Offset of the scratch range in
+                                 // scratchBuffer, used when several builds
+                                 // share a single scratch pool
+    bool insertBarrier // If false, the UAV barrier on the result is left to
+                       // the caller
 ) {
 
   D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAGS flags = m_flags;
@@ -226,7 +236,7 @@ void BottomLevelASGenerator::Generate(
   buildDesc.DestAccelerationStructureData = {
       resultBuffer->GetGPUVirtualAddress()};
   buildDesc.ScratchAccelerationStructureData = {
-      scratchBuffer->GetGPUVirtualAddress()};
+      scratchBuffer->GetGPUVirtualAddress() + scratchOffsetInBytes};
   buildDesc.SourceAccelerationStructureData =
       previousResult ? previousResult->GetGPUVirtualAddress() : 0;
   buildDesc.Inputs.Flags = flags;
@@ -234,6 +244,12 @@ void BottomLevelASGenerator::Generate(
   // Build the AS
   commandList->BuildRaytracingAccelerationStructure(&buildDesc, 0, nullptr);
 
+  // When batching builds, the caller issues a single barrier covering all the
+  // builds of the batch
+  if (!insertBarrier) {
+    return;
+  }
+
   // Wait for the builder to complete by setting a barrier on the resulting
   // buffer. This is particularly important as the construction of the top-level
   // hierarchy may be called right afterwards, before executing the command
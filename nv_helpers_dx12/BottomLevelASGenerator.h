@@ -80,8 +80,8 @@ class BottomLevelASGenerator
 {
 public:
   /// Add a vertex buffer in GPU memory into the acceleration structure. The
-  /// vertices are supposed to be represented by 3 float32 value. Indices are
-  /// implicit.
+  /// vertices are represented by 3 float32 values unless another format is
+  /// specified. Indices are implicit.
   void AddVertexBuffer(ID3D12Resource* vertexBuffer, /// Buffer containing the vertex coordinates,
                                                      /// possibly interleaved with other vertex data
                        UINT64 vertexOffsetInBytes,   /// Offset of the first vertex in the vertex
@@ -97,13 +97,16 @@ public:
                                                         /// be nullptr
                        UINT64 transformOffsetInBytes,   /// Offset of the transform matrix in the
                                                         /// transform buffer
-                       bool isOpaque = true /// If true, the geometry is considered opaque,
-                                            /// optimizing the search for a closest hit
+                       bool isOpaque = true, /// If true, the geometry is considered opaque,
+                                             /// optimizing the search for a closest hit
+                       DXGI_FORMAT vertexFormat = DXGI_FORMAT_R32G32B32_FLOAT /// Format of the
+                                             /// vertex positions, such as R16G16B16A16_FLOAT
+                                             /// for compact vertices
   );
 
   /// Add a vertex buffer along with its index buffer in GPU memory into the acceleration structure.
-  /// The vertices are supposed to be represented by 3 float32 value, and the indices are 32-bit
-  /// unsigned ints
+  /// The vertices are represented by 3 float32 values unless another format is specified, and the
+  /// indices are 32-bit unsigned ints unless DXGI_FORMAT_R16_UINT is specified
   void AddVertexBuffer(ID3D12Resource* vertexBuffer, /// Buffer containing the vertex coordinates,
                                                      /// possibly interleaved with other vertex data
                        UINT64 vertexOffsetInBytes,   /// Offset of the first vertex in the vertex
@@ -124,8 +127,13 @@ public:
                                                         /// be nullptr
                        UINT64 transformOffsetInBytes,   /// Offset of the transform matrix in the
                                                         /// transform buffer
-                       bool isOpaque = true /// If true, the geometry is considered opaque,
-                                            /// optimizing the search for a closest hit
+                       bool isOpaque = true, /// If true, the geometry is considered opaque,
+                                             /// optimizing the search for a closest hit
+                       DXGI_FORMAT vertexFormat = DXGI_FORMAT_R32G32B32_FLOAT, /// Format of the
+                                             /// vertex positions, such as R16G16B16A16_FLOAT
+                                             /// for compact vertices
+                       DXGI_FORMAT indexFormat = DXGI_FORMAT_R32_UINT /// Format of the indices,
+                                             /// R32_UINT or R16_UINT
   );
 
   /// Compute the size of the scratch space required to build the acceleration structure, as well as
@@ -151,8 +159,12 @@ public:
                                      /// store temporary data
       ID3D12Resource* resultBuffer,  /// Result buffer storing the acceleration structure
       bool updateOnly = false,       /// If true, simply refit the existing acceleration structure
-      ID3D12Resource* previousResult = nullptr /// Optional previous acceleration structure, used
-                                               /// if an iterative update is requested
+      ID3D12Resource* previousResult = nullptr, /// Optional previous acceleration structure, used
+                                                /// if an iterative update is requested
+      UINT64 scratchOffsetInBytes = 0, /// Offset of the scratch range in scratchBuffer, used when
+                                       /// several builds share a single scratch pool
+      bool insertBarrier = true /// If false, the UAV barrier on the result is left to the
+                                /// caller, typically to issue a single one per batch of builds
   );
 
 private:
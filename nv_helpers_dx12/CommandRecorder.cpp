@@ -0,0 +1,367 @@
+/*
+
+Recording of the command lists of a frame on several threads. See
+CommandRecorder.h for details.
+
+*/
+
+#include "CommandRecorder.h"
+
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+
+namespace nv_helpers_dx12
+{
+
+namespace
+{
+// Commands framing the draws of a benchmark frame
+const uint32_t kFrameBeginCommand = 0xfffffffe;
+const uint32_t kFrameEndCommand = 0xffffffff;
+
+// Encoding of a draw, standing for the state validation and the packet writing of a driver. The
+// result only depends on the draw, so that the executed stream can be checked
+uint32_t EmulateDraw(uint32_t draw)
+{
+  uint32_t x = draw * 2654435761u + 1;
+  for (int i = 0; i < 256; i++)
+  {
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+  }
+  return x & 0x7fffffff;
+}
+} // namespace
+
+//--------------------------------------------------------------------------------------------------
+//
+// The calling thread is the first worker, hence only workerCount - 1 threads are created
+CommandRecorder::CommandRecorder(Backend* backend, uint32_t workerCount, uint32_t listCount)
+    : m_backend(backend), m_listCount(listCount)
+{
+  if (backend == nullptr || workerCount == 0 || listCount == 0)
+  {
+    throw std::logic_error("The command recorder requires a backend, a worker and a list");
+  }
+  for (uint32_t worker = 1; worker < workerCount; worker++)
+  {
+    m_threads.emplace_back(&CommandRecorder::WorkerLoop, this, worker);
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+CommandRecorder::~CommandRecorder()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_exit = true;
+  }
+  m_workAvailable.notify_all();
+  for (std::thread& thread : m_threads)
+  {
+    thread.join();
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+void CommandRecorder::BeginFrame(uint32_t frameSlot)
+{
+  if (m_inFrame)
+  {
+    throw std::logic_error("BeginFrame called before the end of the previous frame");
+  }
+  m_frameSlot = frameSlot;
+  m_frameLists.clear();
+  m_serialList = kNoList;
+  m_inFrame = true;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// The lists are used in turn within a frame, each of them being opened once per frame
+uint32_t CommandRecorder::NextList()
+{
+  if (!m_inFrame)
+  {
+    throw std::logic_error("Recording commands outside of a frame");
+  }
+  if (m_frameLists.size() >= m_listCount)
+  {
+    throw std::logic_error("The frame uses more command lists than the recorder has");
+  }
+  const uint32_t list = static_cast<uint32_t>(m_frameLists.size());
+  m_frameLists.push_back(list);
+  return list;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+void CommandRecorder::CloseSerialList()
+{
+  if (m_serialList != kNoList)
+  {
+    m_backend->Close(m_serialList);
+    m_serialList = kNoList;
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+uint32_t CommandRecorder::OpenSerialList()
+{
+  CloseSerialList();
+  m_serialList = NextList();
+  m_backend->Open(m_serialList, m_frameSlot);
+  return m_serialList;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// The items are split in as many ranges as workers, unless the ranges would be smaller than
+// minItemsPerList, in which case fewer workers take part. The sizes of the ranges differ by at
+// most one item
+uint32_t CommandRecorder::RecordParallel(uint32_t itemCount, const RecordFunction& record,
+                                         uint32_t minItemsPerList)
+{
+  CloseSerialList();
+  if (itemCount == 0)
+  {
+    return 0;
+  }
+  const auto start = std::chrono::steady_clock::now();
+  const uint32_t maxRanges = (itemCount + std::max(minItemsPerList, 1u) - 1) / std::max(minItemsPerList, 1u);
+  const uint32_t rangeCount = std::min(std::min(GetWorkerCount(), maxRanges),
+                                       m_listCount - static_cast<uint32_t>(m_frameLists.size()));
+  if (rangeCount == 0)
+  {
+    throw std::logic_error("The frame uses more command lists than the recorder has");
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_ranges.clear();
+    uint32_t first = 0;
+    for (uint32_t i = 0; i < rangeCount; i++)
+    {
+      const uint32_t count = itemCount / rangeCount + (i < itemCount % rangeCount ? 1 : 0);
+      m_ranges.push_back({NextList(), first, count});
+      first += count;
+    }
+    m_record = &record;
+    m_pendingRanges = rangeCount;
+    m_exception = nullptr;
+    m_generation++;
+  }
+  if (rangeCount > 1)
+  {
+    m_workAvailable.notify_all();
+  }
+  RecordRange(0);
+
+  std::exception_ptr exception;
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_workDone.wait(lock, [this]() { return m_pendingRanges == 0; });
+    exception = m_exception;
+    m_record = nullptr;
+  }
+  m_statistics.parallelListCount += rangeCount;
+  m_statistics.parallelItemCount += itemCount;
+  m_statistics.parallelSeconds +=
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  if (exception)
+  {
+    std::rethrow_exception(exception);
+  }
+  return rangeCount;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// The first exception thrown by the workers is kept, and the other workers still complete their
+// range so that the recorder can wait for all of them
+void CommandRecorder::RecordRange(uint32_t worker)
+{
+  const Range range = m_ranges[worker];
+  try
+  {
+    m_backend->Open(range.list, m_frameSlot);
+    (*m_record)(range.list, range.first, range.count);
+    m_backend->Close(range.list);
+  }
+  catch (...)
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_exception)
+    {
+      m_exception = std::current_exception();
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (--m_pendingRanges == 0)
+  {
+    m_workDone.notify_one();
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Each worker records its range of each parallel recording, if the recording has enough ranges
+void CommandRecorder::WorkerLoop(uint32_t worker)
+{
+  uint64_t generation = 0;
+  for (;;)
+  {
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_workAvailable.wait(lock, [&]() { return m_exit || m_generation != generation; });
+      if (m_exit)
+      {
+        return;
+      }
+      generation = m_generation;
+      if (worker >= m_ranges.size())
+      {
+        continue;
+      }
+    }
+    RecordRange(worker);
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+uint32_t CommandRecorder::EndFrame()
+{
+  if (!m_inFrame)
+  {
+    throw std::logic_error("EndFrame called without a matching BeginFrame");
+  }
+  CloseSerialList();
+  const uint32_t count = static_cast<uint32_t>(m_frameLists.size());
+  if (count > 0)
+  {
+    m_backend->Execute(m_frameLists.data(), count);
+  }
+  m_inFrame = false;
+  m_statistics.frameCount++;
+  m_statistics.listCount += count;
+  return count;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+MockCommandBackend::MockCommandBackend(uint32_t listCount) : m_lists(listCount) {}
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+void MockCommandBackend::Open(uint32_t list, uint32_t frameSlot)
+{
+  (void)frameSlot;
+  List& mockList = m_lists.at(list);
+  if (mockList.open)
+  {
+    throw std::logic_error("Opening a command list which is already open");
+  }
+  mockList.open = true;
+  mockList.commands.clear();
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+void MockCommandBackend::Close(uint32_t list)
+{
+  m_lists.at(list).open = false;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+void MockCommandBackend::Execute(const uint32_t* lists, uint32_t count)
+{
+  for (uint32_t i = 0; i < count; i++)
+  {
+    const List& mockList = m_lists.at(lists[i]);
+    if (mockList.open)
+    {
+      throw std::logic_error("Executing a command list which is still open");
+    }
+    m_executedCommands.insert(m_executedCommands.end(), mockList.commands.begin(),
+                              mockList.commands.end());
+  }
+  m_executeCallCount++;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+void MockCommandBackend::Record(uint32_t list, uint32_t command)
+{
+  List& mockList = m_lists[list];
+  if (!mockList.open)
+  {
+    throw std::logic_error("Recording into a command list which is not open");
+  }
+  mockList.commands.push_back(command);
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Each frame is made of a serial list opening the frame, the draws recorded in parallel and a
+// serial list closing the frame. The check of the executed stream is not timed
+CommandRecordingBenchmarkResult RunCommandRecordingBenchmark(uint32_t workerCount,
+                                                             uint32_t drawCount,
+                                                             uint32_t frameCount,
+                                                             uint32_t minDrawsPerList)
+{
+  const uint32_t listCount = workerCount + 2;
+  MockCommandBackend backend(listCount);
+  CommandRecorder recorder(&backend, workerCount, listCount);
+  CommandRecordingBenchmarkResult result;
+  result.workerCount = workerCount;
+
+  const CommandRecorder::RecordFunction recordDraws = [&backend](uint32_t list, uint32_t first,
+                                                                 uint32_t count) {
+    for (uint32_t draw = first; draw < first + count; draw++)
+    {
+      backend.Record(list, EmulateDraw(draw));
+    }
+  };
+  for (uint32_t frame = 0; frame < frameCount; frame++)
+  {
+    const auto start = std::chrono::steady_clock::now();
+    recorder.BeginFrame(frame % 3);
+    backend.Record(recorder.OpenSerialList(), kFrameBeginCommand);
+    recorder.RecordParallel(drawCount, recordDraws, minDrawsPerList);
+    backend.Record(recorder.OpenSerialList(), kFrameEndCommand);
+    recorder.EndFrame();
+    result.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    const std::vector<uint32_t>& commands = backend.GetExecutedCommands();
+    bool ordered = commands.size() == drawCount + 2 && commands.front() == kFrameBeginCommand &&
+                   commands.back() == kFrameEndCommand;
+    for (uint32_t draw = 0; ordered && draw < drawCount; draw++)
+    {
+      ordered = commands[draw + 1] == EmulateDraw(draw);
+    }
+    result.ordered = result.ordered && ordered;
+    result.drawCount += drawCount;
+    backend.ClearExecutedCommands();
+  }
+  return result;
+}
+
+} // namespace nv_helpers_dx12
@@ -0,0 +1,221 @@
+/*
+
+The command recorder spreads the recording of a frame over several threads.
+The frame is a sequence of command lists, executed in order by a single
+ExecuteCommandLists call at the end of the frame:
+
+- serial lists are recorded by the calling thread, for the passes whose
+  commands are few or depend on each other
+- RecordParallel splits a range of items, such as the draws of a pass, into
+  contiguous subranges of similar sizes, one per worker. Each worker records
+  its subrange into its own list, the calling thread recording the first one.
+  The lists are executed in the order of the subranges, hence the GPU sees the
+  commands in the same order as if they were recorded by a single thread,
+  whatever the number of workers
+
+Each list has one allocator per frame in flight, reset when the list is opened
+in a frame slot: the frame pacer guarantees that the GPU is done with the
+allocators of the slot. The worker threads are created once, and wait for work
+between the parallel ranges.
+
+The recorder does not depend on D3D12: the command lists, their allocators and
+the queue are accessed through the Backend interface, implemented by the
+application. MockCommandBackend implements it without a device, recording the
+commands as integers, so that the ordering and the scaling of the recording can
+be measured on any platform. RunCommandRecordingBenchmark emulates the CPU cost
+of recording draws on top of it.
+
+Example:
+
+nv_helpers_dx12::CommandRecorder recorder(&backend, 4, 6);
+// Each frame
+recorder.BeginFrame(frameSlot);
+uint32_t list = recorder.OpenSerialList();
+// Record the setup of the frame into the list
+recorder.RecordParallel(drawCount, [&](uint32_t list, uint32_t first, uint32_t count) {
+  // Record draws [first, first + count) into the list
+});
+list = recorder.OpenSerialList();
+// Record the end of the frame into the list
+recorder.EndFrame();
+
+*/
+
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace nv_helpers_dx12
+{
+
+/// Counts of the lists recorded, and time spent in the parallel recording
+struct CommandRecordingStatistics
+{
+  uint64_t frameCount = 0;
+  uint64_t listCount = 0;
+  uint64_t parallelListCount = 0;
+  uint64_t parallelItemCount = 0;
+  /// Time spent by the calling thread in RecordParallel, waiting for the workers included
+  double parallelSeconds = 0.;
+
+  float GetListsPerFrame() const
+  {
+    return frameCount > 0 ? listCount / static_cast<float>(frameCount) : 0.f;
+  }
+  double GetItemsPerSecond() const
+  {
+    return parallelSeconds > 0. ? parallelItemCount / parallelSeconds : 0.;
+  }
+};
+
+/// Helper class recording the command lists of a frame on several threads
+class CommandRecorder
+{
+public:
+  /// Command lists, each with one allocator per frame slot, and the queue executing them
+  class Backend
+  {
+  public:
+    virtual ~Backend() = default;
+    /// Reset the allocator of the list for the frame slot, and the list for recording with it.
+    /// Called from the thread recording the list
+    virtual void Open(uint32_t list, uint32_t frameSlot) = 0;
+    /// Close the list once recorded, from the thread recording it
+    virtual void Close(uint32_t list) = 0;
+    /// Execute the lists in the given order with a single call
+    virtual void Execute(const uint32_t* lists, uint32_t count) = 0;
+  };
+
+  /// Callback recording the items [first, first + count) into a list
+  using RecordFunction = std::function<void(uint32_t list, uint32_t first, uint32_t count)>;
+
+  /// The backend must outlive the recorder. workerCount threads record in parallel, including
+  /// the calling thread, and a frame can use up to listCount lists
+  CommandRecorder(Backend* backend, uint32_t workerCount, uint32_t listCount);
+  ~CommandRecorder();
+
+  CommandRecorder(const CommandRecorder&) = delete;
+  CommandRecorder& operator=(const CommandRecorder&) = delete;
+
+  /// Start a frame using the allocators of a frame slot. Throws if the previous frame was not
+  /// ended
+  void BeginFrame(uint32_t frameSlot);
+
+  /// Close the current serial list, if any, and open the next list of the frame for recording on
+  /// the calling thread. Returns the index of the list. Throws if the frame has no list left
+  uint32_t OpenSerialList();
+
+  /// Close the current serial list, if any, and record itemCount items in parallel, in ranges of
+  /// at least minItemsPerList items. Returns once all the ranges are recorded, with the number of
+  /// lists used. An exception thrown by the callback is rethrown on the calling thread. A serial
+  /// list has to be opened to record after the ranges
+  uint32_t RecordParallel(uint32_t itemCount, const RecordFunction& record,
+                          uint32_t minItemsPerList = 1);
+
+  /// Close the current serial list, if any, and execute the lists of the frame in order. Returns
+  /// the number of lists executed
+  uint32_t EndFrame();
+
+  uint32_t GetWorkerCount() const { return static_cast<uint32_t>(m_threads.size() + 1); }
+  uint32_t GetListCount() const { return m_listCount; }
+
+  const CommandRecordingStatistics& GetStatistics() const { return m_statistics; }
+
+  void ResetStatistics() { m_statistics = CommandRecordingStatistics(); }
+
+private:
+  static const uint32_t kNoList = ~0u;
+
+  struct Range
+  {
+    uint32_t list;
+    uint32_t first;
+    uint32_t count;
+  };
+
+  uint32_t NextList();
+  void CloseSerialList();
+  void RecordRange(uint32_t worker);
+  void WorkerLoop(uint32_t worker);
+
+  Backend* m_backend;
+  uint32_t m_listCount;
+  uint32_t m_frameSlot = 0;
+  bool m_inFrame = false;
+  uint32_t m_serialList = kNoList;
+  /// Lists of the current frame, in execution order
+  std::vector<uint32_t> m_frameLists;
+
+  // Parallel recording, protected by m_mutex
+  std::vector<std::thread> m_threads;
+  std::mutex m_mutex;
+  std::condition_variable m_workAvailable;
+  std::condition_variable m_workDone;
+  std::vector<Range> m_ranges;
+  const RecordFunction* m_record = nullptr;
+  uint64_t m_generation = 0;
+  uint32_t m_pendingRanges = 0;
+  std::exception_ptr m_exception;
+  bool m_exit = false;
+
+  CommandRecordingStatistics m_statistics;
+};
+
+/// Backend without a device, whose lists record integer commands. Executing the lists appends
+/// their commands to a single stream, so that the order seen by the GPU can be checked
+class MockCommandBackend : public CommandRecorder::Backend
+{
+public:
+  explicit MockCommandBackend(uint32_t listCount);
+
+  /// Throws if the list is already open
+  void Open(uint32_t list, uint32_t frameSlot) override;
+  void Close(uint32_t list) override;
+  /// Throws if one of the lists is still open
+  void Execute(const uint32_t* lists, uint32_t count) override;
+
+  /// Record a command into an open list. Each list must only be recorded by one thread at a time
+  void Record(uint32_t list, uint32_t command);
+
+  const std::vector<uint32_t>& GetExecutedCommands() const { return m_executedCommands; }
+  void ClearExecutedCommands() { m_executedCommands.clear(); }
+  uint64_t GetExecuteCallCount() const { return m_executeCallCount; }
+
+private:
+  struct List
+  {
+    bool open = false;
+    std::vector<uint32_t> commands;
+  };
+
+  std::vector<List> m_lists;
+  std::vector<uint32_t> m_executedCommands;
+  uint64_t m_executeCallCount = 0;
+};
+
+/// Results of a recording benchmark
+struct CommandRecordingBenchmarkResult
+{
+  uint32_t workerCount = 0;
+  uint64_t drawCount = 0;
+  double seconds = 0.;
+  /// True if the executed commands were in the order of the draws in every frame
+  bool ordered = true;
+
+  double GetDrawsPerSecond() const { return seconds > 0. ? drawCount / seconds : 0.; }
+};
+
+/// Record frameCount frames of drawCount draws with a MockCommandBackend, each draw emulating the
+/// CPU cost of the state validation and encoding of a driver
+CommandRecordingBenchmarkResult RunCommandRecordingBenchmark(uint32_t workerCount,
+                                                             uint32_t drawCount,
+                                                             uint32_t frameCount,
+                                                             uint32_t minDrawsPerList = 64);
+
+} // namespace nv_helpers_dx12
@@ -0,0 +1,114 @@
+/*
+
+Release of the resources once the GPU is done with them. See
+DeferredReleaseQueue.h for details.
+
+*/
+
+#include "DeferredReleaseQueue.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace nv_helpers_dx12
+{
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+void DeferredReleaseQueue::Release(ReleaseFunction release)
+{
+  m_frameReleases.push_back(std::move(release));
+  m_statistics.releaseCount++;
+  m_statistics.peakPendingCount = std::max<uint64_t>(m_statistics.peakPendingCount, GetPendingCount());
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+void DeferredReleaseQueue::Release(ReleaseFunction release, uint64_t fenceValue)
+{
+  Push(fenceValue, std::move(release));
+  m_statistics.releaseCount++;
+  m_statistics.peakPendingCount = std::max<uint64_t>(m_statistics.peakPendingCount, GetPendingCount());
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// The frames end in the order of their fence values, hence their releases are usually appended
+void DeferredReleaseQueue::EndFrame(uint64_t fenceValue)
+{
+  for (ReleaseFunction& release : m_frameReleases)
+  {
+    Push(fenceValue, std::move(release));
+  }
+  m_frameReleases.clear();
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// The releases with the same fence value are kept in the order they were made
+void DeferredReleaseQueue::Push(uint64_t fenceValue, ReleaseFunction release)
+{
+  auto it = std::upper_bound(
+      m_releases.begin(), m_releases.end(), fenceValue,
+      [](uint64_t value, const PendingRelease& pending) { return value < pending.fenceValue; });
+  m_releases.insert(it, {fenceValue, std::move(release)});
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// The ready releases are removed from the queue before being invoked, so that a release can
+// itself release other resources
+uint32_t DeferredReleaseQueue::Retire(uint64_t completedFenceValue)
+{
+  std::vector<ReleaseFunction> ready;
+  while (!m_releases.empty() && m_releases.front().fenceValue <= completedFenceValue)
+  {
+    ready.push_back(std::move(m_releases.front().release));
+    m_releases.pop_front();
+  }
+  return Invoke(ready);
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+uint32_t DeferredReleaseQueue::ReleaseAll()
+{
+  uint32_t count = 0;
+  while (GetPendingCount() > 0)
+  {
+    std::vector<ReleaseFunction> ready;
+    for (PendingRelease& pending : m_releases)
+    {
+      ready.push_back(std::move(pending.release));
+    }
+    m_releases.clear();
+    for (ReleaseFunction& release : m_frameReleases)
+    {
+      ready.push_back(std::move(release));
+    }
+    m_frameReleases.clear();
+    count += Invoke(ready);
+  }
+  return count;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+uint32_t DeferredReleaseQueue::Invoke(std::vector<ReleaseFunction>& releases)
+{
+  for (ReleaseFunction& release : releases)
+  {
+    if (release)
+    {
+      release();
+    }
+  }
+  m_statistics.retiredCount += releases.size();
+  return static_cast<uint32_t>(releases.size());
+}
+
+} // namespace nv_helpers_dx12
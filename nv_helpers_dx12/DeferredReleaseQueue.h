@@ -0,0 +1,102 @@
+/*
+
+The deferred release queue keeps the resources replaced at runtime alive until
+the GPU is done with them, instead of flushing the queue before releasing them.
+A released resource is tagged with the fence value signaled at the end of the
+last frame which may reference it, ie. the current frame, and is only freed
+once the GPU reaches that value. The frames submitted in the meantime are not
+waited for.
+
+The queue does not depend on D3D12: a release is a callback, typically
+capturing the last ComPtr to the resource and returning its memory to the
+allocator which placed it. The completed fence values are provided by the
+caller, so that the queue can be driven by a mock fence, such as
+MockFrameQueue (see FramePacer.h). The callbacks are invoked by Retire and
+ReleaseAll only, on the calling thread.
+
+Example:
+
+nv_helpers_dx12::DeferredReleaseQueue releases;
+// Replacing a buffer during a frame
+releases.Release([oldBuffer]() { allocator.Free(oldBuffer.Get()); });
+buffer = CreateNewBuffer();
+// Once the frame is submitted
+releases.EndFrame(signaledFenceValue);
+// Each frame, once the slot of the frame is available
+releases.Retire(fence->GetCompletedValue());
+// Before destroying the device, once the GPU is idle
+releases.ReleaseAll();
+
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <vector>
+
+namespace nv_helpers_dx12
+{
+
+/// Counts of the deferred releases
+struct DeferredReleaseStatistics
+{
+  uint64_t releaseCount = 0;
+  uint64_t retiredCount = 0;
+  /// Largest number of releases waiting for the GPU at once
+  uint64_t peakPendingCount = 0;
+};
+
+/// Helper class delaying the release of resources until the GPU reaches a fence value
+class DeferredReleaseQueue
+{
+public:
+  using ReleaseFunction = std::function<void()>;
+
+  DeferredReleaseQueue() = default;
+  DeferredReleaseQueue(const DeferredReleaseQueue&) = delete;
+  DeferredReleaseQueue& operator=(const DeferredReleaseQueue&) = delete;
+
+  /// Release a resource used by the current frame, once the GPU completes the frame
+  void Release(ReleaseFunction release);
+
+  /// Release a resource once the GPU reaches fenceValue, for a resource whose last use is known,
+  /// such as a resource used by an earlier frame or by another queue
+  void Release(ReleaseFunction release, uint64_t fenceValue);
+
+  /// Close the current frame, whose releases are invoked once the GPU reaches fenceValue
+  void EndFrame(uint64_t fenceValue);
+
+  /// Invoke the releases whose fence value has been reached, and return their number
+  uint32_t Retire(uint64_t completedFenceValue);
+
+  /// Invoke all the releases, including the ones of the current frame. The GPU must be idle
+  uint32_t ReleaseAll();
+
+  /// Number of releases not invoked yet, the ones of the current frame included
+  size_t GetPendingCount() const { return m_releases.size() + m_frameReleases.size(); }
+
+  const DeferredReleaseStatistics& GetStatistics() const { return m_statistics; }
+
+  void ResetStatistics() { m_statistics = DeferredReleaseStatistics(); }
+
+private:
+  struct PendingRelease
+  {
+    uint64_t fenceValue;
+    ReleaseFunction release;
+  };
+
+  void Push(uint64_t fenceValue, ReleaseFunction release);
+  uint32_t Invoke(std::vector<ReleaseFunction>& releases);
+
+  /// Releases of the ended frames, sorted by fence value
+  std::deque<PendingRelease> m_releases;
+  /// Releases of the current frame, whose fence value is not known yet
+  std::vector<ReleaseFunction> m_frameReleases;
+  DeferredReleaseStatistics m_statistics;
+};
+
+} // namespace nv_helpers_dx12
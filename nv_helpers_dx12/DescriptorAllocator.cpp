@@ -0,0 +1,129 @@
+/*
+
+Allocation of the slots of descriptor heaps. See DescriptorAllocator.h for
+details.
+
+*/
+
+#include "DescriptorAllocator.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace nv_helpers_dx12
+{
+
+//--------------------------------------------------------------------------------------------------
+//
+// All the slots start free, the lowest ones being allocated first
+DescriptorFreeList::DescriptorFreeList(uint32_t firstSlot, uint32_t count)
+    : m_firstSlot(firstSlot), m_nextFree(count), m_allocated(count, false),
+      m_firstFree(count > 0 ? 0 : kEndOfList)
+{
+  for (uint32_t i = 0; i < count; i++)
+  {
+    m_nextFree[i] = i + 1 < count ? i + 1 : kEndOfList;
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+bool DescriptorFreeList::Allocate(uint32_t* slot)
+{
+  if (m_firstFree == kEndOfList)
+  {
+    return false;
+  }
+  const uint32_t index = m_firstFree;
+  m_firstFree = m_nextFree[index];
+  m_allocated[index] = true;
+  m_usedCount++;
+  m_peakUsedCount = std::max(m_peakUsedCount, m_usedCount);
+  *slot = m_firstSlot + index;
+  return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// The freed slot is the next one allocated, its descriptor being the most likely to be in cache
+void DescriptorFreeList::Free(uint32_t slot)
+{
+  const uint32_t index = slot - m_firstSlot;
+  if (slot < m_firstSlot || index >= m_nextFree.size() || !m_allocated[index])
+  {
+    throw std::logic_error("Freeing a descriptor slot which is not allocated");
+  }
+  m_allocated[index] = false;
+  m_nextFree[index] = m_firstFree;
+  m_firstFree = index;
+  m_usedCount--;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// The ring is never empty, as the upload ring does not allow it
+DescriptorAllocator::DescriptorAllocator(uint32_t staticCount, uint32_t persistentCount,
+                                         uint32_t transientCount)
+    : m_staticCount(staticCount), m_persistent(staticCount, persistentCount),
+      m_transient(std::max(transientCount, 1u))
+{
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+bool DescriptorAllocator::AllocateStatic(uint32_t count, uint32_t* firstSlot)
+{
+  if (count > m_staticCount - m_staticUsedCount)
+  {
+    return false;
+  }
+  *firstSlot = m_staticUsedCount;
+  m_staticUsedCount += count;
+  return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Descriptors have no alignment requirement, and the ring never splits a range at its end
+bool DescriptorAllocator::AllocateTransient(uint32_t count, uint32_t* firstSlot)
+{
+  if (count > m_transient.GetSize())
+  {
+    return false;
+  }
+  uint64_t offset;
+  if (!m_transient.Allocate(count, 1, &offset))
+  {
+    return false;
+  }
+  *firstSlot = m_staticCount + m_persistent.GetCount() + static_cast<uint32_t>(offset);
+  return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+uint32_t DescriptorAllocator::GetCount() const
+{
+  return m_staticCount + m_persistent.GetCount() + static_cast<uint32_t>(m_transient.GetSize());
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+DescriptorStatistics DescriptorAllocator::GetStatistics() const
+{
+  DescriptorStatistics statistics;
+  statistics.staticUsedCount = m_staticUsedCount;
+  statistics.staticCount = m_staticCount;
+  statistics.persistentUsedCount = m_persistent.GetUsedCount();
+  statistics.persistentPeakUsedCount = m_persistent.GetPeakUsedCount();
+  statistics.persistentCount = m_persistent.GetCount();
+  statistics.transientPeakUsedCount = static_cast<uint32_t>(m_transient.GetPeakUsedSize());
+  statistics.transientCount = static_cast<uint32_t>(m_transient.GetSize());
+  return statistics;
+}
+
+} // namespace nv_helpers_dx12
@@ -0,0 +1,130 @@
+/*
+
+The descriptor allocator hands out the slots of a single large shader-visible
+descriptor heap, so that the command lists bind one heap for the whole frame
+instead of switching between small heaps. The heap is split into three regions:
+
+- static: contiguous ranges allocated once at initialization and never freed,
+  for descriptor tables referenced by long-lived data such as the shader binding
+  table
+- persistent: single slots managed by a free list, allocated and freed in
+  constant time, for descriptors living as long as their resource
+- transient: contiguous ranges allocated every frame from a ring, and released
+  once the GPU reaches the fence of the frame. Descriptor tables built on bind,
+  by copying descriptors from a CPU-only staging heap, are allocated there
+
+The allocator only manipulates slot indices, and does not depend on D3D12: the
+application adds the indices, scaled by the descriptor size, to the start of
+its heaps. DescriptorFreeList is the persistent allocator on its own, also used
+for the slots of the staging heaps.
+
+Example:
+
+nv_helpers_dx12::DescriptorAllocator allocator(16, 1024, 1024);
+uint32_t table;
+allocator.AllocateStatic(3, &table);
+// Each frame, once the slot of the frame is available
+allocator.Retire(fence->GetCompletedValue());
+uint32_t transient;
+if (allocator.AllocateTransient(1, &transient))
+  device->CopyDescriptorsSimple(1, GetCpuHandle(transient), stagingHandle, type);
+// Once the frame is submitted
+allocator.EndFrame(signaledFenceValue);
+
+*/
+
+#pragma once
+
+#include "UploadRing.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace nv_helpers_dx12
+{
+
+/// Helper class allocating single descriptor slots in constant time
+class DescriptorFreeList
+{
+public:
+  /// Manage the count slots starting at firstSlot
+  DescriptorFreeList(uint32_t firstSlot, uint32_t count);
+
+  /// Take a free slot. Returns false if none is left
+  bool Allocate(uint32_t* slot);
+
+  /// Return a slot obtained from Allocate. Throws if the slot is not allocated
+  void Free(uint32_t slot);
+
+  uint32_t GetFirstSlot() const { return m_firstSlot; }
+  uint32_t GetCount() const { return static_cast<uint32_t>(m_nextFree.size()); }
+  uint32_t GetUsedCount() const { return m_usedCount; }
+  uint32_t GetPeakUsedCount() const { return m_peakUsedCount; }
+
+private:
+  static const uint32_t kEndOfList = ~0u;
+
+  uint32_t m_firstSlot;
+  /// Next free slot of each free slot, relative to the first slot, forming a stack
+  std::vector<uint32_t> m_nextFree;
+  std::vector<bool> m_allocated;
+  uint32_t m_firstFree;
+  uint32_t m_usedCount = 0;
+  uint32_t m_peakUsedCount = 0;
+};
+
+/// Occupancy of the regions of a DescriptorAllocator
+struct DescriptorStatistics
+{
+  uint32_t staticUsedCount = 0;
+  uint32_t staticCount = 0;
+  uint32_t persistentUsedCount = 0;
+  uint32_t persistentPeakUsedCount = 0;
+  uint32_t persistentCount = 0;
+  /// Largest number of ring slots held by the frames in flight
+  uint32_t transientPeakUsedCount = 0;
+  uint32_t transientCount = 0;
+};
+
+/// Helper class splitting a descriptor heap into static, persistent and per-frame transient
+/// regions
+class DescriptorAllocator
+{
+public:
+  /// The heap holds staticCount + persistentCount + transientCount slots, in that order
+  DescriptorAllocator(uint32_t staticCount, uint32_t persistentCount, uint32_t transientCount);
+
+  /// Reserve count contiguous slots for the lifetime of the heap. Returns false if the static
+  /// region is full
+  bool AllocateStatic(uint32_t count, uint32_t* firstSlot);
+
+  /// Take a slot of the persistent region, until it is freed
+  bool AllocatePersistent(uint32_t* slot) { return m_persistent.Allocate(slot); }
+  /// Release a persistent slot. The GPU must be done with the descriptor it holds
+  void FreePersistent(uint32_t slot) { m_persistent.Free(slot); }
+
+  /// Reserve count contiguous slots for the current frame. Returns false if the frames not
+  /// completed by the GPU use too much of the ring
+  bool AllocateTransient(uint32_t count, uint32_t* firstSlot);
+
+  /// Close the current frame, whose transient slots are released once the GPU reaches fenceValue
+  void EndFrame(uint64_t fenceValue) { m_transient.EndFrame(fenceValue); }
+
+  /// Release the transient slots of the frames whose fence value has been reached
+  void Retire(uint64_t completedFenceValue) { m_transient.Retire(completedFenceValue); }
+
+  /// Total number of slots of the heap
+  uint32_t GetCount() const;
+
+  DescriptorStatistics GetStatistics() const;
+
+private:
+  uint32_t m_staticCount;
+  uint32_t m_staticUsedCount = 0;
+  DescriptorFreeList m_persistent;
+  /// Ring of transient slots, counted in slots rather than bytes
+  UploadRing m_transient;
+};
+
+} // namespace nv_helpers_dx12
@@ -0,0 +1,133 @@
+/*
+
+The frame pacer lets the CPU record several frames ahead of the GPU. See
+FramePacer.h for details.
+
+*/
+
+#include "FramePacer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+
+namespace nv_helpers_dx12
+{
+
+//--------------------------------------------------------------------------------------------------
+//
+// All the slots are initially available
+FramePacer::FramePacer(Queue* queue, uint32_t framesInFlight)
+    : m_queue(queue), m_fenceValues(framesInFlight, 0)
+{
+  if (queue == nullptr || framesInFlight == 0)
+  {
+    throw std::logic_error("The frame pacer requires a queue and at least one frame slot");
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// The slots are used in turn, hence the next slot is the one of the oldest frame in flight: the
+// wait only covers that frame, the more recent ones keeping the GPU busy
+uint32_t FramePacer::BeginFrame()
+{
+  if (m_inFrame)
+  {
+    throw std::logic_error("BeginFrame called before the end of the previous frame");
+  }
+  m_frameSlot = static_cast<uint32_t>(m_frameCount % m_fenceValues.size());
+  if (!IsSlotAvailable(m_frameSlot))
+  {
+    const auto start = std::chrono::steady_clock::now();
+    m_queue->Wait(m_fenceValues[m_frameSlot]);
+    m_statistics.stallSeconds +=
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    m_statistics.stallCount++;
+  }
+  m_statistics.frameCount++;
+  m_inFrame = true;
+  return m_frameSlot;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+uint64_t FramePacer::EndFrame()
+{
+  if (!m_inFrame)
+  {
+    throw std::logic_error("EndFrame called without a matching BeginFrame");
+  }
+  m_fenceValues[m_frameSlot] = m_queue->Signal();
+  m_frameCount++;
+  m_inFrame = false;
+  return m_fenceValues[m_frameSlot];
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Wait for a new fence value, which also covers any work submitted outside of the frames
+void FramePacer::Flush()
+{
+  m_queue->Wait(m_queue->Signal());
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+uint32_t FramePacer::GetPendingFrameCount() const
+{
+  uint32_t pending = 0;
+  for (uint32_t slot = 0; slot < m_fenceValues.size(); slot++)
+  {
+    pending += IsSlotAvailable(slot) ? 0 : 1;
+  }
+  return pending;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+bool FramePacer::IsSlotAvailable(uint32_t slot) const
+{
+  return m_queue->GetCompletedValue() >= m_fenceValues[slot];
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+uint64_t MockFrameQueue::Signal()
+{
+  return ++m_signaledValue;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+void MockFrameQueue::Wait(uint64_t value)
+{
+  if (value > m_signaledValue)
+  {
+    throw std::logic_error("Waiting for a fence value which was never signaled");
+  }
+  if (value > m_completedValue)
+  {
+    m_stalls.push_back(value);
+    m_completedValue = value;
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+void MockFrameQueue::Complete(uint64_t value)
+{
+  if (value > m_signaledValue)
+  {
+    throw std::logic_error("Completing a fence value which was never signaled");
+  }
+  m_completedValue = std::max(m_completedValue, value);
+}
+
+} // namespace nv_helpers_dx12
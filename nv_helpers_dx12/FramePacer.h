@@ -0,0 +1,137 @@
+/*
+
+The frame pacer lets the CPU record up to N frames ahead of the GPU. Each frame
+in flight owns a slot, indexing the per-frame resources written by the CPU:
+command allocators, constant buffer slices, ... The end of the GPU work of a
+frame is marked by a fence value, stored in a ring of N values. Before reusing
+a slot, BeginFrame waits for the fence value of the frame which last used it,
+so that the CPU never overwrites resources the GPU may still be reading, while
+never waiting on the frames submitted since.
+
+The pacer only manipulates fence values, and does not depend on D3D12. The
+queue and its fence are accessed through the Queue interface, implemented by
+the application on top of ID3D12CommandQueue and ID3D12Fence. MockFrameQueue
+implements it without a device, so that the pacing can be validated on any
+platform: the mock GPU only completes the frames on demand.
+
+Example:
+
+nv_helpers_dx12::FramePacer pacer(&queue, 2);
+// Each frame
+uint32_t slot = pacer.BeginFrame();
+commandAllocators[slot]->Reset();
+// Record and submit the frame, using the resources of the slot
+pacer.EndFrame();
+// Before releasing the resources
+pacer.Flush();
+
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace nv_helpers_dx12
+{
+
+/// Time spent by the CPU waiting for the GPU to release frame slots
+struct FramePacingStatistics
+{
+  uint64_t frameCount = 0;
+  /// Frames whose slot was still in use by the GPU when they began
+  uint64_t stallCount = 0;
+  double stallSeconds = 0.;
+
+  float GetStallRate() const
+  {
+    return frameCount > 0 ? stallCount / static_cast<float>(frameCount) : 0.f;
+  }
+};
+
+/// Helper class pipelining the frames recorded by the CPU with their execution on the GPU
+class FramePacer
+{
+public:
+  /// Queue executing the frames, along with a fence whose value increases monotonically
+  class Queue
+  {
+  public:
+    virtual ~Queue() = default;
+    /// Signal the fence with the next value once the work submitted so far completes, and
+    /// return that value
+    virtual uint64_t Signal() = 0;
+    /// Last value reached by the fence
+    virtual uint64_t GetCompletedValue() = 0;
+    /// Block until the fence reaches value
+    virtual void Wait(uint64_t value) = 0;
+  };
+
+  /// The queue must outlive the pacer. framesInFlight is the number of frame slots, ie. the
+  /// number of frames the CPU can record ahead of the GPU
+  FramePacer(Queue* queue, uint32_t framesInFlight);
+
+  /// Wait until the GPU is done with the resources of the next slot, and return that slot.
+  /// Throws if the previous frame was not ended
+  uint32_t BeginFrame();
+
+  /// Mark the end of the GPU work of the current frame, once it has been submitted, and return the
+  /// fence value signaled for it. Throws if no frame was begun
+  uint64_t EndFrame();
+
+  /// Wait for the GPU to complete all the submitted work, for example before releasing
+  /// resources or recording work outside of the frames
+  void Flush();
+
+  /// Slot of the current, or last, frame
+  uint32_t GetFrameSlot() const { return m_frameSlot; }
+
+  uint32_t GetFramesInFlight() const { return static_cast<uint32_t>(m_fenceValues.size()); }
+
+  /// Number of ended frames not completed by the GPU yet
+  uint32_t GetPendingFrameCount() const;
+
+  /// True if the GPU is done with the resources of a slot
+  bool IsSlotAvailable(uint32_t slot) const;
+
+  const FramePacingStatistics& GetStatistics() const { return m_statistics; }
+
+  void ResetStatistics() { m_statistics = FramePacingStatistics(); }
+
+private:
+  Queue* m_queue;
+  /// Fence value signaled at the end of the last frame of each slot, 0 if none
+  std::vector<uint64_t> m_fenceValues;
+  uint32_t m_frameSlot = 0;
+  uint64_t m_frameCount = 0;
+  bool m_inFrame = false;
+  FramePacingStatistics m_statistics;
+};
+
+/// Queue without a device, whose GPU only progresses when asked to. Waiting on a value completes
+/// the GPU work up to that value, as a blocking wait would, and is recorded so that the stalls
+/// can be checked
+class MockFrameQueue : public FramePacer::Queue
+{
+public:
+  uint64_t Signal() override;
+  uint64_t GetCompletedValue() override { return m_completedValue; }
+  /// Throws if the value was never signaled, as the wait would never return
+  void Wait(uint64_t value) override;
+
+  /// Complete the GPU work up to the given fence value
+  void Complete(uint64_t value);
+  /// Complete all the signaled work
+  void CompleteAll() { Complete(m_signaledValue); }
+
+  uint64_t GetSignaledValue() const { return m_signaledValue; }
+  /// Values waited for while not completed yet
+  const std::vector<uint64_t>& GetStalls() const { return m_stalls; }
+
+private:
+  uint64_t m_signaledValue = 0;
+  uint64_t m_completedValue = 0;
+  std::vector<uint64_t> m_stalls;
+};
+
+} // namespace nv_helpers_dx12
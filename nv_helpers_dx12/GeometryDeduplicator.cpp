@@ -0,0 +1,165 @@
+/*
+
+The geometry deduplicator detects identical geometry at bottom-level AS
+creation time. See GeometryDeduplicator.h for details.
+
+*/
+
+#include "GeometryDeduplicator.h"
+
+#include <cstring>
+
+namespace nv_helpers_dx12
+{
+
+namespace
+{
+//--------------------------------------------------------------------------------------------------
+//
+// Mix a 64-bit word into the hash. Processing the data by words instead of bytes keeps the
+// hashing of large meshes well below the cost of the AS build it may avoid
+inline uint64_t MixWord(uint64_t hash, uint64_t word)
+{
+  word *= 0x9e3779b97f4a7c15ull;
+  word ^= word >> 32;
+  hash ^= word;
+  hash *= 0x100000001b3ull;
+  return hash ^ (hash >> 29);
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Mix a block of bytes into the hash, 8 bytes at a time
+inline uint64_t MixBytes(uint64_t hash, const uint8_t* bytes, size_t sizeInBytes)
+{
+  size_t i = 0;
+  for (; i + sizeof(uint64_t) <= sizeInBytes; i += sizeof(uint64_t))
+  {
+    uint64_t word;
+    memcpy(&word, bytes + i, sizeof(word));
+    hash = MixWord(hash, word);
+  }
+  if (i < sizeInBytes)
+  {
+    uint64_t word = 0;
+    memcpy(&word, bytes + i, sizeInBytes - i);
+    hash = MixWord(hash, word);
+  }
+  // The size is part of the hash, so that trailing zeros are not ignored
+  return MixWord(hash, sizeInBytes);
+}
+} // namespace
+
+//--------------------------------------------------------------------------------------------------
+//
+// Hash a contiguous block of memory
+uint64_t GeometryDeduplicator::HashData(const void* data, size_t sizeInBytes, uint64_t seed)
+{
+  return MixBytes(seed, static_cast<const uint8_t*>(data), sizeInBytes);
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Hash the first elementSizeInBytes bytes of each element of a strided stream
+uint64_t GeometryDeduplicator::HashStridedData(const void* data, uint32_t elementCount,
+                                               uint32_t strideInBytes,
+                                               uint32_t elementSizeInBytes, uint64_t seed)
+{
+  // Tightly packed streams are hashed in one go
+  if (strideInBytes == elementSizeInBytes)
+  {
+    return HashData(data, static_cast<size_t>(elementCount) * strideInBytes, seed);
+  }
+
+  const uint8_t* bytes = static_cast<const uint8_t*>(data);
+  uint64_t hash = seed;
+  for (uint32_t i = 0; i < elementCount; i++)
+  {
+    hash = MixBytes(hash, bytes + static_cast<size_t>(i) * strideInBytes, elementSizeInBytes);
+  }
+  return hash;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Add a geometry of the BLAS to the key
+void GeometryDeduplicator::Key::AddGeometry(uint64_t vertexHash, uint32_t vertexCount,
+                                            uint32_t vertexStrideInBytes, uint64_t indexHash,
+                                            uint32_t indexCount, uint32_t geometryFlags,
+                                            uint32_t vertexFormat, uint32_t indexFormat)
+{
+  Add(vertexHash);
+  Add(vertexCount);
+  Add(vertexStrideInBytes);
+  Add(indexHash);
+  Add(indexCount);
+  Add(geometryFlags);
+  Add(vertexFormat);
+  Add(indexFormat);
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Add the build flags of the BLAS to the key
+void GeometryDeduplicator::Key::AddBuildFlags(uint32_t buildFlags)
+{
+  Add(buildFlags);
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Append a field to the key and update its hash
+void GeometryDeduplicator::Key::Add(uint64_t field)
+{
+  m_fields.push_back(field);
+  m_hash = MixWord(m_hash, field);
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Look for a BLAS registered with an identical key
+bool GeometryDeduplicator::Find(const Key& key, size_t* blasIndex)
+{
+  auto bucket = m_entries.find(key.GetHash());
+  if (bucket == m_entries.end())
+  {
+    return false;
+  }
+
+  for (const Entry& entry : bucket->second)
+  {
+    if (entry.key == key)
+    {
+      *blasIndex = entry.blasIndex;
+
+      m_statistics.duplicateGeometries++;
+      m_statistics.savedResultBytes += entry.resultSizeInBytes;
+      m_statistics.savedScratchBytes += entry.scratchSizeInBytes;
+      m_statistics.savedPrimitives += entry.primitiveCount;
+      return true;
+    }
+  }
+  return false;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Register a newly created BLAS
+void GeometryDeduplicator::Register(const Key& key, size_t blasIndex, uint64_t resultSizeInBytes,
+                                    uint64_t scratchSizeInBytes, uint64_t primitiveCount)
+{
+  m_entries[key.GetHash()].push_back(
+      {key, blasIndex, resultSizeInBytes, scratchSizeInBytes, primitiveCount});
+  m_statistics.uniqueGeometries++;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Forget all the registered geometries
+void GeometryDeduplicator::Reset()
+{
+  m_entries.clear();
+  m_statistics = Statistics();
+}
+
+} // namespace nv_helpers_dx12
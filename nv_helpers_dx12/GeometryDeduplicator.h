@@ -0,0 +1,126 @@
+/*
+
+The geometry deduplicator detects identical geometry at bottom-level AS
+creation time, so that copies of the same mesh share a single BLAS referenced
+by several top-level instances, each with its own transform.
+
+The geometry is identified by a content hash. Vertex streams are hashed in a
+stride-aware way: only the position bytes of each vertex are hashed, as they are
+the only data seen by the AS builder, so meshes differing only by their other
+attributes (eg. colors) still share their BLAS. The key also contains the vertex
+and index counts, the stride and the build flags, and is compared field by field
+upon lookup, so that two keys sharing a bucket are told apart. The contents of the
+buffers are only represented by their 64-bit hashes and are never compared:
+two different buffers with equal hashes would share a BLAS, which is improbable
+but not impossible.
+
+Example:
+
+GeometryDeduplicator::Key key;
+key.AddGeometry(vertexHash, vertexCount, sizeof(Vertex), indexHash, indexCount, geometryFlags);
+key.AddBuildFlags(buildFlags);
+
+size_t blasIndex;
+if (!deduplicator.Find(key, &blasIndex))
+{
+  blasIndex = blasStorage.size();
+  blasStorage.push_back(CreateTheBLAS(...));
+  deduplicator.Register(key, blasIndex, resultSize, scratchSize, primitiveCount);
+}
+
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace nv_helpers_dx12
+{
+
+/// Helper class sharing bottom-level acceleration structures between identical geometries
+class GeometryDeduplicator
+{
+public:
+  /// Hash a contiguous block of memory
+  static uint64_t HashData(const void* data, size_t sizeInBytes, uint64_t seed = kHashSeed);
+
+  /// Hash a strided stream, only considering the first elementSizeInBytes bytes of each
+  /// element. For vertex buffers this allows hashing the positions only, skipping the
+  /// other interleaved attributes
+  static uint64_t HashStridedData(const void* data, uint32_t elementCount, uint32_t strideInBytes,
+                                  uint32_t elementSizeInBytes, uint64_t seed = kHashSeed);
+
+  /// Identification of the contents of a BLAS
+  class Key
+  {
+  public:
+    /// Add a geometry of the BLAS. The hashes are typically obtained with HashStridedData for
+    /// the vertices and HashData for the indices. indexHash and indexCount are 0 for
+    /// non-indexed geometry. The vertex and index formats distinguish identical bytes
+    /// interpreted differently, such as half floats and normalized integers, or pairs of 16-bit
+    /// indices and 32-bit indices
+    void AddGeometry(uint64_t vertexHash, uint32_t vertexCount, uint32_t vertexStrideInBytes,
+                     uint64_t indexHash, uint32_t indexCount, uint32_t geometryFlags,
+                     uint32_t vertexFormat = 0, uint32_t indexFormat = 0);
+
+    /// Add the build flags of the BLAS, as two identical geometries built with different
+    /// flags result in different acceleration structures
+    void AddBuildFlags(uint32_t buildFlags);
+
+    uint64_t GetHash() const { return m_hash; }
+    bool operator==(const Key& other) const { return m_fields == other.m_fields; }
+
+  private:
+    void Add(uint64_t field);
+
+    uint64_t m_hash = kHashSeed;
+    /// All the fields of the key, compared upon lookup to rule out collisions of the key hash.
+    /// The content hashes of the buffers are compared as is
+    std::vector<uint64_t> m_fields;
+  };
+
+  /// Savings obtained by sharing the BLAS of identical geometries
+  struct Statistics
+  {
+    uint32_t uniqueGeometries = 0;    /// Number of BLAS actually built
+    uint32_t duplicateGeometries = 0; /// Number of BLAS creations served by an existing BLAS
+    uint64_t savedResultBytes = 0;    /// AS memory which would have been allocated otherwise
+    uint64_t savedScratchBytes = 0;   /// Scratch memory which would have been used otherwise
+    uint64_t savedPrimitives = 0;     /// Triangles which would have been processed by the builder
+  };
+
+  /// Look for a BLAS registered with an identical key. If found, blasIndex receives the index
+  /// given upon registration and the savings are accounted for
+  bool Find(const Key& key, size_t* blasIndex);
+
+  /// Register a newly created BLAS, identified by an application-defined index
+  void Register(const Key& key, size_t blasIndex, uint64_t resultSizeInBytes,
+                uint64_t scratchSizeInBytes, uint64_t primitiveCount);
+
+  const Statistics& GetStatistics() const { return m_statistics; }
+
+  /// Forget all the registered geometries and reset the statistics
+  void Reset();
+
+private:
+  static const uint64_t kHashSeed = 0xcbf29ce484222325ull;
+
+  /// Registered BLAS along with its key and the amount of work needed to build it
+  struct Entry
+  {
+    Key key;
+    size_t blasIndex;
+    uint64_t resultSizeInBytes;
+    uint64_t scratchSizeInBytes;
+    uint64_t primitiveCount;
+  };
+
+  /// Entries indexed by key hash. Colliding keys are stored in the same bucket
+  std::unordered_map<uint64_t, std::vector<Entry>> m_entries;
+  Statistics m_statistics;
+};
+
+} // namespace nv_helpers_dx12
@@ -0,0 +1,855 @@
+/*
+
+The glTF loader reads binary glTF 2.0 files without copying their geometry. See
+GltfLoader.h for details.
+
+*/
+
+#include "GltfLoader.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+namespace nv_helpers_dx12
+{
+
+namespace
+{
+const uint32_t kGlbMagic = 0x46546C67;     // "glTF"
+const uint32_t kJsonChunkType = 0x4E4F534A; // "JSON"
+const uint32_t kBinChunkType = 0x004E4942;  // "BIN\0"
+
+const uint32_t kComponentByte = 5120;
+const uint32_t kComponentUnsignedByte = 5121;
+const uint32_t kComponentShort = 5122;
+const uint32_t kComponentUnsignedShort = 5123;
+const uint32_t kComponentUnsignedInt = 5125;
+const uint32_t kComponentFloat = 5126;
+
+const uint32_t kModeTriangles = 4;
+
+//--------------------------------------------------------------------------------------------------
+//
+// Minimal JSON document, sufficient for the glTF description
+struct JsonValue
+{
+  enum class Type
+  {
+    Null,
+    Boolean,
+    Number,
+    String,
+    Array,
+    Object
+  };
+
+  Type type = Type::Null;
+  bool boolean = false;
+  double number = 0.;
+  std::string string;
+  std::vector<JsonValue> elements;
+  std::vector<std::pair<std::string, JsonValue>> members;
+
+  /// Member of an object, nullptr if not found
+  const JsonValue* Find(const char* name) const
+  {
+    for (const auto& member : members)
+    {
+      if (member.first == name)
+        return &member.second;
+    }
+    return nullptr;
+  }
+
+  /// Numeric member of an object, or defaultValue if not found
+  double GetNumber(const char* name, double defaultValue) const
+  {
+    const JsonValue* value = Find(name);
+    return value != nullptr && value->type == Type::Number ? value->number : defaultValue;
+  }
+
+  /// Array member of an object, or an empty array if not found
+  const std::vector<JsonValue>& GetArray(const char* name) const
+  {
+    static const std::vector<JsonValue> empty;
+    const JsonValue* value = Find(name);
+    return value != nullptr && value->type == Type::Array ? value->elements : empty;
+  }
+};
+
+//--------------------------------------------------------------------------------------------------
+//
+// Recursive descent JSON parser
+class JsonParser
+{
+public:
+  JsonParser(const char* begin, const char* end) : m_p(begin), m_end(end) {}
+
+  bool Parse(JsonValue& value)
+  {
+    if (!ParseValue(value, 0))
+    {
+      return false;
+    }
+    SkipWhitespace();
+    return m_p == m_end;
+  }
+
+private:
+  /// Nesting limit, protecting the stack against malicious files
+  static const int kMaxDepth = 64;
+
+  void SkipWhitespace()
+  {
+    while (m_p < m_end && (*m_p == ' ' || *m_p == '\t' || *m_p == '\n' || *m_p == '\r'))
+    {
+      m_p++;
+    }
+  }
+
+  bool Consume(const char* token)
+  {
+    const size_t length = strlen(token);
+    if (static_cast<size_t>(m_end - m_p) < length || memcmp(m_p, token, length) != 0)
+    {
+      return false;
+    }
+    m_p += length;
+    return true;
+  }
+
+  bool ParseValue(JsonValue& value, int depth)
+  {
+    SkipWhitespace();
+    if (m_p == m_end || depth > kMaxDepth)
+    {
+      return false;
+    }
+    switch (*m_p)
+    {
+    case '{':
+      return ParseObject(value, depth);
+    case '[':
+      return ParseArray(value, depth);
+    case '"':
+      value.type = JsonValue::Type::String;
+      return ParseString(value.string);
+    case 't':
+      value.type = JsonValue::Type::Boolean;
+      value.boolean = true;
+      return Consume("true");
+    case 'f':
+      value.type = JsonValue::Type::Boolean;
+      return Consume("false");
+    case 'n':
+      return Consume("null");
+    default:
+      value.type = JsonValue::Type::Number;
+      return ParseNumber(value.number);
+    }
+  }
+
+  bool ParseObject(JsonValue& value, int depth)
+  {
+    value.type = JsonValue::Type::Object;
+    m_p++;
+    SkipWhitespace();
+    if (m_p < m_end && *m_p == '}')
+    {
+      m_p++;
+      return true;
+    }
+    while (true)
+    {
+      SkipWhitespace();
+      value.members.emplace_back();
+      if (!ParseString(value.members.back().first))
+      {
+        return false;
+      }
+      SkipWhitespace();
+      if (!Consume(":") || !ParseValue(value.members.back().second, depth + 1))
+      {
+        return false;
+      }
+      SkipWhitespace();
+      if (Consume("}"))
+      {
+        return true;
+      }
+      if (!Consume(","))
+      {
+        return false;
+      }
+    }
+  }
+
+  bool ParseArray(JsonValue& value, int depth)
+  {
+    value.type = JsonValue::Type::Array;
+    m_p++;
+    SkipWhitespace();
+    if (m_p < m_end && *m_p == ']')
+    {
+      m_p++;
+      return true;
+    }
+    while (true)
+    {
+      value.elements.emplace_back();
+      if (!ParseValue(value.elements.back(), depth + 1))
+      {
+        return false;
+      }
+      SkipWhitespace();
+      if (Consume("]"))
+      {
+        return true;
+      }
+      if (!Consume(","))
+      {
+        return false;
+      }
+    }
+  }
+
+  bool ParseString(std::string& string)
+  {
+    if (!Consume("\""))
+    {
+      return false;
+    }
+    while (m_p < m_end && *m_p != '"')
+    {
+      if (*m_p != '\\')
+      {
+        string.push_back(*m_p++);
+        continue;
+      }
+      if (++m_p == m_end)
+      {
+        return false;
+      }
+      const char escaped = *m_p++;
+      switch (escaped)
+      {
+      case 'b':
+        string.push_back('\b');
+        break;
+      case 'f':
+        string.push_back('\f');
+        break;
+      case 'n':
+        string.push_back('\n');
+        break;
+      case 'r':
+        string.push_back('\r');
+        break;
+      case 't':
+        string.push_back('\t');
+        break;
+      case 'u':
+      {
+        // Encode the code unit in UTF-8. Surrogate pairs are kept as two code points, as the
+        // names are never used for anything but lookups
+        if (m_end - m_p < 4)
+        {
+          return false;
+        }
+        const std::string digits(m_p, m_p + 4);
+        const unsigned long codeUnit = strtoul(digits.c_str(), nullptr, 16);
+        m_p += 4;
+        if (codeUnit < 0x80)
+        {
+          string.push_back(static_cast<char>(codeUnit));
+        }
+        else if (codeUnit < 0x800)
+        {
+          string.push_back(static_cast<char>(0xC0 | (codeUnit >> 6)));
+          string.push_back(static_cast<char>(0x80 | (codeUnit & 0x3F)));
+        }
+        else
+        {
+          string.push_back(static_cast<char>(0xE0 | (codeUnit >> 12)));
+          string.push_back(static_cast<char>(0x80 | ((codeUnit >> 6) & 0x3F)));
+          string.push_back(static_cast<char>(0x80 | (codeUnit & 0x3F)));
+        }
+        break;
+      }
+      default:
+        string.push_back(escaped);
+        break;
+      }
+    }
+    return Consume("\"");
+  }
+
+  bool ParseNumber(double& number)
+  {
+    const char* begin = m_p;
+    while (m_p < m_end && (isdigit(static_cast<unsigned char>(*m_p)) || *m_p == '-' || *m_p == '+' ||
+                           *m_p == '.' || *m_p == 'e' || *m_p == 'E'))
+    {
+      m_p++;
+    }
+    if (m_p == begin)
+    {
+      return false;
+    }
+    // The chunk is not null-terminated
+    const std::string text(begin, m_p);
+    char* end;
+    number = strtod(text.c_str(), &end);
+    return end == text.c_str() + text.size();
+  }
+
+  const char* m_p;
+  const char* m_end;
+};
+
+uint32_t GetComponentSize(uint32_t componentType)
+{
+  switch (componentType)
+  {
+  case kComponentByte:
+  case kComponentUnsignedByte:
+    return 1;
+  case kComponentShort:
+  case kComponentUnsignedShort:
+    return 2;
+  case kComponentUnsignedInt:
+  case kComponentFloat:
+    return 4;
+  default:
+    return 0;
+  }
+}
+
+uint32_t GetComponentCount(const std::string& type)
+{
+  static const struct
+  {
+    const char* name;
+    uint32_t count;
+  } types[] = {{"SCALAR", 1}, {"VEC2", 2}, {"VEC3", 3}, {"VEC4", 4},
+               {"MAT2", 4},   {"MAT3", 9}, {"MAT4", 16}};
+  for (const auto& entry : types)
+  {
+    if (type == entry.name)
+      return entry.count;
+  }
+  return 0;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Resolve an accessor into a range of the BIN chunk, checking that all its elements lie within
+// its buffer view
+bool ResolveAccessor(const JsonValue& document, size_t accessorIndex, const uint8_t* binaryChunk,
+                     uint64_t binaryChunkSize, GltfAccessor* accessor)
+{
+  const std::vector<JsonValue>& accessors = document.GetArray("accessors");
+  const std::vector<JsonValue>& bufferViews = document.GetArray("bufferViews");
+  if (accessorIndex >= accessors.size())
+  {
+    return false;
+  }
+  const JsonValue& description = accessors[accessorIndex];
+  const JsonValue* type = description.Find("type");
+  const JsonValue* normalized = description.Find("normalized");
+  const double viewIndex = description.GetNumber("bufferView", -1.);
+  if (description.Find("sparse") != nullptr || type == nullptr || viewIndex < 0. ||
+      viewIndex >= static_cast<double>(bufferViews.size()))
+  {
+    return false;
+  }
+  const JsonValue& view = bufferViews[static_cast<size_t>(viewIndex)];
+  // Only the buffer stored in the BIN chunk, the first one, is supported
+  if (view.GetNumber("buffer", 0.) != 0.)
+  {
+    return false;
+  }
+
+  accessor->count = static_cast<uint32_t>(description.GetNumber("count", 0.));
+  accessor->componentType = static_cast<uint32_t>(description.GetNumber("componentType", 0.));
+  accessor->componentCount = GetComponentCount(type->string);
+  accessor->normalized = normalized != nullptr && normalized->boolean;
+  const uint32_t elementSize = accessor->GetElementSize();
+  accessor->strideInBytes = static_cast<uint32_t>(view.GetNumber("byteStride", elementSize));
+  if (elementSize == 0 || accessor->count == 0 || accessor->strideInBytes < elementSize)
+  {
+    return false;
+  }
+
+  const uint64_t viewOffset = static_cast<uint64_t>(view.GetNumber("byteOffset", 0.));
+  const uint64_t viewLength = static_cast<uint64_t>(view.GetNumber("byteLength", 0.));
+  const uint64_t offset = static_cast<uint64_t>(description.GetNumber("byteOffset", 0.));
+  const uint64_t extent =
+      offset + static_cast<uint64_t>(accessor->count - 1) * accessor->strideInBytes + elementSize;
+  if (viewOffset + viewLength > binaryChunkSize || extent > viewLength)
+  {
+    return false;
+  }
+  accessor->offsetInBytes = viewOffset + offset;
+  accessor->data = binaryChunk + accessor->offsetInBytes;
+  return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Local transform of a node, as a column-major 4x4 matrix
+void GetNodeTransform(const JsonValue& node, float transform[16])
+{
+  const std::vector<JsonValue>& matrix = node.GetArray("matrix");
+  if (matrix.size() == 16)
+  {
+    for (int i = 0; i < 16; i++)
+    {
+      transform[i] = static_cast<float>(matrix[i].number);
+    }
+    return;
+  }
+
+  float t[3] = {0.f, 0.f, 0.f};
+  float r[4] = {0.f, 0.f, 0.f, 1.f};
+  float s[3] = {1.f, 1.f, 1.f};
+  const std::vector<JsonValue>& translation = node.GetArray("translation");
+  const std::vector<JsonValue>& rotation = node.GetArray("rotation");
+  const std::vector<JsonValue>& scale = node.GetArray("scale");
+  for (size_t i = 0; i < 3 && translation.size() == 3; i++)
+    t[i] = static_cast<float>(translation[i].number);
+  for (size_t i = 0; i < 4 && rotation.size() == 4; i++)
+    r[i] = static_cast<float>(rotation[i].number);
+  for (size_t i = 0; i < 3 && scale.size() == 3; i++)
+    s[i] = static_cast<float>(scale[i].number);
+
+  // T * R * S, with the rotation given as a quaternion (x, y, z, w)
+  const float x = r[0], y = r[1], z = r[2], w = r[3];
+  const float rotationMatrix[3][3] = {{1.f - 2.f * (y * y + z * z), 2.f * (x * y - z * w), 2.f * (x * z + y * w)},
+                                      {2.f * (x * y + z * w), 1.f - 2.f * (x * x + z * z), 2.f * (y * z - x * w)},
+                                      {2.f * (x * z - y * w), 2.f * (y * z + x * w), 1.f - 2.f * (x * x + y * y)}};
+  for (int column = 0; column < 3; column++)
+  {
+    for (int row = 0; row < 3; row++)
+    {
+      transform[column * 4 + row] = rotationMatrix[row][column] * s[column];
+    }
+    transform[column * 4 + 3] = 0.f;
+  }
+  transform[12] = t[0];
+  transform[13] = t[1];
+  transform[14] = t[2];
+  transform[15] = 1.f;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Accumulate the transforms of the node hierarchy, adding an instance for each node with a mesh
+bool AddNodeInstances(const JsonValue& document, size_t nodeIndex, const float parent[16],
+                      size_t meshCount, int depth, std::vector<SceneInstance>& instances)
+{
+  const std::vector<JsonValue>& nodes = document.GetArray("nodes");
+  // The depth bounds the recursion on cyclic hierarchies
+  if (nodeIndex >= nodes.size() || depth > static_cast<int>(nodes.size()))
+  {
+    return false;
+  }
+  const JsonValue& node = nodes[nodeIndex];
+
+  float local[16];
+  float world[16];
+  GetNodeTransform(node, local);
+  for (int column = 0; column < 4; column++)
+  {
+    for (int row = 0; row < 4; row++)
+    {
+      float sum = 0.f;
+      for (int k = 0; k < 4; k++)
+      {
+        sum += parent[k * 4 + row] * local[column * 4 + k];
+      }
+      world[column * 4 + row] = sum;
+    }
+  }
+
+  const double meshIndex = node.GetNumber("mesh", -1.);
+  if (meshIndex >= 0.)
+  {
+    if (meshIndex >= static_cast<double>(meshCount))
+    {
+      return false;
+    }
+    SceneInstance instance;
+    instance.meshIndex = static_cast<uint32_t>(meshIndex);
+    for (int row = 0; row < 3; row++)
+    {
+      for (int column = 0; column < 4; column++)
+      {
+        instance.transform[row][column] = world[column * 4 + row];
+      }
+    }
+    instances.push_back(instance);
+  }
+
+  for (const JsonValue& child : node.GetArray("children"))
+  {
+    if (!AddNodeInstances(document, static_cast<size_t>(child.number), world, meshCount, depth + 1,
+                          instances))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+} // namespace
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+uint32_t GltfAccessor::GetElementSize() const
+{
+  return GetComponentSize(componentType) * componentCount;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Read a component as a float, following the glTF normalization rules
+float GltfAccessor::GetFloat(uint32_t element, uint32_t component) const
+{
+  const uint8_t* source = data + static_cast<size_t>(element) * strideInBytes +
+                          component * GetComponentSize(componentType);
+  switch (componentType)
+  {
+  case kComponentByte:
+  {
+    const float value = static_cast<float>(static_cast<int8_t>(*source));
+    return normalized ? std::max(value / 127.f, -1.f) : value;
+  }
+  case kComponentUnsignedByte:
+    return normalized ? *source / 255.f : *source;
+  case kComponentShort:
+  {
+    int16_t value;
+    memcpy(&value, source, sizeof(value));
+    return normalized ? std::max(value / 32767.f, -1.f) : value;
+  }
+  case kComponentUnsignedShort:
+  {
+    uint16_t value;
+    memcpy(&value, source, sizeof(value));
+    return normalized ? value / 65535.f : value;
+  }
+  case kComponentUnsignedInt:
+  {
+    uint32_t value;
+    memcpy(&value, source, sizeof(value));
+    return static_cast<float>(value);
+  }
+  default:
+  {
+    float value;
+    memcpy(&value, source, sizeof(value));
+    return value;
+  }
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Read an index, stored as an unsigned integer of any size
+uint32_t GltfAccessor::GetIndex(uint32_t element) const
+{
+  const uint8_t* source = data + static_cast<size_t>(element) * strideInBytes;
+  switch (componentType)
+  {
+  case kComponentUnsignedByte:
+    return *source;
+  case kComponentUnsignedShort:
+  {
+    uint16_t value;
+    memcpy(&value, source, sizeof(value));
+    return value;
+  }
+  default:
+  {
+    uint32_t value;
+    memcpy(&value, source, sizeof(value));
+    return value;
+  }
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Map the file and parse it in place
+bool GlbFile::Open(const std::string& fileName)
+{
+  return m_file.Open(fileName) && Parse(m_file.GetData(), m_file.GetSize());
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Parse the JSON chunk of a .glb file, and resolve the accessors of the meshes into ranges of the
+// BIN chunk
+bool GlbFile::Parse(const void* data, size_t sizeInBytes)
+{
+  m_binaryChunk = nullptr;
+  m_binaryChunkSize = 0;
+  m_meshes.clear();
+  m_instances.clear();
+
+  // 12-byte header followed by the JSON chunk and the optional BIN chunk, each chunk starting
+  // with its length and type
+  const uint8_t* bytes = static_cast<const uint8_t*>(data);
+  uint32_t header[3];
+  if (sizeInBytes < sizeof(header))
+  {
+    return false;
+  }
+  memcpy(header, bytes, sizeof(header));
+  if (header[0] != kGlbMagic || header[1] != 2 || header[2] > sizeInBytes)
+  {
+    return false;
+  }
+
+  const char* jsonBegin = nullptr;
+  const char* jsonEnd = nullptr;
+  for (uint64_t offset = sizeof(header); offset + 8 <= header[2];)
+  {
+    uint32_t chunk[2];
+    memcpy(chunk, bytes + offset, sizeof(chunk));
+    offset += sizeof(chunk);
+    if (offset + chunk[0] > header[2])
+    {
+      return false;
+    }
+    if (chunk[1] == kJsonChunkType && jsonBegin == nullptr)
+    {
+      jsonBegin = reinterpret_cast<const char*>(bytes + offset);
+      jsonEnd = jsonBegin + chunk[0];
+    }
+    else if (chunk[1] == kBinChunkType && m_binaryChunk == nullptr)
+    {
+      m_binaryChunk = bytes + offset;
+      m_binaryChunkSize = chunk[0];
+    }
+    offset += chunk[0];
+  }
+
+  JsonValue document;
+  if (jsonBegin == nullptr || !JsonParser(jsonBegin, jsonEnd).Parse(document))
+  {
+    return false;
+  }
+
+  // Triangle primitives
+  for (const JsonValue& mesh : document.GetArray("meshes"))
+  {
+    m_meshes.emplace_back();
+    for (const JsonValue& primitive : mesh.GetArray("primitives"))
+    {
+      const JsonValue* attributes = primitive.Find("attributes");
+      if (primitive.GetNumber("mode", kModeTriangles) != kModeTriangles || attributes == nullptr ||
+          attributes->Find("POSITION") == nullptr)
+      {
+        continue;
+      }
+
+      GltfPrimitive result;
+      if (!ResolveAccessor(document, static_cast<size_t>(attributes->GetNumber("POSITION", 0.)),
+                           m_binaryChunk, m_binaryChunkSize, &result.positions) ||
+          result.positions.componentCount != 3)
+      {
+        return false;
+      }
+      if (attributes->Find("COLOR_0") != nullptr &&
+          (!ResolveAccessor(document, static_cast<size_t>(attributes->GetNumber("COLOR_0", 0.)),
+                            m_binaryChunk, m_binaryChunkSize, &result.colors) ||
+           result.colors.count != result.positions.count || result.colors.componentCount < 3))
+      {
+        return false;
+      }
+      if (primitive.Find("indices") != nullptr &&
+          (!ResolveAccessor(document, static_cast<size_t>(primitive.GetNumber("indices", 0.)),
+                            m_binaryChunk, m_binaryChunkSize, &result.indices) ||
+           result.indices.componentCount != 1 || result.indices.componentType == kComponentFloat))
+      {
+        return false;
+      }
+      m_meshes.back().primitives.push_back(result);
+    }
+  }
+
+  // Instances of the default scene, or of all the root nodes if there is no scene
+  std::vector<size_t> roots;
+  const std::vector<JsonValue>& scenes = document.GetArray("scenes");
+  const size_t sceneIndex = static_cast<size_t>(document.GetNumber("scene", 0.));
+  if (sceneIndex < scenes.size())
+  {
+    for (const JsonValue& node : scenes[sceneIndex].GetArray("nodes"))
+    {
+      roots.push_back(static_cast<size_t>(node.number));
+    }
+  }
+  else
+  {
+    const std::vector<JsonValue>& nodes = document.GetArray("nodes");
+    std::vector<bool> isChild(nodes.size(), false);
+    for (const JsonValue& node : nodes)
+    {
+      for (const JsonValue& child : node.GetArray("children"))
+      {
+        if (static_cast<size_t>(child.number) < nodes.size())
+          isChild[static_cast<size_t>(child.number)] = true;
+      }
+    }
+    for (size_t i = 0; i < nodes.size(); i++)
+    {
+      if (!isChild[i])
+        roots.push_back(i);
+    }
+  }
+
+  const float identity[16] = {1.f, 0.f, 0.f, 0.f, 0.f, 1.f, 0.f, 0.f,
+                              0.f, 0.f, 1.f, 0.f, 0.f, 0.f, 0.f, 1.f};
+  for (size_t root : roots)
+  {
+    if (!AddNodeInstances(document, root, identity, m_meshes.size(), 0, m_instances))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Check whether the positions can be used as a R32G32B32_FLOAT vertex buffer
+bool GlbFile::IsDirectPositionStream(const GltfAccessor& positions)
+{
+  return positions.componentType == kComponentFloat && positions.componentCount == 3 &&
+         positions.offsetInBytes % 4 == 0 && positions.strideInBytes % 4 == 0;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Check whether the indices can be used as a R32_UINT or R16_UINT index buffer
+bool GlbFile::IsDirectIndexStream(const GltfAccessor& indices)
+{
+  if (indices.componentType == kComponentUnsignedShort)
+  {
+    return indices.strideInBytes == 2 && indices.offsetInBytes % 2 == 0;
+  }
+  return indices.componentType == kComponentUnsignedInt && indices.strideInBytes == 4 &&
+         indices.offsetInBytes % 4 == 0;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Decode the primitives of a mesh into a single indexed mesh
+Mesh ConvertGltfMesh(const GltfMesh& gltfMesh)
+{
+  Mesh mesh;
+  for (const GltfPrimitive& primitive : gltfMesh.primitives)
+  {
+    const uint32_t firstVertex = static_cast<uint32_t>(mesh.vertices.size());
+    for (uint32_t v = 0; v < primitive.positions.count; v++)
+    {
+      MeshVertex vertex = {{primitive.positions.GetFloat(v, 0), primitive.positions.GetFloat(v, 1),
+                            primitive.positions.GetFloat(v, 2)},
+                           {1.f, 1.f, 1.f, 1.f}};
+      for (uint32_t c = 0; primitive.colors.IsValid() && c < primitive.colors.componentCount; c++)
+      {
+        vertex.color[c] = primitive.colors.GetFloat(v, c);
+      }
+      mesh.vertices.push_back(vertex);
+    }
+
+    // Non-indexed primitives list their vertices in order. Out of range indices are clamped, so
+    // that the result is always safe to render
+    const uint32_t indexCount =
+        primitive.indices.IsValid() ? primitive.indices.count : primitive.positions.count;
+    for (uint32_t i = 0; i + 2 < indexCount; i += 3)
+    {
+      for (uint32_t k = 0; k < 3; k++)
+      {
+        const uint32_t index = primitive.indices.IsValid() ? primitive.indices.GetIndex(i + k) : i + k;
+        mesh.indices.push_back(firstVertex + std::min(index, primitive.positions.count - 1));
+      }
+    }
+  }
+  return mesh;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Copying loader: read the whole file, then convert all the meshes
+bool LoadGlbAsScene(const std::string& fileName, Scene* scene)
+{
+  std::ifstream file(fileName, std::ios::binary | std::ios::ate);
+  if (!file.good())
+  {
+    return false;
+  }
+  std::vector<uint8_t> contents(static_cast<size_t>(file.tellg()));
+  file.seekg(0);
+  if (!file.read(reinterpret_cast<char*>(contents.data()), contents.size()))
+  {
+    return false;
+  }
+
+  GlbFile glb;
+  if (!glb.Parse(contents.data(), contents.size()))
+  {
+    return false;
+  }
+  scene->meshes.clear();
+  for (const GltfMesh& mesh : glb.GetMeshes())
+  {
+    scene->meshes.push_back(ConvertGltfMesh(mesh));
+  }
+  scene->instances = glb.GetInstances();
+  return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+uint64_t GetPeakResidentSetSize()
+{
+#ifdef _WIN32
+  PROCESS_MEMORY_COUNTERS counters;
+  if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+  {
+    return 0;
+  }
+  return counters.PeakWorkingSetSize;
+#else
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0)
+  {
+    return 0;
+  }
+#ifdef __APPLE__
+  return static_cast<uint64_t>(usage.ru_maxrss);
+#else
+  // Reported in kilobytes on Linux
+  return static_cast<uint64_t>(usage.ru_maxrss) * 1024;
+#endif
+#endif
+}
+
+} // namespace nv_helpers_dx12
@@ -0,0 +1,137 @@
+/*
+
+The glTF loader reads binary glTF 2.0 files (.glb) without copying their
+geometry. The file is memory-mapped, and only its JSON chunk is parsed: the
+accessors of the meshes are exposed as ranges of the mapped BIN chunk, with
+their offset and stride, so that the BIN chunk can be uploaded in one go and
+referenced by the acceleration structure builds. When a stream matches what
+BottomLevelASGenerator::AddVertexBuffer expects (3 floats per position, 16-bit
+or 32-bit indices, aligned offsets and strides), it can be handed over as-is
+instead of being repacked, as reported by IsDirectPositionStream and
+IsDirectIndexStream.
+
+The nodes of the default scene are flattened into instances, each carrying the
+world transform of a node referencing a mesh, which map directly to TLAS
+instances.
+
+Only the geometry is read: triangle primitives with their positions, optional
+vertex colors and optional indices. Sparse and compressed accessors are not
+supported.
+
+LoadGlbAsScene is the traditional alternative, reading the whole file into
+memory and converting it into a Scene, used as a reference for the load time
+and peak memory usage of the zero-copy path.
+
+Example:
+
+nv_helpers_dx12::GlbFile glb;
+if (glb.Open("sponza.glb"))
+{
+  // Upload glb.GetBinaryChunk() into vertexBuffer
+  for (const nv_helpers_dx12::GltfPrimitive& primitive : glb.GetMeshes()[0].primitives)
+  {
+    bottomLevelAS.AddVertexBuffer(vertexBuffer, primitive.positions.offsetInBytes,
+                                  primitive.positions.count, primitive.positions.strideInBytes,
+                                  nullptr, 0);
+  }
+}
+
+*/
+
+#pragma once
+
+#include "MappedFile.h"
+#include "Mesh.h"
+
+#include <string>
+
+namespace nv_helpers_dx12
+{
+
+/// Typed view of a range of the BIN chunk
+struct GltfAccessor
+{
+  /// Start of the first element, nullptr if the accessor is not defined
+  const uint8_t* data = nullptr;
+  /// Offset of the first element in the BIN chunk
+  uint64_t offsetInBytes = 0;
+  uint32_t count = 0;
+  uint32_t strideInBytes = 0;
+  /// Component type, using the GL enumerants of glTF (5126 for float...)
+  uint32_t componentType = 0;
+  /// Number of components per element, 1 for SCALAR, 3 for VEC3...
+  uint32_t componentCount = 0;
+  bool normalized = false;
+
+  bool IsValid() const { return data != nullptr; }
+  uint32_t GetElementSize() const;
+
+  /// Read a component as a float, applying the normalization if any
+  float GetFloat(uint32_t element, uint32_t component) const;
+
+  /// Read an integer index
+  uint32_t GetIndex(uint32_t element) const;
+};
+
+/// Triangle list of a mesh
+struct GltfPrimitive
+{
+  GltfAccessor positions;
+  /// COLOR_0 attribute, invalid if the primitive has no vertex colors
+  GltfAccessor colors;
+  /// Invalid for non-indexed primitives
+  GltfAccessor indices;
+};
+
+struct GltfMesh
+{
+  std::vector<GltfPrimitive> primitives;
+};
+
+class GlbFile
+{
+public:
+  /// Map and parse a .glb file. Returns false if the file cannot be read or is not a valid
+  /// binary glTF 2.0 file
+  bool Open(const std::string& fileName);
+
+  /// Parse a .glb file already in memory, which must outlive the accessors
+  bool Parse(const void* data, size_t sizeInBytes);
+
+  /// BIN chunk, referenced by all the accessors
+  const uint8_t* GetBinaryChunk() const { return m_binaryChunk; }
+  uint64_t GetBinaryChunkSize() const { return m_binaryChunkSize; }
+
+  const std::vector<GltfMesh>& GetMeshes() const { return m_meshes; }
+
+  /// One instance per node referencing a mesh in the default scene, with the world transform
+  /// of the node. The mesh index refers to GetMeshes
+  const std::vector<SceneInstance>& GetInstances() const { return m_instances; }
+
+  /// True if the positions can be passed as-is to AddVertexBuffer
+  static bool IsDirectPositionStream(const GltfAccessor& positions);
+
+  /// True if the indices can be passed as-is to AddVertexBuffer, with the R16_UINT format for
+  /// 16-bit indices and R32_UINT otherwise
+  static bool IsDirectIndexStream(const GltfAccessor& indices);
+
+private:
+  MappedFile m_file;
+  const uint8_t* m_binaryChunk = nullptr;
+  uint64_t m_binaryChunkSize = 0;
+  std::vector<GltfMesh> m_meshes;
+  std::vector<SceneInstance> m_instances;
+};
+
+/// Read a whole .glb file into memory and convert it into a scene, each glTF mesh becoming a
+/// Mesh with its primitives concatenated. Vertices without color are white
+bool LoadGlbAsScene(const std::string& fileName, Scene* scene);
+
+/// Convert a mesh of a parsed .glb file, concatenating its primitives
+Mesh ConvertGltfMesh(const GltfMesh& gltfMesh);
+
+/// Peak resident memory of the process in bytes, used to compare the memory footprint of the
+/// loaders. Returns 0 if not available
+uint64_t GetPeakResidentSetSize();
+
+} // namespace nv_helpers_dx12
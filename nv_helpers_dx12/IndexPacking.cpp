@@ -0,0 +1,72 @@
+/*
+
+Automatic 16-bit index buffers. See IndexPacking.h for details.
+
+*/
+
+#include "IndexPacking.h"
+
+#include "ParallelFor.h"
+
+#include <cstring>
+
+namespace nv_helpers_dx12
+{
+
+//--------------------------------------------------------------------------------------------------
+//
+// The largest 16-bit index, 65535, addresses the last vertex of a mesh of 65536 vertices, but it
+// is also the strip cut value of the input assembler: keeping it out of the 16-bit meshes leaves
+// the indices valid whatever the primitive topology
+IndexFormat SelectIndexFormat(size_t vertexCount)
+{
+  return vertexCount < 0x10000 ? IndexFormat::UInt16 : IndexFormat::UInt32;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Narrow the indices in parallel. The 32-bit indices are copied as-is
+PackedIndices PackIndices(const uint32_t* indices, size_t indexCount, size_t vertexCount,
+                          uint32_t workerCount)
+{
+  PackedIndices packed;
+  packed.format = SelectIndexFormat(vertexCount);
+  packed.indexCount = static_cast<uint32_t>(indexCount);
+  packed.data.resize((packed.GetSizeInBytes() + 3) & ~uint64_t(3), 0);
+
+  if (packed.format == IndexFormat::UInt32)
+  {
+    if (indexCount > 0)
+    {
+      memcpy(packed.data.data(), indices, indexCount * sizeof(uint32_t));
+    }
+    return packed;
+  }
+
+  uint16_t* target = reinterpret_cast<uint16_t*>(packed.data.data());
+  ParallelFor(indexCount, workerCount, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++)
+    {
+      target[i] = static_cast<uint16_t>(indices[i]);
+    }
+  });
+  return packed;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+uint32_t UnpackIndex(const PackedIndices& packed, size_t index)
+{
+  if (packed.format == IndexFormat::UInt16)
+  {
+    uint16_t value;
+    memcpy(&value, packed.data.data() + index * sizeof(uint16_t), sizeof(value));
+    return value;
+  }
+  uint32_t value;
+  memcpy(&value, packed.data.data() + index * sizeof(uint32_t), sizeof(value));
+  return value;
+}
+
+} // namespace nv_helpers_dx12
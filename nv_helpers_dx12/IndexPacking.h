@@ -0,0 +1,63 @@
+/*
+
+Automatic selection of the index format of a mesh. Meshes with fewer than 65536
+vertices are indexed with 16-bit indices, halving the memory and bandwidth of
+their index buffers, and larger meshes keep 32-bit indices. Both formats are
+accepted by the input assembler (DXGI_FORMAT_R16_UINT and R32_UINT) and by the
+raytracing acceleration structure builds.
+
+The packed data is padded to a multiple of 4 bytes, so that an odd number of
+16-bit indices can still be fetched by the shaders as a raw buffer of 32-bit
+words, the index i being in the low 16 bits of word i / 2 for even values of i,
+and in the high 16 bits otherwise.
+
+Example:
+
+nv_helpers_dx12::PackedIndices packed = nv_helpers_dx12::PackIndices(
+    mesh.indices.data(), mesh.indices.size(), mesh.vertices.size());
+// Upload packed.data, and use packed.format for the index buffer view and the
+// BLAS geometry
+
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace nv_helpers_dx12
+{
+
+enum class IndexFormat
+{
+  UInt16,
+  UInt32
+};
+
+/// Indices stored in the narrowest format allowed by the vertex count of their mesh
+struct PackedIndices
+{
+  IndexFormat format = IndexFormat::UInt32;
+  uint32_t indexCount = 0;
+  /// Indices, padded with zeros to a multiple of 4 bytes
+  std::vector<uint8_t> data;
+
+  uint32_t GetIndexSize() const { return format == IndexFormat::UInt16 ? 2 : 4; }
+  /// Size of the indices, without the padding
+  uint64_t GetSizeInBytes() const { return static_cast<uint64_t>(indexCount) * GetIndexSize(); }
+};
+
+/// Format of the indices of a mesh with the given number of vertices: 16 bits if the mesh has
+/// fewer than 65536 vertices, 32 bits otherwise
+IndexFormat SelectIndexFormat(size_t vertexCount);
+
+/// Pack the indices of a mesh, whose indices are all smaller than vertexCount, in the format
+/// selected by SelectIndexFormat, using workerCount threads (0 for the number of hardware threads)
+PackedIndices PackIndices(const uint32_t* indices, size_t indexCount, size_t vertexCount,
+                          uint32_t workerCount = 0);
+
+/// Read a packed index
+uint32_t UnpackIndex(const PackedIndices& packed, size_t index);
+
+} // namespace nv_helpers_dx12
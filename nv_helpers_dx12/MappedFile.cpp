@@ -0,0 +1,136 @@
+/*
+
+Read-only memory mapping of a whole file. See MappedFile.h for details.
+
+*/
+
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace nv_helpers_dx12
+{
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+MappedFile::~MappedFile()
+{
+  Close();
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Map the whole file in read-only mode
+bool MappedFile::Open(const std::string& fileName)
+{
+  Close();
+
+#ifdef _WIN32
+  HANDLE file = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                            FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+  if (file == INVALID_HANDLE_VALUE)
+  {
+    return false;
+  }
+  m_file = file;
+
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(file, &size))
+  {
+    Close();
+    return false;
+  }
+  m_size = static_cast<size_t>(size.QuadPart);
+  // Empty files cannot be mapped, but are valid
+  if (m_size == 0)
+  {
+    return true;
+  }
+
+  m_mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (m_mapping == nullptr)
+  {
+    Close();
+    return false;
+  }
+  m_data = MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+#else
+  const int file = open(fileName.c_str(), O_RDONLY);
+  if (file < 0)
+  {
+    return false;
+  }
+
+  struct stat status;
+  if (fstat(file, &status) != 0)
+  {
+    close(file);
+    return false;
+  }
+  m_size = static_cast<size_t>(status.st_size);
+  if (m_size == 0)
+  {
+    close(file);
+    return true;
+  }
+
+  // The mapping remains valid once the descriptor is closed
+  void* data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, file, 0);
+  close(file);
+  if (data != MAP_FAILED)
+  {
+    madvise(data, m_size, MADV_SEQUENTIAL);
+    m_data = data;
+  }
+#endif
+
+  if (m_data == nullptr)
+  {
+    Close();
+    return false;
+  }
+  return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Release the mapping
+void MappedFile::Close()
+{
+#ifdef _WIN32
+  if (m_data != nullptr)
+  {
+    UnmapViewOfFile(m_data);
+  }
+  if (m_mapping != nullptr)
+  {
+    CloseHandle(m_mapping);
+  }
+  if (m_file != nullptr)
+  {
+    CloseHandle(m_file);
+  }
+  m_mapping = nullptr;
+  m_file = nullptr;
+#else
+  if (m_data != nullptr)
+  {
+    munmap(const_cast<void*>(m_data), m_size);
+  }
+#endif
+  m_data = nullptr;
+  m_size = 0;
+}
+
+} // namespace nv_helpers_dx12
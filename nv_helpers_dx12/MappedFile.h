@@ -0,0 +1,59 @@
+/*
+
+Read-only memory mapping of a whole file. The loaders parse the mapped bytes in
+place, leaving the paging of the file to the operating system instead of
+copying it into an intermediate buffer. The mapping uses CreateFileMapping on
+Windows and mmap on POSIX systems, and is released with the object.
+
+Example:
+
+nv_helpers_dx12::MappedFile file;
+if (file.Open("bunny.obj"))
+{
+  const char* text = static_cast<const char*>(file.GetData());
+  Parse(text, text + file.GetSize());
+}
+
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace nv_helpers_dx12
+{
+
+class MappedFile
+{
+public:
+  MappedFile() = default;
+  ~MappedFile();
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  /// Map the whole file, closing the previously mapped one if any. Returns false if the file
+  /// cannot be opened or mapped
+  bool Open(const std::string& fileName);
+
+  /// Unmap the file
+  void Close();
+
+  /// Start of the mapped bytes, nullptr if no file is mapped or the file is empty
+  const void* GetData() const { return m_data; }
+
+  /// Size of the file in bytes
+  size_t GetSize() const { return m_size; }
+
+private:
+  const void* m_data = nullptr;
+  size_t m_size = 0;
+
+#ifdef _WIN32
+  void* m_file = nullptr;
+  void* m_mapping = nullptr;
+#endif
+};
+
+} // namespace nv_helpers_dx12
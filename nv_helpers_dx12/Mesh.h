@@ -0,0 +1,54 @@
+/*
+
+CPU-side representation of the geometry handled by the import helpers (scene
+generator, loaders, mesh processing). The vertex layout matches the Vertex
+structure of the sample, a float3 position followed by a float4 color, so that
+the vertices can be copied as-is into the vertex buffers used by the rasterizer
+and by BottomLevelASGenerator::AddVertexBuffer, and read by the hit shaders.
+
+A scene references the meshes through instances, each carrying a transform in
+the 3x4 row-major layout of D3D12_RAYTRACING_INSTANCE_DESC::Transform.
+
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace nv_helpers_dx12
+{
+
+/// Vertex of a mesh, binary compatible with the Vertex structure of the sample
+struct MeshVertex
+{
+  float position[3];
+  float color[4];
+};
+static_assert(sizeof(MeshVertex) == 28, "MeshVertex must match the vertex layout of the sample");
+
+/// Indexed triangle mesh
+struct Mesh
+{
+  std::vector<MeshVertex> vertices;
+  std::vector<uint32_t> indices;
+
+  uint32_t GetTriangleCount() const { return static_cast<uint32_t>(indices.size() / 3); }
+};
+
+/// Instance of a mesh in a scene
+struct SceneInstance
+{
+  uint32_t meshIndex;
+  /// Object-to-world transform, 3x4 row-major, with the translation in the last column
+  float transform[3][4];
+};
+
+/// Set of meshes along with their instances
+struct Scene
+{
+  std::vector<Mesh> meshes;
+  std::vector<SceneInstance> instances;
+};
+
+} // namespace nv_helpers_dx12
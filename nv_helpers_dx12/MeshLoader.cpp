@@ -0,0 +1,974 @@
+/*
+
+The mesh loader imports triangle meshes from Wavefront OBJ and binary PLY files.
+See MeshLoader.h for details.
+
+*/
+
+#include "MeshLoader.h"
+
+#include "MappedFile.h"
+#include "ParallelFor.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+namespace nv_helpers_dx12
+{
+
+namespace
+{
+/// Default color of the vertices without color attribute
+const float kDefaultColor[4] = {1.f, 1.f, 1.f, 1.f};
+
+/// Number of chunks of OBJ text per worker, so that a chunk with denser content, such as faces
+/// with many attributes, does not stall the others
+const size_t kChunksPerWorker = 4;
+
+/// Smallest OBJ chunk worth a worker
+const size_t kMinChunkSizeInBytes = 64 * 1024;
+
+//--------------------------------------------------------------------------------------------------
+//
+// Measure the duration of an import and record it in the statistics, if any, when going out of
+// scope
+class LoadTimer
+{
+public:
+  explicit LoadTimer(MeshLoadStatistics* statistics)
+      : m_statistics(statistics), m_start(std::chrono::steady_clock::now())
+  {
+  }
+
+  ~LoadTimer()
+  {
+    if (m_statistics != nullptr)
+    {
+      m_statistics->seconds =
+          std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start).count();
+    }
+  }
+
+private:
+  MeshLoadStatistics* m_statistics;
+  std::chrono::steady_clock::time_point m_start;
+};
+
+inline bool IsDigit(char c)
+{
+  return c >= '0' && c <= '9';
+}
+
+inline bool IsBlank(char c)
+{
+  return c == ' ' || c == '\t' || c == '\r';
+}
+
+inline const char* SkipBlanks(const char* p, const char* end)
+{
+  while (p < end && IsBlank(*p))
+  {
+    p++;
+  }
+  return p;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Parse a signed integer, returning the end of the number or nullptr if there are no digits
+const char* ParseInteger(const char* p, const char* end, int64_t* value)
+{
+  bool negative = false;
+  if (p < end && (*p == '-' || *p == '+'))
+  {
+    negative = (*p == '-');
+    p++;
+  }
+  if (p == end || !IsDigit(*p))
+  {
+    return nullptr;
+  }
+  int64_t result = 0;
+  while (p < end && IsDigit(*p))
+  {
+    result = result * 10 + (*p - '0');
+    p++;
+  }
+  *value = negative ? -result : result;
+  return p;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Contents of a chunk of OBJ text
+struct ObjChunk
+{
+  std::vector<MeshVertex> vertices;
+  /// Vertex indices of the triangles, 0-based. The relative indices are resolved against the
+  /// vertices of the chunk only, and listed in relativeIndices to be offset once the vertex
+  /// count of the previous chunks is known
+  std::vector<int64_t> indices;
+  std::vector<size_t> relativeIndices;
+  bool valid = true;
+};
+
+//--------------------------------------------------------------------------------------------------
+//
+// Parse the vertex line "v x y z [w | r g b [a]]" starting after the "v"
+bool ParseObjVertex(const char* p, const char* end, ObjChunk& chunk)
+{
+  float values[7];
+  int count = 0;
+  while (count < 7)
+  {
+    p = SkipBlanks(p, end);
+    if (p == end)
+    {
+      break;
+    }
+    p = ParseFloat(p, end, &values[count]);
+    if (p == nullptr)
+    {
+      return false;
+    }
+    count++;
+  }
+  if (count < 3)
+  {
+    return false;
+  }
+
+  MeshVertex vertex = {{values[0], values[1], values[2]},
+                       {kDefaultColor[0], kDefaultColor[1], kDefaultColor[2], kDefaultColor[3]}};
+  if (count >= 6)
+  {
+    vertex.color[0] = values[3];
+    vertex.color[1] = values[4];
+    vertex.color[2] = values[5];
+    vertex.color[3] = count == 7 ? values[6] : 1.f;
+  }
+  chunk.vertices.push_back(vertex);
+  return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Parse the face line "f v1[/vt1][/vn1] v2... v3..." starting after the "f", triangulating
+// polygons as fans around their first vertex
+bool ParseObjFace(const char* p, const char* end, ObjChunk& chunk, std::vector<int64_t>& polygon)
+{
+  polygon.clear();
+  while (true)
+  {
+    p = SkipBlanks(p, end);
+    if (p == end)
+    {
+      break;
+    }
+    int64_t index;
+    p = ParseInteger(p, end, &index);
+    if (p == nullptr || index == 0)
+    {
+      return false;
+    }
+    polygon.push_back(index > 0 ? index - 1 : index);
+    // Skip the texture coordinate and normal indices
+    while (p < end && !IsBlank(*p))
+    {
+      p++;
+    }
+  }
+  if (polygon.size() < 3)
+  {
+    return false;
+  }
+
+  const int64_t chunkVertexCount = static_cast<int64_t>(chunk.vertices.size());
+  for (size_t i = 1; i + 1 < polygon.size(); i++)
+  {
+    const int64_t triangle[3] = {polygon[0], polygon[i], polygon[i + 1]};
+    for (int64_t index : triangle)
+    {
+      if (index < 0)
+      {
+        // Resolved against the vertices of the chunk, and possibly pointing before it
+        chunk.relativeIndices.push_back(chunk.indices.size());
+        index += chunkVertexCount;
+      }
+      chunk.indices.push_back(index);
+    }
+  }
+  return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Parse the lines of an OBJ chunk, ignoring the unsupported statements
+void ParseObjChunk(const char* p, const char* end, ObjChunk& chunk)
+{
+  std::vector<int64_t> polygon;
+  while (p < end && chunk.valid)
+  {
+    const char* lineEnd = static_cast<const char*>(memchr(p, '\n', end - p));
+    if (lineEnd == nullptr)
+    {
+      lineEnd = end;
+    }
+    p = SkipBlanks(p, lineEnd);
+    if (lineEnd - p >= 2 && IsBlank(p[1]))
+    {
+      if (p[0] == 'v')
+      {
+        chunk.valid = ParseObjVertex(p + 1, lineEnd, chunk);
+      }
+      else if (p[0] == 'f')
+      {
+        chunk.valid = ParseObjFace(p + 1, lineEnd, chunk, polygon);
+      }
+    }
+    p = lineEnd + 1;
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Scalar types of the PLY properties
+enum class PlyType
+{
+  Int8,
+  UInt8,
+  Int16,
+  UInt16,
+  Int32,
+  UInt32,
+  Float32,
+  Float64
+};
+
+bool ParsePlyType(const std::string& name, PlyType* type)
+{
+  static const struct
+  {
+    const char* name;
+    PlyType type;
+  } types[] = {{"char", PlyType::Int8},     {"int8", PlyType::Int8},       {"uchar", PlyType::UInt8},
+               {"uint8", PlyType::UInt8},   {"short", PlyType::Int16},     {"int16", PlyType::Int16},
+               {"ushort", PlyType::UInt16}, {"uint16", PlyType::UInt16},   {"int", PlyType::Int32},
+               {"int32", PlyType::Int32},   {"uint", PlyType::UInt32},     {"uint32", PlyType::UInt32},
+               {"float", PlyType::Float32}, {"float32", PlyType::Float32}, {"double", PlyType::Float64},
+               {"float64", PlyType::Float64}};
+  for (const auto& entry : types)
+  {
+    if (name == entry.name)
+    {
+      *type = entry.type;
+      return true;
+    }
+  }
+  return false;
+}
+
+size_t GetPlyTypeSize(PlyType type)
+{
+  switch (type)
+  {
+  case PlyType::Int8:
+  case PlyType::UInt8:
+    return 1;
+  case PlyType::Int16:
+  case PlyType::UInt16:
+    return 2;
+  case PlyType::Int32:
+  case PlyType::UInt32:
+  case PlyType::Float32:
+    return 4;
+  default:
+    return 8;
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Read a scalar of the given type, swapping the bytes of big endian files
+double ReadPlyValue(const uint8_t* data, PlyType type, bool bigEndian)
+{
+  uint8_t bytes[8];
+  const size_t size = GetPlyTypeSize(type);
+  memcpy(bytes, data, size);
+  if (bigEndian)
+  {
+    std::reverse(bytes, bytes + size);
+  }
+
+  switch (type)
+  {
+  case PlyType::Int8:
+    return static_cast<int8_t>(bytes[0]);
+  case PlyType::UInt8:
+    return bytes[0];
+  case PlyType::Int16:
+  {
+    int16_t value;
+    memcpy(&value, bytes, sizeof(value));
+    return value;
+  }
+  case PlyType::UInt16:
+  {
+    uint16_t value;
+    memcpy(&value, bytes, sizeof(value));
+    return value;
+  }
+  case PlyType::Int32:
+  {
+    int32_t value;
+    memcpy(&value, bytes, sizeof(value));
+    return value;
+  }
+  case PlyType::UInt32:
+  {
+    uint32_t value;
+    memcpy(&value, bytes, sizeof(value));
+    return value;
+  }
+  case PlyType::Float32:
+  {
+    float value;
+    memcpy(&value, bytes, sizeof(value));
+    return value;
+  }
+  default:
+  {
+    double value;
+    memcpy(&value, bytes, sizeof(value));
+    return value;
+  }
+  }
+}
+
+struct PlyProperty
+{
+  std::string name;
+  PlyType type;
+  /// Lists are stored as a count of type countType followed by the values
+  bool isList;
+  PlyType countType;
+};
+
+struct PlyElement
+{
+  std::string name;
+  size_t count;
+  std::vector<PlyProperty> properties;
+
+  bool HasList() const
+  {
+    for (const PlyProperty& property : properties)
+    {
+      if (property.isList)
+        return true;
+    }
+    return false;
+  }
+
+  /// Size of an element without lists
+  size_t GetStride() const
+  {
+    size_t stride = 0;
+    for (const PlyProperty& property : properties)
+    {
+      stride += GetPlyTypeSize(property.type);
+    }
+    return stride;
+  }
+
+  /// Offset of a property of an element without lists, or SIZE_MAX if it does not exist
+  size_t GetOffset(const char* propertyName, PlyType* type) const
+  {
+    size_t offset = 0;
+    for (const PlyProperty& property : properties)
+    {
+      if (property.name == propertyName)
+      {
+        *type = property.type;
+        return offset;
+      }
+      offset += GetPlyTypeSize(property.type);
+    }
+    return SIZE_MAX;
+  }
+};
+
+//--------------------------------------------------------------------------------------------------
+//
+// Parse the ASCII header of a PLY file, returning the start of the binary data or nullptr if the
+// header is malformed or the file is not binary
+const uint8_t* ParsePlyHeader(const char* begin, const char* end, std::vector<PlyElement>& elements,
+                              bool* bigEndian)
+{
+  const char* p = begin;
+  bool hasFormat = false;
+  bool first = true;
+  while (p < end)
+  {
+    const char* lineEnd = static_cast<const char*>(memchr(p, '\n', end - p));
+    if (lineEnd == nullptr)
+    {
+      return nullptr;
+    }
+
+    // Split the line into words
+    std::vector<std::string> words;
+    const char* word = SkipBlanks(p, lineEnd);
+    while (word < lineEnd)
+    {
+      const char* wordEnd = word;
+      while (wordEnd < lineEnd && !IsBlank(*wordEnd))
+      {
+        wordEnd++;
+      }
+      words.emplace_back(word, wordEnd);
+      word = SkipBlanks(wordEnd, lineEnd);
+    }
+    p = lineEnd + 1;
+
+    if (first)
+    {
+      if (words.size() != 1 || words[0] != "ply")
+      {
+        return nullptr;
+      }
+      first = false;
+    }
+    else if (words.empty() || words[0] == "comment" || words[0] == "obj_info")
+    {
+      continue;
+    }
+    else if (words[0] == "format" && words.size() >= 2)
+    {
+      if (words[1] != "binary_little_endian" && words[1] != "binary_big_endian")
+      {
+        return nullptr;
+      }
+      *bigEndian = (words[1] == "binary_big_endian");
+      hasFormat = true;
+    }
+    else if (words[0] == "element" && words.size() == 3)
+    {
+      // The count must be a plain decimal number: strtoull would accept a sign, and ignore the
+      // characters following the digits
+      const char* countBegin = words[2].c_str();
+      char* countEnd = nullptr;
+      errno = 0;
+      const unsigned long long count = std::strtoull(countBegin, &countEnd, 10);
+      if (!IsDigit(*countBegin) || *countEnd != '\0' || errno == ERANGE ||
+          static_cast<size_t>(count) != count)
+      {
+        return nullptr;
+      }
+      elements.push_back({words[1], static_cast<size_t>(count), {}});
+    }
+    else if (words[0] == "property" && !elements.empty())
+    {
+      PlyProperty property = {};
+      if (words.size() == 5 && words[1] == "list")
+      {
+        property.isList = true;
+        if (!ParsePlyType(words[2], &property.countType) || !ParsePlyType(words[3], &property.type))
+        {
+          return nullptr;
+        }
+        property.name = words[4];
+      }
+      else if (words.size() == 3)
+      {
+        if (!ParsePlyType(words[1], &property.type))
+        {
+          return nullptr;
+        }
+        property.name = words[2];
+      }
+      else
+      {
+        return nullptr;
+      }
+      elements.back().properties.push_back(property);
+    }
+    else if (words[0] == "end_header")
+    {
+      return hasFormat ? reinterpret_cast<const uint8_t*>(p) : nullptr;
+    }
+    else
+    {
+      return nullptr;
+    }
+  }
+  return nullptr;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Skip an element with lists, returning the end of the element or nullptr if it overflows the
+// file
+const uint8_t* SkipPlyElement(const uint8_t* p, const uint8_t* end, const PlyProperty* properties,
+                              size_t propertyCount, bool bigEndian)
+{
+  for (size_t i = 0; i < propertyCount; i++)
+  {
+    const PlyProperty& property = properties[i];
+    size_t size = GetPlyTypeSize(property.type);
+    if (property.isList)
+    {
+      const size_t countSize = GetPlyTypeSize(property.countType);
+      if (static_cast<size_t>(end - p) < countSize)
+      {
+        return nullptr;
+      }
+      const double count = ReadPlyValue(p, property.countType, bigEndian);
+      if (count < 0.)
+      {
+        return nullptr;
+      }
+      p += countSize;
+      size *= static_cast<size_t>(count);
+    }
+    if (static_cast<size_t>(end - p) < size)
+    {
+      return nullptr;
+    }
+    p += size;
+  }
+  return p;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Read the vertices of a PLY file in parallel
+bool ReadPlyVertices(const PlyElement& element, const uint8_t* data, bool bigEndian, Mesh* mesh,
+                     uint32_t workerCount)
+{
+  const size_t stride = element.GetStride();
+  if (stride == 0)
+  {
+    return false;
+  }
+  PlyType positionTypes[3];
+  size_t positionOffsets[3];
+  const char* positionNames[3] = {"x", "y", "z"};
+  for (int i = 0; i < 3; i++)
+  {
+    positionOffsets[i] = element.GetOffset(positionNames[i], &positionTypes[i]);
+    if (positionOffsets[i] == SIZE_MAX)
+    {
+      return false;
+    }
+  }
+
+  // Integer colors are normalized by the largest value of their type
+  PlyType colorTypes[4];
+  size_t colorOffsets[4];
+  float colorScales[4];
+  const char* colorNames[4] = {"red", "green", "blue", "alpha"};
+  for (int i = 0; i < 4; i++)
+  {
+    colorOffsets[i] = element.GetOffset(colorNames[i], &colorTypes[i]);
+    colorScales[i] = colorTypes[i] == PlyType::UInt8    ? 1.f / 255.f
+                     : colorTypes[i] == PlyType::UInt16 ? 1.f / 65535.f
+                                                        : 1.f;
+  }
+
+  mesh->vertices.resize(element.count);
+  ParallelFor(element.count, workerCount, [&](size_t begin, size_t end) {
+    for (size_t v = begin; v < end; v++)
+    {
+      const uint8_t* source = data + v * stride;
+      MeshVertex& vertex = mesh->vertices[v];
+      for (int i = 0; i < 3; i++)
+      {
+        vertex.position[i] = static_cast<float>(
+            ReadPlyValue(source + positionOffsets[i], positionTypes[i], bigEndian));
+      }
+      for (int i = 0; i < 4; i++)
+      {
+        vertex.color[i] =
+            colorOffsets[i] == SIZE_MAX
+                ? kDefaultColor[i]
+                : static_cast<float>(ReadPlyValue(source + colorOffsets[i], colorTypes[i], bigEndian)) *
+                      colorScales[i];
+      }
+    }
+  });
+  return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Read the faces of a PLY file. As the faces have a variable size, they are first assumed to be
+// triangles, which can be decoded in parallel. The faces are decoded sequentially if this
+// assumption fails
+const uint8_t* ReadPlyFaces(const PlyElement& element, const uint8_t* data, const uint8_t* end,
+                            bool bigEndian, Mesh* mesh, uint32_t workerCount)
+{
+  // Locate the index list, preceded by scalars only in the triangle layout
+  size_t listIndex = SIZE_MAX;
+  for (size_t i = 0; i < element.properties.size(); i++)
+  {
+    const PlyProperty& property = element.properties[i];
+    if (property.isList && (property.name == "vertex_indices" || property.name == "vertex_index"))
+    {
+      listIndex = i;
+    }
+  }
+  if (listIndex == SIZE_MAX)
+  {
+    return nullptr;
+  }
+  const PlyProperty& list = element.properties[listIndex];
+  const size_t countSize = GetPlyTypeSize(list.countType);
+  const size_t indexSize = GetPlyTypeSize(list.type);
+  const double vertexCount = static_cast<double>(mesh->vertices.size());
+
+  bool scalarsOnly = true;
+  size_t listOffset = 0;
+  size_t triangleStride = countSize + 3 * indexSize;
+  for (size_t i = 0; i < element.properties.size(); i++)
+  {
+    if (i == listIndex)
+      continue;
+    scalarsOnly &= !element.properties[i].isList;
+    const size_t size = GetPlyTypeSize(element.properties[i].type);
+    triangleStride += size;
+    if (i < listIndex)
+      listOffset += size;
+  }
+
+  if (scalarsOnly && static_cast<size_t>(end - data) / triangleStride >= element.count)
+  {
+    std::atomic<bool> triangles(true);
+    std::atomic<bool> valid(true);
+    mesh->indices.resize(3 * element.count);
+    ParallelFor(element.count, workerCount, [&](size_t faceBegin, size_t faceEnd) {
+      for (size_t f = faceBegin; f < faceEnd && triangles.load(std::memory_order_relaxed); f++)
+      {
+        const uint8_t* source = data + f * triangleStride + listOffset;
+        if (ReadPlyValue(source, list.countType, bigEndian) != 3.)
+        {
+          triangles = false;
+          break;
+        }
+        for (size_t i = 0; i < 3; i++)
+        {
+          const double index = ReadPlyValue(source + countSize + i * indexSize, list.type, bigEndian);
+          if (index < 0. || index >= vertexCount)
+          {
+            valid = false;
+          }
+          mesh->indices[3 * f + i] = static_cast<uint32_t>(index);
+        }
+      }
+    });
+    if (triangles)
+    {
+      return valid ? data + element.count * triangleStride : nullptr;
+    }
+    mesh->indices.clear();
+  }
+
+  // Sequential decoding of arbitrary polygons, triangulated as fans
+  const uint8_t* p = data;
+  std::vector<uint32_t> polygon;
+  for (size_t f = 0; f < element.count; f++)
+  {
+    p = SkipPlyElement(p, end, element.properties.data(), listIndex, bigEndian);
+    if (p == nullptr || static_cast<size_t>(end - p) < countSize)
+    {
+      return nullptr;
+    }
+    const double count = ReadPlyValue(p, list.countType, bigEndian);
+    p += countSize;
+    if (count < 3. || static_cast<size_t>(end - p) / indexSize < static_cast<size_t>(count))
+    {
+      return nullptr;
+    }
+    polygon.clear();
+    for (size_t i = 0; i < static_cast<size_t>(count); i++, p += indexSize)
+    {
+      const double index = ReadPlyValue(p, list.type, bigEndian);
+      if (index < 0. || index >= vertexCount)
+      {
+        return nullptr;
+      }
+      polygon.push_back(static_cast<uint32_t>(index));
+    }
+    for (size_t i = 1; i + 1 < polygon.size(); i++)
+    {
+      const uint32_t triangle[3] = {polygon[0], polygon[i], polygon[i + 1]};
+      mesh->indices.insert(mesh->indices.end(), triangle, triangle + 3);
+    }
+    p = SkipPlyElement(p, end, element.properties.data() + listIndex + 1,
+                       element.properties.size() - listIndex - 1, bigEndian);
+    if (p == nullptr)
+    {
+      return nullptr;
+    }
+  }
+  return p;
+}
+} // namespace
+
+//--------------------------------------------------------------------------------------------------
+//
+// Fast float parser. The digits are accumulated in an integer mantissa, which is then scaled by
+// an exact power of ten whenever possible
+const char* ParseFloat(const char* p, const char* end, float* value)
+{
+  static const double kPowersOfTen[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+                                        1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+                                        1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+  const uint64_t kMaxMantissa = 100000000000000000ull;
+
+  bool negative = false;
+  if (p < end && (*p == '-' || *p == '+'))
+  {
+    negative = (*p == '-');
+    p++;
+  }
+
+  uint64_t mantissa = 0;
+  int exponent = 0;
+  int digits = 0;
+  for (; p < end && IsDigit(*p); p++, digits++)
+  {
+    // Digits beyond the precision of the mantissa only scale it
+    if (mantissa < kMaxMantissa)
+      mantissa = mantissa * 10 + (*p - '0');
+    else
+      exponent++;
+  }
+  if (p < end && *p == '.')
+  {
+    for (p++; p < end && IsDigit(*p); p++, digits++)
+    {
+      if (mantissa < kMaxMantissa)
+      {
+        mantissa = mantissa * 10 + (*p - '0');
+        exponent--;
+      }
+    }
+  }
+  if (digits == 0)
+  {
+    return nullptr;
+  }
+
+  if (p < end && (*p == 'e' || *p == 'E'))
+  {
+    int64_t explicitExponent;
+    const char* exponentEnd = ParseInteger(p + 1, end, &explicitExponent);
+    if (exponentEnd != nullptr)
+    {
+      exponent += static_cast<int>(std::max<int64_t>(-1000, std::min<int64_t>(1000, explicitExponent)));
+      p = exponentEnd;
+    }
+  }
+
+  double result = static_cast<double>(mantissa);
+  if (mantissa != 0 && exponent != 0)
+  {
+    if (exponent > 0 && exponent <= 22)
+      result *= kPowersOfTen[exponent];
+    else if (exponent < 0 && exponent >= -22)
+      result /= kPowersOfTen[-exponent];
+    else
+      result *= std::pow(10., exponent);
+  }
+  *value = static_cast<float>(negative ? -result : result);
+  return p;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Load an OBJ file, parsing chunks of lines in parallel
+bool LoadOBJ(const std::string& fileName, Mesh* mesh, MeshLoadStatistics* statistics,
+             uint32_t workerCount)
+{
+  LoadTimer timer(statistics);
+  MappedFile file;
+  if (!file.Open(fileName))
+  {
+    return false;
+  }
+  if (statistics != nullptr)
+  {
+    statistics->fileSizeInBytes = file.GetSize();
+  }
+  const char* text = static_cast<const char*>(file.GetData());
+  const char* textEnd = text + file.GetSize();
+
+  // Cut the text into chunks ending at line boundaries
+  const size_t workers = GetWorkerCount(workerCount);
+  const size_t chunkCount = std::max<size_t>(
+      1, std::min(workers * kChunksPerWorker, file.GetSize() / kMinChunkSizeInBytes));
+  std::vector<const char*> boundaries = {text};
+  for (size_t c = 1; c < chunkCount; c++)
+  {
+    const char* boundary = std::max(boundaries.back(), text + c * (file.GetSize() / chunkCount));
+    const char* lineEnd = static_cast<const char*>(memchr(boundary, '\n', textEnd - boundary));
+    if (lineEnd == nullptr)
+    {
+      break;
+    }
+    boundaries.push_back(lineEnd + 1);
+  }
+  boundaries.push_back(textEnd);
+
+  std::vector<ObjChunk> chunks(boundaries.size() - 1);
+  ParallelFor(chunks.size(), workerCount, [&](size_t begin, size_t end) {
+    for (size_t c = begin; c < end; c++)
+    {
+      ParseObjChunk(boundaries[c], boundaries[c + 1], chunks[c]);
+    }
+  });
+
+  // Offset the chunks by the vertices and indices of the previous ones
+  std::vector<size_t> vertexOffsets(chunks.size() + 1, 0);
+  std::vector<size_t> indexOffsets(chunks.size() + 1, 0);
+  for (size_t c = 0; c < chunks.size(); c++)
+  {
+    if (!chunks[c].valid)
+    {
+      return false;
+    }
+    vertexOffsets[c + 1] = vertexOffsets[c] + chunks[c].vertices.size();
+    indexOffsets[c + 1] = indexOffsets[c] + chunks[c].indices.size();
+  }
+  const int64_t vertexCount = static_cast<int64_t>(vertexOffsets.back());
+  if (vertexCount > UINT32_MAX)
+  {
+    return false;
+  }
+
+  mesh->vertices.resize(vertexOffsets.back());
+  mesh->indices.resize(indexOffsets.back());
+  std::atomic<bool> valid(true);
+  ParallelFor(chunks.size(), workerCount, [&](size_t begin, size_t end) {
+    for (size_t c = begin; c < end; c++)
+    {
+      ObjChunk& chunk = chunks[c];
+      for (size_t index : chunk.relativeIndices)
+      {
+        chunk.indices[index] += static_cast<int64_t>(vertexOffsets[c]);
+      }
+      std::copy(chunk.vertices.begin(), chunk.vertices.end(),
+                mesh->vertices.begin() + vertexOffsets[c]);
+      uint32_t* indices = mesh->indices.data() + indexOffsets[c];
+      for (size_t i = 0; i < chunk.indices.size(); i++)
+      {
+        if (chunk.indices[i] < 0 || chunk.indices[i] >= vertexCount)
+        {
+          valid = false;
+        }
+        indices[i] = static_cast<uint32_t>(chunk.indices[i]);
+      }
+    }
+  });
+  return valid;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Load a binary PLY file
+bool LoadPLY(const std::string& fileName, Mesh* mesh, MeshLoadStatistics* statistics,
+             uint32_t workerCount)
+{
+  LoadTimer timer(statistics);
+  MappedFile file;
+  if (!file.Open(fileName))
+  {
+    return false;
+  }
+  if (statistics != nullptr)
+  {
+    statistics->fileSizeInBytes = file.GetSize();
+  }
+  const char* text = static_cast<const char*>(file.GetData());
+  const uint8_t* end = reinterpret_cast<const uint8_t*>(text + file.GetSize());
+
+  std::vector<PlyElement> elements;
+  bool bigEndian = false;
+  const uint8_t* p = ParsePlyHeader(text, text + file.GetSize(), elements, &bigEndian);
+  if (p == nullptr)
+  {
+    return false;
+  }
+
+  mesh->vertices.clear();
+  mesh->indices.clear();
+  bool hasVertices = false;
+  for (const PlyElement& element : elements)
+  {
+    if (element.name == "vertex")
+    {
+      // Vertices with lists are not supported, as they could not be read in parallel. Vertices
+      // without properties have no position
+      if (element.HasList() || element.GetStride() == 0 ||
+          static_cast<size_t>(end - p) / element.GetStride() < element.count ||
+          !ReadPlyVertices(element, p, bigEndian, mesh, workerCount))
+      {
+        return false;
+      }
+      p += element.count * element.GetStride();
+      hasVertices = true;
+    }
+    else if (element.name == "face")
+    {
+      // The vertices are needed to validate the indices
+      if (!hasVertices)
+      {
+        return false;
+      }
+      p = ReadPlyFaces(element, p, end, bigEndian, mesh, workerCount);
+      // The elements following the faces are not needed
+      return p != nullptr;
+    }
+    else
+    {
+      for (size_t i = 0; i < element.count && p != nullptr; i++)
+      {
+        p = SkipPlyElement(p, end, element.properties.data(), element.properties.size(), bigEndian);
+      }
+      if (p == nullptr)
+      {
+        return false;
+      }
+    }
+  }
+  return hasVertices;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Load an OBJ or PLY file depending on its extension
+bool LoadMesh(const std::string& fileName, Mesh* mesh, MeshLoadStatistics* statistics,
+              uint32_t workerCount)
+{
+  const size_t dot = fileName.find_last_of('.');
+  std::string extension = dot == std::string::npos ? std::string() : fileName.substr(dot + 1);
+  std::transform(extension.begin(), extension.end(), extension.begin(),
+                 [](char c) { return static_cast<char>(tolower(c)); });
+  if (extension == "obj")
+  {
+    return LoadOBJ(fileName, mesh, statistics, workerCount);
+  }
+  if (extension == "ply")
+  {
+    return LoadPLY(fileName, mesh, statistics, workerCount);
+  }
+  return false;
+}
+
+} // namespace nv_helpers_dx12
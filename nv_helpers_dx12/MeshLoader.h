@@ -0,0 +1,73 @@
+/*
+
+The mesh loader imports triangle meshes from Wavefront OBJ and binary PLY files
+into the Mesh representation, whose vertices share the layout of the Vertex
+structure of the sample and can be uploaded as-is for AddVertexBuffer, along
+with 32-bit indices.
+
+The files are memory-mapped and parsed in parallel:
+- OBJ: the text is cut into chunks at line boundaries, each chunk being parsed
+  by a worker with a dedicated float parser. Relative (negative) indices are
+  resolved once the vertex counts of the chunks are known. Only the positions,
+  the optional vertex colors (x y z r g b) and the faces are imported, polygons
+  being triangulated as fans
+- PLY: the vertex and face elements are read in place. Faces are decoded in
+  parallel when they are all triangles, and sequentially otherwise
+Missing vertex colors default to white.
+
+The loading statistics provide the parsing throughput, used to benchmark the
+import of large assets.
+
+Example:
+
+nv_helpers_dx12::Mesh mesh;
+nv_helpers_dx12::MeshLoadStatistics statistics;
+if (nv_helpers_dx12::LoadMesh("dragon.ply", &mesh, &statistics))
+{
+  printf("%.1f MB/s\n", statistics.GetThroughput() / (1024. * 1024.));
+}
+
+*/
+
+#pragma once
+
+#include "Mesh.h"
+
+#include <string>
+
+namespace nv_helpers_dx12
+{
+
+/// Timing of a mesh import
+struct MeshLoadStatistics
+{
+  uint64_t fileSizeInBytes = 0;
+  /// Time spent mapping and parsing the file
+  double seconds = 0.;
+
+  /// Parsed bytes per second
+  double GetThroughput() const
+  {
+    return seconds > 0. ? static_cast<double>(fileSizeInBytes) / seconds : 0.;
+  }
+};
+
+/// Load a Wavefront OBJ file, using workerCount threads (0 for the number of hardware threads).
+/// Returns false if the file cannot be read or is malformed
+bool LoadOBJ(const std::string& fileName, Mesh* mesh, MeshLoadStatistics* statistics = nullptr,
+             uint32_t workerCount = 0);
+
+/// Load a binary, little or big endian, PLY file. Returns false if the file cannot be read, is
+/// malformed or uses the ASCII encoding
+bool LoadPLY(const std::string& fileName, Mesh* mesh, MeshLoadStatistics* statistics = nullptr,
+             uint32_t workerCount = 0);
+
+/// Load an OBJ or PLY file depending on its extension
+bool LoadMesh(const std::string& fileName, Mesh* mesh, MeshLoadStatistics* statistics = nullptr,
+              uint32_t workerCount = 0);
+
+/// Parse a floating-point number at the start of [begin, end), as written by printf-like
+/// functions. Returns the end of the number, or nullptr if no number could be parsed
+const char* ParseFloat(const char* begin, const char* end, float* value);
+
+} // namespace nv_helpers_dx12
@@ -0,0 +1,387 @@
+/*
+
+Triangle and vertex reordering for the rasterizer. See MeshOptimizer.h for
+details.
+
+*/
+
+#include "MeshOptimizer.h"
+
+#include "ParallelFor.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace nv_helpers_dx12
+{
+
+namespace
+{
+//--------------------------------------------------------------------------------------------------
+//
+// Triangles adjacent to each vertex, in compressed rows: the triangles of vertex v are
+// triangles[offsets[v]] to triangles[offsets[v + 1] - 1]
+struct VertexAdjacency
+{
+  std::vector<uint32_t> offsets;
+  std::vector<uint32_t> triangles;
+
+  VertexAdjacency(const uint32_t* indices, size_t indexCount, size_t vertexCount)
+      : offsets(vertexCount + 1, 0), triangles(indexCount)
+  {
+    for (size_t i = 0; i < indexCount; i++)
+    {
+      offsets[indices[i] + 1]++;
+    }
+    for (size_t v = 0; v < vertexCount; v++)
+    {
+      offsets[v + 1] += offsets[v];
+    }
+    std::vector<uint32_t> cursors(offsets.begin(), offsets.end() - 1);
+    for (size_t i = 0; i < indexCount; i++)
+    {
+      triangles[cursors[indices[i]]++] = static_cast<uint32_t>(i / 3);
+    }
+  }
+};
+
+//--------------------------------------------------------------------------------------------------
+//
+// Area-weighted centroid and normal of a range of triangles. The length of the normal is twice
+// the area of the triangles
+void AccumulateTriangles(const uint32_t* indices, size_t firstTriangle, size_t lastTriangle,
+                         const MeshVertex* vertices, double centroid[3], double normal[3],
+                         double* area)
+{
+  for (size_t t = firstTriangle; t < lastTriangle; t++)
+  {
+    const float* a = vertices[indices[3 * t + 0]].position;
+    const float* b = vertices[indices[3 * t + 1]].position;
+    const float* c = vertices[indices[3 * t + 2]].position;
+    const double ab[3] = {b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+    const double ac[3] = {c[0] - a[0], c[1] - a[1], c[2] - a[2]};
+    const double n[3] = {ab[1] * ac[2] - ab[2] * ac[1], ab[2] * ac[0] - ab[0] * ac[2],
+                         ab[0] * ac[1] - ab[1] * ac[0]};
+    const double triangleArea = 0.5 * std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+    for (int k = 0; k < 3; k++)
+    {
+      centroid[k] += triangleArea * (a[k] + b[k] + c[k]) / 3.;
+      normal[k] += n[k];
+    }
+    *area += triangleArea;
+  }
+}
+} // namespace
+
+//--------------------------------------------------------------------------------------------------
+//
+// Simulate a FIFO cache: a vertex inserted upon the n-th miss is evicted by the (n + cacheSize)-th
+// miss, hence only the miss index of the last insertion of each vertex needs to be stored
+VertexCacheStatistics AnalyzeVertexCache(const uint32_t* indices, size_t indexCount,
+                                         size_t vertexCount, uint32_t cacheSize)
+{
+  VertexCacheStatistics statistics;
+  statistics.indexCount = indexCount;
+
+  // 0 for vertices never transformed
+  std::vector<uint64_t> insertion(vertexCount, 0);
+  uint64_t misses = 0;
+  for (size_t i = 0; i < indexCount; i++)
+  {
+    uint64_t& inserted = insertion[indices[i]];
+    if (inserted == 0)
+    {
+      statistics.referencedVertexCount++;
+    }
+    if (inserted == 0 || misses - inserted >= cacheSize)
+    {
+      inserted = ++misses;
+    }
+  }
+  statistics.transformedVertexCount = misses;
+  return statistics;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Tipsify, as described by Sander et al. Each step emits all the remaining triangles around the
+// fanning vertex, then picks the next fanning vertex among the vertices of these triangles,
+// preferring the ones that will still be in the cache once their remaining triangles are emitted.
+// When none of them has remaining triangles, the fanning restarts from the most recently used
+// vertex with remaining triangles, or from the next one in the input order. Clusters start on
+// these restarts, and whenever the next fanning vertex is already out of the cache
+void OptimizeVertexCache(uint32_t* destination, const uint32_t* indices, size_t indexCount,
+                         size_t vertexCount, uint32_t cacheSize,
+                         std::vector<uint32_t>* clusterOffsets)
+{
+  const size_t triangleCount = indexCount / 3;
+  if (clusterOffsets != nullptr)
+  {
+    clusterOffsets->clear();
+  }
+  if (triangleCount == 0)
+  {
+    return;
+  }
+
+  const VertexAdjacency adjacency(indices, triangleCount * 3, vertexCount);
+  // Number of triangles not emitted yet around each vertex
+  std::vector<uint32_t> liveTriangles(vertexCount);
+  for (size_t v = 0; v < vertexCount; v++)
+  {
+    liveTriangles[v] = adjacency.offsets[v + 1] - adjacency.offsets[v];
+  }
+  // Time at which the vertices entered the cache, the current time being 'time'
+  std::vector<uint64_t> cacheTime(vertexCount, 0);
+  uint64_t time = cacheSize + 1;
+  std::vector<bool> emitted(triangleCount, false);
+  std::vector<uint32_t> deadEnds;
+  std::vector<uint32_t> candidates;
+  std::vector<uint32_t> output;
+  output.reserve(triangleCount * 3);
+
+  int64_t fanningVertex = 0;
+  while (fanningVertex < static_cast<int64_t>(vertexCount) && liveTriangles[fanningVertex] == 0)
+  {
+    fanningVertex++;
+  }
+  size_t cursor = static_cast<size_t>(fanningVertex) + 1;
+  bool newCluster = true;
+
+  while (fanningVertex >= 0 && fanningVertex < static_cast<int64_t>(vertexCount))
+  {
+    if (newCluster && clusterOffsets != nullptr)
+    {
+      clusterOffsets->push_back(static_cast<uint32_t>(output.size() / 3));
+    }
+    candidates.clear();
+    for (uint32_t a = adjacency.offsets[fanningVertex]; a < adjacency.offsets[fanningVertex + 1];
+         a++)
+    {
+      const uint32_t triangle = adjacency.triangles[a];
+      if (emitted[triangle])
+      {
+        continue;
+      }
+      emitted[triangle] = true;
+      for (int k = 0; k < 3; k++)
+      {
+        const uint32_t v = indices[3 * triangle + k];
+        output.push_back(v);
+        deadEnds.push_back(v);
+        candidates.push_back(v);
+        liveTriangles[v]--;
+        if (time - cacheTime[v] > cacheSize)
+        {
+          cacheTime[v] = time++;
+        }
+      }
+    }
+
+    // Next fanning vertex among the candidates
+    int64_t next = -1;
+    int64_t bestPriority = -1;
+    for (uint32_t v : candidates)
+    {
+      if (liveTriangles[v] == 0)
+      {
+        continue;
+      }
+      int64_t priority = 0;
+      if (time - cacheTime[v] + 2 * liveTriangles[v] <= cacheSize)
+      {
+        priority = static_cast<int64_t>(time - cacheTime[v]);
+      }
+      if (priority > bestPriority)
+      {
+        bestPriority = priority;
+        next = v;
+      }
+    }
+    newCluster = next < 0 || time - cacheTime[next] > cacheSize;
+
+    // Dead end: most recently used vertex with remaining triangles, or next vertex in input order
+    while (next < 0 && !deadEnds.empty())
+    {
+      const uint32_t v = deadEnds.back();
+      deadEnds.pop_back();
+      if (liveTriangles[v] > 0)
+      {
+        next = v;
+      }
+    }
+    while (next < 0 && cursor < vertexCount)
+    {
+      if (liveTriangles[cursor] > 0)
+      {
+        next = static_cast<int64_t>(cursor);
+      }
+      cursor++;
+    }
+    fanningVertex = next;
+  }
+
+  // The indices of a trailing incomplete triangle, if any, are kept as-is at the end
+  std::copy(output.begin(), output.end(), destination);
+  std::copy(indices + output.size(), indices + indexCount, destination + output.size());
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Sort the clusters by decreasing dot product between their normal and the vector from the
+// center of the mesh to their own center, the clusters on the outer hull facing outward being
+// likely to occlude the rest of the mesh
+void OptimizeOverdraw(uint32_t* indices, size_t indexCount, const MeshVertex* vertices,
+                      const std::vector<uint32_t>& clusterOffsets)
+{
+  const size_t triangleCount = indexCount / 3;
+  const size_t clusterCount = clusterOffsets.size();
+  if (clusterCount < 2)
+  {
+    return;
+  }
+  auto clusterEnd = [&](size_t c) {
+    return c + 1 < clusterCount ? clusterOffsets[c + 1] : triangleCount;
+  };
+
+  double meshCentroid[3] = {0., 0., 0.};
+  double meshNormal[3] = {0., 0., 0.};
+  double meshArea = 0.;
+  AccumulateTriangles(indices, 0, triangleCount, vertices, meshCentroid, meshNormal, &meshArea);
+  for (int k = 0; k < 3; k++)
+  {
+    meshCentroid[k] /= std::max(meshArea, 1e-30);
+  }
+
+  std::vector<double> sortKeys(clusterCount);
+  for (size_t c = 0; c < clusterCount; c++)
+  {
+    double centroid[3] = {0., 0., 0.};
+    double normal[3] = {0., 0., 0.};
+    double area = 0.;
+    AccumulateTriangles(indices, clusterOffsets[c], clusterEnd(c), vertices, centroid, normal,
+                        &area);
+    const double normalLength =
+        std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+    double key = 0.;
+    if (area > 0. && normalLength > 0.)
+    {
+      for (int k = 0; k < 3; k++)
+      {
+        key += (centroid[k] / area - meshCentroid[k]) * normal[k] / normalLength;
+      }
+    }
+    sortKeys[c] = key;
+  }
+
+  std::vector<uint32_t> order(clusterCount);
+  for (size_t c = 0; c < clusterCount; c++)
+  {
+    order[c] = static_cast<uint32_t>(c);
+  }
+  std::stable_sort(order.begin(), order.end(),
+                   [&](uint32_t a, uint32_t b) { return sortKeys[a] > sortKeys[b]; });
+
+  std::vector<uint32_t> sorted;
+  sorted.reserve(triangleCount * 3);
+  for (uint32_t c : order)
+  {
+    sorted.insert(sorted.end(), indices + 3 * clusterOffsets[c], indices + 3 * clusterEnd(c));
+  }
+  std::copy(sorted.begin(), sorted.end(), indices);
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+size_t OptimizeVertexFetch(std::vector<MeshVertex>* vertices, uint32_t* indices, size_t indexCount)
+{
+  const uint32_t kUnused = ~0u;
+  std::vector<uint32_t> remap(vertices->size(), kUnused);
+  std::vector<MeshVertex> reordered;
+  reordered.reserve(vertices->size());
+  for (size_t i = 0; i < indexCount; i++)
+  {
+    uint32_t& target = remap[indices[i]];
+    if (target == kUnused)
+    {
+      target = static_cast<uint32_t>(reordered.size());
+      reordered.push_back((*vertices)[indices[i]]);
+    }
+    indices[i] = target;
+  }
+  vertices->swap(reordered);
+  return vertices->size();
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Meshes referencing out-of-range vertices are left untouched
+void OptimizeMesh(Mesh* mesh, uint32_t cacheSize)
+{
+  const size_t vertexCount = mesh->vertices.size();
+  for (uint32_t index : mesh->indices)
+  {
+    if (index >= vertexCount)
+    {
+      return;
+    }
+  }
+
+  std::vector<uint32_t> clusterOffsets;
+  OptimizeVertexCache(mesh->indices.data(), mesh->indices.data(), mesh->indices.size(),
+                      vertexCount, cacheSize, &clusterOffsets);
+  OptimizeOverdraw(mesh->indices.data(), mesh->indices.size(), mesh->vertices.data(),
+                   clusterOffsets);
+  OptimizeVertexFetch(&mesh->vertices, mesh->indices.data(), mesh->indices.size());
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Each worker processes whole meshes, the statistics being gathered per mesh and summed once all
+// the meshes are optimized
+void OptimizeMeshes(std::vector<Mesh>* meshes, uint32_t workerCount, VertexCacheStatistics* before,
+                    VertexCacheStatistics* after, uint32_t cacheSize)
+{
+  std::vector<VertexCacheStatistics> meshBefore(meshes->size());
+  std::vector<VertexCacheStatistics> meshAfter(meshes->size());
+  ParallelFor(meshes->size(), workerCount, [&](size_t begin, size_t end) {
+    for (size_t m = begin; m < end; m++)
+    {
+      Mesh& mesh = (*meshes)[m];
+      if (before != nullptr)
+      {
+        meshBefore[m] = AnalyzeVertexCache(mesh.indices.data(), mesh.indices.size(),
+                                           mesh.vertices.size(), cacheSize);
+      }
+      OptimizeMesh(&mesh, cacheSize);
+      if (after != nullptr)
+      {
+        meshAfter[m] = AnalyzeVertexCache(mesh.indices.data(), mesh.indices.size(),
+                                          mesh.vertices.size(), cacheSize);
+      }
+    }
+  });
+
+  auto sum = [](const std::vector<VertexCacheStatistics>& statistics) {
+    VertexCacheStatistics total;
+    for (const VertexCacheStatistics& s : statistics)
+    {
+      total.indexCount += s.indexCount;
+      total.referencedVertexCount += s.referencedVertexCount;
+      total.transformedVertexCount += s.transformedVertexCount;
+    }
+    return total;
+  };
+  if (before != nullptr)
+  {
+    *before = sum(meshBefore);
+  }
+  if (after != nullptr)
+  {
+    *after = sum(meshAfter);
+  }
+}
+
+} // namespace nv_helpers_dx12
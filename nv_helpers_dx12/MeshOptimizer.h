@@ -0,0 +1,109 @@
+/*
+
+The mesh optimizer reorders indexed triangle meshes for the rasterizer, in
+three steps following "Fast Triangle Reordering for Vertex Locality and Reduced
+Overdraw" (Sander, Nehab and Barczak, 2007):
+- Vertex cache reordering with Tipsify, which fans around the vertices while
+  favoring the ones still in a simulated post-transform cache. The sequence is
+  cut into clusters wherever the fanning reaches a dead end and restarts from a
+  vertex likely out of the cache
+- Overdraw-aware cluster ordering, drawing first the clusters facing away from
+  the center of the mesh, which tend to occlude the others. As the clusters
+  start with a cold cache anyway, their reordering barely affects the vertex
+  cache efficiency
+- Vertex fetch reordering, remapping the vertices in the order of their first
+  use so that the vertex fetches are mostly sequential. Unreferenced vertices
+  are dropped
+
+The efficiency of the vertex cache is reported as:
+- ACMR, the average cache miss ratio: the number of transformed vertices per
+  triangle, between 0.5 (ideal for large regular meshes) and 3
+- ATVR, the average transformed vertex ratio: the number of transformed
+  vertices per referenced vertex, 1 being ideal
+- Hit rate: the fraction of the indices found in the cache
+all measured by simulating a FIFO cache in software.
+
+Example:
+
+nv_helpers_dx12::VertexCacheStatistics before = nv_helpers_dx12::AnalyzeVertexCache(
+    mesh.indices.data(), mesh.indices.size(), mesh.vertices.size());
+nv_helpers_dx12::OptimizeMesh(&mesh);
+nv_helpers_dx12::VertexCacheStatistics after = nv_helpers_dx12::AnalyzeVertexCache(
+    mesh.indices.data(), mesh.indices.size(), mesh.vertices.size());
+
+*/
+
+#pragma once
+
+#include "Mesh.h"
+
+#include <cstddef>
+
+namespace nv_helpers_dx12
+{
+
+/// Size of the simulated post-transform vertex cache, typical of recent hardware
+const uint32_t kDefaultVertexCacheSize = 16;
+
+/// Efficiency of a FIFO post-transform vertex cache for an index sequence
+struct VertexCacheStatistics
+{
+  uint64_t indexCount = 0;
+  /// Number of distinct vertices referenced by the indices
+  uint64_t referencedVertexCount = 0;
+  /// Number of cache misses
+  uint64_t transformedVertexCount = 0;
+
+  /// Average number of transformed vertices per triangle
+  float GetACMR() const
+  {
+    return indexCount > 0 ? 3.f * transformedVertexCount / static_cast<float>(indexCount) : 0.f;
+  }
+  /// Average number of transformed vertices per referenced vertex
+  float GetATVR() const
+  {
+    return referencedVertexCount > 0
+               ? transformedVertexCount / static_cast<float>(referencedVertexCount)
+               : 0.f;
+  }
+  /// Fraction of the indices hitting the cache
+  float GetHitRate() const
+  {
+    return indexCount > 0 ? 1.f - transformedVertexCount / static_cast<float>(indexCount) : 0.f;
+  }
+};
+
+/// Simulate a FIFO vertex cache of cacheSize entries over a triangle list
+VertexCacheStatistics AnalyzeVertexCache(const uint32_t* indices, size_t indexCount,
+                                         size_t vertexCount,
+                                         uint32_t cacheSize = kDefaultVertexCacheSize);
+
+/// Reorder the triangles for the vertex cache using Tipsify, writing the reordered triangle list
+/// into destination, which can alias indices. If clusterOffsets is not nullptr, it receives the
+/// index of the first triangle of each cluster of the new order
+void OptimizeVertexCache(uint32_t* destination, const uint32_t* indices, size_t indexCount,
+                         size_t vertexCount, uint32_t cacheSize = kDefaultVertexCacheSize,
+                         std::vector<uint32_t>* clusterOffsets = nullptr);
+
+/// Reorder the clusters of triangles, given by the index of their first triangle, to reduce the
+/// overdraw: the clusters facing outward from the center of the mesh are drawn first. The
+/// indices are reordered in place
+void OptimizeOverdraw(uint32_t* indices, size_t indexCount, const MeshVertex* vertices,
+                      const std::vector<uint32_t>& clusterOffsets);
+
+/// Renumber the vertices in the order of their first use in the index buffer, dropping the
+/// unreferenced vertices. Returns the new number of vertices
+size_t OptimizeVertexFetch(std::vector<MeshVertex>* vertices, uint32_t* indices, size_t indexCount);
+
+/// Run the three steps on a mesh
+void OptimizeMesh(Mesh* mesh, uint32_t cacheSize = kDefaultVertexCacheSize);
+
+/// Optimize the meshes in parallel using workerCount threads (0 for the number of hardware
+/// threads). If before and after are not nullptr, they receive the cache statistics of the whole
+/// set of meshes before and after optimization
+void OptimizeMeshes(std::vector<Mesh>* meshes, uint32_t workerCount = 0,
+                    VertexCacheStatistics* before = nullptr,
+                    VertexCacheStatistics* after = nullptr,
+                    uint32_t cacheSize = kDefaultVertexCacheSize);
+
+} // namespace nv_helpers_dx12
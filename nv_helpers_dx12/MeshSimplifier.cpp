@@ -0,0 +1,529 @@
+/*
+
+Quadric error metric simplification and LOD chains. See MeshSimplifier.h for
+details.
+
+*/
+
+#include "MeshSimplifier.h"
+
+#include "MeshOptimizer.h"
+#include "ParallelFor.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+namespace nv_helpers_dx12
+{
+
+namespace
+{
+//--------------------------------------------------------------------------------------------------
+//
+// Sum of weighted squared distances to planes, stored as the upper half of a symmetric 4x4 matrix
+// along with the total weight
+struct Quadric
+{
+  double a00 = 0., a01 = 0., a02 = 0., a03 = 0.;
+  double a11 = 0., a12 = 0., a13 = 0.;
+  double a22 = 0., a23 = 0.;
+  double a33 = 0.;
+  double weight = 0.;
+
+  /// Add the plane n.x + d = 0, with a unit normal n
+  void AddPlane(const double n[3], double d, double planeWeight)
+  {
+    a00 += planeWeight * n[0] * n[0];
+    a01 += planeWeight * n[0] * n[1];
+    a02 += planeWeight * n[0] * n[2];
+    a03 += planeWeight * n[0] * d;
+    a11 += planeWeight * n[1] * n[1];
+    a12 += planeWeight * n[1] * n[2];
+    a13 += planeWeight * n[1] * d;
+    a22 += planeWeight * n[2] * n[2];
+    a23 += planeWeight * n[2] * d;
+    a33 += planeWeight * d * d;
+    weight += planeWeight;
+  }
+
+  Quadric& operator+=(const Quadric& q)
+  {
+    a00 += q.a00;
+    a01 += q.a01;
+    a02 += q.a02;
+    a03 += q.a03;
+    a11 += q.a11;
+    a12 += q.a12;
+    a13 += q.a13;
+    a22 += q.a22;
+    a23 += q.a23;
+    a33 += q.a33;
+    weight += q.weight;
+    return *this;
+  }
+
+  /// Weighted sum of the squared distances from p to the planes
+  double Evaluate(const double p[3]) const
+  {
+    const double x = p[0], y = p[1], z = p[2];
+    return a00 * x * x + a11 * y * y + a22 * z * z + a33 +
+           2. * (a01 * x * y + a02 * x * z + a03 * x + a12 * y * z + a13 * y + a23 * z);
+  }
+};
+
+/// Hash of the raw bytes of a few floats, used to find the vertices sharing a position or all
+/// their attributes
+struct FloatKeyHash
+{
+  template <size_t N>
+  size_t operator()(const std::array<uint32_t, N>& key) const
+  {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (uint32_t k : key)
+    {
+      hash = (hash ^ k) * 0x100000001b3ull;
+    }
+    return static_cast<size_t>(hash ^ (hash >> 32));
+  }
+};
+
+template <size_t N>
+std::array<uint32_t, N> MakeKey(const float* values)
+{
+  std::array<uint32_t, N> key;
+  memcpy(key.data(), values, N * sizeof(float));
+  return key;
+}
+
+void TriangleNormal(const double a[3], const double b[3], const double c[3], double normal[3])
+{
+  const double ab[3] = {b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+  const double ac[3] = {c[0] - a[0], c[1] - a[1], c[2] - a[2]};
+  normal[0] = ab[1] * ac[2] - ab[2] * ac[1];
+  normal[1] = ab[2] * ac[0] - ab[0] * ac[2];
+  normal[2] = ab[0] * ac[1] - ab[1] * ac[0];
+}
+
+struct Collapse
+{
+  double cost;
+  uint32_t from;
+  uint32_t to;
+};
+} // namespace
+
+//--------------------------------------------------------------------------------------------------
+//
+// The simplification works on representative vertices, the first vertex of each group sharing
+// a position and all its attributes. The vertices of the positions shared by several groups are
+// seams, and are locked along with the vertices of the border edges, used by a single triangle
+std::vector<uint32_t> SimplifyMesh(const MeshVertex* vertices, size_t vertexCount,
+                                   const uint32_t* indices, size_t indexCount,
+                                   size_t targetIndexCount, float maxError, float colorWeight,
+                                   float* resultError)
+{
+  if (resultError != nullptr)
+  {
+    *resultError = 0.f;
+  }
+  std::vector<uint32_t> result(indices, indices + indexCount - indexCount % 3);
+  if (vertexCount == 0 || result.size() <= targetIndexCount)
+  {
+    return result;
+  }
+
+  // Normalized positions, the largest extent of the bounding box becoming 1
+  float lower[3] = {vertices[0].position[0], vertices[0].position[1], vertices[0].position[2]};
+  float upper[3] = {lower[0], lower[1], lower[2]};
+  for (size_t v = 1; v < vertexCount; v++)
+  {
+    for (int k = 0; k < 3; k++)
+    {
+      lower[k] = std::min(lower[k], vertices[v].position[k]);
+      upper[k] = std::max(upper[k], vertices[v].position[k]);
+    }
+  }
+  const double extent = std::max(std::max(upper[0] - lower[0], upper[1] - lower[1]),
+                                 std::max(upper[2] - lower[2], 1e-30f));
+  std::vector<double> positions(3 * vertexCount);
+  for (size_t v = 0; v < vertexCount; v++)
+  {
+    for (int k = 0; k < 3; k++)
+    {
+      positions[3 * v + k] = (vertices[v].position[k] - lower[k]) / extent;
+    }
+  }
+  auto position = [&](uint32_t v) { return &positions[3 * v]; };
+
+  // Representatives and position groups
+  std::vector<uint32_t> representative(vertexCount);
+  std::vector<uint32_t> positionGroup(vertexCount);
+  std::vector<uint32_t> groupSize(vertexCount, 0);
+  {
+    std::unordered_map<std::array<uint32_t, 7>, uint32_t, FloatKeyHash> vertexMap;
+    std::unordered_map<std::array<uint32_t, 3>, uint32_t, FloatKeyHash> positionMap;
+    vertexMap.reserve(vertexCount);
+    positionMap.reserve(vertexCount);
+    for (uint32_t v = 0; v < vertexCount; v++)
+    {
+      representative[v] =
+          vertexMap.emplace(MakeKey<7>(vertices[v].position), v).first->second;
+      positionGroup[v] = positionMap.emplace(MakeKey<3>(vertices[v].position), v).first->second;
+      if (representative[v] == v)
+      {
+        groupSize[positionGroup[v]]++;
+      }
+    }
+  }
+  for (uint32_t& index : result)
+  {
+    index = representative[index];
+  }
+
+  std::vector<bool> locked(vertexCount, false);
+  for (size_t v = 0; v < vertexCount; v++)
+  {
+    locked[v] = groupSize[positionGroup[v]] > 1;
+  }
+  {
+    // Border edges, between position groups, used by a single triangle
+    std::unordered_map<uint64_t, int32_t> edges;
+    edges.reserve(result.size());
+    for (size_t i = 0; i < result.size(); i += 3)
+    {
+      for (int k = 0; k < 3; k++)
+      {
+        const uint32_t a = positionGroup[result[i + k]];
+        const uint32_t b = positionGroup[result[i + (k + 1) % 3]];
+        if (a != b)
+        {
+          const uint64_t key = (static_cast<uint64_t>(std::min(a, b)) << 32) | std::max(a, b);
+          edges[key]++;
+        }
+      }
+    }
+    for (size_t i = 0; i < result.size(); i += 3)
+    {
+      for (int k = 0; k < 3; k++)
+      {
+        const uint32_t a = positionGroup[result[i + k]];
+        const uint32_t b = positionGroup[result[i + (k + 1) % 3]];
+        const uint64_t key = (static_cast<uint64_t>(std::min(a, b)) << 32) | std::max(a, b);
+        if (a != b && edges[key] == 1)
+        {
+          locked[result[i + k]] = true;
+          locked[result[i + (k + 1) % 3]] = true;
+        }
+      }
+    }
+  }
+
+  // Quadrics of the planes of the triangles, weighted by their area
+  std::vector<Quadric> quadrics(vertexCount);
+  for (size_t i = 0; i < result.size(); i += 3)
+  {
+    double normal[3];
+    TriangleNormal(position(result[i]), position(result[i + 1]), position(result[i + 2]), normal);
+    const double length =
+        std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+    if (length == 0.)
+    {
+      continue;
+    }
+    for (int k = 0; k < 3; k++)
+    {
+      normal[k] /= length;
+    }
+    const double* a = position(result[i]);
+    const double d = -(normal[0] * a[0] + normal[1] * a[1] + normal[2] * a[2]);
+    for (int k = 0; k < 3; k++)
+    {
+      quadrics[result[i + k]].AddPlane(normal, d, 0.5 * length);
+    }
+  }
+
+  const double maxCost = static_cast<double>(maxError) * maxError;
+  double largestCost = 0.;
+  std::vector<uint32_t> adjacencyOffsets(vertexCount + 1);
+  std::vector<uint32_t> adjacency;
+  std::vector<uint32_t> collapseTarget(vertexCount);
+  std::vector<bool> touched(vertexCount);
+  std::vector<Collapse> candidates;
+
+  while (result.size() > targetIndexCount)
+  {
+    // Triangles around each vertex
+    std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+    for (uint32_t index : result)
+    {
+      adjacencyOffsets[index + 1]++;
+    }
+    for (size_t v = 0; v < vertexCount; v++)
+    {
+      adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+    }
+    adjacency.resize(result.size());
+    {
+      std::vector<uint32_t> cursors(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+      for (size_t i = 0; i < result.size(); i++)
+      {
+        adjacency[cursors[result[i]]++] = static_cast<uint32_t>(i / 3);
+      }
+    }
+
+    // Candidate collapses along the edges, in both directions
+    candidates.clear();
+    for (size_t i = 0; i < result.size(); i += 3)
+    {
+      for (int k = 0; k < 3; k++)
+      {
+        const uint32_t a = result[i + k];
+        const uint32_t b = result[i + (k + 1) % 3];
+        for (int direction = 0; direction < 2; direction++)
+        {
+          const uint32_t from = direction == 0 ? a : b;
+          const uint32_t to = direction == 0 ? b : a;
+          if (locked[from] || from == to)
+          {
+            continue;
+          }
+          Quadric merged = quadrics[from];
+          merged += quadrics[to];
+          double cost = merged.weight > 0. ? merged.Evaluate(position(to)) / merged.weight : 0.;
+          for (int c = 0; c < 4; c++)
+          {
+            const double difference = vertices[from].color[c] - vertices[to].color[c];
+            cost += colorWeight * difference * difference;
+          }
+          candidates.push_back({std::max(cost, 0.), from, to});
+        }
+      }
+    }
+    std::sort(candidates.begin(), candidates.end(), [](const Collapse& x, const Collapse& y) {
+      return x.cost < y.cost || (x.cost == y.cost && (x.from < y.from || (x.from == y.from && x.to < y.to)));
+    });
+
+    // Cheapest collapses, stopping once enough triangles are removed
+    for (size_t v = 0; v < vertexCount; v++)
+    {
+      collapseTarget[v] = static_cast<uint32_t>(v);
+    }
+    std::fill(touched.begin(), touched.end(), false);
+    const size_t trianglesToRemove = (result.size() - targetIndexCount + 2) / 3;
+    size_t removedTriangles = 0;
+    size_t collapseCount = 0;
+    for (const Collapse& collapse : candidates)
+    {
+      if (removedTriangles >= trianglesToRemove || collapse.cost > maxCost)
+      {
+        break;
+      }
+      const uint32_t from = collapse.from;
+      const uint32_t to = collapse.to;
+      if (touched[from] || touched[to])
+      {
+        continue;
+      }
+
+      // Reject the collapses flipping a triangle, or connecting the vertex to another copy of
+      // a seam position
+      bool valid = true;
+      size_t removed = 0;
+      for (uint32_t a = adjacencyOffsets[from]; a < adjacencyOffsets[from + 1] && valid; a++)
+      {
+        const uint32_t* triangle = &result[3 * adjacency[a]];
+        if (triangle[0] == to || triangle[1] == to || triangle[2] == to)
+        {
+          removed++;
+          continue;
+        }
+        double before[3];
+        double after[3];
+        TriangleNormal(position(triangle[0]), position(triangle[1]), position(triangle[2]), before);
+        const double* moved[3];
+        for (int k = 0; k < 3; k++)
+        {
+          moved[k] = position(triangle[k] == from ? to : triangle[k]);
+          if (triangle[k] != from && positionGroup[triangle[k]] == positionGroup[to])
+          {
+            valid = false;
+          }
+        }
+        TriangleNormal(moved[0], moved[1], moved[2], after);
+        if (before[0] * after[0] + before[1] * after[1] + before[2] * after[2] < 0.)
+        {
+          valid = false;
+        }
+      }
+      if (!valid)
+      {
+        continue;
+      }
+
+      collapseTarget[from] = to;
+      touched[from] = true;
+      touched[to] = true;
+      quadrics[to] += quadrics[from];
+      largestCost = std::max(largestCost, collapse.cost);
+      removedTriangles += removed;
+      collapseCount++;
+    }
+    if (collapseCount == 0)
+    {
+      break;
+    }
+
+    // Apply the collapses and drop the degenerate triangles
+    size_t kept = 0;
+    for (size_t i = 0; i < result.size(); i += 3)
+    {
+      const uint32_t a = collapseTarget[result[i]];
+      const uint32_t b = collapseTarget[result[i + 1]];
+      const uint32_t c = collapseTarget[result[i + 2]];
+      if (a == b || b == c || a == c)
+      {
+        continue;
+      }
+      result[kept++] = a;
+      result[kept++] = b;
+      result[kept++] = c;
+    }
+    result.resize(kept);
+  }
+
+  if (resultError != nullptr)
+  {
+    *resultError = static_cast<float>(std::sqrt(largestCost));
+  }
+  return result;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Each level simplifies the previous one, and is reordered for the vertex cache as it is meant
+// to be rendered as well. The errors are converted from the relative error of the simplifier
+// into the units of the mesh
+LodChain BuildLodChain(const Mesh& mesh, const LodChainDesc& desc)
+{
+  LodChain chain;
+  if (mesh.vertices.empty())
+  {
+    return chain;
+  }
+
+  float lower[3] = {mesh.vertices[0].position[0], mesh.vertices[0].position[1],
+                    mesh.vertices[0].position[2]};
+  float upper[3] = {lower[0], lower[1], lower[2]};
+  for (const MeshVertex& vertex : mesh.vertices)
+  {
+    for (int k = 0; k < 3; k++)
+    {
+      lower[k] = std::min(lower[k], vertex.position[k]);
+      upper[k] = std::max(upper[k], vertex.position[k]);
+    }
+  }
+  float extent = 0.f;
+  for (int k = 0; k < 3; k++)
+  {
+    chain.center[k] = 0.5f * (lower[k] + upper[k]);
+    extent = std::max(extent, upper[k] - lower[k]);
+  }
+  for (const MeshVertex& vertex : mesh.vertices)
+  {
+    const float d[3] = {vertex.position[0] - chain.center[0], vertex.position[1] - chain.center[1],
+                        vertex.position[2] - chain.center[2]};
+    chain.radius = std::max(chain.radius, std::sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]));
+  }
+
+  // The simplification of each level starts from the previous one, hence the errors of the levels
+  // accumulate, and each level is only allowed what remains of the error budget
+  float accumulatedError = 0.f;
+  chain.lods.push_back({mesh.indices, 0.f});
+  while (chain.lods.size() < desc.maxLodCount)
+  {
+    const MeshLod& previous = chain.lods.back();
+    const size_t target =
+        static_cast<size_t>(previous.GetTriangleCount() * desc.reduction) * 3;
+    const float remainingError = desc.maxError - accumulatedError;
+    if (target < 3 * static_cast<size_t>(desc.minTriangleCount) || remainingError <= 0.f)
+    {
+      break;
+    }
+    MeshLod lod;
+    float relativeError = 0.f;
+    lod.indices = SimplifyMesh(mesh.vertices.data(), mesh.vertices.size(), previous.indices.data(),
+                               previous.indices.size(), target, remainingError, 1.f, &relativeError);
+    // Levels barely simpler than the previous one are not worth keeping
+    if (lod.indices.size() > previous.indices.size() * 9 / 10)
+    {
+      break;
+    }
+    OptimizeVertexCache(lod.indices.data(), lod.indices.data(), lod.indices.size(),
+                        mesh.vertices.size());
+    accumulatedError += relativeError;
+    lod.error = accumulatedError * extent;
+    chain.lods.push_back(std::move(lod));
+  }
+  return chain;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+std::vector<LodChain> BuildLodChains(const std::vector<Mesh>& meshes, uint32_t workerCount,
+                                     const LodChainDesc& desc)
+{
+  std::vector<LodChain> chains(meshes.size());
+  ParallelFor(meshes.size(), workerCount, [&](size_t begin, size_t end) {
+    for (size_t m = begin; m < end; m++)
+    {
+      chains[m] = BuildLodChain(meshes[m], desc);
+    }
+  });
+  return chains;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// The error is scaled by the largest scaling of the transform, and projected at the distance of
+// the closest point of the bounding sphere. Instances containing the camera use the full detail
+uint32_t SelectLod(const LodChain& chain, const float objectToWorld[3][4], const float eye[3],
+                   float screenHeight, float fovY, float maxPixelError)
+{
+  if (chain.lods.size() < 2)
+  {
+    return 0;
+  }
+  const float(*m)[4] = objectToWorld;
+  float scale = 0.f;
+  float center[3];
+  for (int r = 0; r < 3; r++)
+  {
+    center[r] = m[r][0] * chain.center[0] + m[r][1] * chain.center[1] + m[r][2] * chain.center[2] +
+                m[r][3];
+    scale = std::max(scale, std::sqrt(m[0][r] * m[0][r] + m[1][r] * m[1][r] + m[2][r] * m[2][r]));
+  }
+  const float d[3] = {center[0] - eye[0], center[1] - eye[1], center[2] - eye[2]};
+  const float distance = std::sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]) - chain.radius * scale;
+  if (distance <= 0.f)
+  {
+    return 0;
+  }
+
+  const float pixelsPerUnit = screenHeight / (2.f * std::tan(0.5f * fovY) * distance);
+  uint32_t selected = 0;
+  for (uint32_t lod = 1; lod < chain.lods.size(); lod++)
+  {
+    if (chain.lods[lod].error * scale * pixelsPerUnit > maxPixelError)
+    {
+      break;
+    }
+    selected = lod;
+  }
+  return selected;
+}
+
+} // namespace nv_helpers_dx12
@@ -0,0 +1,100 @@
+/*
+
+The mesh simplifier reduces the triangle count of indexed meshes by collapsing
+edges, ordered by the quadric error metric of Garland and Heckbert. A vertex is
+collapsed onto one of its neighbors, which keeps the vertex buffer unchanged:
+the simplified meshes only have a new index buffer, so that all the levels of
+detail of a mesh share its vertices. The cost of a collapse is the mean squared
+distance of the merged vertex to the planes of the triangles it replaces, plus
+the squared difference of the vertex colors, so that the color boundaries are
+preserved.
+
+Attribute seams, where vertices share a position but not their attributes, are
+kept intact by never collapsing the seam vertices themselves. The same applies
+to the borders of open meshes. Vertices with the same position and the same
+attributes are considered as a single vertex, so that meshes with unwelded
+vertices can still be simplified.
+
+The collapses are performed in passes: each pass sorts the candidate edges by
+cost and collapses the cheapest ones, each vertex being involved in at most one
+collapse per pass, until the target triangle count or the maximum error is
+reached. The errors are relative to the size of the mesh, 1 being its largest
+bounding box extent.
+
+A LOD chain is a sequence of simplified index buffers, each level halving the
+triangle count of the previous one. SelectLod picks the coarsest level whose
+error, projected on screen, remains below a given number of pixels.
+
+Example:
+
+nv_helpers_dx12::LodChain chain = nv_helpers_dx12::BuildLodChain(mesh);
+// Upload chain.lods[i].indices into the index buffer of each level
+uint32_t lod = nv_helpers_dx12::SelectLod(chain, instance.transform, eye, screenHeight, fovY);
+
+*/
+
+#pragma once
+
+#include "Mesh.h"
+
+#include <cstddef>
+
+namespace nv_helpers_dx12
+{
+
+/// Simplify a mesh down to targetIndexCount indices, without exceeding maxError. Returns the
+/// new indices, referencing the original vertices. If resultError is not nullptr, it receives
+/// the largest error of the performed collapses
+std::vector<uint32_t> SimplifyMesh(const MeshVertex* vertices, size_t vertexCount,
+                                   const uint32_t* indices, size_t indexCount,
+                                   size_t targetIndexCount, float maxError = 1.f,
+                                   float colorWeight = 1.f, float* resultError = nullptr);
+
+/// Level of detail of a mesh
+struct MeshLod
+{
+  std::vector<uint32_t> indices;
+  /// Geometric error in the units of the mesh, 0 for the original mesh
+  float error = 0.f;
+
+  uint32_t GetTriangleCount() const { return static_cast<uint32_t>(indices.size() / 3); }
+};
+
+/// Levels of detail of a mesh, from the original one to the coarsest
+struct LodChain
+{
+  std::vector<MeshLod> lods;
+  /// Bounding sphere of the mesh
+  float center[3] = {0.f, 0.f, 0.f};
+  float radius = 0.f;
+};
+
+struct LodChainDesc
+{
+  /// Maximum number of levels, the original mesh included
+  uint32_t maxLodCount = 5;
+  /// Triangle count ratio between consecutive levels
+  float reduction = 0.5f;
+  /// No level is generated below this number of triangles
+  uint32_t minTriangleCount = 32;
+  /// Largest relative error allowed in the coarsest level. The errors of the levels accumulate,
+  /// each level being simplified within what remains of this budget
+  float maxError = 0.1f;
+};
+
+/// Generate the levels of detail of a mesh. The generation stops early when a level cannot
+/// reduce the triangle count significantly
+LodChain BuildLodChain(const Mesh& mesh, const LodChainDesc& desc = LodChainDesc());
+
+/// Generate the LOD chains of several meshes in parallel, using workerCount threads (0 for the
+/// number of hardware threads)
+std::vector<LodChain> BuildLodChains(const std::vector<Mesh>& meshes, uint32_t workerCount = 0,
+                                     const LodChainDesc& desc = LodChainDesc());
+
+/// Select the coarsest level of an instance whose error, projected on a screen of screenHeight
+/// pixels with a vertical field of view fovY in radians, stays below maxPixelError. The
+/// transform is the 3x4 row-major object-to-world transform of the instance
+uint32_t SelectLod(const LodChain& chain, const float objectToWorld[3][4], const float eye[3],
+                   float screenHeight, float fovY, float maxPixelError = 1.f);
+
+} // namespace nv_helpers_dx12
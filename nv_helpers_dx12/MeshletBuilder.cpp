@@ -0,0 +1,426 @@
+/*
+
+Meshlet building and culling. See MeshletBuilder.h for details.
+
+*/
+
+#include "MeshletBuilder.h"
+
+#include "ParallelFor.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <stdexcept>
+
+namespace nv_helpers_dx12
+{
+
+namespace
+{
+inline float Dot(const float a[3], const float b[3])
+{
+  return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+inline void Cross(const float a[3], const float b[3], float result[3])
+{
+  result[0] = a[1] * b[2] - a[2] * b[1];
+  result[1] = a[2] * b[0] - a[0] * b[2];
+  result[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+inline float Normalize(float v[3])
+{
+  const float length = std::sqrt(Dot(v, v));
+  if (length > 0.f)
+  {
+    v[0] /= length;
+    v[1] /= length;
+    v[2] /= length;
+  }
+  return length;
+}
+
+inline float Distance(const float a[3], const float b[3])
+{
+  const float d[3] = {a[0] - b[0], a[1] - b[1], a[2] - b[2]};
+  return std::sqrt(Dot(d, d));
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Ritter's bounding sphere: start from the sphere around two distant vertices, and grow it to
+// enclose the vertices outside
+void ComputeBoundingSphere(const MeshletMesh& meshletMesh, const Meshlet& meshlet,
+                           const MeshVertex* vertices, float center[3], float* radius)
+{
+  auto position = [&](uint32_t v) {
+    return vertices[meshletMesh.vertices[meshlet.vertexOffset + v]].position;
+  };
+  auto farthest = [&](const float* from) {
+    uint32_t best = 0;
+    float bestDistance = -1.f;
+    for (uint32_t v = 0; v < meshlet.vertexCount; v++)
+    {
+      const float distance = Distance(from, position(v));
+      if (distance > bestDistance)
+      {
+        bestDistance = distance;
+        best = v;
+      }
+    }
+    return position(best);
+  };
+  const float* a = farthest(position(0));
+  const float* b = farthest(a);
+  for (int k = 0; k < 3; k++)
+  {
+    center[k] = 0.5f * (a[k] + b[k]);
+  }
+  *radius = 0.5f * Distance(a, b);
+
+  for (uint32_t v = 0; v < meshlet.vertexCount; v++)
+  {
+    const float* p = position(v);
+    const float distance = Distance(p, center);
+    if (distance > *radius)
+    {
+      const float newRadius = 0.5f * (*radius + distance);
+      const float shift = (newRadius - *radius) / distance;
+      for (int k = 0; k < 3; k++)
+      {
+        center[k] += (p[k] - center[k]) * shift;
+      }
+      *radius = newRadius;
+    }
+  }
+  // Compensate for the rounding errors, so that the sphere is conservative
+  *radius *= 1.0001f;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// The cone axis is the average of the unit triangle normals, and the cone contains all the
+// normals when the smallest cosine between the axis and the normals is positive. Degenerate
+// triangles are ignored
+void ComputeNormalCone(const MeshletMesh& meshletMesh, const Meshlet& meshlet,
+                       const MeshVertex* vertices, float axis[3], float* cutoff)
+{
+  std::vector<float> normals;
+  normals.reserve(3 * meshlet.triangleCount);
+  float sum[3] = {0.f, 0.f, 0.f};
+  for (uint32_t t = 0; t < meshlet.triangleCount; t++)
+  {
+    const uint8_t* triangle = &meshletMesh.triangles[meshlet.triangleOffset + 3 * t];
+    const float* a = vertices[meshletMesh.vertices[meshlet.vertexOffset + triangle[0]]].position;
+    const float* b = vertices[meshletMesh.vertices[meshlet.vertexOffset + triangle[1]]].position;
+    const float* c = vertices[meshletMesh.vertices[meshlet.vertexOffset + triangle[2]]].position;
+    const float ab[3] = {b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+    const float ac[3] = {c[0] - a[0], c[1] - a[1], c[2] - a[2]};
+    float normal[3];
+    Cross(ab, ac, normal);
+    if (Normalize(normal) == 0.f)
+    {
+      continue;
+    }
+    normals.insert(normals.end(), normal, normal + 3);
+    for (int k = 0; k < 3; k++)
+    {
+      sum[k] += normal[k];
+    }
+  }
+
+  axis[0] = axis[1] = axis[2] = 0.f;
+  *cutoff = 1.f;
+  if (normals.empty() || Normalize(sum) == 0.f)
+  {
+    return;
+  }
+  float minimumCosine = 1.f;
+  for (size_t n = 0; n < normals.size(); n += 3)
+  {
+    minimumCosine = std::min(minimumCosine, Dot(&normals[n], sum));
+  }
+  if (minimumCosine <= 0.f)
+  {
+    return;
+  }
+  axis[0] = sum[0];
+  axis[1] = sum[1];
+  axis[2] = sum[2];
+  *cutoff = std::sqrt(1.f - minimumCosine * minimumCosine);
+}
+} // namespace
+
+//--------------------------------------------------------------------------------------------------
+//
+// The triangles are added in order to the current meshlet until one of the limits is reached.
+// The local index of each mesh vertex is only valid if the vertex was last seen by the current
+// meshlet, which avoids clearing the table for each meshlet
+MeshletMesh BuildMeshlets(const Mesh& mesh, uint32_t maxVertices, uint32_t maxTriangles)
+{
+  if (maxVertices < 3 || maxVertices > kMaxMeshletVertices || maxTriangles < 1 ||
+      maxTriangles > kMaxMeshletTriangles)
+  {
+    throw std::logic_error("Invalid meshlet limits");
+  }
+
+  MeshletMesh result;
+  const uint32_t kNone = ~0u;
+  std::vector<uint32_t> owner(mesh.vertices.size(), kNone);
+  std::vector<uint8_t> localIndex(mesh.vertices.size(), 0);
+  Meshlet current;
+
+  auto flush = [&]() {
+    if (current.triangleCount > 0)
+    {
+      result.meshlets.push_back(current);
+    }
+    current = Meshlet();
+    current.vertexOffset = static_cast<uint32_t>(result.vertices.size());
+    current.triangleOffset = static_cast<uint32_t>(result.triangles.size());
+  };
+
+  const size_t triangleCount = mesh.indices.size() / 3;
+  for (size_t t = 0; t < triangleCount; t++)
+  {
+    const uint32_t* triangle = &mesh.indices[3 * t];
+    const uint32_t meshletIndex = static_cast<uint32_t>(result.meshlets.size());
+    uint32_t newVertices = 0;
+    for (int k = 0; k < 3; k++)
+    {
+      // Repeated vertices within the triangle are only counted once
+      const bool repeated = (k > 0 && triangle[k] == triangle[0]) ||
+                            (k > 1 && triangle[k] == triangle[1]);
+      if (owner[triangle[k]] != meshletIndex && !repeated)
+      {
+        newVertices++;
+      }
+    }
+    if (current.vertexCount + newVertices > maxVertices || current.triangleCount + 1 > maxTriangles)
+    {
+      flush();
+    }
+
+    const uint32_t owned = static_cast<uint32_t>(result.meshlets.size());
+    for (int k = 0; k < 3; k++)
+    {
+      const uint32_t v = triangle[k];
+      if (owner[v] != owned)
+      {
+        owner[v] = owned;
+        localIndex[v] = static_cast<uint8_t>(current.vertexCount++);
+        result.vertices.push_back(v);
+      }
+      result.triangles.push_back(localIndex[v]);
+    }
+    current.triangleCount++;
+  }
+  flush();
+
+  for (Meshlet& meshlet : result.meshlets)
+  {
+    ComputeBoundingSphere(result, meshlet, mesh.vertices.data(), meshlet.center, &meshlet.radius);
+    ComputeNormalCone(result, meshlet, mesh.vertices.data(), meshlet.coneAxis, &meshlet.coneCutoff);
+  }
+  return result;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+std::vector<MeshletMesh> BuildMeshlets(const std::vector<Mesh>& meshes, uint32_t workerCount)
+{
+  std::vector<MeshletMesh> result(meshes.size());
+  ParallelFor(meshes.size(), workerCount, [&](size_t begin, size_t end) {
+    for (size_t m = begin; m < end; m++)
+    {
+      result[m] = BuildMeshlets(meshes[m]);
+    }
+  });
+  return result;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// The side planes contain the eye and the edges of the view pyramid. For instance, the right
+// plane contains the direction forward + tan(fovX / 2) * right, and its inward normal is
+// tan(fovX / 2) * forward - right
+CullingCamera MakeCullingCamera(const float eye[3], const float center[3], const float up[3],
+                                float fovY, float aspectRatio, float zNear, float zFar)
+{
+  float forward[3] = {center[0] - eye[0], center[1] - eye[1], center[2] - eye[2]};
+  Normalize(forward);
+  float right[3];
+  Cross(forward, up, right);
+  Normalize(right);
+  float trueUp[3];
+  Cross(right, forward, trueUp);
+
+  const float tanY = std::tan(0.5f * fovY);
+  const float tanX = tanY * aspectRatio;
+  CullingCamera camera;
+  std::copy(eye, eye + 3, camera.position);
+
+  float normals[6][3];
+  for (int k = 0; k < 3; k++)
+  {
+    normals[0][k] = forward[k];
+    normals[1][k] = -forward[k];
+    normals[2][k] = tanX * forward[k] + right[k];
+    normals[3][k] = tanX * forward[k] - right[k];
+    normals[4][k] = tanY * forward[k] + trueUp[k];
+    normals[5][k] = tanY * forward[k] - trueUp[k];
+  }
+  for (int p = 0; p < 6; p++)
+  {
+    Normalize(normals[p]);
+    std::copy(normals[p], normals[p] + 3, camera.planes[p]);
+    camera.planes[p][3] = -Dot(normals[p], eye);
+  }
+  camera.planes[0][3] -= zNear;
+  camera.planes[1][3] += zFar;
+  return camera;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// A plane P, seen as a row vector, becomes P * M in object space for an object-to-world
+// transform M. The planes are then normalized again, so that the sphere tests remain valid in
+// object space, and the position is transformed by the inverse of M
+CullingCamera TransformCullingCamera(const CullingCamera& camera, const float objectToWorld[3][4])
+{
+  const float(*m)[4] = objectToWorld;
+  CullingCamera result;
+  for (int p = 0; p < 6; p++)
+  {
+    const float* plane = camera.planes[p];
+    float* transformed = result.planes[p];
+    for (int c = 0; c < 4; c++)
+    {
+      transformed[c] = plane[0] * m[0][c] + plane[1] * m[1][c] + plane[2] * m[2][c];
+    }
+    transformed[3] += plane[3];
+    const float length = std::sqrt(Dot(transformed, transformed));
+    if (length > 0.f)
+    {
+      for (int c = 0; c < 4; c++)
+      {
+        transformed[c] /= length;
+      }
+    }
+  }
+
+  // Inverse of the linear part by the adjugate, applied to the position minus the translation
+  const float cofactors[3][3] = {
+      {m[1][1] * m[2][2] - m[1][2] * m[2][1], m[0][2] * m[2][1] - m[0][1] * m[2][2],
+       m[0][1] * m[1][2] - m[0][2] * m[1][1]},
+      {m[1][2] * m[2][0] - m[1][0] * m[2][2], m[0][0] * m[2][2] - m[0][2] * m[2][0],
+       m[0][2] * m[1][0] - m[0][0] * m[1][2]},
+      {m[1][0] * m[2][1] - m[1][1] * m[2][0], m[0][1] * m[2][0] - m[0][0] * m[2][1],
+       m[0][0] * m[1][1] - m[0][1] * m[1][0]}};
+  const float determinant =
+      m[0][0] * cofactors[0][0] + m[0][1] * cofactors[1][0] + m[0][2] * cofactors[2][0];
+  const float relative[3] = {camera.position[0] - m[0][3], camera.position[1] - m[1][3],
+                             camera.position[2] - m[2][3]};
+  for (int r = 0; r < 3; r++)
+  {
+    result.position[r] = determinant != 0.f ? Dot(cofactors[r], relative) / determinant : 0.f;
+  }
+  return result;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// All the triangles face away from the camera if the direction from the camera to any point of
+// the bounding sphere is within 90 degrees minus the cone half-angle of the cone axis, which is
+// conservatively tested as dot(center - eye, axis) >= sin(half-angle) * |center - eye| + radius
+bool IsMeshletVisible(const Meshlet& meshlet, const CullingCamera& camera)
+{
+  for (int p = 0; p < 6; p++)
+  {
+    if (Dot(camera.planes[p], meshlet.center) + camera.planes[p][3] < -meshlet.radius)
+    {
+      return false;
+    }
+  }
+  const float toCenter[3] = {meshlet.center[0] - camera.position[0],
+                             meshlet.center[1] - camera.position[1],
+                             meshlet.center[2] - camera.position[2]};
+  return Dot(toCenter, meshlet.coneAxis) <
+         meshlet.coneCutoff * std::sqrt(Dot(toCenter, toCenter)) + meshlet.radius;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+void CullMeshlets(const MeshletMesh& mesh, const CullingCamera& camera,
+                  std::vector<uint32_t>* visibleMeshlets, MeshletCullingStatistics* statistics)
+{
+  uint64_t visibleMeshletCount = 0;
+  uint64_t visibleTriangleCount = 0;
+  for (size_t m = 0; m < mesh.meshlets.size(); m++)
+  {
+    if (!IsMeshletVisible(mesh.meshlets[m], camera))
+    {
+      continue;
+    }
+    visibleMeshletCount++;
+    visibleTriangleCount += mesh.meshlets[m].triangleCount;
+    if (visibleMeshlets != nullptr)
+    {
+      visibleMeshlets->push_back(static_cast<uint32_t>(m));
+    }
+  }
+  if (statistics != nullptr)
+  {
+    statistics->meshletCount += mesh.meshlets.size();
+    statistics->visibleMeshletCount += visibleMeshletCount;
+    statistics->triangleCount += mesh.GetTriangleCount();
+    statistics->visibleTriangleCount += visibleTriangleCount;
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// The instances are split among the workers, each gathering its own statistics
+MeshletCullingStatistics CullSceneMeshlets(const std::vector<MeshletMesh>& meshes,
+                                           const std::vector<SceneInstance>& instances,
+                                           const CullingCamera& camera, uint32_t workerCount)
+{
+  const auto start = std::chrono::steady_clock::now();
+  const uint32_t workers = GetWorkerCount(workerCount);
+  std::vector<MeshletCullingStatistics> workerStatistics(workers);
+  ParallelFor(workers, workers, [&](size_t begin, size_t end) {
+    for (size_t w = begin; w < end; w++)
+    {
+      const size_t first = instances.size() * w / workers;
+      const size_t last = instances.size() * (w + 1) / workers;
+      for (size_t i = first; i < last; i++)
+      {
+        const SceneInstance& instance = instances[i];
+        if (instance.meshIndex >= meshes.size())
+        {
+          continue;
+        }
+        CullMeshlets(meshes[instance.meshIndex], TransformCullingCamera(camera, instance.transform),
+                     nullptr, &workerStatistics[w]);
+      }
+    }
+  });
+
+  MeshletCullingStatistics statistics;
+  for (const MeshletCullingStatistics& s : workerStatistics)
+  {
+    statistics.meshletCount += s.meshletCount;
+    statistics.visibleMeshletCount += s.visibleMeshletCount;
+    statistics.triangleCount += s.triangleCount;
+    statistics.visibleTriangleCount += s.visibleTriangleCount;
+  }
+  statistics.seconds =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  return statistics;
+}
+
+} // namespace nv_helpers_dx12
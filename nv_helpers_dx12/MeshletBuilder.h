@@ -0,0 +1,129 @@
+/*
+
+The meshlet builder splits indexed triangle meshes into small clusters of at
+most 64 vertices and 124 triangles, the sizes recommended for mesh shaders. Each
+meshlet references the vertices of the mesh through a list of vertex indices,
+and describes its triangles with 8-bit indices into that list. The triangles are
+gathered greedily in the order of the index buffer, so that meshes optimized for
+the vertex cache beforehand (see MeshOptimizer.h) produce compact meshlets.
+
+Each meshlet carries culling data:
+- A bounding sphere, for frustum culling
+- A normal cone, containing the normals of all its triangles, for back-face
+  culling. The normals follow the counter-clockwise convention of the imported
+  meshes: the front face of a triangle (a, b, c) is the side of cross(b - a, c - a)
+
+CullMeshlets tests the meshlets of a mesh against a camera expressed in the
+space of the mesh, and CullSceneMeshlets processes all the instances of a scene
+in parallel, transforming the camera into the space of each instance.
+
+Example:
+
+nv_helpers_dx12::MeshletMesh meshlets = nv_helpers_dx12::BuildMeshlets(mesh);
+nv_helpers_dx12::CullingCamera camera = nv_helpers_dx12::MakeCullingCamera(
+    eye, center, up, fovY, aspectRatio, zNear, zFar);
+std::vector<uint32_t> visibleMeshlets;
+nv_helpers_dx12::CullMeshlets(meshlets, camera, &visibleMeshlets);
+
+*/
+
+#pragma once
+
+#include "Mesh.h"
+
+#include <cstddef>
+
+namespace nv_helpers_dx12
+{
+
+const uint32_t kMaxMeshletVertices = 64;
+const uint32_t kMaxMeshletTriangles = 124;
+
+struct Meshlet
+{
+  /// First entry of the meshlet in MeshletMesh::vertices
+  uint32_t vertexOffset = 0;
+  /// First entry of the meshlet in MeshletMesh::triangles, 3 entries per triangle
+  uint32_t triangleOffset = 0;
+  uint32_t vertexCount = 0;
+  uint32_t triangleCount = 0;
+
+  float center[3] = {0.f, 0.f, 0.f};
+  float radius = 0.f;
+  /// Axis of the normal cone, and sine of its half-angle. Meshlets whose normals span more than
+  /// a half-space have a null axis and a cutoff of 1, and are never back-face culled
+  float coneAxis[3] = {0.f, 0.f, 0.f};
+  float coneCutoff = 1.f;
+};
+
+/// Meshlets of a mesh
+struct MeshletMesh
+{
+  std::vector<Meshlet> meshlets;
+  /// Indices into the vertices of the mesh
+  std::vector<uint32_t> vertices;
+  /// Indices into the vertices of the meshlet
+  std::vector<uint8_t> triangles;
+
+  uint32_t GetTriangleCount() const { return static_cast<uint32_t>(triangles.size() / 3); }
+};
+
+/// Split a mesh into meshlets, and compute their culling data. The limits cannot exceed
+/// kMaxMeshletVertices and kMaxMeshletTriangles
+MeshletMesh BuildMeshlets(const Mesh& mesh, uint32_t maxVertices = kMaxMeshletVertices,
+                          uint32_t maxTriangles = kMaxMeshletTriangles);
+
+/// Build the meshlets of several meshes in parallel, using workerCount threads (0 for the number
+/// of hardware threads)
+std::vector<MeshletMesh> BuildMeshlets(const std::vector<Mesh>& meshes, uint32_t workerCount = 0);
+
+/// Camera position and frustum planes, in the space of the tested meshlets. The planes are
+/// (a, b, c, d) with a normalized (a, b, c) pointing inside the frustum, a point p being inside
+/// when a p.x + b p.y + c p.z + d >= 0
+struct CullingCamera
+{
+  float position[3];
+  float planes[6][4];
+};
+
+/// Camera looking from eye to center, with a vertical field of view fovY in radians
+CullingCamera MakeCullingCamera(const float eye[3], const float center[3], const float up[3],
+                                float fovY, float aspectRatio, float zNear, float zFar);
+
+/// Express a camera in the space of an instance, given the object-to-world transform of the
+/// instance in the 3x4 row-major layout of SceneInstance
+CullingCamera TransformCullingCamera(const CullingCamera& camera, const float objectToWorld[3][4]);
+
+/// True if the meshlet may be visible: its bounding sphere intersects the frustum, and some of
+/// its triangles may face the camera
+bool IsMeshletVisible(const Meshlet& meshlet, const CullingCamera& camera);
+
+struct MeshletCullingStatistics
+{
+  uint64_t meshletCount = 0;
+  uint64_t visibleMeshletCount = 0;
+  uint64_t triangleCount = 0;
+  uint64_t visibleTriangleCount = 0;
+  double seconds = 0.;
+
+  float GetCulledTriangleFraction() const
+  {
+    return triangleCount > 0 ? 1.f - visibleTriangleCount / static_cast<float>(triangleCount) : 0.f;
+  }
+  /// Meshlets tested per second
+  double GetThroughput() const { return seconds > 0. ? meshletCount / seconds : 0.; }
+};
+
+/// Cull the meshlets of a mesh, appending the indices of the potentially visible ones to
+/// visibleMeshlets if not nullptr, and adding the counts to statistics if not nullptr
+void CullMeshlets(const MeshletMesh& mesh, const CullingCamera& camera,
+                  std::vector<uint32_t>* visibleMeshlets,
+                  MeshletCullingStatistics* statistics = nullptr);
+
+/// Cull the meshlets of all the instances of a scene in parallel, for a camera expressed in
+/// world space, and return the statistics of the whole scene
+MeshletCullingStatistics CullSceneMeshlets(const std::vector<MeshletMesh>& meshes,
+                                           const std::vector<SceneInstance>& instances,
+                                           const CullingCamera& camera, uint32_t workerCount = 0);
+
+} // namespace nv_helpers_dx12
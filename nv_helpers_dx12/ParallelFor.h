@@ -0,0 +1,100 @@
+/*
+
+Minimal helper splitting a loop over a range of indices across worker threads.
+The range is cut into one contiguous chunk per worker, the first chunk being
+processed by the calling thread. As the chunks only depend on the index range
+and the worker count, algorithms writing each index to a precomputed location
+produce the same output regardless of the scheduling of the threads.
+
+Example:
+
+nv_helpers_dx12::ParallelFor(meshes.size(), 0, [&](size_t begin, size_t end) {
+  for (size_t i = begin; i < end; i++)
+    ProcessMesh(meshes[i]);
+});
+
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <thread>
+#include <vector>
+
+namespace nv_helpers_dx12
+{
+
+//--------------------------------------------------------------------------------------------------
+// Number of workers to use, where 0 stands for the number of hardware threads
+inline uint32_t GetWorkerCount(uint32_t requestedWorkers = 0)
+{
+  if (requestedWorkers != 0)
+  {
+    return requestedWorkers;
+  }
+  const uint32_t hardwareThreads = std::thread::hardware_concurrency();
+  return hardwareThreads != 0 ? hardwareThreads : 1;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Call function(begin, end) on contiguous chunks covering [0, count), using up to workerCount
+// threads (0 for the number of hardware threads). Exceptions thrown by the function are
+// propagated to the caller once all the workers have completed
+template <typename Function>
+void ParallelFor(size_t count, uint32_t workerCount, Function&& function)
+{
+  if (count == 0)
+  {
+    return;
+  }
+  const size_t workers = std::min<size_t>(GetWorkerCount(workerCount), count);
+  if (workers == 1)
+  {
+    function(size_t(0), count);
+    return;
+  }
+
+  const size_t chunkSize = (count + workers - 1) / workers;
+  std::vector<std::exception_ptr> errors(workers);
+  auto runChunk = [&](size_t worker) {
+    const size_t begin = worker * chunkSize;
+    const size_t end = std::min(count, begin + chunkSize);
+    if (begin >= end)
+    {
+      return;
+    }
+    try
+    {
+      function(begin, end);
+    }
+    catch (...)
+    {
+      errors[worker] = std::current_exception();
+    }
+  };
+
+  std::vector<std::thread> threads;
+  threads.reserve(workers - 1);
+  for (size_t worker = 1; worker < workers; worker++)
+  {
+    threads.emplace_back(runChunk, worker);
+  }
+  runChunk(0);
+  for (std::thread& thread : threads)
+  {
+    thread.join();
+  }
+
+  for (const std::exception_ptr& error : errors)
+  {
+    if (error)
+    {
+      std::rethrow_exception(error);
+    }
+  }
+}
+
+} // namespace nv_helpers_dx12
@@ -0,0 +1,372 @@
+/*
+
+On-disk cache of the pipelines, keyed by their canonical description. See
+PipelineCache.h for details.
+
+*/
+
+#include "PipelineCache.h"
+
+#include "GeometryDeduplicator.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/stat.h>
+#endif
+
+namespace nv_helpers_dx12
+{
+
+namespace
+{
+const char kEntryMagic[4] = {'N', 'V', 'P', 'C'};
+const size_t kKeyLength = 32;
+// Seeds of the two halves of the keys
+const uint64_t kKeySeeds[2] = {0xcbf29ce484222325ull, 0x9e3779b97f4a7c15ull};
+
+// Header preceding the description and the blob in an entry
+struct EntryHeader
+{
+  char magic[4];
+  uint32_t formatVersion;
+  char key[kKeyLength];
+  uint64_t descriptionSize;
+  uint64_t blobSize;
+};
+
+// Field of a record, with the separators escaped so that fields cannot merge. An empty field is
+// written as a dash, and a field made of a dash is escaped
+std::string Escape(const std::string& field)
+{
+  if (field.empty())
+  {
+    return "-";
+  }
+  if (field == "-")
+  {
+    return "\\-";
+  }
+  std::string escaped;
+  for (char c : field)
+  {
+    switch (c)
+    {
+    case '\\':
+      escaped += "\\\\";
+      break;
+    case ' ':
+      escaped += "\\s";
+      break;
+    case '\n':
+      escaped += "\\n";
+      break;
+    default:
+      escaped += c;
+    }
+  }
+  return escaped;
+}
+
+// UTF-8 encoding of a symbol, wchar_t holding UTF-16 code units on Windows and code points
+// elsewhere
+std::string ToUtf8(const std::wstring& symbol)
+{
+  std::string utf8;
+  for (size_t i = 0; i < symbol.size(); i++)
+  {
+    uint32_t c = static_cast<uint32_t>(symbol[i]);
+    if (c >= 0xd800 && c < 0xdc00 && i + 1 < symbol.size())
+    {
+      const uint32_t low = static_cast<uint32_t>(symbol[i + 1]);
+      if (low >= 0xdc00 && low < 0xe000)
+      {
+        c = 0x10000 + ((c - 0xd800) << 10) + (low - 0xdc00);
+        i++;
+      }
+    }
+    if (c < 0x80)
+    {
+      utf8 += static_cast<char>(c);
+    }
+    else if (c < 0x800)
+    {
+      utf8 += static_cast<char>(0xc0 | (c >> 6));
+      utf8 += static_cast<char>(0x80 | (c & 0x3f));
+    }
+    else if (c < 0x10000)
+    {
+      utf8 += static_cast<char>(0xe0 | (c >> 12));
+      utf8 += static_cast<char>(0x80 | ((c >> 6) & 0x3f));
+      utf8 += static_cast<char>(0x80 | (c & 0x3f));
+    }
+    else
+    {
+      utf8 += static_cast<char>(0xf0 | (c >> 18));
+      utf8 += static_cast<char>(0x80 | ((c >> 12) & 0x3f));
+      utf8 += static_cast<char>(0x80 | ((c >> 6) & 0x3f));
+      utf8 += static_cast<char>(0x80 | (c & 0x3f));
+    }
+  }
+  return utf8;
+}
+
+std::vector<std::string> ToUtf8(const std::vector<std::wstring>& symbols)
+{
+  std::vector<std::string> utf8;
+  for (const std::wstring& symbol : symbols)
+  {
+    utf8.push_back(ToUtf8(symbol));
+  }
+  return utf8;
+}
+} // namespace
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+PipelineDescription::PipelineDescription(const std::string& type) : m_type(type) {}
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+void PipelineDescription::AddValue(const std::string& name, const std::string& value)
+{
+  AddRecord("value", {name, value}, {});
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+void PipelineDescription::AddValue(const std::string& name, uint64_t value)
+{
+  AddRecord("value", {name, std::to_string(value)}, {});
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+void PipelineDescription::AddBytes(const std::string& name, const void* data, size_t size)
+{
+  AddRecord("bytes", {name, ComputeContentKey(data, size)}, {});
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+void PipelineDescription::AddLibrary(const std::string& libraryKey,
+                                     const std::vector<std::wstring>& exports)
+{
+  AddRecord("library", {libraryKey}, ToUtf8(exports));
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+void PipelineDescription::AddHitGroup(const std::wstring& hitGroupName,
+                                      const std::wstring& closestHitSymbol,
+                                      const std::wstring& anyHitSymbol,
+                                      const std::wstring& intersectionSymbol)
+{
+  AddRecord("hitgroup",
+            {ToUtf8(hitGroupName), ToUtf8(closestHitSymbol), ToUtf8(anyHitSymbol),
+             ToUtf8(intersectionSymbol)},
+            {});
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+void PipelineDescription::AddRootSignatureAssociation(const std::string& rootSignatureKey,
+                                                      const std::vector<std::wstring>& symbols)
+{
+  AddRecord("association", {rootSignatureKey}, ToUtf8(symbols));
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// The records are only sorted when building the text, so that they can be added in any order
+std::string PipelineDescription::GetText() const
+{
+  std::vector<std::string> records = m_records;
+  std::sort(records.begin(), records.end());
+  std::string text = Escape(m_type) + "\n";
+  for (const std::string& record : records)
+  {
+    text.append(record).push_back('\n');
+  }
+  return text;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+std::string PipelineDescription::GetKey() const
+{
+  const std::string text = GetText();
+  return ComputeContentKey(text.data(), text.size());
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+std::string PipelineDescription::ComputeContentKey(const void* data, size_t size)
+{
+  static const char kDigits[] = "0123456789abcdef";
+  std::string key;
+  for (uint64_t seed : kKeySeeds)
+  {
+    const uint64_t hash = GeometryDeduplicator::HashData(data, size, seed);
+    for (int shift = 60; shift >= 0; shift -= 4)
+    {
+      key.push_back(kDigits[(hash >> shift) & 0xf]);
+    }
+  }
+  return key;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// A record is the kind followed by its fields, the number of symbols and the sorted symbols.
+// Duplicate symbols are kept, as the pipeline creation may reject them
+void PipelineDescription::AddRecord(const std::string& kind, const std::vector<std::string>& fields,
+                                    std::vector<std::string> symbols)
+{
+  std::string record = kind;
+  for (const std::string& field : fields)
+  {
+    record.append(" ").append(Escape(field));
+  }
+  std::sort(symbols.begin(), symbols.end());
+  record.append(" ").append(std::to_string(symbols.size()));
+  for (const std::string& symbol : symbols)
+  {
+    record.append(" ").append(Escape(symbol));
+  }
+  m_records.push_back(record);
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+PipelineCache::PipelineCache(const std::string& directory) : m_directory(directory)
+{
+  if (!m_directory.empty())
+  {
+    // Failing to create the directory is not an error: it may already exist, and otherwise the
+    // entries cannot be stored and the pipelines are created from scratch
+#ifdef _WIN32
+    CreateDirectoryA(m_directory.c_str(), nullptr);
+#else
+    mkdir(m_directory.c_str(), 0755);
+#endif
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// The header is checked against the key, and the stored description against the one of the
+// pipeline, so that a truncated, foreign or colliding entry is not used
+bool PipelineCache::Find(const PipelineDescription& description, std::vector<uint8_t>* blob)
+{
+  blob->clear();
+  if (!IsEnabled())
+  {
+    m_statistics.missCount++;
+    return false;
+  }
+  const std::string text = description.GetText();
+  const std::string key = PipelineDescription::ComputeContentKey(text.data(), text.size());
+  std::ifstream file(GetEntryPath(key), std::ios::binary);
+  EntryHeader header;
+  std::string storedText;
+  bool found = file.good() && file.read(reinterpret_cast<char*>(&header), sizeof(header)) &&
+               memcmp(header.magic, kEntryMagic, sizeof(kEntryMagic)) == 0 &&
+               header.formatVersion == kFormatVersion &&
+               key.compare(0, kKeyLength, header.key, kKeyLength) == 0 &&
+               header.descriptionSize == text.size();
+  if (found)
+  {
+    storedText.resize(static_cast<size_t>(header.descriptionSize));
+    blob->resize(static_cast<size_t>(header.blobSize));
+    found = file.read(&storedText[0], storedText.size()) && storedText == text &&
+            file.read(reinterpret_cast<char*>(blob->data()), blob->size()) &&
+            file.peek() == std::char_traits<char>::eof();
+  }
+  if (!found)
+  {
+    blob->clear();
+    m_statistics.missCount++;
+    return false;
+  }
+  m_statistics.hitCount++;
+  return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+bool PipelineCache::Store(const PipelineDescription& description, const std::vector<uint8_t>& blob)
+{
+  if (!IsEnabled())
+  {
+    return false;
+  }
+  const std::string text = description.GetText();
+  const std::string key = PipelineDescription::ComputeContentKey(text.data(), text.size());
+  EntryHeader header;
+  memcpy(header.magic, kEntryMagic, sizeof(kEntryMagic));
+  header.formatVersion = kFormatVersion;
+  memcpy(header.key, key.data(), kKeyLength);
+  header.descriptionSize = text.size();
+  header.blobSize = blob.size();
+
+  const std::string path = GetEntryPath(key);
+  const std::string temporaryPath = path + ".tmp";
+  bool written = false;
+  {
+    std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+    written = file.write(reinterpret_cast<const char*>(&header), sizeof(header)) &&
+              file.write(text.data(), text.size()) &&
+              file.write(reinterpret_cast<const char*>(blob.data()), blob.size());
+  }
+  // rename does not replace an existing file on Windows, such as a rejected entry
+  std::remove(path.c_str());
+  if (!written || std::rename(temporaryPath.c_str(), path.c_str()) != 0)
+  {
+    std::remove(temporaryPath.c_str());
+    m_statistics.storeFailureCount++;
+    return false;
+  }
+  return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+void PipelineCache::Reject(const PipelineDescription& description)
+{
+  m_statistics.rejectedCount++;
+  if (IsEnabled())
+  {
+    std::remove(GetEntryPath(description.GetKey()).c_str());
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+std::string PipelineCache::GetEntryPath(const std::string& key) const
+{
+  return m_directory + "/" + key + ".pso";
+}
+
+} // namespace nv_helpers_dx12
@@ -0,0 +1,146 @@
+/*
+
+The pipeline cache stores the pipelines created by the application on disk, so
+that the next launches can reuse them instead of compiling them from scratch.
+Each pipeline is identified by a canonical description, built as a set of
+self-contained records: the libraries with their exports, the hit groups, the
+root signature associations, the shader configuration, or the fields of a
+graphics pipeline state. The records are sorted, as well as the lists of
+symbols within them, so that the description does not depend on the order in
+which the pipeline was assembled. Shaders, libraries and root signatures are
+referred to by the content key of their bytecode, hence editing any of them
+produces a new description.
+
+The key of a pipeline is a 128-bit hash of its description, and names its
+entry. Each entry holds the description itself, checked upon lookup so that a
+hash collision cannot return the blob of another pipeline, followed by the
+cached blob returned by the driver. Blobs are only valid for the device and
+driver which created them: the application reports a blob rejected upon
+pipeline creation, and its entry is removed until the pipeline is stored
+again.
+
+The descriptions and the cache do not depend on D3D12, so that the
+canonicalization and the keys can be validated on any platform.
+
+Example:
+
+nv_helpers_dx12::PipelineCache cache("PipelineCache");
+nv_helpers_dx12::PipelineDescription description("graphics");
+description.AddBytes("vs", vertexShader.data(), vertexShader.size());
+description.AddValue("topology", D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE);
+std::vector<uint8_t> blob;
+if (cache.Find(description, &blob) && !blob.empty())
+{
+  psoDesc.CachedPSO = {blob.data(), blob.size()};
+}
+// Create the pipeline, calling cache.Reject(description) if the blob is rejected, then store
+// the blob returned by GetCachedBlob
+cache.Store(description, cachedBlob);
+
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace nv_helpers_dx12
+{
+
+/// Canonical description of a pipeline, independent of the order of the additions
+class PipelineDescription
+{
+public:
+  /// The type distinguishes pipelines of different kinds with the same records
+  explicit PipelineDescription(const std::string& type);
+
+  /// Add a named value. Adding several values of the same name keeps all of them
+  void AddValue(const std::string& name, const std::string& value);
+  void AddValue(const std::string& name, uint64_t value);
+
+  /// Add a named value identified by the content key of the data, such as shader bytecode
+  void AddBytes(const std::string& name, const void* data, size_t size);
+
+  /// Add a library, identified by the content key of its bytecode, with its exported symbols
+  void AddLibrary(const std::string& libraryKey, const std::vector<std::wstring>& exports);
+
+  /// Add a hit group with its shaders, an empty symbol standing for the default shader
+  void AddHitGroup(const std::wstring& hitGroupName, const std::wstring& closestHitSymbol,
+                   const std::wstring& anyHitSymbol, const std::wstring& intersectionSymbol);
+
+  /// Add the association of a root signature, identified by the content key of its serialized
+  /// form, to a set of symbols
+  void AddRootSignatureAssociation(const std::string& rootSignatureKey,
+                                   const std::vector<std::wstring>& symbols);
+
+  /// Canonical text of the description: the type on the first line, followed by the sorted
+  /// records, one per line
+  std::string GetText() const;
+
+  /// Key of the description as 32 hexadecimal digits
+  std::string GetKey() const;
+
+  /// Content key of arbitrary data as 32 hexadecimal digits
+  static std::string ComputeContentKey(const void* data, size_t size);
+
+private:
+  void AddRecord(const std::string& kind, const std::vector<std::string>& fields,
+                 std::vector<std::string> symbols);
+
+  std::string m_type;
+  std::vector<std::string> m_records;
+};
+
+/// Counts of the cache lookups
+struct PipelineCacheStatistics
+{
+  uint32_t hitCount = 0;
+  uint32_t missCount = 0;
+  /// Blobs found in the cache but rejected upon pipeline creation
+  uint32_t rejectedCount = 0;
+  /// Entries which could not be written to disk
+  uint32_t storeFailureCount = 0;
+
+  float GetHitRate() const
+  {
+    const uint32_t lookups = hitCount + missCount;
+    return lookups > 0 ? hitCount / static_cast<float>(lookups) : 0.f;
+  }
+};
+
+/// Helper class caching pipeline blobs on disk, keyed by the hash of the pipeline description
+class PipelineCache
+{
+public:
+  /// Version of the format of the entries, changing it invalidates all of them
+  static const uint32_t kFormatVersion = 1;
+
+  /// The directory is created if needed, and an empty directory disables the cache, every lookup
+  /// then being a miss
+  explicit PipelineCache(const std::string& directory);
+
+  /// Read the blob stored for the pipeline. Returns false if there is no valid entry with the
+  /// same description. The blob may be empty for pipelines without any cached blob
+  bool Find(const PipelineDescription& description, std::vector<uint8_t>* blob);
+
+  /// Write the entry of the pipeline through a temporary file, so that an interrupted write leaves
+  /// no entry. Returns false if the entry cannot be written
+  bool Store(const PipelineDescription& description, const std::vector<uint8_t>& blob);
+
+  /// Remove the entry of a pipeline whose blob was rejected, e.g. after a driver update
+  void Reject(const PipelineDescription& description);
+
+  /// Path of the entry of a key
+  std::string GetEntryPath(const std::string& key) const;
+
+  bool IsEnabled() const { return !m_directory.empty(); }
+
+  const PipelineCacheStatistics& GetStatistics() const { return m_statistics; }
+
+private:
+  std::string m_directory;
+  PipelineCacheStatistics m_statistics;
+};
+
+} // namespace nv_helpers_dx12
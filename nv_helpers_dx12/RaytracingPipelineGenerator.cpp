@@ -40,6 +40,7 @@ compiling in debug mode.
 */
 
 #include "RaytracingPipelineGenerator.h"
+#include "RootSignatureGenerator.h"
 
 #include "dxcapi.h"
 #include <unordered_set>
@@ -70,6 +71,20 @@ void RayTracingPipelineGenerator::AddLibrary(IDxcBlob* dxilLibrary,
   m_libraries.emplace_back(Library(dxilLibrary, symbolExports));
 }
 
+//--------------------------------------------------------------------------------------------------
+//
+// Add a DXIL library which may still be compiling. Its bytecode is waited for by Generate, so that
+// the compilation overlaps the description of the rest of the pipeline
+void RayTracingPipelineGenerator::AddLibrary(std::shared_future<std::vector<uint8_t>> dxilLibrary,
+                                             const std::vector<std::wstring>& symbolExports)
+{
+  if (!dxilLibrary.valid())
+  {
+    throw std::logic_error("Adding a library without a pending compilation");
+  }
+  m_libraries.emplace_back(Library(nullptr, symbolExports, std::move(dxilLibrary)));
+}
+
 //--------------------------------------------------------------------------------------------------
 //
 // In DXR the hit-related shaders are grouped into hit groups. Such shaders are:
@@ -155,6 +170,9 @@ ID3D12StateObject* RayTracingPipelineGenerator::Generate()
 
   UINT currentIndex = 0;
 
+  // Wait for the libraries still compiling
+  ResolvePendingLibraries();
+
   // Add all the DXIL libraries
   for (const Library& lib : m_libraries)
   {
@@ -281,6 +299,58 @@ ID3D12StateObject* RayTracingPipelineGenerator::Generate()
   return rtStateObject;
 }
 
+//--------------------------------------------------------------------------------------------------
+//
+// The description holds everything Generate turns into subobjects, the libraries being identified
+// by the content key of their bytecode. The empty root signatures are the same for all pipelines
+PipelineDescription RayTracingPipelineGenerator::GetDescription()
+{
+  ResolvePendingLibraries();
+
+  PipelineDescription description("raytracing");
+  for (const Library& lib : m_libraries)
+  {
+    description.AddLibrary(
+        PipelineDescription::ComputeContentKey(lib.m_libDesc.DXILLibrary.pShaderBytecode,
+                                               lib.m_libDesc.DXILLibrary.BytecodeLength),
+        lib.m_exportedSymbols);
+  }
+  for (const HitGroup& group : m_hitGroups)
+  {
+    description.AddHitGroup(group.m_hitGroupName, group.m_closestHitSymbol, group.m_anyHitSymbol,
+                            group.m_intersectionSymbol);
+  }
+  for (const RootSignatureAssociation& assoc : m_rootSignatureAssociations)
+  {
+    const std::string rootSignatureKey = RootSignatureGenerator::GetKey(assoc.m_rootSignature);
+    if (rootSignatureKey.empty())
+    {
+      throw std::logic_error("Describing a pipeline with a root signature without key");
+    }
+    description.AddRootSignatureAssociation(rootSignatureKey, assoc.m_symbols);
+  }
+  description.AddValue("maxPayloadSize", m_maxPayLoadSizeInBytes);
+  description.AddValue("maxAttributeSize", m_maxAttributeSizeInBytes);
+  description.AddValue("maxRecursionDepth", m_maxRecursionDepth);
+  return description;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// The bytecode is owned by the shared state of the future, which lives as long as the library
+void RayTracingPipelineGenerator::ResolvePendingLibraries()
+{
+  for (Library& lib : m_libraries)
+  {
+    if (lib.m_pendingDxil.valid())
+    {
+      const std::vector<uint8_t>& dxil = lib.m_pendingDxil.get();
+      lib.m_libDesc.DXILLibrary.BytecodeLength = dxil.size();
+      lib.m_libDesc.DXILLibrary.pShaderBytecode = dxil.data();
+    }
+  }
+}
+
 //--------------------------------------------------------------------------------------------------
 //
 // The pipeline creation requires having at least one empty global and local root signatures, so
@@ -434,9 +504,11 @@ void RayTracingPipelineGenerator::BuildShaderExportList(std::vector<std::wstring
 //
 // Store data related to a DXIL library: the library itself, the exported symbols, and the
 // associated descriptors
-RayTracingPipelineGenerator::Library::Library(IDxcBlob* dxil,
-                                              const std::vector<std::wstring>& exportedSymbols)
-    : m_dxil(dxil), m_exportedSymbols(exportedSymbols), m_exports(exportedSymbols.size())
+RayTracingPipelineGenerator::Library::Library(
+    IDxcBlob* dxil, const std::vector<std::wstring>& exportedSymbols,
+    std::shared_future<std::vector<uint8_t>> pendingDxil /*= {}*/)
+    : m_dxil(dxil), m_pendingDxil(std::move(pendingDxil)), m_exportedSymbols(exportedSymbols),
+      m_exports(exportedSymbols.size())
 {
   // Create one export descriptor per symbol
   for (size_t i = 0; i < m_exportedSymbols.size(); i++)
@@ -447,9 +519,10 @@ RayTracingPipelineGenerator::Library::Library(IDxcBlob* dxil,
     m_exports[i].Flags = D3D12_EXPORT_FLAG_NONE;
   }
 
-  // Create a library descriptor combining the DXIL code and the export names
-  m_libDesc.DXILLibrary.BytecodeLength = dxil->GetBufferSize();
-  m_libDesc.DXILLibrary.pShaderBytecode = dxil->GetBufferPointer();
+  // Create a library descriptor combining the DXIL code and the export names. The code of a
+  // pending library is set by Generate
+  m_libDesc.DXILLibrary.BytecodeLength = dxil ? dxil->GetBufferSize() : 0;
+  m_libDesc.DXILLibrary.pShaderBytecode = dxil ? dxil->GetBufferPointer() : nullptr;
   m_libDesc.NumExports = static_cast<UINT>(m_exportedSymbols.size());
   m_libDesc.pExports = m_exports.data();
 }
@@ -460,7 +533,7 @@ RayTracingPipelineGenerator::Library::Library(IDxcBlob* dxil,
 // the default constructor would copy the string pointers of the symbols into the descriptors, which
 // would cause issues when the original Library object gets out of scope
 RayTracingPipelineGenerator::Library::Library(const Library& source)
-    : Library(source.m_dxil, source.m_exportedSymbols)
+    : Library(source.m_dxil, source.m_exportedSymbols, source.m_pendingDxil)
 {
 }
 
@@ -65,6 +65,10 @@ rtStateObject = pipeline.Generate();
 
 #include <dxcapi.h>
 
+#include "PipelineCache.h"
+
+#include <cstdint>
+#include <future>
 #include <string>
 #include <vector>
 
@@ -84,6 +88,11 @@ public:
   /// names of the shaders declared in the library, although unused ones can be omitted.
   void AddLibrary(IDxcBlob* dxilLibrary, const std::vector<std::wstring>& symbolExports);
 
+  /// Add a DXIL library which may still be compiling, such as a result of a ShaderCompileQueue.
+  /// Its bytecode is only waited for by Generate, which rethrows the compilation errors
+  void AddLibrary(std::shared_future<std::vector<uint8_t>> dxilLibrary,
+                  const std::vector<std::wstring>& symbolExports);
+
   /// In DXR the hit-related shaders are grouped into hit groups. Such shaders are:
   /// - The intersection shader, which can be used to intersect custom geometry, and is called upon
   ///   hitting the bounding box the the object. A default one exists to intersect triangles
@@ -122,15 +131,23 @@ public:
   /// Compiles the raytracing state object
   ID3D12StateObject* Generate();
 
+  /// Canonical description of the pipeline, identifying it in a PipelineCache. Waits for the
+  /// pending libraries, and requires the root signatures to carry their key (see
+  /// RootSignatureGenerator::GetKey)
+  PipelineDescription GetDescription();
+
 private:
   /// Storage for DXIL libraries and their exported symbols
   struct Library
   {
-    Library(IDxcBlob* dxil, const std::vector<std::wstring>& exportedSymbols);
+    Library(IDxcBlob* dxil, const std::vector<std::wstring>& exportedSymbols,
+            std::shared_future<std::vector<uint8_t>> pendingDxil = {});
 
     Library(const Library& source);
 
     IDxcBlob* m_dxil;
+    /// Bytecode of a library added while compiling, used instead of m_dxil once available
+    std::shared_future<std::vector<uint8_t>> m_pendingDxil;
     const std::vector<std::wstring> m_exportedSymbols;
 
     std::vector<D3D12_EXPORT_DESC> m_exports;
@@ -176,6 +193,9 @@ private:
   /// hit group names
   void BuildShaderExportList(std::vector<std::wstring>& exportedSymbols);
 
+  /// Wait for the libraries still compiling, and point their descriptors to their bytecode
+  void ResolvePendingLibraries();
+
   std::vector<Library> m_libraries = {};
   std::vector<HitGroup> m_hitGroups = {};
   std::vector<RootSignatureAssociation> m_rootSignatureAssociations = {};
@@ -0,0 +1,318 @@
+/*
+
+Compilation and execution of a frame described as passes and resources. See
+RenderGraph.h for details.
+
+*/
+
+#include "RenderGraph.h"
+
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+
+// Helper to compute aligned buffer sizes
+#ifndef ROUND_UP
+#define ROUND_UP(v, powerOf2Alignment) (((v) + (powerOf2Alignment)-1) & ~((powerOf2Alignment)-1))
+#endif
+
+namespace nv_helpers_dx12
+{
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+uint32_t RenderGraph::ImportResource(const std::string& name, void* resource)
+{
+  m_resources.push_back({name, resource, true, 0, 1, false, false, kInvalidHandle, kInvalidHandle, 0, 0});
+  m_compiled = false;
+  return static_cast<uint32_t>(m_resources.size() - 1);
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+uint32_t RenderGraph::CreateTransientResource(const std::string& name, uint64_t sizeInBytes,
+                                              uint64_t alignment)
+{
+  if (alignment == 0 || (alignment & (alignment - 1)) != 0)
+  {
+    throw std::logic_error("The alignment of a transient resource must be a power of two");
+  }
+  m_resources.push_back(
+      {name, nullptr, false, sizeInBytes, alignment, false, false, kInvalidHandle, kInvalidHandle, 0, 0});
+  m_compiled = false;
+  return static_cast<uint32_t>(m_resources.size() - 1);
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+void RenderGraph::SetResource(uint32_t resource, void* pointer)
+{
+  m_resources.at(resource).pointer = pointer;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+uint32_t RenderGraph::AddPass(const std::string& name, std::function<void()> execute,
+                              bool hasSideEffects)
+{
+  m_passes.push_back({name, std::move(execute), hasSideEffects, {}, false});
+  m_compiled = false;
+  return static_cast<uint32_t>(m_passes.size() - 1);
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Reading and writing a resource in the same state, such as an UAV, is a single access
+void RenderGraph::AddAccess(uint32_t pass, uint32_t resource, uint32_t state, bool write)
+{
+  if (resource >= m_resources.size())
+  {
+    throw std::logic_error("Access to an unknown render graph resource");
+  }
+  std::vector<Access>& accesses = m_passes.at(pass).accesses;
+  for (Access& access : accesses)
+  {
+    if (access.resource == resource)
+    {
+      if (access.state != state)
+      {
+        throw std::logic_error("A render graph pass uses a resource in two different states");
+      }
+      access.write |= write;
+      return;
+    }
+  }
+  accesses.push_back({resource, state, write, kInvalidHandle, 0});
+  m_compiled = false;
+}
+
+void RenderGraph::Read(uint32_t pass, uint32_t resource, uint32_t state)
+{
+  AddAccess(pass, resource, state, false);
+}
+
+void RenderGraph::Write(uint32_t pass, uint32_t resource, uint32_t state)
+{
+  AddAccess(pass, resource, state, true);
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// The passes are visited from the last one, so that a pass is kept once one of its writes is read
+// by a kept pass after it. A pass reading a resource keeps all the previous writers of that
+// resource, as the graph does not know whether a write covers the whole resource
+void RenderGraph::Compile()
+{
+  std::vector<bool> read(m_resources.size(), false);
+  for (size_t p = m_passes.size(); p-- > 0;)
+  {
+    Pass& pass = m_passes[p];
+    bool kept = pass.hasSideEffects;
+    for (const Access& access : pass.accesses)
+    {
+      kept |= access.write && (m_resources[access.resource].imported || read[access.resource]);
+    }
+    pass.culled = !kept;
+    if (kept)
+    {
+      for (const Access& access : pass.accesses)
+      {
+        read[access.resource] = read[access.resource] || !access.write ||
+                                m_resources[access.resource].imported;
+      }
+    }
+  }
+
+  // Lifetimes, and next use of each access
+  for (Resource& resource : m_resources)
+  {
+    resource.used = false;
+    resource.aliased = false;
+    resource.firstPass = kInvalidHandle;
+    resource.lastPass = kInvalidHandle;
+    resource.heapOffset = 0;
+  }
+  std::vector<Access*> lastAccesses(m_resources.size(), nullptr);
+  for (uint32_t p = 0; p < m_passes.size(); p++)
+  {
+    if (m_passes[p].culled)
+    {
+      continue;
+    }
+    for (Access& access : m_passes[p].accesses)
+    {
+      Resource& resource = m_resources[access.resource];
+      if (!resource.used)
+      {
+        resource.used = true;
+        resource.firstPass = p;
+        resource.firstState = access.state;
+      }
+      resource.lastPass = p;
+      access.nextPass = kInvalidHandle;
+      if (lastAccesses[access.resource])
+      {
+        lastAccesses[access.resource]->nextPass = p;
+        lastAccesses[access.resource]->nextState = access.state;
+      }
+      lastAccesses[access.resource] = &access;
+    }
+  }
+
+  PlaceTransientResources();
+
+  m_statistics.passCount = static_cast<uint32_t>(m_passes.size());
+  m_statistics.culledPassCount = static_cast<uint32_t>(
+      std::count_if(m_passes.begin(), m_passes.end(), [](const Pass& pass) { return pass.culled; }));
+  m_compiled = true;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Each resource is placed at the lowest offset where it does not overlap the resources already
+// placed and alive at the same time. Those offsets are either 0 or the end of one of these
+// resources
+void RenderGraph::PlaceTransientResources()
+{
+  std::vector<uint32_t> order;
+  m_statistics.transientResourceCount = 0;
+  m_statistics.culledResourceCount = 0;
+  m_statistics.transientSize = 0;
+  m_statistics.heapSize = 0;
+  for (uint32_t r = 0; r < m_resources.size(); r++)
+  {
+    if (m_resources[r].imported)
+    {
+      continue;
+    }
+    if (!m_resources[r].used)
+    {
+      m_statistics.culledResourceCount++;
+      continue;
+    }
+    order.push_back(r);
+    m_statistics.transientResourceCount++;
+    m_statistics.transientSize += m_resources[r].size;
+  }
+  std::stable_sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b) {
+    return m_resources[a].size > m_resources[b].size;
+  });
+
+  std::vector<uint32_t> placed;
+  for (uint32_t r : order)
+  {
+    Resource& resource = m_resources[r];
+    std::vector<uint32_t> alive;
+    std::vector<uint64_t> candidates = {0};
+    for (uint32_t other : placed)
+    {
+      const Resource& o = m_resources[other];
+      if (o.firstPass <= resource.lastPass && resource.firstPass <= o.lastPass)
+      {
+        alive.push_back(other);
+        candidates.push_back(ROUND_UP(o.heapOffset + o.size, resource.alignment));
+      }
+    }
+    std::sort(candidates.begin(), candidates.end());
+    for (uint64_t offset : candidates)
+    {
+      const bool fits = std::none_of(alive.begin(), alive.end(), [&](uint32_t other) {
+        const Resource& o = m_resources[other];
+        return offset < o.heapOffset + o.size && o.heapOffset < offset + resource.size;
+      });
+      if (fits)
+      {
+        resource.heapOffset = offset;
+        break;
+      }
+    }
+    m_statistics.heapSize = std::max(m_statistics.heapSize, resource.heapOffset + resource.size);
+    placed.push_back(r);
+  }
+
+  // Resources sharing memory can only be the ones with disjoint lifetimes
+  for (size_t i = 0; i < placed.size(); i++)
+  {
+    for (size_t j = i + 1; j < placed.size(); j++)
+    {
+      Resource& a = m_resources[placed[i]];
+      Resource& b = m_resources[placed[j]];
+      if (a.heapOffset < b.heapOffset + b.size && b.heapOffset < a.heapOffset + a.size)
+      {
+        a.aliased = true;
+        b.aliased = true;
+      }
+    }
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// The transitions to the first state of the resources which are not used by the first pass are
+// begun with it, and the transitions to the next state of a resource are begun after its use,
+// unless the next use is by the next pass. The first use of an aliased resource is preceded by an
+// aliasing barrier instead, its previous content being lost
+void RenderGraph::Execute(ResourceStateTracker* tracker,
+                          const std::function<void()>& flushBarriers) const
+{
+  if (!m_compiled)
+  {
+    throw std::logic_error("Executing a render graph which is not compiled");
+  }
+  std::vector<uint32_t> keptPasses;
+  for (uint32_t p = 0; p < m_passes.size(); p++)
+  {
+    if (!m_passes[p].culled)
+    {
+      keptPasses.push_back(p);
+    }
+  }
+  if (keptPasses.empty())
+  {
+    return;
+  }
+
+  for (const Resource& resource : m_resources)
+  {
+    if (resource.used && resource.firstPass != keptPasses.front() && !resource.aliased)
+    {
+      tracker->BeginTransition(resource.pointer, resource.firstState);
+    }
+  }
+
+  for (size_t k = 0; k < keptPasses.size(); k++)
+  {
+    const uint32_t p = keptPasses[k];
+    const Pass& pass = m_passes[p];
+    for (const Access& access : pass.accesses)
+    {
+      const Resource& resource = m_resources[access.resource];
+      if (resource.aliased && resource.firstPass == p)
+      {
+        tracker->AliasingBarrier(nullptr, resource.pointer);
+      }
+      tracker->Transition(resource.pointer, access.state);
+    }
+    flushBarriers();
+    if (pass.execute)
+    {
+      pass.execute();
+    }
+
+    const uint32_t nextPass = k + 1 < keptPasses.size() ? keptPasses[k + 1] : kInvalidHandle;
+    for (const Access& access : pass.accesses)
+    {
+      if (access.nextPass != kInvalidHandle && access.nextPass != nextPass &&
+          access.nextState != access.state)
+      {
+        tracker->BeginTransition(m_resources[access.resource].pointer, access.nextState);
+      }
+    }
+  }
+}
+
+} // namespace nv_helpers_dx12
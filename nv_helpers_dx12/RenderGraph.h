@@ -0,0 +1,175 @@
+/*
+
+The render graph describes a frame as a sequence of passes, each declaring the
+resources it reads and writes, and the state it uses them in. Compiling the
+graph then derives what the passes do not spell out:
+
+- culling: passes whose writes are never read by a kept pass are removed. The
+  passes writing imported resources, such as the back buffer, or flagged with
+  side effects, are always kept
+- lifetimes: each transient resource lives from the first to the last kept pass
+  using it, and is not allocated at all if no kept pass uses it
+- aliasing: transient resources whose lifetimes do not overlap share the same
+  range of a heap. The placement is a greedy first fit of the resources, from
+  the largest to the smallest, which is enough for the handful of transient
+  resources of a frame
+- barriers: the execution declares the state of each access to a
+  ResourceStateTracker, which batches the transitions of each pass. The graph
+  knowing the next uses of the resources, it begins split barriers as soon as
+  a resource is done with, and issues an aliasing barrier before the first use
+  of a resource sharing its range with others
+
+The graph only manipulates opaque resource pointers, sizes and the numerical
+values of the D3D12 states, and does not depend on D3D12: the application
+creates the transient resources at the heap offsets computed by the graph, and
+records the commands of each pass in its callback. Hence the culling, the
+aliasing and the barriers of a frame can be checked without a device. The
+passes are executed in declaration order, which must be a valid order.
+
+Example:
+
+nv_helpers_dx12::RenderGraph graph;
+uint32_t backBuffer = graph.ImportResource("back buffer", nullptr);
+uint32_t output = graph.CreateTransientResource("output", outputSize, 65536);
+uint32_t trace = graph.AddPass("raytracing", [&]() { commandList->DispatchRays(&desc); });
+graph.Write(trace, output, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+uint32_t copy = graph.AddPass("copy", [&]() { commandList->CopyResource(...); });
+graph.Read(copy, output, D3D12_RESOURCE_STATE_COPY_SOURCE);
+graph.Write(copy, backBuffer, D3D12_RESOURCE_STATE_COPY_DEST);
+graph.Compile();
+// Create the output at graph.GetHeapOffset(output) in a heap of graph.GetHeapSize() bytes
+graph.SetResource(output, outputResource);
+// Each frame
+graph.SetResource(backBuffer, renderTargets[frameIndex]);
+graph.Execute(&tracker, [&]() { FlushBarriers(); });
+
+*/
+
+#pragma once
+
+#include "ResourceStateTracker.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace nv_helpers_dx12
+{
+
+/// Results of the compilation of a RenderGraph
+struct RenderGraphStatistics
+{
+  uint32_t passCount = 0;
+  uint32_t culledPassCount = 0;
+  /// Transient resources used by the kept passes
+  uint32_t transientResourceCount = 0;
+  /// Transient resources only used by culled passes, hence not allocated
+  uint32_t culledResourceCount = 0;
+  /// Memory needed by the transient resources without aliasing
+  uint64_t transientSize = 0;
+  /// Memory needed by the transient resources with aliasing
+  uint64_t heapSize = 0;
+
+  uint64_t GetAliasingSavings() const { return transientSize - heapSize; }
+};
+
+/// Helper class ordering the passes of a frame, culling the unused ones and deriving the memory
+/// and barriers of their resources
+class RenderGraph
+{
+public:
+  static const uint32_t kInvalidHandle = ~0u;
+
+  /// Declare a resource owned by the application, living across frames. The pointer can be
+  /// changed at any time with SetResource, for example to the back buffer of the frame
+  uint32_t ImportResource(const std::string& name, void* resource);
+
+  /// Declare a resource only living within the frame, whose memory is placed by the graph. The
+  /// alignment must be a power of two
+  uint32_t CreateTransientResource(const std::string& name, uint64_t sizeInBytes,
+                                   uint64_t alignment);
+
+  /// Set the resource executed with, once created for transient resources
+  void SetResource(uint32_t resource, void* pointer);
+
+  /// Add a pass executed after the previous ones. Passes with side effects are never culled
+  uint32_t AddPass(const std::string& name, std::function<void()> execute,
+                   bool hasSideEffects = false);
+
+  /// Declare that a pass reads or writes a resource in a state. A pass can use each resource in a
+  /// single state
+  void Read(uint32_t pass, uint32_t resource, uint32_t state);
+  void Write(uint32_t pass, uint32_t resource, uint32_t state);
+
+  /// Cull the passes, compute the lifetimes and the placement of the transient resources
+  void Compile();
+
+  /// Execute the kept passes: declare the states of their accesses to the tracker, call
+  /// flushBarriers to issue the barriers of the pass, and execute the pass. Throws if the graph
+  /// is not compiled
+  void Execute(ResourceStateTracker* tracker, const std::function<void()>& flushBarriers) const;
+
+  bool IsPassCulled(uint32_t pass) const { return m_passes.at(pass).culled; }
+  /// True if a kept pass uses the resource
+  bool IsResourceUsed(uint32_t resource) const { return m_resources.at(resource).used; }
+  /// True if the range of a transient resource is shared with other resources
+  bool IsResourceAliased(uint32_t resource) const { return m_resources.at(resource).aliased; }
+  uint64_t GetHeapOffset(uint32_t resource) const { return m_resources.at(resource).heapOffset; }
+  /// State of the first use of a resource in the frame, to create transient resources in
+  uint32_t GetFirstState(uint32_t resource) const { return m_resources.at(resource).firstState; }
+  /// Size of the heap holding all the transient resources
+  uint64_t GetHeapSize() const { return m_statistics.heapSize; }
+
+  const std::string& GetPassName(uint32_t pass) const { return m_passes.at(pass).name; }
+  size_t GetPassCount() const { return m_passes.size(); }
+
+  const RenderGraphStatistics& GetStatistics() const { return m_statistics; }
+
+private:
+  struct Resource
+  {
+    std::string name;
+    void* pointer;
+    bool imported;
+    uint64_t size;
+    uint64_t alignment;
+    // Compilation results
+    bool used;
+    bool aliased;
+    uint32_t firstPass;
+    uint32_t lastPass;
+    uint32_t firstState;
+    uint64_t heapOffset;
+  };
+
+  struct Access
+  {
+    uint32_t resource;
+    uint32_t state;
+    bool write;
+    /// Next kept pass using the resource in the frame, and its state
+    uint32_t nextPass;
+    uint32_t nextState;
+  };
+
+  struct Pass
+  {
+    std::string name;
+    std::function<void()> execute;
+    bool hasSideEffects;
+    std::vector<Access> accesses;
+    bool culled;
+  };
+
+  void AddAccess(uint32_t pass, uint32_t resource, uint32_t state, bool write);
+  void PlaceTransientResources();
+
+  std::vector<Resource> m_resources;
+  std::vector<Pass> m_passes;
+  bool m_compiled = false;
+  RenderGraphStatistics m_statistics;
+};
+
+} // namespace nv_helpers_dx12
@@ -0,0 +1,182 @@
+/*
+
+Placement of buffers in heaps suballocated by TLSF allocators. See
+ResourceHeapAllocator.h for details.
+
+*/
+
+#include "ResourceHeapAllocator.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace nv_helpers_dx12
+{
+
+namespace
+{
+//--------------------------------------------------------------------------------------------------
+//
+// Description of a buffer, matching the one of nv_helpers_dx12::CreateBuffer
+D3D12_RESOURCE_DESC GetBufferDesc(uint64_t size, D3D12_RESOURCE_FLAGS flags)
+{
+  D3D12_RESOURCE_DESC bufDesc = {};
+  bufDesc.Alignment = 0;
+  bufDesc.DepthOrArraySize = 1;
+  bufDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+  bufDesc.Flags = flags;
+  bufDesc.Format = DXGI_FORMAT_UNKNOWN;
+  bufDesc.Height = 1;
+  bufDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+  bufDesc.MipLevels = 1;
+  bufDesc.SampleDesc.Count = 1;
+  bufDesc.SampleDesc.Quality = 0;
+  bufDesc.Width = size;
+  return bufDesc;
+}
+} // namespace
+
+//--------------------------------------------------------------------------------------------------
+//
+// The heaps are only created when a buffer is placed in their pool
+ResourceHeapAllocator::ResourceHeapAllocator(ID3D12Device* device, uint64_t heapSizeInBytes)
+    : m_device(device), m_heapSize(heapSizeInBytes)
+{
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+ResourceHeapAllocator::~ResourceHeapAllocator()
+{
+  for (auto& heaps : m_heaps)
+  {
+    for (Heap& heap : heaps)
+    {
+      heap.heap->Release();
+    }
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Acceleration structures are created in their own state, which they never leave
+ResourceHeapAllocator::Pool ResourceHeapAllocator::GetPool(D3D12_RESOURCE_STATES initState,
+                                                          const D3D12_HEAP_PROPERTIES& heapProps)
+{
+  if (heapProps.Type == D3D12_HEAP_TYPE_UPLOAD)
+  {
+    return Pool::Upload;
+  }
+  if (heapProps.Type != D3D12_HEAP_TYPE_DEFAULT)
+  {
+    throw std::logic_error("Buffers can only be placed in upload and default heaps");
+  }
+  return initState == D3D12_RESOURCE_STATE_RAYTRACING_ACCELERATION_STRUCTURE
+             ? Pool::AccelerationStructure
+             : Pool::Default;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// The buffer is placed in the first heap of its pool with a free range large enough, and a new
+// heap is added to the pool if none has one. The TLSF allocators return ranges in constant time,
+// hence the cost of a failed search only grows with the number of heaps, which stays low
+ID3D12Resource* ResourceHeapAllocator::CreateBuffer(uint64_t size, D3D12_RESOURCE_FLAGS flags,
+                                                    D3D12_RESOURCE_STATES initState,
+                                                    const D3D12_HEAP_PROPERTIES& heapProps)
+{
+  const Pool pool = GetPool(initState, heapProps);
+  const size_t poolIndex = static_cast<size_t>(pool);
+  const D3D12_RESOURCE_DESC bufDesc = GetBufferDesc(size, flags);
+  const D3D12_RESOURCE_ALLOCATION_INFO info = m_device->GetResourceAllocationInfo(0, 1, &bufDesc);
+
+  ID3D12Resource* pBuffer;
+  if (info.SizeInBytes > m_heapSize)
+  {
+    HRESULT hr = m_device->CreateCommittedResource(&heapProps, D3D12_HEAP_FLAG_NONE, &bufDesc,
+                                                   initState, nullptr, IID_PPV_ARGS(&pBuffer));
+    if (FAILED(hr))
+    {
+      throw std::logic_error("Could not create a committed buffer");
+    }
+    m_committedBufferCounts[poolIndex]++;
+    return pBuffer;
+  }
+
+  std::vector<Heap>& heaps = m_heaps[poolIndex];
+  Placement placement = {pool, 0, TlsfAllocation()};
+  for (; placement.heapIndex < heaps.size(); placement.heapIndex++)
+  {
+    placement.allocation = heaps[placement.heapIndex].allocator->Allocate(info.SizeInBytes, info.Alignment);
+    if (placement.allocation.IsValid())
+    {
+      break;
+    }
+  }
+  if (!placement.allocation.IsValid())
+  {
+    D3D12_HEAP_DESC heapDesc = {};
+    heapDesc.SizeInBytes = m_heapSize;
+    heapDesc.Properties = heapProps;
+    heapDesc.Alignment = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+    heapDesc.Flags = D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS;
+    Heap heap;
+    HRESULT hr = m_device->CreateHeap(&heapDesc, IID_PPV_ARGS(&heap.heap));
+    if (FAILED(hr))
+    {
+      throw std::logic_error("Could not create a resource heap");
+    }
+    heap.allocator.reset(new TlsfAllocator(m_heapSize, D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT));
+    heaps.push_back(std::move(heap));
+    placement.heapIndex = static_cast<uint32_t>(heaps.size() - 1);
+    placement.allocation = heaps.back().allocator->Allocate(info.SizeInBytes, info.Alignment);
+  }
+
+  HRESULT hr = m_device->CreatePlacedResource(heaps[placement.heapIndex].heap,
+                                              placement.allocation.offset, &bufDesc, initState,
+                                              nullptr, IID_PPV_ARGS(&pBuffer));
+  if (FAILED(hr))
+  {
+    heaps[placement.heapIndex].allocator->Free(placement.allocation);
+    throw std::logic_error("Could not create a placed buffer");
+  }
+  m_placements[pBuffer] = placement;
+  return pBuffer;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+void ResourceHeapAllocator::Free(ID3D12Resource* buffer)
+{
+  auto it = m_placements.find(buffer);
+  if (it == m_placements.end())
+  {
+    return;
+  }
+  const Placement& placement = it->second;
+  m_heaps[static_cast<size_t>(placement.pool)][placement.heapIndex].allocator->Free(placement.allocation);
+  m_placements.erase(it);
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+ResourceHeapStatistics ResourceHeapAllocator::GetStatistics(Pool pool) const
+{
+  ResourceHeapStatistics statistics;
+  for (const Heap& heap : m_heaps[static_cast<size_t>(pool)])
+  {
+    const TlsfStatistics heapStatistics = heap.allocator->GetStatistics();
+    statistics.heapCount++;
+    statistics.heapSize += heapStatistics.size;
+    statistics.usedSize += heapStatistics.usedSize;
+    statistics.largestFreeRange = std::max(statistics.largestFreeRange, heapStatistics.largestFreeRange);
+    statistics.placedBufferCount += heapStatistics.allocationCount;
+  }
+  statistics.committedBufferCount = m_committedBufferCounts[static_cast<size_t>(pool)];
+  return statistics;
+}
+
+} // namespace nv_helpers_dx12
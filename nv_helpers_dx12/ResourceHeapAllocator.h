@@ -0,0 +1,131 @@
+/*
+
+The resource heap allocator places the buffers in a few large heaps instead of
+creating each of them with CreateCommittedResource, which allocates a heap per
+buffer in the kernel. The ranges of each heap are managed by a TlsfAllocator,
+so that placing and freeing a buffer runs in constant time.
+
+The buffers are split into pools, each with its own heaps: upload buffers,
+default buffers, and acceleration structures, which are recognized by their
+initial state. Heaps are added to a pool as it fills up. Buffers larger than a
+heap are still created as committed resources, as well as all the buffers if
+the heap size is 0, to compare both strategies.
+
+The placement of a buffer is aligned on 64 KB, as required by D3D12, hence
+placing does not reduce the memory used by small buffers: the gain is in the
+number of memory allocations and in their cost. The allocator does not track
+the references to the buffers: the application calls Free once the GPU is done
+with a buffer, and releases its own references. The allocator must outlive the
+buffers it placed.
+
+Example:
+
+nv_helpers_dx12::ResourceHeapAllocator allocator(device, 64 * 1024 * 1024);
+ComPtr<ID3D12Resource> buffer = allocator.CreateBuffer(size, D3D12_RESOURCE_FLAG_NONE,
+  D3D12_RESOURCE_STATE_GENERIC_READ, nv_helpers_dx12::kUploadHeapProps);
+// Once the GPU is done with the buffer
+allocator.Free(buffer.Get());
+buffer.Reset();
+
+*/
+
+#pragma once
+
+#include "d3d12.h"
+
+#include "TlsfAllocator.h"
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace nv_helpers_dx12
+{
+
+/// Occupancy of a pool of ResourceHeapAllocator
+struct ResourceHeapStatistics
+{
+  uint32_t heapCount = 0;
+  /// Total size of the heaps of the pool
+  uint64_t heapSize = 0;
+  /// Bytes of the heaps used by placed buffers, placement alignment included
+  uint64_t usedSize = 0;
+  /// Largest free range over the heaps of the pool
+  uint64_t largestFreeRange = 0;
+  uint32_t placedBufferCount = 0;
+  /// Buffers created as committed resources, as they did not fit in a heap
+  uint32_t committedBufferCount = 0;
+
+  /// Share of the free memory of the heaps which cannot serve an allocation as large as the free
+  /// memory
+  float GetFragmentation() const
+  {
+    const uint64_t freeSize = heapSize - usedSize;
+    return freeSize > 0 ? 1.f - largestFreeRange / static_cast<float>(freeSize) : 0.f;
+  }
+};
+
+/// Helper class placing buffers in heaps suballocated by TLSF allocators
+class ResourceHeapAllocator
+{
+public:
+  enum class Pool
+  {
+    Upload,
+    Default,
+    AccelerationStructure,
+    Count
+  };
+
+  /// Default size of the heaps, large enough to hold the buffers of typical scenes in a few heaps
+  static const uint64_t kDefaultHeapSize = 64 * 1024 * 1024;
+
+  /// With a heap size of 0, all the buffers are created as committed resources
+  ResourceHeapAllocator(ID3D12Device* device, uint64_t heapSizeInBytes = kDefaultHeapSize);
+  ~ResourceHeapAllocator();
+
+  ResourceHeapAllocator(const ResourceHeapAllocator&) = delete;
+  ResourceHeapAllocator& operator=(const ResourceHeapAllocator&) = delete;
+
+  /// Create a buffer, as nv_helpers_dx12::CreateBuffer does, placed in a heap of the pool
+  /// matching the heap type and initial state
+  ID3D12Resource* CreateBuffer(uint64_t size, D3D12_RESOURCE_FLAGS flags,
+                               D3D12_RESOURCE_STATES initState,
+                               const D3D12_HEAP_PROPERTIES& heapProps);
+
+  /// Release the heap range of a buffer returned by CreateBuffer, so that it can be reused by
+  /// the next buffers. The GPU must be done with the buffer, and the buffer must not be used
+  /// afterwards. Committed buffers are ignored, as their memory is released with them
+  void Free(ID3D12Resource* buffer);
+
+  uint64_t GetHeapSize() const { return m_heapSize; }
+
+  ResourceHeapStatistics GetStatistics(Pool pool) const;
+
+private:
+  /// Heap of a pool, along with the allocator of its ranges
+  struct Heap
+  {
+    ID3D12Heap* heap;
+    std::unique_ptr<TlsfAllocator> allocator;
+  };
+
+  /// Location of a placed buffer, to free its range
+  struct Placement
+  {
+    Pool pool;
+    uint32_t heapIndex;
+    TlsfAllocation allocation;
+  };
+
+  static Pool GetPool(D3D12_RESOURCE_STATES initState, const D3D12_HEAP_PROPERTIES& heapProps);
+
+  ID3D12Device* m_device;
+  uint64_t m_heapSize;
+
+  std::vector<Heap> m_heaps[static_cast<size_t>(Pool::Count)];
+  uint32_t m_committedBufferCounts[static_cast<size_t>(Pool::Count)] = {};
+  std::unordered_map<ID3D12Resource*, Placement> m_placements;
+};
+
+} // namespace nv_helpers_dx12
@@ -0,0 +1,306 @@
+/*
+
+Derivation of the barriers from the states the resources are used in. See
+ResourceStateTracker.h for details.
+
+*/
+
+#include "ResourceStateTracker.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace nv_helpers_dx12
+{
+
+//--------------------------------------------------------------------------------------------------
+//
+// Registering a resource again resets its state, for example when the resource is recreated at
+// the same address
+void ResourceStateTracker::Register(void* resource, uint32_t state, uint32_t subresourceCount)
+{
+  if (subresourceCount == 0)
+  {
+    throw std::logic_error("A tracked resource needs at least one subresource");
+  }
+  m_resources[resource] = {subresourceCount, {state}, {kNoSplit}};
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+void ResourceStateTracker::Unregister(void* resource)
+{
+  m_resources.erase(resource);
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+ResourceStateTracker::TrackedResource& ResourceStateTracker::Find(void* resource)
+{
+  auto it = m_resources.find(resource);
+  if (it == m_resources.end())
+  {
+    throw std::logic_error("Using a resource whose state is not tracked");
+  }
+  return it->second;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Give each subresource its own entry, before one of them changes state on its own
+void ResourceStateTracker::Expand(TrackedResource& tracked)
+{
+  if (tracked.states.size() == 1 && tracked.subresourceCount > 1)
+  {
+    tracked.states.assign(tracked.subresourceCount, tracked.states[0]);
+    tracked.splitStates.assign(tracked.subresourceCount, tracked.splitStates[0]);
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Merge the entries back into a single one once all the subresources share their state
+void ResourceStateTracker::Collapse(TrackedResource& tracked)
+{
+  if (tracked.states.size() == 1)
+  {
+    return;
+  }
+  for (size_t i = 1; i < tracked.states.size(); i++)
+  {
+    if (tracked.states[i] != tracked.states[0] || tracked.splitStates[i] != tracked.splitStates[0])
+    {
+      return;
+    }
+  }
+  tracked.states.resize(1);
+  tracked.splitStates.resize(1);
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// A split barrier begun in the current batch has nothing to overlap with, and becomes a plain
+// transition
+void ResourceStateTracker::EndSplit(void* resource, TrackedResource& tracked, size_t entry,
+                                    uint32_t subresource)
+{
+  auto begin = std::find_if(m_pendingBarriers.begin(), m_pendingBarriers.end(),
+                            [&](const ResourceBarrierDesc& barrier) {
+                              return barrier.resource == resource &&
+                                     barrier.subresource == subresource &&
+                                     barrier.split == ResourceBarrierDesc::Split::BeginOnly;
+                            });
+  if (begin != m_pendingBarriers.end())
+  {
+    begin->split = ResourceBarrierDesc::Split::None;
+    m_statistics.splitBarrierCount--;
+    tracked.states[entry] = tracked.splitStates[entry];
+    tracked.splitStates[entry] = kNoSplit;
+    return;
+  }
+
+  ResourceBarrierDesc barrier;
+  barrier.split = ResourceBarrierDesc::Split::EndOnly;
+  barrier.resource = resource;
+  barrier.subresource = subresource;
+  barrier.stateBefore = tracked.states[entry];
+  barrier.stateAfter = tracked.splitStates[entry];
+  m_pendingBarriers.push_back(barrier);
+  m_statistics.emittedBarrierCount++;
+  tracked.states[entry] = tracked.splitStates[entry];
+  tracked.splitStates[entry] = kNoSplit;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Within a batch, no command uses the resource between its transitions. Hence the last barrier
+// of the batch referencing the resource, if it is a plain transition of the same subresource, can
+// be redirected to the new state, or removed if it comes back to its initial state
+void ResourceStateTracker::TransitionEntry(void* resource, TrackedResource& tracked, size_t entry,
+                                           uint32_t subresource, uint32_t state)
+{
+  m_statistics.requestedTransitionCount++;
+  if (tracked.splitStates[entry] != kNoSplit)
+  {
+    EndSplit(resource, tracked, entry, subresource);
+  }
+  if (tracked.states[entry] == state)
+  {
+    m_statistics.droppedTransitionCount++;
+    return;
+  }
+
+  auto last = std::find_if(m_pendingBarriers.rbegin(), m_pendingBarriers.rend(),
+                           [resource](const ResourceBarrierDesc& barrier) {
+                             return barrier.resource == resource;
+                           });
+  if (last != m_pendingBarriers.rend() && last->type == ResourceBarrierDesc::Type::Transition &&
+      last->split == ResourceBarrierDesc::Split::None && last->subresource == subresource)
+  {
+    tracked.states[entry] = state;
+    if (last->stateBefore == state)
+    {
+      m_pendingBarriers.erase(std::next(last).base());
+      m_statistics.emittedBarrierCount--;
+      m_statistics.droppedTransitionCount += 2;
+    }
+    else
+    {
+      last->stateAfter = state;
+      m_statistics.mergedTransitionCount++;
+    }
+    return;
+  }
+
+  ResourceBarrierDesc barrier;
+  barrier.resource = resource;
+  barrier.subresource = subresource;
+  barrier.stateBefore = tracked.states[entry];
+  barrier.stateAfter = state;
+  m_pendingBarriers.push_back(barrier);
+  m_statistics.emittedBarrierCount++;
+  tracked.states[entry] = state;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// A transition of all the subresources is a single barrier while they share their state, and
+// one barrier per subresource otherwise
+void ResourceStateTracker::Transition(void* resource, uint32_t state, uint32_t subresource)
+{
+  TrackedResource& tracked = Find(resource);
+  if (subresource == kAllSubresources)
+  {
+    if (tracked.states.size() == 1)
+    {
+      TransitionEntry(resource, tracked, 0, kAllSubresources, state);
+      return;
+    }
+    for (uint32_t i = 0; i < tracked.subresourceCount; i++)
+    {
+      TransitionEntry(resource, tracked, i, i, state);
+    }
+    Collapse(tracked);
+    return;
+  }
+
+  if (subresource >= tracked.subresourceCount)
+  {
+    throw std::logic_error("Transition of a subresource out of range");
+  }
+  Expand(tracked);
+  TransitionEntry(resource, tracked, tracked.states.size() == 1 ? 0 : subresource,
+                  tracked.subresourceCount == 1 ? kAllSubresources : subresource, state);
+  Collapse(tracked);
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// A split barrier already begun for the resource is ended first, as D3D12 does not allow two
+// pending transitions of the same subresource
+void ResourceStateTracker::BeginTransition(void* resource, uint32_t state, uint32_t subresource)
+{
+  TrackedResource& tracked = Find(resource);
+  if (subresource != kAllSubresources)
+  {
+    if (subresource >= tracked.subresourceCount)
+    {
+      throw std::logic_error("Transition of a subresource out of range");
+    }
+    Expand(tracked);
+  }
+  const size_t firstEntry = subresource == kAllSubresources || tracked.states.size() == 1 ? 0 : subresource;
+  const size_t lastEntry = subresource == kAllSubresources ? tracked.states.size() : firstEntry + 1;
+  for (size_t entry = firstEntry; entry < lastEntry; entry++)
+  {
+    const uint32_t barrierSubresource = tracked.states.size() == 1 ? kAllSubresources
+                                                                   : static_cast<uint32_t>(entry);
+    m_statistics.requestedTransitionCount++;
+    if (tracked.splitStates[entry] != kNoSplit)
+    {
+      EndSplit(resource, tracked, entry, barrierSubresource);
+    }
+    if (tracked.states[entry] == state)
+    {
+      m_statistics.droppedTransitionCount++;
+      continue;
+    }
+    ResourceBarrierDesc barrier;
+    barrier.split = ResourceBarrierDesc::Split::BeginOnly;
+    barrier.resource = resource;
+    barrier.subresource = barrierSubresource;
+    barrier.stateBefore = tracked.states[entry];
+    barrier.stateAfter = state;
+    m_pendingBarriers.push_back(barrier);
+    m_statistics.emittedBarrierCount++;
+    m_statistics.splitBarrierCount++;
+    tracked.splitStates[entry] = state;
+  }
+  Collapse(tracked);
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+void ResourceStateTracker::UAVBarrier(void* resource)
+{
+  ResourceBarrierDesc barrier;
+  barrier.type = ResourceBarrierDesc::Type::UAV;
+  barrier.resource = resource;
+  m_pendingBarriers.push_back(barrier);
+  m_statistics.emittedBarrierCount++;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+void ResourceStateTracker::AliasingBarrier(void* resourceBefore, void* resourceAfter)
+{
+  ResourceBarrierDesc barrier;
+  barrier.type = ResourceBarrierDesc::Type::Aliasing;
+  barrier.resourceBefore = resourceBefore;
+  barrier.resource = resourceAfter;
+  m_pendingBarriers.push_back(barrier);
+  m_statistics.emittedBarrierCount++;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+size_t ResourceStateTracker::Flush(std::vector<ResourceBarrierDesc>* barriers)
+{
+  const size_t count = m_pendingBarriers.size();
+  if (count > 0)
+  {
+    barriers->insert(barriers->end(), m_pendingBarriers.begin(), m_pendingBarriers.end());
+    m_pendingBarriers.clear();
+    m_statistics.batchCount++;
+  }
+  return count;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+uint32_t ResourceStateTracker::GetState(void* resource, uint32_t subresource) const
+{
+  auto it = m_resources.find(resource);
+  if (it == m_resources.end())
+  {
+    throw std::logic_error("Querying a resource whose state is not tracked");
+  }
+  const TrackedResource& tracked = it->second;
+  if (tracked.states.size() == 1)
+  {
+    return tracked.states[0];
+  }
+  if (subresource == kAllSubresources)
+  {
+    throw std::logic_error("The subresources of the resource are in different states");
+  }
+  return tracked.states.at(subresource);
+}
+
+} // namespace nv_helpers_dx12
@@ -0,0 +1,158 @@
+/*
+
+The resource state tracker records the current state of each resource, and of
+each of its subresources, so that the command recording only declares the state
+a resource is used in. The tracker computes the transitions from the recorded
+states, and accumulates them into a batch issued with a single ResourceBarrier
+call once the commands using them are about to be recorded:
+
+- transitions to the current state are dropped
+- successive transitions of the same resource within a batch are merged, and
+  dropped if they return to the state the batch started with, as no command
+  was recorded in between
+- BeginTransition starts a split barrier, letting the GPU overlap the transition
+  with the commands recorded until the resource is used in its new state, where
+  the tracker ends it
+
+The tracker only manipulates opaque resource pointers and the numerical values
+of the D3D12 states, and does not depend on D3D12: the application converts the
+flushed barriers into D3D12_RESOURCE_BARRIER. Hence the barriers emitted for a
+sequence of uses can be checked without a device. The implicit state promotion
+and decay of D3D12 are not modeled: resources are always transitioned
+explicitly.
+
+Example:
+
+nv_helpers_dx12::ResourceStateTracker tracker;
+tracker.Register(outputResource, D3D12_RESOURCE_STATE_COPY_SOURCE);
+tracker.Transition(outputResource, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+tracker.Transition(renderTarget, D3D12_RESOURCE_STATE_RENDER_TARGET);
+std::vector<nv_helpers_dx12::ResourceBarrierDesc> barriers;
+tracker.Flush(&barriers);
+// Convert barriers and call commandList->ResourceBarrier once, then record the commands
+
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace nv_helpers_dx12
+{
+
+/// Barrier flushed by the tracker, with the values of the matching D3D12 fields
+struct ResourceBarrierDesc
+{
+  enum class Type
+  {
+    Transition,
+    UAV,
+    Aliasing
+  };
+  /// Transition barriers may be the beginning or the end of a split barrier
+  enum class Split
+  {
+    None,
+    BeginOnly,
+    EndOnly
+  };
+
+  Type type = Type::Transition;
+  Split split = Split::None;
+  void* resource = nullptr;
+  /// Resource whose memory the resource now uses, for aliasing barriers
+  void* resourceBefore = nullptr;
+  uint32_t subresource = 0;
+  uint32_t stateBefore = 0;
+  uint32_t stateAfter = 0;
+};
+
+/// Counts of the transitions requested and of the barriers actually emitted
+struct ResourceStateStatistics
+{
+  uint64_t requestedTransitionCount = 0;
+  /// Requests for the current state, or undone within their batch
+  uint64_t droppedTransitionCount = 0;
+  /// Requests merged with a previous transition of their batch
+  uint64_t mergedTransitionCount = 0;
+  uint64_t emittedBarrierCount = 0;
+  uint64_t splitBarrierCount = 0;
+  /// Non-empty batches, ie. ResourceBarrier calls
+  uint64_t batchCount = 0;
+
+  float GetBarriersPerBatch() const
+  {
+    return batchCount > 0 ? emittedBarrierCount / static_cast<float>(batchCount) : 0.f;
+  }
+};
+
+/// Helper class deriving the barriers of a command stream from the states resources are used in
+class ResourceStateTracker
+{
+public:
+  /// Value of D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES
+  static const uint32_t kAllSubresources = 0xffffffff;
+
+  /// Start tracking a resource, in the given state for all its subresources
+  void Register(void* resource, uint32_t state, uint32_t subresourceCount = 1);
+
+  /// Stop tracking a resource, for example before releasing it
+  void Unregister(void* resource);
+
+  /// Declare the use of a resource, or of one of its subresources, in a state. Ends the split
+  /// barrier begun for the resource, if any. Throws if the resource is not registered
+  void Transition(void* resource, uint32_t state, uint32_t subresource = kAllSubresources);
+
+  /// Begin a split transition to a state the resource will be used in later on. The transition
+  /// is ended by the next Transition call for the resource
+  void BeginTransition(void* resource, uint32_t state, uint32_t subresource = kAllSubresources);
+
+  /// Order the accesses to a resource in the unordered access state
+  void UAVBarrier(void* resource);
+
+  /// Order the accesses to resources sharing memory, before using the resource after. Any of the
+  /// resources may be null, meaning any resource placed in the same memory
+  void AliasingBarrier(void* resourceBefore, void* resourceAfter);
+
+  /// Move the barriers of the current batch to the end of barriers, and return their number.
+  /// The batch must be flushed before recording the commands using the resources it transitions
+  size_t Flush(std::vector<ResourceBarrierDesc>* barriers);
+
+  /// State of a subresource, or the state of all the subresources if they share it. Throws if the
+  /// subresources are in different states
+  uint32_t GetState(void* resource, uint32_t subresource = kAllSubresources) const;
+
+  size_t GetPendingBarrierCount() const { return m_pendingBarriers.size(); }
+
+  const ResourceStateStatistics& GetStatistics() const { return m_statistics; }
+
+  void ResetStatistics() { m_statistics = ResourceStateStatistics(); }
+
+private:
+  static const uint32_t kNoSplit = 0xffffffff;
+
+  /// States of a resource, a single one while all its subresources share it
+  struct TrackedResource
+  {
+    uint32_t subresourceCount;
+    std::vector<uint32_t> states;
+    /// Target state of the split barrier begun for each entry of states, if any
+    std::vector<uint32_t> splitStates;
+  };
+
+  TrackedResource& Find(void* resource);
+  void TransitionEntry(void* resource, TrackedResource& tracked, size_t entry, uint32_t subresource,
+                       uint32_t state);
+  void EndSplit(void* resource, TrackedResource& tracked, size_t entry, uint32_t subresource);
+  static void Expand(TrackedResource& tracked);
+  static void Collapse(TrackedResource& tracked);
+
+  std::unordered_map<void*, TrackedResource> m_resources;
+  std::vector<ResourceBarrierDesc> m_pendingBarriers;
+  ResourceStateStatistics m_statistics;
+};
+
+} // namespace nv_helpers_dx12
@@ -36,11 +36,20 @@ pointers will be bound.
 */
 
 #include "RootSignatureGenerator.h"
+#include "PipelineCache.h"
 #include <stdexcept>
 
 namespace nv_helpers_dx12
 {
 
+namespace
+{
+// Private data of the root signatures holding their content key
+const GUID kRootSignatureKeyGuid = {
+    0x6a1c3d52, 0x8f4e, 0x4b7a, {0x9c, 0x21, 0x3e, 0x5d, 0x70, 0x14, 0xa8, 0xcb}};
+const UINT kRootSignatureKeyLength = 32;
+} // namespace
+
 //--------------------------------------------------------------------------------------------------
 //
 // Add a set of heap range descriptors as a parameter of the root signature.
@@ -190,7 +199,34 @@ ID3D12RootSignature* RootSignatureGenerator::Generate(ID3D12Device* device, bool
   {
     throw std::logic_error("Cannot create root signature");
   }
+  SetKey(pRootSig, pSigBlob->GetBufferPointer(), pSigBlob->GetBufferSize());
   return pRootSig;
 }
 
+//--------------------------------------------------------------------------------------------------
+//
+// Attach the content key of the serialized form of a root signature to it
+void RootSignatureGenerator::SetKey(ID3D12RootSignature* rootSignature, const void* serialized,
+                                    size_t size)
+{
+  const std::string key = PipelineDescription::ComputeContentKey(serialized, size);
+  rootSignature->SetPrivateData(kRootSignatureKeyGuid, kRootSignatureKeyLength, key.data());
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Content key attached to a root signature, or an empty string if none was attached
+std::string RootSignatureGenerator::GetKey(ID3D12RootSignature* rootSignature)
+{
+  char key[kRootSignatureKeyLength];
+  UINT size = kRootSignatureKeyLength;
+  if (rootSignature == nullptr ||
+      FAILED(rootSignature->GetPrivateData(kRootSignatureKeyGuid, &size, key)) ||
+      size != kRootSignatureKeyLength)
+  {
+    return std::string();
+  }
+  return std::string(key, size);
+}
+
 } // namespace nv_helpers_dx12
@@ -54,6 +54,7 @@ return rsc.Generate(m_device.Get(), true);
 
 #include "d3d12.h"
 
+#include <string>
 #include <tuple>
 #include <vector>
 
@@ -105,6 +106,14 @@ namespace nv_helpers_dx12
 		/// Create the root signature from the set of parameters, in the order of the addition calls
 		ID3D12RootSignature* Generate(ID3D12Device* device, bool isLocal);
 
+		/// Attach the content key of the serialized form of a root signature to it, so that the
+		/// pipelines using it can be described in a PipelineCache. Generate attaches the key of the
+		/// root signatures it creates
+		static void SetKey(ID3D12RootSignature* rootSignature, const void* serialized, size_t size);
+
+		/// Content key attached to a root signature, or an empty string if none was attached
+		static std::string GetKey(ID3D12RootSignature* rootSignature);
+
 	private:
 		/// Heap range descriptors
 		std::vector<std::vector<D3D12_DESCRIPTOR_RANGE>> m_ranges;
@@ -0,0 +1,272 @@
+/*
+
+The scene generator creates reproducible synthetic scenes for performance
+measurements. See SceneGenerator.h for details.
+
+*/
+
+#include "SceneGenerator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+
+namespace nv_helpers_dx12
+{
+
+namespace
+{
+const float kPi = 3.14159265358979f;
+
+//--------------------------------------------------------------------------------------------------
+//
+// Small SplitMix64 generator. Unlike the standard distributions, its output is fully specified,
+// hence identical across compilers
+class Random
+{
+public:
+  explicit Random(uint64_t seed) : m_state(seed) {}
+
+  uint64_t NextInteger()
+  {
+    uint64_t z = (m_state += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+  }
+
+  /// Uniform in [0,1)
+  float Next() { return static_cast<float>(NextInteger() >> 40) / static_cast<float>(1 << 24); }
+
+  /// Uniform in [a,b)
+  float Next(float a, float b) { return a + (b - a) * Next(); }
+
+  /// Standard normal distribution, using the Box-Muller transform
+  float NextGaussian()
+  {
+    const float u = std::max(Next(), 1e-7f);
+    const float v = Next();
+    return std::sqrt(-2.f * std::log(u)) * std::cos(2.f * kPi * v);
+  }
+
+private:
+  uint64_t m_state;
+};
+
+//--------------------------------------------------------------------------------------------------
+//
+// Fill a transform with a uniform scale, a rotation around the vertical axis and a translation
+void SetTransform(SceneInstance& instance, float scale, float angle, const float translation[3])
+{
+  const float c = std::cos(angle) * scale;
+  const float s = std::sin(angle) * scale;
+  const float transform[3][4] = {{c, 0.f, s, translation[0]},
+                                 {0.f, scale, 0.f, translation[1]},
+                                 {-s, 0.f, c, translation[2]}};
+  std::copy(&transform[0][0], &transform[0][0] + 12, &instance.transform[0][0]);
+}
+} // namespace
+
+//--------------------------------------------------------------------------------------------------
+//
+// Generate a bumpy sphere with exactly triangleCount triangles
+Mesh GenerateMesh(uint32_t triangleCount, uint64_t seed)
+{
+  Random random(seed);
+  Mesh mesh;
+
+  // A latitude/longitude tessellation with rows bands of columns quads, the first and last bands
+  // being fans of columns triangles around the poles, provides 2 x (rows - 1) x columns triangles.
+  // The rows are chosen so that the quads are roughly square
+  const uint32_t rows =
+      1 + std::max(1u, static_cast<uint32_t>(std::lround(std::sqrt(triangleCount / 4.f))));
+  const uint32_t columns = std::max(3u, (triangleCount + 2 * (rows - 1) - 1) / (2 * (rows - 1)));
+
+  // Base color of the mesh, modulated by the latitude
+  const float baseColor[3] = {random.Next(0.2f, 1.f), random.Next(0.2f, 1.f), random.Next(0.2f, 1.f)};
+
+  // Radial displacement of the rings, shared by the first and last columns so that the sphere is
+  // closed. The poles are not displaced
+  std::vector<float> bumps((rows + 1) * columns);
+  for (uint32_t r = 1; r < rows; r++)
+  {
+    for (uint32_t c = 0; c < columns; c++)
+    {
+      bumps[r * columns + c] = random.Next(-0.1f, 0.1f);
+    }
+  }
+
+  // The poles are single vertices, surrounding the rings of columns + 1 vertices
+  mesh.vertices.reserve((rows - 1) * (columns + 1) + 2);
+  for (uint32_t r = 0; r <= rows; r++)
+  {
+    const float theta = kPi * static_cast<float>(r) / static_cast<float>(rows);
+    const float shade = 0.6f + 0.4f * std::cos(theta);
+    const bool pole = r == 0 || r == rows;
+    for (uint32_t c = 0; c <= (pole ? 0 : columns); c++)
+    {
+      const float phi = 2.f * kPi * static_cast<float>(c) / static_cast<float>(columns);
+      const float radius = 0.5f * (1.f + bumps[r * columns + (c % columns)]);
+      mesh.vertices.push_back({{radius * std::sin(theta) * std::cos(phi), radius * std::cos(theta),
+                                radius * std::sin(theta) * std::sin(phi)},
+                               {baseColor[0] * shade, baseColor[1] * shade, baseColor[2] * shade,
+                                1.f}});
+    }
+  }
+
+  // Index of the vertex of a ring, for 1 <= r < rows
+  const auto ringVertex = [columns](uint32_t r, uint32_t c) { return 1 + (r - 1) * (columns + 1) + c; };
+  const uint32_t southPole = static_cast<uint32_t>(mesh.vertices.size()) - 1;
+
+  mesh.indices.reserve(6 * static_cast<size_t>(rows) * columns);
+  for (uint32_t c = 0; c < columns; c++)
+  {
+    const uint32_t fan[3] = {0, ringVertex(1, c + 1), ringVertex(1, c)};
+    mesh.indices.insert(mesh.indices.end(), fan, fan + 3);
+  }
+  for (uint32_t r = 1; r + 1 < rows; r++)
+  {
+    for (uint32_t c = 0; c < columns; c++)
+    {
+      const uint32_t a = ringVertex(r, c);
+      const uint32_t b = a + 1;
+      const uint32_t d = ringVertex(r + 1, c);
+      const uint32_t e = d + 1;
+      const uint32_t quad[6] = {a, b, d, b, e, d};
+      mesh.indices.insert(mesh.indices.end(), quad, quad + 6);
+    }
+  }
+  for (uint32_t c = 0; c < columns; c++)
+  {
+    const uint32_t fan[3] = {ringVertex(rows - 1, c), ringVertex(rows - 1, c + 1), southPole};
+    mesh.indices.insert(mesh.indices.end(), fan, fan + 3);
+  }
+  mesh.indices.resize(3 * static_cast<size_t>(triangleCount));
+  return mesh;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Generate the scene described by desc
+Scene GenerateScene(const SceneDesc& desc)
+{
+  Scene scene;
+  Random random(desc.seed);
+
+  // Each mesh has its own seed derived from the scene seed, so that changing the instance
+  // count or the layout does not alter the meshes
+  const uint32_t meshCount = std::max(1u, desc.meshCount);
+  scene.meshes.reserve(meshCount);
+  for (uint32_t m = 0; m < meshCount; m++)
+  {
+    scene.meshes.push_back(GenerateMesh(desc.trianglesPerMesh, desc.seed * 0x100000001b3ull + m));
+  }
+
+  // Spacing of the instances if they were evenly distributed in the extent. The instances are
+  // sized after it, and enlarged by the overlap factor
+  const uint32_t side = std::max(
+      1u, static_cast<uint32_t>(std::ceil(std::cbrt(static_cast<float>(desc.instanceCount)) - 1e-3f)));
+  const float spacing = desc.extent / static_cast<float>(side);
+  const float scale = 0.8f * spacing * (1.f + 3.f * std::max(0.f, desc.overlap));
+  const float halfExtent = 0.5f * desc.extent;
+
+  std::vector<float> clusterCenters;
+  if (desc.layout == SceneLayout::Clustered)
+  {
+    for (uint32_t c = 0; c < std::max(1u, desc.clusterCount) * 3; c++)
+    {
+      clusterCenters.push_back(random.Next(-halfExtent, halfExtent));
+    }
+  }
+
+  scene.instances.resize(desc.instanceCount);
+  for (uint32_t i = 0; i < desc.instanceCount; i++)
+  {
+    // Initialized for the compilers which do not see that the switch covers all the layouts
+    float translation[3] = {};
+    switch (desc.layout)
+    {
+    case SceneLayout::Grid:
+    {
+      const uint32_t cell[3] = {i % side, (i / side) % side, i / (side * side)};
+      for (int k = 0; k < 3; k++)
+      {
+        translation[k] = -halfExtent + (static_cast<float>(cell[k]) + 0.5f) * spacing;
+      }
+      break;
+    }
+    case SceneLayout::Random:
+      for (int k = 0; k < 3; k++)
+      {
+        translation[k] = random.Next(-halfExtent, halfExtent);
+      }
+      break;
+    case SceneLayout::Clustered:
+    {
+      const size_t cluster = i % (clusterCenters.size() / 3);
+      for (int k = 0; k < 3; k++)
+      {
+        translation[k] = clusterCenters[3 * cluster + k] + 0.05f * desc.extent * random.NextGaussian();
+      }
+      break;
+    }
+    }
+
+    SceneInstance& instance = scene.instances[i];
+    instance.meshIndex = i % meshCount;
+    SetTransform(instance, scale, random.Next(0.f, 2.f * kPi), translation);
+  }
+  return scene;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Parse a layout name
+bool ParseSceneLayout(const std::string& name, SceneLayout* layout)
+{
+  if (name == "grid")
+    *layout = SceneLayout::Grid;
+  else if (name == "random")
+    *layout = SceneLayout::Random;
+  else if (name == "clustered")
+    *layout = SceneLayout::Clustered;
+  else
+    return false;
+  return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Write the flattened scene into a Wavefront OBJ file
+bool SaveSceneAsOBJ(const Scene& scene, const std::string& fileName)
+{
+  std::ofstream file(fileName);
+  if (!file.good())
+  {
+    return false;
+  }
+
+  size_t firstVertex = 1;
+  for (const SceneInstance& instance : scene.instances)
+  {
+    const Mesh& mesh = scene.meshes[instance.meshIndex];
+    const float(*t)[4] = instance.transform;
+    for (const MeshVertex& v : mesh.vertices)
+    {
+      const float* p = v.position;
+      file << "v " << t[0][0] * p[0] + t[0][1] * p[1] + t[0][2] * p[2] + t[0][3] << ' '
+           << t[1][0] * p[0] + t[1][1] * p[1] + t[1][2] * p[2] + t[1][3] << ' '
+           << t[2][0] * p[0] + t[2][1] * p[1] + t[2][2] * p[2] + t[2][3] << ' ' << v.color[0]
+           << ' ' << v.color[1] << ' ' << v.color[2] << '\n';
+    }
+    for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+    {
+      file << "f " << firstVertex + mesh.indices[i] << ' ' << firstVertex + mesh.indices[i + 1]
+           << ' ' << firstVertex + mesh.indices[i + 2] << '\n';
+    }
+    firstVertex += mesh.vertices.size();
+  }
+  return file.good();
+}
+
+} // namespace nv_helpers_dx12
@@ -0,0 +1,77 @@
+/*
+
+The scene generator creates reproducible synthetic scenes for performance
+measurements. A scene is made of a number of distinct meshes, each with an exact
+triangle count, instantiated many times according to a layout:
+- Grid: instances on a regular 3D grid filling the scene extent
+- Random: instances uniformly distributed in the scene extent
+- Clustered: instances gathered around a few random cluster centers
+The overlap factor enlarges the instances relative to their spacing, from
+disjoint instances (0) to heavily overlapping ones (1), which stresses the
+top-level hierarchy.
+
+The whole generation only depends on the description, and in particular on its
+seed: it uses its own random number generator rather than the implementation-
+defined standard distributions, so that a given description produces the same
+scene on any platform.
+
+Example:
+
+nv_helpers_dx12::SceneDesc desc;
+desc.seed = 42;
+desc.instanceCount = 10000;
+desc.trianglesPerMesh = 5000;
+desc.layout = nv_helpers_dx12::SceneLayout::Clustered;
+nv_helpers_dx12::Scene scene = nv_helpers_dx12::GenerateScene(desc);
+
+*/
+
+#pragma once
+
+#include "Mesh.h"
+
+#include <string>
+
+namespace nv_helpers_dx12
+{
+
+/// Placement of the instances in a generated scene
+enum class SceneLayout
+{
+  Grid,
+  Random,
+  Clustered
+};
+
+/// Description of a generated scene
+struct SceneDesc
+{
+  uint64_t seed = 1;
+  uint32_t instanceCount = 64;
+  /// Number of distinct meshes, the instances using them in turn
+  uint32_t meshCount = 4;
+  uint32_t trianglesPerMesh = 1024;
+  SceneLayout layout = SceneLayout::Grid;
+  /// Number of clusters for the Clustered layout
+  uint32_t clusterCount = 8;
+  /// Size of the cube, centered on the origin, in which the instances are placed
+  float extent = 4.f;
+  /// 0 keeps the instances within their share of the extent, 1 makes them heavily overlap
+  float overlap = 0.f;
+};
+
+/// Generate the scene described by desc
+Scene GenerateScene(const SceneDesc& desc);
+
+/// Generate a bumpy sphere of unit diameter with exactly triangleCount triangles. When the count
+/// does not match a full tessellation, the last band of the sphere is left incomplete
+Mesh GenerateMesh(uint32_t triangleCount, uint64_t seed);
+
+/// Parse a layout name (grid, random or clustered). Returns false for an unknown name
+bool ParseSceneLayout(const std::string& name, SceneLayout* layout);
+
+/// Write the scene with all its instances flattened into a Wavefront OBJ file, with the vertex
+/// colors appended to the positions, so that it can be consumed by other renderers
+bool SaveSceneAsOBJ(const Scene& scene, const std::string& fileName);
+
+} // namespace nv_helpers_dx12
@@ -0,0 +1,347 @@
+/*
+
+On-disk cache of the compiled shaders. See ShaderCache.h for details.
+
+*/
+
+#include "ShaderCache.h"
+
+#include "GeometryDeduplicator.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/stat.h>
+#endif
+
+namespace nv_helpers_dx12
+{
+
+namespace
+{
+const char kEntryMagic[4] = {'N', 'V', 'S', 'C'};
+const size_t kKeyLength = 32;
+// Seeds of the two halves of the key
+const uint64_t kKeySeeds[2] = {0xcbf29ce484222325ull, 0x9e3779b97f4a7c15ull};
+
+// Header preceding the bytecode in an entry
+struct EntryHeader
+{
+  char magic[4];
+  uint32_t formatVersion;
+  char key[kKeyLength];
+  double compileSeconds;
+  uint64_t bytecodeSize;
+};
+
+double GetSecondsSince(const std::chrono::steady_clock::time_point& start)
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Directory of a path, with its trailing separator, or an empty string for a bare file name
+std::string GetDirectory(const std::string& path)
+{
+  const size_t separator = path.find_last_of("/\\");
+  return separator == std::string::npos ? std::string() : path.substr(0, separator + 1);
+}
+
+bool ReadFile(const std::string& fileName, std::string* contents)
+{
+  std::ifstream file(fileName, std::ios::binary);
+  if (!file.good())
+  {
+    return false;
+  }
+  std::stringstream stream;
+  stream << file.rdbuf();
+  *contents = stream.str();
+  return true;
+}
+
+// Name of the file included by a line, if the line is an #include directive
+bool ParseInclude(const std::string& line, std::string* includeName)
+{
+  size_t i = line.find_first_not_of(" \t");
+  if (i == std::string::npos || line[i] != '#')
+  {
+    return false;
+  }
+  i = line.find_first_not_of(" \t", i + 1);
+  if (i == std::string::npos || line.compare(i, 7, "include") != 0)
+  {
+    return false;
+  }
+  i = line.find_first_not_of(" \t", i + 7);
+  if (i == std::string::npos || (line[i] != '"' && line[i] != '<'))
+  {
+    return false;
+  }
+  const char closing = line[i] == '"' ? '"' : '>';
+  const size_t end = line.find(closing, i + 1);
+  if (end == std::string::npos)
+  {
+    return false;
+  }
+  *includeName = line.substr(i + 1, end - i - 1);
+  return true;
+}
+
+// Append the source of the file to the output, replacing the includes by their expanded source.
+// A file already expanded is replaced by a marker only, as with include guards
+void Expand(const std::string& fileName, const std::string& source, std::set<std::string>& expanded,
+            std::string& output)
+{
+  std::istringstream lines(source);
+  std::string line;
+  std::string includeName;
+  while (std::getline(lines, line))
+  {
+    if (!ParseInclude(line, &includeName))
+    {
+      output.append(line).push_back('\n');
+      continue;
+    }
+    // The file is looked for next to the including file, then in the working directory
+    std::string includePath = GetDirectory(fileName) + includeName;
+    std::string includeSource;
+    if (!ReadFile(includePath, &includeSource))
+    {
+      includePath = includeName;
+      if (!ReadFile(includePath, &includeSource))
+      {
+        // The compiler reports the missing file, the directive is kept in the key
+        output.append(line).push_back('\n');
+        continue;
+      }
+    }
+    output.append("#line 1 \"").append(includePath).append("\"\n");
+    if (expanded.insert(includePath).second)
+    {
+      Expand(includePath, includeSource, expanded, output);
+    }
+  }
+}
+} // namespace
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+ShaderCache::ShaderCache(Compiler* compiler, const std::string& directory)
+    : m_compiler(compiler), m_directory(directory)
+{
+  if (!m_directory.empty())
+  {
+    // Failing to create the directory is not an error: it may already exist, and otherwise the
+    // entries cannot be stored and the shaders are compiled
+#ifdef _WIN32
+    CreateDirectoryA(m_directory.c_str(), nullptr);
+#else
+    mkdir(m_directory.c_str(), 0755);
+#endif
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+std::vector<uint8_t> ShaderCache::Compile(const std::string& fileName,
+                                          const std::string& entryPoint, const std::string& target,
+                                          uint32_t flags)
+{
+  return Compile(m_compiler, fileName, entryPoint, target, flags);
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// The lookup and the compilation run without holding the lock, so that several threads can
+// compile at once. The lookup time of the misses is counted in the compilation time, so that the
+// saved time only accounts for what the hits avoided
+std::vector<uint8_t> ShaderCache::Compile(Compiler* compiler, const std::string& fileName,
+                                          const std::string& entryPoint, const std::string& target,
+                                          uint32_t flags)
+{
+  if (compiler == nullptr)
+  {
+    throw std::logic_error("The shader cache requires a compiler");
+  }
+  const auto start = std::chrono::steady_clock::now();
+  std::string key;
+  std::vector<uint8_t> bytecode;
+  if (IsEnabled())
+  {
+    key = ComputeKey(ExpandIncludes(fileName), entryPoint, target, flags, compiler->GetVersion());
+    double recordedSeconds = 0.;
+    if (Load(key, &bytecode, &recordedSeconds))
+    {
+      const double loadSeconds = GetSecondsSince(start);
+      std::lock_guard<std::mutex> lock(m_statisticsMutex);
+      m_statistics.hitCount++;
+      m_statistics.loadSeconds += loadSeconds;
+      m_statistics.savedSeconds += recordedSeconds - loadSeconds;
+      return bytecode;
+    }
+  }
+
+  const auto compileStart = std::chrono::steady_clock::now();
+  std::string errors;
+  if (!compiler->Compile(fileName, entryPoint, target, flags, &bytecode, &errors))
+  {
+    throw std::logic_error("Failed to compile " + fileName + ":\n" + errors);
+  }
+  const bool stored = !IsEnabled() || Store(key, bytecode, GetSecondsSince(compileStart));
+  std::lock_guard<std::mutex> lock(m_statisticsMutex);
+  m_statistics.missCount++;
+  m_statistics.compileSeconds += GetSecondsSince(start);
+  if (!stored)
+  {
+    m_statistics.storeFailureCount++;
+  }
+  return bytecode;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+ShaderCacheStatistics ShaderCache::GetStatistics() const
+{
+  std::lock_guard<std::mutex> lock(m_statisticsMutex);
+  return m_statistics;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+std::string ShaderCache::ExpandIncludes(const std::string& fileName)
+{
+  std::string source;
+  if (!ReadFile(fileName, &source))
+  {
+    throw std::logic_error("Cannot find shader file " + fileName);
+  }
+  std::set<std::string> expanded = {fileName};
+  std::string output;
+  Expand(fileName, source, expanded, output);
+  return output;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// The fields are separated by a null character, so that moving characters from one field to the
+// next changes the key
+std::string ShaderCache::ComputeKey(const std::string& expandedSource,
+                                    const std::string& entryPoint, const std::string& target,
+                                    uint32_t flags, const std::string& compilerVersion)
+{
+  std::string description;
+  description.append(compilerVersion).push_back('\0');
+  description.append(target).push_back('\0');
+  description.append(entryPoint).push_back('\0');
+  description.append(std::to_string(flags)).push_back('\0');
+  description.append(std::to_string(kFormatVersion)).push_back('\0');
+  description.append(expandedSource);
+
+  static const char kDigits[] = "0123456789abcdef";
+  std::string key;
+  for (uint64_t seed : kKeySeeds)
+  {
+    const uint64_t hash = GeometryDeduplicator::HashData(description.data(), description.size(), seed);
+    for (int shift = 60; shift >= 0; shift -= 4)
+    {
+      key.push_back(kDigits[(hash >> shift) & 0xf]);
+    }
+  }
+  return key;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+std::string ShaderCache::GetEntryPath(const std::string& key) const
+{
+  return m_directory + "/" + key + ".cso";
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// The header is checked against the key, so that a truncated or foreign file is not used
+bool ShaderCache::Load(const std::string& key, std::vector<uint8_t>* bytecode,
+                       double* compileSeconds) const
+{
+  std::ifstream file(GetEntryPath(key), std::ios::binary);
+  if (!file.good())
+  {
+    return false;
+  }
+  EntryHeader header;
+  if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+      memcmp(header.magic, kEntryMagic, sizeof(kEntryMagic)) != 0 ||
+      header.formatVersion != kFormatVersion || key.compare(0, kKeyLength, header.key, kKeyLength) != 0)
+  {
+    return false;
+  }
+  bytecode->resize(static_cast<size_t>(header.bytecodeSize));
+  if (!file.read(reinterpret_cast<char*>(bytecode->data()), bytecode->size()) ||
+      file.peek() != std::char_traits<char>::eof())
+  {
+    bytecode->clear();
+    return false;
+  }
+  *compileSeconds = header.compileSeconds;
+  return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+bool ShaderCache::Store(const std::string& key, const std::vector<uint8_t>& bytecode,
+                        double compileSeconds) const
+{
+  EntryHeader header;
+  memcpy(header.magic, kEntryMagic, sizeof(kEntryMagic));
+  header.formatVersion = kFormatVersion;
+  memcpy(header.key, key.data(), kKeyLength);
+  header.compileSeconds = compileSeconds;
+  header.bytecodeSize = bytecode.size();
+
+  // The temporary file is specific to the thread, in case several threads compile the same shader
+  const std::string path = GetEntryPath(key);
+  const std::string temporaryPath =
+      path + "." + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + ".tmp";
+  {
+    std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+    if (!file.write(reinterpret_cast<const char*>(&header), sizeof(header)) ||
+        !file.write(reinterpret_cast<const char*>(bytecode.data()), bytecode.size()))
+    {
+      file.close();
+      std::remove(temporaryPath.c_str());
+      return false;
+    }
+  }
+  // rename does not replace an existing file on Windows, such as an invalid entry. It also fails
+  // if another thread stored the same entry in the meantime, which is then valid
+  std::remove(path.c_str());
+  if (std::rename(temporaryPath.c_str(), path.c_str()) != 0)
+  {
+    std::remove(temporaryPath.c_str());
+    std::vector<uint8_t> storedBytecode;
+    double storedSeconds = 0.;
+    return Load(key, &storedBytecode, &storedSeconds);
+  }
+  return true;
+}
+
+} // namespace nv_helpers_dx12
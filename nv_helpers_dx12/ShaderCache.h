@@ -0,0 +1,135 @@
+/*
+
+The shader cache stores the bytecode of the compiled shaders on disk, so that
+the next launches load it instead of running the compiler. The entries are
+content-addressed: the key is a 128-bit hash of the source with its includes
+expanded, the entry point, the target profile, the compilation flags and the
+version of the compiler. Editing a shader or any file it includes, such as
+Common.hlsl, or updating the compiler, hence produces a new key, and the stale
+entries are simply never read again.
+
+The includes are expanded textually, following the quoted and angled #include
+directives recursively relative to the including file, each file being expanded
+once. The directives are not evaluated, so an include disabled by an #if still
+contributes to the key, which can only cause a spurious miss.
+
+The cache does not depend on D3D12 or DXC: the compiler is accessed through the
+Compiler interface, implemented by the application on top of DXC or
+D3DCompile. Each entry also records the time its compilation took, so that the
+cache can report the time saved by the hits. A stub compiler can validate the
+keys and the invalidation on any platform.
+
+The cache can be used by several threads at once, each passing its own
+compiler instance, as compilers such as DXC are not thread-safe (see
+ShaderCompileQueue.h).
+
+Example:
+
+nv_helpers_dx12::ShaderCache cache(&compiler, "ShaderCache");
+std::vector<uint8_t> rayGen = cache.Compile("RayGen.hlsl", "", "lib_6_3");
+std::vector<uint8_t> vertexShader = cache.Compile("shaders.hlsl", "VSMain", "vs_5_0", flags);
+// Time saved by the hits, compared to compiling every shader
+double saved = cache.GetStatistics().savedSeconds;
+
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace nv_helpers_dx12
+{
+
+/// Counts of the cache lookups, and time spent compiling and loading
+struct ShaderCacheStatistics
+{
+  uint32_t hitCount = 0;
+  uint32_t missCount = 0;
+  /// Entries which could not be written to disk
+  uint32_t storeFailureCount = 0;
+  /// Time spent by the compiler on the misses
+  double compileSeconds = 0.;
+  /// Time spent expanding the sources, hashing and reading the entries of the hits
+  double loadSeconds = 0.;
+  /// Compilation time recorded in the entries of the hits, minus the time spent loading them
+  double savedSeconds = 0.;
+
+  float GetHitRate() const
+  {
+    const uint32_t lookups = hitCount + missCount;
+    return lookups > 0 ? hitCount / static_cast<float>(lookups) : 0.f;
+  }
+};
+
+/// Helper class caching compiled shaders on disk, keyed by the hash of their expanded source and
+/// compilation parameters
+class ShaderCache
+{
+public:
+  /// Shader compiler, such as DXC or D3DCompile
+  class Compiler
+  {
+  public:
+    virtual ~Compiler() = default;
+    /// Identification of the compiler and its version, part of the key of the entries
+    virtual std::string GetVersion() = 0;
+    /// Compile the entry point of the file for the target profile, with compiler-specific flags.
+    /// The entry point is empty for libraries. Returns false and the messages of the compiler upon
+    /// failure
+    virtual bool Compile(const std::string& fileName, const std::string& entryPoint,
+                         const std::string& target, uint32_t flags, std::vector<uint8_t>* bytecode,
+                         std::string* errors) = 0;
+  };
+
+  /// Version of the format of the entries, changing it invalidates all of them
+  static const uint32_t kFormatVersion = 1;
+
+  /// The compiler must outlive the cache. It can be null if the compiler is given to each
+  /// compilation. The directory is created if needed, and an empty directory disables the cache,
+  /// every shader then being compiled
+  ShaderCache(Compiler* compiler, const std::string& directory);
+
+  /// Return the bytecode of the shader, loaded from the cache or compiled and stored into it.
+  /// Throws with the messages of the compiler if the compilation fails
+  std::vector<uint8_t> Compile(const std::string& fileName, const std::string& entryPoint,
+                               const std::string& target, uint32_t flags = 0);
+
+  /// Same as above with the given compiler, which is only used by the calling thread for the
+  /// duration of the call
+  std::vector<uint8_t> Compile(Compiler* compiler, const std::string& fileName,
+                               const std::string& entryPoint, const std::string& target,
+                               uint32_t flags = 0);
+
+  /// Source of the file with its includes expanded recursively. Throws if the file cannot be read
+  static std::string ExpandIncludes(const std::string& fileName);
+
+  /// Key of the shader as 32 hexadecimal digits, also used as the name of its entry
+  static std::string ComputeKey(const std::string& expandedSource, const std::string& entryPoint,
+                                const std::string& target, uint32_t flags,
+                                const std::string& compilerVersion);
+
+  /// Path of the entry of a key
+  std::string GetEntryPath(const std::string& key) const;
+
+  bool IsEnabled() const { return !m_directory.empty(); }
+
+  ShaderCacheStatistics GetStatistics() const;
+
+private:
+  /// Read the bytecode and the recorded compilation time of an entry. Returns false if the entry
+  /// is missing or invalid
+  bool Load(const std::string& key, std::vector<uint8_t>* bytecode, double* compileSeconds) const;
+  /// Write an entry through a temporary file, so that an interrupted write leaves no entry
+  bool Store(const std::string& key, const std::vector<uint8_t>& bytecode,
+             double compileSeconds) const;
+
+  Compiler* m_compiler;
+  std::string m_directory;
+  mutable std::mutex m_statisticsMutex;
+  ShaderCacheStatistics m_statistics;
+};
+
+} // namespace nv_helpers_dx12
@@ -0,0 +1,220 @@
+/*
+
+Compilation of shaders on worker threads. See ShaderCompileQueue.h for
+details.
+
+*/
+
+#include "ShaderCompileQueue.h"
+
+#include "ParallelFor.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+namespace nv_helpers_dx12
+{
+
+namespace
+{
+double GetSecondsSince(const std::chrono::steady_clock::time_point& start)
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+} // namespace
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+ShaderCompileQueue::ShaderCompileQueue(ShaderCache* cache, CompilerFactory createCompiler,
+                                       uint32_t workerCount)
+    : m_cache(cache), m_createCompiler(std::move(createCompiler))
+{
+  if (cache == nullptr || !m_createCompiler)
+  {
+    throw std::logic_error("The shader compile queue requires a cache and a compiler factory");
+  }
+  const uint32_t workers = nv_helpers_dx12::GetWorkerCount(workerCount);
+  for (uint32_t worker = 0; worker < workers; worker++)
+  {
+    m_threads.emplace_back(&ShaderCompileQueue::WorkerLoop, this);
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// The workers only exit once the queue is empty
+ShaderCompileQueue::~ShaderCompileQueue()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_exit = true;
+  }
+  m_taskAvailable.notify_all();
+  for (std::thread& thread : m_threads)
+  {
+    thread.join();
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+ShaderCompileQueue::Result ShaderCompileQueue::Submit(const std::string& fileName,
+                                                      const std::string& entryPoint,
+                                                      const std::string& target, uint32_t flags)
+{
+  Result result;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_statistics.taskCount == 0)
+    {
+      m_firstSubmission = std::chrono::steady_clock::now();
+    }
+    m_tasks.push_back({fileName, entryPoint, target, flags, std::promise<Bytecode>()});
+    result = m_tasks.back().promise.get_future().share();
+    m_statistics.taskCount++;
+  }
+  m_taskAvailable.notify_one();
+  return result;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+void ShaderCompileQueue::WaitForAll()
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_tasksDone.wait(lock, [this]() { return m_tasks.empty() && m_runningCount == 0; });
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+ShaderCompileStatistics ShaderCompileQueue::GetStatistics() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_statistics;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// The compiler of the worker is created upon its first task, and a failure to create it fails
+// the task like a compilation error. The promise is fulfilled outside of the lock, as it may
+// wake up a thread waiting for the result
+void ShaderCompileQueue::WorkerLoop()
+{
+  std::unique_ptr<ShaderCache::Compiler> compiler;
+  for (;;)
+  {
+    Task task;
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_taskAvailable.wait(lock, [this]() { return m_exit || !m_tasks.empty(); });
+      if (m_tasks.empty())
+      {
+        return;
+      }
+      task = std::move(m_tasks.front());
+      m_tasks.pop_front();
+      m_runningCount++;
+      m_statistics.peakRunningCount = std::max(m_statistics.peakRunningCount, m_runningCount);
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    bool failed = false;
+    bool createdCompiler = false;
+    try
+    {
+      if (!compiler)
+      {
+        compiler = m_createCompiler();
+        createdCompiler = true;
+      }
+      task.promise.set_value(
+          m_cache->Compile(compiler.get(), task.fileName, task.entryPoint, task.target, task.flags));
+    }
+    catch (...)
+    {
+      task.promise.set_exception(std::current_exception());
+      failed = true;
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_runningCount--;
+      m_statistics.taskSeconds += GetSecondsSince(start);
+      m_statistics.elapsedSeconds = GetSecondsSince(m_firstSubmission);
+      m_statistics.failedTaskCount += failed ? 1 : 0;
+      m_statistics.compilerCount += createdCompiler && compiler ? 1 : 0;
+    }
+    m_tasksDone.notify_all();
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+bool MockShaderCompiler::Compile(const std::string& fileName, const std::string& entryPoint,
+                                 const std::string& target, uint32_t /*flags*/,
+                                 std::vector<uint8_t>* bytecode, std::string* errors)
+{
+  std::this_thread::sleep_for(std::chrono::duration<double>(m_latencySeconds));
+  if (fileName.find("error") != std::string::npos)
+  {
+    *errors = fileName + ": error: mock compilation failure";
+    return false;
+  }
+  *bytecode = GetBytecode(fileName, entryPoint, target);
+  return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+std::vector<uint8_t> MockShaderCompiler::GetBytecode(const std::string& fileName,
+                                                     const std::string& entryPoint,
+                                                     const std::string& target)
+{
+  const std::string text = fileName + '\0' + entryPoint + '\0' + target;
+  return std::vector<uint8_t>(text.begin(), text.end());
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// The tasks are named after their index, and all submitted before waiting for the first result,
+// as the application does
+ShaderCompileBenchmarkResult RunShaderCompileBenchmark(uint32_t workerCount, uint32_t taskCount,
+                                                       double latencySeconds)
+{
+  ShaderCache cache(nullptr, "");
+  ShaderCompileBenchmarkResult result;
+  result.taskCount = taskCount;
+  result.serialSeconds = taskCount * latencySeconds;
+
+  const auto start = std::chrono::steady_clock::now();
+  {
+    ShaderCompileQueue queue(&cache, [latencySeconds]() {
+      return std::unique_ptr<ShaderCache::Compiler>(new MockShaderCompiler(latencySeconds));
+    }, workerCount);
+    result.workerCount = queue.GetWorkerCount();
+
+    std::vector<ShaderCompileQueue::Result> results;
+    for (uint32_t task = 0; task < taskCount; task++)
+    {
+      results.push_back(queue.Submit("shader" + std::to_string(task) + ".hlsl", "", "lib_6_3"));
+    }
+    for (uint32_t task = 0; task < taskCount; task++)
+    {
+      result.matched &= results[task].get() ==
+                        MockShaderCompiler::GetBytecode("shader" + std::to_string(task) + ".hlsl",
+                                                        "", "lib_6_3");
+    }
+    result.seconds = GetSecondsSince(start);
+    result.peakRunningCount = queue.GetStatistics().peakRunningCount;
+  }
+  return result;
+}
+
+} // namespace nv_helpers_dx12
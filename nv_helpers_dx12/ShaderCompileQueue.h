@@ -0,0 +1,164 @@
+/*
+
+The shader compile queue compiles shaders on worker threads, so that the
+libraries and entry points of the application are compiled concurrently, and
+while the rest of the initialization runs. Each submission is a task compiling
+one library or one entry point through a ShaderCache, and returns a future of
+its bytecode. The tasks run in submission order, on as many workers as there
+are cores by default.
+
+Compilers such as DXC are not thread-safe, hence each worker creates its own
+compiler instance through a factory, upon running its first task. Workers
+which never get a task do not create any.
+
+The queue does not depend on D3D12 or DXC. MockShaderCompiler emulates the
+latency of a compiler, so that the scheduling and the scaling of the queue can
+be measured on any platform with RunShaderCompileBenchmark.
+
+Example:
+
+nv_helpers_dx12::ShaderCache cache(nullptr, "ShaderCache");
+nv_helpers_dx12::ShaderCompileQueue queue(
+    &cache, []() { return std::make_unique<DxcCompiler>(); });
+nv_helpers_dx12::ShaderCompileQueue::Result rayGen = queue.Submit("RayGen.hlsl", "", "lib_6_3");
+nv_helpers_dx12::ShaderCompileQueue::Result miss = queue.Submit("Miss.hlsl", "", "lib_6_3");
+// Other initialization work, then wait for the bytecode, rethrowing the compilation errors
+const std::vector<uint8_t>& rayGenBytecode = rayGen.get();
+
+*/
+
+#pragma once
+
+#include "ShaderCache.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace nv_helpers_dx12
+{
+
+/// Counts of the compilation tasks, and time spent running them
+struct ShaderCompileStatistics
+{
+  uint32_t taskCount = 0;
+  uint32_t failedTaskCount = 0;
+  /// Compiler instances created, at most one per worker
+  uint32_t compilerCount = 0;
+  /// Largest number of tasks running at once
+  uint32_t peakRunningCount = 0;
+  /// Sum of the durations of the tasks
+  double taskSeconds = 0.;
+  /// Time from the first submission to the completion of the last task
+  double elapsedSeconds = 0.;
+
+  /// Average number of tasks running at once
+  double GetParallelism() const { return elapsedSeconds > 0. ? taskSeconds / elapsedSeconds : 0.; }
+};
+
+/// Helper class compiling shaders through a cache on worker threads
+class ShaderCompileQueue
+{
+public:
+  using Bytecode = std::vector<uint8_t>;
+  /// Bytecode of a shader, once compiled. get() rethrows the errors of the compilation
+  using Result = std::shared_future<Bytecode>;
+  /// Create a compiler instance, called on the worker thread which will use it
+  using CompilerFactory = std::function<std::unique_ptr<ShaderCache::Compiler>()>;
+
+  /// The cache must outlive the queue. workerCount threads are created, 0 standing for the number
+  /// of hardware threads
+  ShaderCompileQueue(ShaderCache* cache, CompilerFactory createCompiler, uint32_t workerCount = 0);
+  /// Complete the submitted tasks before stopping the workers
+  ~ShaderCompileQueue();
+
+  ShaderCompileQueue(const ShaderCompileQueue&) = delete;
+  ShaderCompileQueue& operator=(const ShaderCompileQueue&) = delete;
+
+  /// Queue the compilation of a library, with an empty entry point, or of an entry point
+  Result Submit(const std::string& fileName, const std::string& entryPoint,
+                const std::string& target, uint32_t flags = 0);
+
+  /// Block until all the submitted tasks are completed
+  void WaitForAll();
+
+  uint32_t GetWorkerCount() const { return static_cast<uint32_t>(m_threads.size()); }
+
+  ShaderCompileStatistics GetStatistics() const;
+
+private:
+  struct Task
+  {
+    std::string fileName;
+    std::string entryPoint;
+    std::string target;
+    uint32_t flags;
+    std::promise<Bytecode> promise;
+  };
+
+  void WorkerLoop();
+
+  ShaderCache* m_cache;
+  CompilerFactory m_createCompiler;
+  std::vector<std::thread> m_threads;
+
+  // Protected by m_mutex
+  mutable std::mutex m_mutex;
+  std::condition_variable m_taskAvailable;
+  std::condition_variable m_tasksDone;
+  std::deque<Task> m_tasks;
+  uint32_t m_runningCount = 0;
+  bool m_exit = false;
+  std::chrono::steady_clock::time_point m_firstSubmission;
+  ShaderCompileStatistics m_statistics;
+};
+
+/// Compiler without any backend, sleeping for a fixed latency per compilation. The bytecode is
+/// made of the file name, entry point and target, so that the results can be matched to their
+/// tasks. A file name containing "error" fails to compile
+class MockShaderCompiler : public ShaderCache::Compiler
+{
+public:
+  explicit MockShaderCompiler(double latencySeconds) : m_latencySeconds(latencySeconds) {}
+
+  std::string GetVersion() override { return "mock"; }
+  bool Compile(const std::string& fileName, const std::string& entryPoint,
+               const std::string& target, uint32_t flags, std::vector<uint8_t>* bytecode,
+               std::string* errors) override;
+
+  static std::vector<uint8_t> GetBytecode(const std::string& fileName,
+                                          const std::string& entryPoint, const std::string& target);
+
+private:
+  double m_latencySeconds;
+};
+
+/// Results of a compilation benchmark
+struct ShaderCompileBenchmarkResult
+{
+  uint32_t workerCount = 0;
+  uint32_t taskCount = 0;
+  double seconds = 0.;
+  /// Time a single thread would take to compile all the shaders
+  double serialSeconds = 0.;
+  uint32_t peakRunningCount = 0;
+  /// True if every future returned the bytecode of its own task
+  bool matched = true;
+
+  double GetSpeedup() const { return seconds > 0. ? serialSeconds / seconds : 0.; }
+};
+
+/// Compile taskCount shaders with MockShaderCompiler instances of the given latency, through a
+/// disabled cache
+ShaderCompileBenchmarkResult RunShaderCompileBenchmark(uint32_t workerCount, uint32_t taskCount,
+                                                       double latencySeconds);
+
+} // namespace nv_helpers_dx12
@@ -0,0 +1,398 @@
+/*
+
+Two-level segregated fit allocation of the ranges of a memory block. See
+TlsfAllocator.h for details.
+
+*/
+
+#include "TlsfAllocator.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <stdexcept>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace nv_helpers_dx12
+{
+
+namespace
+{
+//--------------------------------------------------------------------------------------------------
+//
+// Index of the lowest and highest set bits of a non-zero value
+uint32_t LowestBit(uint64_t value)
+{
+#ifdef _MSC_VER
+  unsigned long index;
+  _BitScanForward64(&index, value);
+  return index;
+#else
+  return static_cast<uint32_t>(__builtin_ctzll(value));
+#endif
+}
+
+uint32_t HighestBit(uint64_t value)
+{
+#ifdef _MSC_VER
+  unsigned long index;
+  _BitScanReverse64(&index, value);
+  return index;
+#else
+  return 63 - static_cast<uint32_t>(__builtin_clzll(value));
+#endif
+}
+
+/// Small deterministic generator for the stress benchmark
+uint64_t NextRandom(uint64_t* state)
+{
+  uint64_t z = (*state += 0x9e3779b97f4a7c15ull);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+  return z ^ (z >> 31);
+}
+} // namespace
+
+// The constants are bound to references by the standard algorithms, and need a definition
+const uint32_t TlsfAllocation::kInvalidHandle;
+const uint32_t TlsfAllocator::kSecondLevelLog2;
+const uint32_t TlsfAllocator::kSecondLevelCount;
+const uint32_t TlsfAllocator::kNullBlock;
+const uint32_t TlsfAllocator::kFirstLevelCount;
+
+//--------------------------------------------------------------------------------------------------
+//
+// The memory block starts as a single free block
+TlsfAllocator::TlsfAllocator(uint64_t sizeInBytes, uint64_t granularity)
+    : m_size(sizeInBytes), m_granularity(granularity)
+{
+  if (granularity == 0 || (granularity & (granularity - 1)) != 0)
+  {
+    throw std::logic_error("The TLSF granularity must be a power of two");
+  }
+  for (auto& lists : m_freeLists)
+  {
+    std::fill(std::begin(lists), std::end(lists), kNullBlock);
+  }
+  const uint64_t units = sizeInBytes / granularity;
+  if (units > 0)
+  {
+    InsertFreeBlock(CreateBlock(0, units));
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Sizes below kSecondLevelCount units have one class each. Above, the first level is the power
+// of two of the size, and the second one the next kSecondLevelLog2 bits
+void TlsfAllocator::GetClass(uint64_t units, uint32_t* firstLevel, uint32_t* secondLevel)
+{
+  if (units < kSecondLevelCount)
+  {
+    *firstLevel = 0;
+    *secondLevel = static_cast<uint32_t>(units);
+    return;
+  }
+  const uint32_t highestBit = HighestBit(units);
+  *firstLevel = highestBit - kSecondLevelLog2 + 1;
+  *secondLevel = static_cast<uint32_t>(units >> (highestBit - kSecondLevelLog2)) & (kSecondLevelCount - 1);
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+uint32_t TlsfAllocator::CreateBlock(uint64_t offset, uint64_t size)
+{
+  uint32_t block;
+  if (!m_unusedBlocks.empty())
+  {
+    block = m_unusedBlocks.back();
+    m_unusedBlocks.pop_back();
+  }
+  else
+  {
+    block = static_cast<uint32_t>(m_blocks.size());
+    m_blocks.emplace_back();
+  }
+  m_blocks[block] = {offset, size, kNullBlock, kNullBlock, kNullBlock, kNullBlock, false};
+  return block;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+void TlsfAllocator::InsertFreeBlock(uint32_t block)
+{
+  uint32_t firstLevel, secondLevel;
+  GetClass(m_blocks[block].size, &firstLevel, &secondLevel);
+  uint32_t& head = m_freeLists[firstLevel][secondLevel];
+  m_blocks[block].isFree = true;
+  m_blocks[block].previousFree = kNullBlock;
+  m_blocks[block].nextFree = head;
+  if (head != kNullBlock)
+  {
+    m_blocks[head].previousFree = block;
+  }
+  head = block;
+  m_freeBlockCount++;
+  m_firstLevelBitmap |= 1ull << firstLevel;
+  m_secondLevelBitmaps[firstLevel] |= 1u << secondLevel;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+void TlsfAllocator::RemoveFreeBlock(uint32_t block)
+{
+  uint32_t firstLevel, secondLevel;
+  GetClass(m_blocks[block].size, &firstLevel, &secondLevel);
+  const Block& b = m_blocks[block];
+  if (b.previousFree != kNullBlock)
+  {
+    m_blocks[b.previousFree].nextFree = b.nextFree;
+  }
+  else
+  {
+    m_freeLists[firstLevel][secondLevel] = b.nextFree;
+  }
+  if (b.nextFree != kNullBlock)
+  {
+    m_blocks[b.nextFree].previousFree = b.previousFree;
+  }
+  if (m_freeLists[firstLevel][secondLevel] == kNullBlock)
+  {
+    m_secondLevelBitmaps[firstLevel] &= ~(1u << secondLevel);
+    if (m_secondLevelBitmaps[firstLevel] == 0)
+    {
+      m_firstLevelBitmap &= ~(1ull << firstLevel);
+    }
+  }
+  m_blocks[block].isFree = false;
+  m_freeBlockCount--;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// The size is rounded up to the next class boundary, so that any block of the class found is
+// large enough, without walking the free lists
+uint32_t TlsfAllocator::FindFreeBlock(uint64_t units) const
+{
+  if (units >= kSecondLevelCount)
+  {
+    const uint64_t roundedUnits = units + (1ull << (HighestBit(units) - kSecondLevelLog2)) - 1;
+    if (roundedUnits < units)
+    {
+      return kNullBlock;
+    }
+    units = roundedUnits;
+  }
+  uint32_t firstLevel, secondLevel;
+  GetClass(units, &firstLevel, &secondLevel);
+  if (firstLevel >= kFirstLevelCount)
+  {
+    return kNullBlock;
+  }
+
+  uint32_t secondLevelMap = m_secondLevelBitmaps[firstLevel] & (~0u << secondLevel);
+  if (secondLevelMap == 0)
+  {
+    const uint64_t firstLevelMap =
+        firstLevel + 1 < 64 ? m_firstLevelBitmap & (~0ull << (firstLevel + 1)) : 0;
+    if (firstLevelMap == 0)
+    {
+      return kNullBlock;
+    }
+    firstLevel = LowestBit(firstLevelMap);
+    secondLevelMap = m_secondLevelBitmaps[firstLevel];
+  }
+  return m_freeLists[firstLevel][LowestBit(secondLevelMap)];
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+void TlsfAllocator::SplitBlock(uint32_t block, uint64_t units)
+{
+  const uint32_t remainder = CreateBlock(m_blocks[block].offset + units, m_blocks[block].size - units);
+  Block& b = m_blocks[block];
+  b.size = units;
+  m_blocks[remainder].previousPhysical = block;
+  m_blocks[remainder].nextPhysical = b.nextPhysical;
+  if (b.nextPhysical != kNullBlock)
+  {
+    m_blocks[b.nextPhysical].previousPhysical = remainder;
+  }
+  b.nextPhysical = remainder;
+  InsertFreeBlock(remainder);
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+void TlsfAllocator::MergeWithNext(uint32_t block)
+{
+  const uint32_t next = m_blocks[block].nextPhysical;
+  m_blocks[block].size += m_blocks[next].size;
+  m_blocks[block].nextPhysical = m_blocks[next].nextPhysical;
+  if (m_blocks[next].nextPhysical != kNullBlock)
+  {
+    m_blocks[m_blocks[next].nextPhysical].previousPhysical = block;
+  }
+  m_unusedBlocks.push_back(next);
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Alignments larger than the granularity are obtained by searching for a block large enough to
+// contain an aligned range, and splitting the padding in front of it into a free block
+TlsfAllocation TlsfAllocator::Allocate(uint64_t sizeInBytes, uint64_t alignment)
+{
+  if (alignment == 0 || (alignment & (alignment - 1)) != 0)
+  {
+    throw std::logic_error("The TLSF alignment must be a power of two");
+  }
+  TlsfAllocation allocation;
+  const uint64_t units = std::max<uint64_t>(1, (sizeInBytes + m_granularity - 1) / m_granularity);
+  const uint64_t alignmentUnits = std::max<uint64_t>(1, alignment / m_granularity);
+  const uint64_t searchedUnits = units + alignmentUnits - 1;
+  if (units > m_size / m_granularity || searchedUnits < units)
+  {
+    return allocation;
+  }
+
+  uint32_t block = FindFreeBlock(searchedUnits);
+  if (block == kNullBlock)
+  {
+    return allocation;
+  }
+  RemoveFreeBlock(block);
+
+  // The previous physical block of a free block is never free, hence the padding cannot be
+  // merged and becomes a free block of its own
+  const uint64_t padding = (alignmentUnits - m_blocks[block].offset % alignmentUnits) % alignmentUnits;
+  if (padding > 0)
+  {
+    SplitBlock(block, padding);
+    const uint32_t aligned = m_blocks[block].nextPhysical;
+    RemoveFreeBlock(aligned);
+    InsertFreeBlock(block);
+    block = aligned;
+  }
+  if (m_blocks[block].size > units)
+  {
+    SplitBlock(block, units);
+  }
+
+  m_usedSize += units * m_granularity;
+  m_allocationCount++;
+  allocation.offset = m_blocks[block].offset * m_granularity;
+  allocation.size = units * m_granularity;
+  allocation.handle = block;
+  return allocation;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+void TlsfAllocator::Free(const TlsfAllocation& allocation)
+{
+  if (!allocation.IsValid() || allocation.handle >= m_blocks.size() ||
+      m_blocks[allocation.handle].isFree)
+  {
+    throw std::logic_error("Freeing a TLSF allocation which is not allocated");
+  }
+  uint32_t block = allocation.handle;
+  m_usedSize -= m_blocks[block].size * m_granularity;
+  m_allocationCount--;
+
+  const uint32_t next = m_blocks[block].nextPhysical;
+  if (next != kNullBlock && m_blocks[next].isFree)
+  {
+    RemoveFreeBlock(next);
+    MergeWithNext(block);
+  }
+  const uint32_t previous = m_blocks[block].previousPhysical;
+  if (previous != kNullBlock && m_blocks[previous].isFree)
+  {
+    RemoveFreeBlock(previous);
+    MergeWithNext(previous);
+    block = previous;
+  }
+  InsertFreeBlock(block);
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// The largest free block is in the highest non-empty class, whose list is the only one walked
+TlsfStatistics TlsfAllocator::GetStatistics() const
+{
+  TlsfStatistics statistics;
+  statistics.size = m_size;
+  statistics.usedSize = m_usedSize;
+  statistics.allocationCount = m_allocationCount;
+  statistics.freeRangeCount = m_freeBlockCount;
+  if (m_firstLevelBitmap != 0)
+  {
+    const uint32_t firstLevel = HighestBit(m_firstLevelBitmap);
+    const uint32_t secondLevel = HighestBit(m_secondLevelBitmaps[firstLevel]);
+    for (uint32_t block = m_freeLists[firstLevel][secondLevel]; block != kNullBlock;
+         block = m_blocks[block].nextFree)
+    {
+      statistics.largestFreeRange =
+          std::max(statistics.largestFreeRange, m_blocks[block].size * m_granularity);
+    }
+  }
+  return statistics;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Allocations and frees are drawn with equal probability, the freed allocation being picked at
+// random among the live ones
+TlsfStressResult RunTlsfStressBenchmark(uint64_t heapSizeInBytes, uint64_t operationCount,
+                                        uint64_t maxAllocationSize, uint64_t seed)
+{
+  TlsfAllocator allocator(heapSizeInBytes);
+  std::vector<TlsfAllocation> live;
+  TlsfStressResult result;
+  uint64_t state = seed;
+  const double logMaxSize = std::log(static_cast<double>(std::max<uint64_t>(maxAllocationSize, 2)));
+
+  const auto start = std::chrono::steady_clock::now();
+  for (uint64_t operation = 0; operation < operationCount; operation++)
+  {
+    const uint64_t random = NextRandom(&state);
+    if (live.empty() || (random & 1) == 0)
+    {
+      const double unit = (random >> 11) * (1.0 / 9007199254740992.0);
+      const uint64_t size = static_cast<uint64_t>(std::exp(unit * logMaxSize));
+      const uint64_t alignment = (random & 6) == 0 ? 65536 : 256;
+      const TlsfAllocation allocation = allocator.Allocate(size, alignment);
+      if (allocation.IsValid())
+      {
+        live.push_back(allocation);
+      }
+      else
+      {
+        result.failedAllocationCount++;
+      }
+      result.peakUsedSize = std::max(result.peakUsedSize, allocator.GetUsedSize());
+    }
+    else
+    {
+      const size_t index = static_cast<size_t>((random >> 1) % live.size());
+      allocator.Free(live[index]);
+      live[index] = live.back();
+      live.pop_back();
+    }
+  }
+  result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  result.operationCount = operationCount;
+  result.finalStatistics = allocator.GetStatistics();
+  return result;
+}
+
+} // namespace nv_helpers_dx12
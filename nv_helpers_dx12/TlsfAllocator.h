@@ -0,0 +1,158 @@
+/*
+
+The TLSF allocator manages the ranges of a memory block, such as a D3D12 heap,
+with the two-level segregated fit algorithm of Masmano et al.: allocations and
+frees run in constant time, and the fragmentation stays low for long-running
+allocation patterns.
+
+The free ranges are classified by size in a two-level table: the first level is
+the power of two of the size, and the second one splits each power of two into
+kSecondLevelCount linear classes. Bitmaps of the non-empty classes let the
+allocator find a free range large enough with a couple of bit scans. Freed
+ranges are merged with their free neighbors immediately.
+
+The allocator only manipulates offsets and sizes, and does not depend on D3D12.
+All the sizes and offsets are rounded to the granularity given at construction.
+The stress benchmark runs a random mix of allocations and frees, and reports the
+throughput and the resulting fragmentation.
+
+Example:
+
+nv_helpers_dx12::TlsfAllocator allocator(64 * 1024 * 1024, 256);
+nv_helpers_dx12::TlsfAllocation allocation = allocator.Allocate(size, 65536);
+if (allocation.IsValid())
+{
+  device->CreatePlacedResource(heap, allocation.offset, ...);
+}
+allocator.Free(allocation);
+
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace nv_helpers_dx12
+{
+
+/// Range handed out by TlsfAllocator
+struct TlsfAllocation
+{
+  static const uint32_t kInvalidHandle = ~0u;
+
+  uint64_t offset = 0;
+  uint64_t size = 0;
+  /// Identifier of the range in the allocator, used to free it
+  uint32_t handle = kInvalidHandle;
+
+  bool IsValid() const { return handle != kInvalidHandle; }
+};
+
+/// Occupancy of a TlsfAllocator
+struct TlsfStatistics
+{
+  uint64_t size = 0;
+  uint64_t usedSize = 0;
+  uint64_t largestFreeRange = 0;
+  uint32_t allocationCount = 0;
+  uint32_t freeRangeCount = 0;
+
+  /// Share of the free memory which cannot serve an allocation as large as the free memory
+  float GetFragmentation() const
+  {
+    const uint64_t freeSize = size - usedSize;
+    return freeSize > 0 ? 1.f - largestFreeRange / static_cast<float>(freeSize) : 0.f;
+  }
+};
+
+/// Helper class allocating ranges of a memory block in constant time
+class TlsfAllocator
+{
+public:
+  /// Number of linear classes per power of two, as a power of two
+  static const uint32_t kSecondLevelLog2 = 4;
+  static const uint32_t kSecondLevelCount = 1u << kSecondLevelLog2;
+
+  /// The granularity must be a power of two
+  TlsfAllocator(uint64_t sizeInBytes, uint64_t granularity = 256);
+
+  /// Allocate a range at an offset aligned on alignment, which must be a power of two. Returns
+  /// an invalid allocation if no free range is large enough
+  TlsfAllocation Allocate(uint64_t sizeInBytes, uint64_t alignment = 1);
+
+  /// Release a range returned by Allocate
+  void Free(const TlsfAllocation& allocation);
+
+  uint64_t GetSize() const { return m_size; }
+  uint64_t GetUsedSize() const { return m_usedSize; }
+  bool IsEmpty() const { return m_allocationCount == 0; }
+
+  TlsfStatistics GetStatistics() const;
+
+private:
+  static const uint32_t kNullBlock = ~0u;
+  static const uint32_t kFirstLevelCount = 64 - kSecondLevelLog2 + 1;
+
+  /// Range of the memory block, free or allocated. The blocks of the memory block are linked in
+  /// address order, and the free blocks of each class in a list
+  struct Block
+  {
+    uint64_t offset;
+    uint64_t size;
+    uint32_t previousPhysical;
+    uint32_t nextPhysical;
+    uint32_t previousFree;
+    uint32_t nextFree;
+    bool isFree;
+  };
+
+  static void GetClass(uint64_t units, uint32_t* firstLevel, uint32_t* secondLevel);
+  uint32_t CreateBlock(uint64_t offset, uint64_t size);
+  void InsertFreeBlock(uint32_t block);
+  void RemoveFreeBlock(uint32_t block);
+  uint32_t FindFreeBlock(uint64_t units) const;
+  /// Split the end of a block into a new free block, starting units after its start
+  void SplitBlock(uint32_t block, uint64_t units);
+  /// Merge a block with the next physical one, which is destroyed
+  void MergeWithNext(uint32_t block);
+
+  uint64_t m_size;
+  uint64_t m_granularity;
+  uint64_t m_usedSize = 0;
+  uint32_t m_allocationCount = 0;
+  uint32_t m_freeBlockCount = 0;
+
+  /// Blocks, in units of the granularity, and the unused entries of the vector
+  std::vector<Block> m_blocks;
+  std::vector<uint32_t> m_unusedBlocks;
+
+  uint64_t m_firstLevelBitmap = 0;
+  uint32_t m_secondLevelBitmaps[kFirstLevelCount] = {};
+  uint32_t m_freeLists[kFirstLevelCount][kSecondLevelCount];
+};
+
+/// Result of the TLSF stress benchmark
+struct TlsfStressResult
+{
+  uint64_t operationCount = 0;
+  /// Allocations which did not find a free range
+  uint64_t failedAllocationCount = 0;
+  uint64_t peakUsedSize = 0;
+  double seconds = 0.;
+  /// Occupancy at the end of the benchmark, before freeing the remaining allocations
+  TlsfStatistics finalStatistics;
+
+  /// Allocations and frees per second
+  double GetThroughput() const { return seconds > 0. ? operationCount / seconds : 0.; }
+};
+
+/// Run operationCount random allocations and frees on an allocator of heapSizeInBytes bytes. The
+/// allocation sizes follow a log-uniform distribution up to maxAllocationSize, with the
+/// 64 KB alignment of D3D12 buffers for a quarter of them
+TlsfStressResult RunTlsfStressBenchmark(uint64_t heapSizeInBytes, uint64_t operationCount,
+                                        uint64_t maxAllocationSize = 4 * 1024 * 1024,
+                                        uint64_t seed = 1);
+
+} // namespace nv_helpers_dx12
@@ -0,0 +1,143 @@
+/*
+
+Batched copies of the initial data of resources through a staging buffer. See
+UploadBatcher.h for details.
+
+*/
+
+#include "UploadBatcher.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace nv_helpers_dx12
+{
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+UploadBatcher::UploadBatcher(Backend* backend, uint64_t stagingSize)
+    : m_backend(backend), m_staging(stagingSize)
+{
+  if (backend == nullptr)
+  {
+    throw std::logic_error("The upload batcher requires a backend");
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// The chunks of an upload are at most as large as the staging buffer. A chunk following the
+// previous one in both the staging buffer and the destination extends its copy
+void UploadBatcher::Upload(void* destination, const void* data, uint64_t size,
+                           uint64_t destinationOffset)
+{
+  if (destination == nullptr || (data == nullptr && size > 0))
+  {
+    throw std::logic_error("Uploading to or from a null pointer");
+  }
+  const uint8_t* bytes = static_cast<const uint8_t*>(data);
+  uint64_t uploaded = 0;
+  while (uploaded < size)
+  {
+    const uint64_t chunk = std::min(size - uploaded, m_staging.GetSize());
+    const uint64_t stagingOffset = AllocateStaging(chunk);
+    m_backend->WriteStaging(stagingOffset, bytes + uploaded, chunk);
+
+    const bool last = uploaded + chunk == size;
+    UploadCopy* previous = m_copies.empty() ? nullptr : &m_copies.back();
+    if (previous && previous->destination == destination &&
+        previous->destinationOffset + previous->size == destinationOffset + uploaded &&
+        previous->stagingOffset + previous->size == stagingOffset)
+    {
+      previous->size += chunk;
+      previous->last = last;
+    }
+    else
+    {
+      m_copies.push_back({destination, destinationOffset + uploaded, stagingOffset, chunk, last});
+    }
+    uploaded += chunk;
+  }
+  m_statistics.uploadCount++;
+  m_statistics.uploadedBytes += size;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// When the staging buffer is full, the pending copies are submitted first, as their staging
+// memory can only be reused once they are executed. The completed batches are then retired,
+// and the batcher only blocks if none is
+uint64_t UploadBatcher::AllocateStaging(uint64_t size)
+{
+  uint64_t offset = 0;
+  while (!m_staging.Allocate(size, kStagingAlignment, &offset))
+  {
+    if (!m_copies.empty())
+    {
+      Flush();
+      continue;
+    }
+    if (Retire() > 0)
+    {
+      continue;
+    }
+    if (m_batches.empty())
+    {
+      throw std::logic_error("The staging buffer is full without any pending batch");
+    }
+    m_backend->Wait(m_batches.front());
+    m_statistics.stallCount++;
+    Retire();
+  }
+  return offset;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+uint64_t UploadBatcher::Flush()
+{
+  if (m_copies.empty())
+  {
+    return 0;
+  }
+  const uint64_t fenceValue = m_backend->Submit(m_copies.data(), static_cast<uint32_t>(m_copies.size()));
+  m_staging.EndFrame(fenceValue);
+  m_batches.push_back(fenceValue);
+  m_statistics.copyCount += m_copies.size();
+  m_statistics.batchCount++;
+  m_copies.clear();
+  return fenceValue;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+uint32_t UploadBatcher::Retire()
+{
+  const uint64_t completedValue = m_backend->GetCompletedValue();
+  m_staging.Retire(completedValue);
+  uint32_t count = 0;
+  while (!m_batches.empty() && m_batches.front() <= completedValue)
+  {
+    m_batches.pop_front();
+    count++;
+  }
+  return count;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+void UploadBatcher::WaitForAll()
+{
+  Flush();
+  if (!m_batches.empty())
+  {
+    m_backend->Wait(m_batches.back());
+  }
+  Retire();
+}
+
+} // namespace nv_helpers_dx12
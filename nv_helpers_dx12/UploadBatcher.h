@@ -0,0 +1,138 @@
+/*
+
+The upload batcher moves the initial data of static buffers, such as vertex and
+index buffers, into default heap resources. Reading static data from an upload
+heap crosses the bus at every draw and every acceleration structure build,
+while a default heap resource is read from video memory.
+
+The data of many uploads is packed into a single staging buffer, suballocated
+by an UploadRing, and the copies into the destination resources are submitted
+in batches, one command list per batch. A batch is tagged with the fence value
+signaled after it, and its staging memory is reused once the GPU reaches that
+value. Uploads larger than the staging buffer are split into chunks. When the
+staging buffer is full, the pending copies are submitted and the batcher waits
+for the oldest batch.
+
+The batcher does not depend on D3D12: the staging buffer, the command list and
+the queue are accessed through the Backend interface, implemented by the
+application. The last copy of each upload is flagged, so that the backend can
+transition the destination to its final state after it. A mock backend copying
+into CPU memory can validate the packing and the retirement on any platform.
+
+Example:
+
+nv_helpers_dx12::UploadBatcher batcher(&backend, 8 * 1024 * 1024);
+batcher.Upload(vertexBuffer, vertices.data(), vertices.size() * sizeof(Vertex));
+batcher.Upload(indexBuffer, indices.data(), indices.size() * sizeof(uint32_t));
+// Submit the pending copies before executing the work using the buffers on the same queue
+batcher.Flush();
+// Before releasing the staging buffer
+batcher.WaitForAll();
+
+*/
+
+#pragma once
+
+#include "UploadRing.h"
+
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+namespace nv_helpers_dx12
+{
+
+/// Copy of a range of the staging buffer into a destination resource
+struct UploadCopy
+{
+  void* destination;
+  uint64_t destinationOffset;
+  uint64_t stagingOffset;
+  uint64_t size;
+  /// True for the last copy of an upload, after which the destination holds all its data
+  bool last;
+};
+
+/// Counts of the uploads, and of the copies and batches recording them
+struct UploadBatchStatistics
+{
+  uint64_t uploadCount = 0;
+  uint64_t uploadedBytes = 0;
+  uint64_t copyCount = 0;
+  uint64_t batchCount = 0;
+  /// Waits for the GPU to release staging memory
+  uint64_t stallCount = 0;
+
+  float GetCopiesPerBatch() const
+  {
+    return batchCount > 0 ? copyCount / static_cast<float>(batchCount) : 0.f;
+  }
+};
+
+/// Helper class packing the initial data of resources into a staging buffer, and copying it in
+/// batches
+class UploadBatcher
+{
+public:
+  /// Staging buffer, command list recording the copies, and queue executing them along with a
+  /// fence whose value increases monotonically
+  class Backend
+  {
+  public:
+    virtual ~Backend() = default;
+    /// Write data into the staging buffer
+    virtual void WriteStaging(uint64_t stagingOffset, const void* data, uint64_t size) = 0;
+    /// Record the copies into a command list and execute it, then signal the fence and return the
+    /// signaled value
+    virtual uint64_t Submit(const UploadCopy* copies, uint32_t count) = 0;
+    /// Last value reached by the fence
+    virtual uint64_t GetCompletedValue() = 0;
+    /// Block until the fence reaches value
+    virtual void Wait(uint64_t value) = 0;
+  };
+
+  /// Alignment of the data in the staging buffer
+  static const uint64_t kStagingAlignment = 16;
+
+  /// The backend must outlive the batcher
+  UploadBatcher(Backend* backend, uint64_t stagingSize);
+
+  /// Copy size bytes of data into the destination at destinationOffset, once the pending copies
+  /// are submitted. The data is written to the staging buffer immediately
+  void Upload(void* destination, const void* data, uint64_t size, uint64_t destinationOffset = 0);
+
+  /// Submit the pending copies as a batch, and return the fence value signaled after it, or 0 if
+  /// no copy was pending
+  uint64_t Flush();
+
+  /// Reuse the staging memory of the batches completed by the GPU. Returns the number of batches
+  /// retired
+  uint32_t Retire();
+
+  /// Submit the pending copies and wait for all the batches to complete
+  void WaitForAll();
+
+  uint64_t GetStagingSize() const { return m_staging.GetSize(); }
+
+  /// Largest staging memory used at once
+  uint64_t GetPeakStagingSize() const { return m_staging.GetPeakUsedSize(); }
+
+  /// Number of submitted batches not completed yet
+  size_t GetPendingBatchCount() const { return m_batches.size(); }
+
+  const UploadBatchStatistics& GetStatistics() const { return m_statistics; }
+
+private:
+  /// Allocate staging memory, submitting the pending copies and waiting for the GPU if needed
+  uint64_t AllocateStaging(uint64_t size);
+
+  Backend* m_backend;
+  UploadRing m_staging;
+  /// Copies not submitted yet
+  std::vector<UploadCopy> m_copies;
+  /// Fence values of the submitted batches not completed yet, in submission order
+  std::deque<uint64_t> m_batches;
+  UploadBatchStatistics m_statistics;
+};
+
+} // namespace nv_helpers_dx12
@@ -0,0 +1,93 @@
+/*
+
+Linear per-frame suballocation of an upload buffer. See UploadRing.h for
+details.
+
+*/
+
+#include "UploadRing.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+// Helper to compute aligned buffer sizes
+#ifndef ROUND_UP
+#define ROUND_UP(v, powerOf2Alignment) (((v) + (powerOf2Alignment)-1) & ~((powerOf2Alignment)-1))
+#endif
+
+namespace nv_helpers_dx12
+{
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+UploadRing::UploadRing(uint64_t sizeInBytes) : m_size(sizeInBytes)
+{
+  if (sizeInBytes == 0)
+  {
+    throw std::logic_error("The upload ring cannot be empty");
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// An allocation not fitting before the end of the buffer starts over at offset 0, which is always
+// aligned. The skipped bytes belong to the current frame, and are released along with it
+bool UploadRing::Allocate(uint64_t sizeInBytes, uint64_t alignment, uint64_t* offset)
+{
+  if (alignment == 0 || (alignment & (alignment - 1)) != 0)
+  {
+    throw std::logic_error("The upload ring alignment must be a power of two");
+  }
+  if (sizeInBytes > m_size)
+  {
+    throw std::logic_error("The allocation is larger than the upload ring");
+  }
+
+  // Restart an empty ring at offset 0, so that allocations as large as the ring always succeed
+  if (GetUsedSize() == 0 && m_head % m_size != 0)
+  {
+    m_head += m_size - m_head % m_size;
+    m_tail = m_head;
+  }
+
+  const uint64_t position = m_head % m_size;
+  uint64_t start = ROUND_UP(position, alignment);
+  if (start + sizeInBytes > m_size)
+  {
+    start = 0;
+  }
+  const uint64_t consumed = (start >= position ? start - position : m_size - position) + sizeInBytes;
+  if (GetUsedSize() + consumed > m_size)
+  {
+    return false;
+  }
+
+  m_head += consumed;
+  m_peakUsedSize = std::max(m_peakUsedSize, GetUsedSize());
+  *offset = start;
+  return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Frames without any allocation are recorded as well, to keep the fence values ordered
+void UploadRing::EndFrame(uint64_t fenceValue)
+{
+  m_frames.push_back({fenceValue, m_head});
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// The fence values increase along with the frames, hence the released frames are the oldest ones
+void UploadRing::Retire(uint64_t completedFenceValue)
+{
+  while (!m_frames.empty() && m_frames.front().fenceValue <= completedFenceValue)
+  {
+    // Frames without allocations ended before a restart of the ring may be behind its tail
+    m_tail = std::max(m_tail, m_frames.front().head);
+    m_frames.pop_front();
+  }
+}
+
+} // namespace nv_helpers_dx12
@@ -0,0 +1,85 @@
+/*
+
+The upload ring suballocates a persistently mapped upload buffer for the data
+written by the CPU every frame, such as constant buffers. Allocations are linear:
+each one bumps the head of the ring, wrapping around at the end of the buffer,
+and they are never freed individually. Instead, the allocations of a frame are
+tagged with the fence value signaled at the end of the frame, and released all
+at once when the GPU reaches that value.
+
+The ring only manipulates offsets, and does not depend on D3D12: the
+application maps the buffer and adds the returned offsets to its CPU and GPU
+addresses. The completed fence values are provided by the caller, so that the
+ring can be driven by a mock fence, such as MockFrameQueue (see FramePacer.h).
+
+Example:
+
+nv_helpers_dx12::UploadRing ring(1024 * 1024);
+// Each frame, once the slot of the frame is available
+ring.Retire(fence->GetCompletedValue());
+uint64_t offset;
+if (ring.Allocate(sizeof(constants), nv_helpers_dx12::UploadRing::kConstantBufferAlignment, &offset))
+  memcpy(mappedData + offset, &constants, sizeof(constants));
+// Once the frame is submitted
+ring.EndFrame(signaledFenceValue);
+
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+
+namespace nv_helpers_dx12
+{
+
+/// Helper class handing out per-frame suballocations of an upload buffer
+class UploadRing
+{
+public:
+  /// Alignment of the constant buffer views
+  static const uint64_t kConstantBufferAlignment = 256;
+
+  explicit UploadRing(uint64_t sizeInBytes);
+
+  /// Reserve sizeInBytes bytes in the current frame, at an offset aligned on alignment, which
+  /// must be a power of two. Returns false if the ring is full, ie. the frames not completed by
+  /// the GPU use too much of it. Throws if the allocation is larger than the ring
+  bool Allocate(uint64_t sizeInBytes, uint64_t alignment, uint64_t* offset);
+
+  /// Close the current frame, whose allocations are released once the GPU reaches fenceValue
+  void EndFrame(uint64_t fenceValue);
+
+  /// Release the allocations of the frames whose fence value has been reached
+  void Retire(uint64_t completedFenceValue);
+
+  uint64_t GetSize() const { return m_size; }
+
+  /// Bytes used by the frames not released yet, alignment and wrapping padding included
+  uint64_t GetUsedSize() const { return m_head - m_tail; }
+
+  /// Largest used size observed, to size the ring
+  uint64_t GetPeakUsedSize() const { return m_peakUsedSize; }
+
+  /// Number of frames ended but not released yet
+  size_t GetPendingFrameCount() const { return m_frames.size(); }
+
+private:
+  /// End of the allocations of an ended frame, and the fence value releasing them
+  struct Frame
+  {
+    uint64_t fenceValue;
+    uint64_t head;
+  };
+
+  uint64_t m_size;
+  /// Monotonic positions of the next allocation and of the oldest used byte. Their difference is
+  /// the used size, and their remainder by the size the offset in the buffer
+  uint64_t m_head = 0;
+  uint64_t m_tail = 0;
+  uint64_t m_peakUsedSize = 0;
+  std::deque<Frame> m_frames;
+};
+
+} // namespace nv_helpers_dx12
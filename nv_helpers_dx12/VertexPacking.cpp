@@ -0,0 +1,279 @@
+/*
+
+Compact vertex layouts. See VertexPacking.h for details.
+
+*/
+
+#include "VertexPacking.h"
+
+#include "ParallelFor.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace nv_helpers_dx12
+{
+
+namespace
+{
+const float kSNorm16Max = 32767.f;
+const float kUNorm8Max = 255.f;
+
+inline uint8_t PackUNorm8(float value)
+{
+  return static_cast<uint8_t>(std::lround(std::min(std::max(value, 0.f), 1.f) * kUNorm8Max));
+}
+
+inline int16_t PackSNorm16(float value)
+{
+  return static_cast<int16_t>(std::lround(std::min(std::max(value, -1.f), 1.f) * kSNorm16Max));
+}
+
+inline float UnpackSNorm16(int16_t value)
+{
+  return std::max(static_cast<float>(value) / kSNorm16Max, -1.f);
+}
+} // namespace
+
+//--------------------------------------------------------------------------------------------------
+//
+// Convert a float to a half, handling the overflows, subnormals and special values
+uint16_t FloatToHalf(float value)
+{
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  const uint16_t sign = static_cast<uint16_t>((bits >> 16) & 0x8000);
+  uint32_t magnitude = bits & 0x7fffffff;
+
+  // Infinities and NaNs
+  if (magnitude >= 0x7f800000)
+  {
+    return sign | (magnitude > 0x7f800000 ? 0x7e00 : 0x7c00);
+  }
+  // Values rounding beyond the largest half, 65504
+  if (magnitude >= 0x477ff000)
+  {
+    return sign | 0x7c00;
+  }
+  // Subnormal halves, below 2^-14, are multiples of 2^-24: the scaling is exact, and the
+  // conversion to an integer rounds to the nearest even value
+  if (magnitude < 0x38800000)
+  {
+    float absolute;
+    memcpy(&absolute, &magnitude, sizeof(absolute));
+    return sign | static_cast<uint16_t>(std::nearbyint(absolute * 16777216.f));
+  }
+  // Normal halves: rebias the exponent from 127 to 15, and round the 13 dropped mantissa bits to
+  // the nearest even value
+  const uint32_t odd = (magnitude >> 13) & 1;
+  magnitude += 0xc8000000u + 0xfff + odd;
+  return sign | static_cast<uint16_t>(magnitude >> 13);
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Convert a half to a float, which is always exact
+float HalfToFloat(uint16_t value)
+{
+  const uint32_t sign = static_cast<uint32_t>(value & 0x8000) << 16;
+  const uint32_t exponent = (value >> 10) & 0x1f;
+  const uint32_t mantissa = value & 0x3ff;
+
+  if (exponent == 0)
+  {
+    const float magnitude = static_cast<float>(mantissa) / 16777216.f;
+    return sign != 0 ? -magnitude : magnitude;
+  }
+  uint32_t bits;
+  if (exponent == 31)
+  {
+    bits = sign | 0x7f800000 | (mantissa << 13);
+  }
+  else
+  {
+    bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+  }
+  float result;
+  memcpy(&result, &bits, sizeof(result));
+  return result;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Pack the vertices in parallel. The normalized positions first require the bounding box of the
+// mesh, computed sequentially as it is much cheaper than the packing itself
+PackedVertices PackVertices(const MeshVertex* vertices, size_t vertexCount,
+                            const VertexLayout& layout, uint32_t workerCount)
+{
+  PackedVertices packed;
+  packed.layout = layout;
+  packed.vertexCount = static_cast<uint32_t>(vertexCount);
+  packed.data.resize(vertexCount * layout.GetStride());
+
+  if (layout.positionFormat == PositionFormat::SNorm16x4 && vertexCount > 0)
+  {
+    float lower[3] = {vertices[0].position[0], vertices[0].position[1], vertices[0].position[2]};
+    float upper[3] = {lower[0], lower[1], lower[2]};
+    for (size_t v = 1; v < vertexCount; v++)
+    {
+      for (int k = 0; k < 3; k++)
+      {
+        lower[k] = std::min(lower[k], vertices[v].position[k]);
+        upper[k] = std::max(upper[k], vertices[v].position[k]);
+      }
+    }
+    // Flat axes keep a non-zero scale, so that the decoding transform remains invertible
+    for (int k = 0; k < 3; k++)
+    {
+      packed.positionOffset[k] = 0.5f * (lower[k] + upper[k]);
+      packed.positionScale[k] = std::max(0.5f * (upper[k] - lower[k]), 1e-6f);
+    }
+  }
+
+  const uint32_t stride = layout.GetStride();
+  const uint32_t colorOffset = layout.GetColorOffset();
+  ParallelFor(vertexCount, workerCount, [&](size_t begin, size_t end) {
+    for (size_t v = begin; v < end; v++)
+    {
+      const MeshVertex& vertex = vertices[v];
+      uint8_t* target = packed.data.data() + v * stride;
+
+      switch (layout.positionFormat)
+      {
+      case PositionFormat::Float3:
+        memcpy(target, vertex.position, 3 * sizeof(float));
+        break;
+      case PositionFormat::Half4:
+      {
+        const uint16_t position[4] = {FloatToHalf(vertex.position[0]), FloatToHalf(vertex.position[1]),
+                                      FloatToHalf(vertex.position[2]), FloatToHalf(1.f)};
+        memcpy(target, position, sizeof(position));
+        break;
+      }
+      case PositionFormat::SNorm16x4:
+      {
+        int16_t position[4];
+        for (int k = 0; k < 3; k++)
+        {
+          position[k] = PackSNorm16((vertex.position[k] - packed.positionOffset[k]) /
+                                    packed.positionScale[k]);
+        }
+        position[3] = PackSNorm16(1.f);
+        memcpy(target, position, sizeof(position));
+        break;
+      }
+      }
+
+      if (layout.colorFormat == ColorFormat::Float4)
+      {
+        memcpy(target + colorOffset, vertex.color, 4 * sizeof(float));
+      }
+      else
+      {
+        const uint8_t color[4] = {PackUNorm8(vertex.color[0]), PackUNorm8(vertex.color[1]),
+                                  PackUNorm8(vertex.color[2]), PackUNorm8(vertex.color[3])};
+        memcpy(target + colorOffset, color, sizeof(color));
+      }
+    }
+  });
+  return packed;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Decode a packed vertex, as the input assembler and the hit shaders do
+void UnpackVertex(const PackedVertices& packed, size_t index, MeshVertex* vertex)
+{
+  const VertexLayout& layout = packed.layout;
+  const uint8_t* source = packed.data.data() + index * layout.GetStride();
+
+  switch (layout.positionFormat)
+  {
+  case PositionFormat::Float3:
+    memcpy(vertex->position, source, 3 * sizeof(float));
+    break;
+  case PositionFormat::Half4:
+  {
+    uint16_t position[4];
+    memcpy(position, source, sizeof(position));
+    for (int k = 0; k < 3; k++)
+    {
+      vertex->position[k] = HalfToFloat(position[k]);
+    }
+    break;
+  }
+  case PositionFormat::SNorm16x4:
+  {
+    int16_t position[4];
+    memcpy(position, source, sizeof(position));
+    for (int k = 0; k < 3; k++)
+    {
+      vertex->position[k] =
+          UnpackSNorm16(position[k]) * packed.positionScale[k] + packed.positionOffset[k];
+    }
+    break;
+  }
+  }
+
+  if (layout.colorFormat == ColorFormat::Float4)
+  {
+    memcpy(vertex->color, source + layout.GetColorOffset(), 4 * sizeof(float));
+  }
+  else
+  {
+    uint8_t color[4];
+    memcpy(color, source + layout.GetColorOffset(), sizeof(color));
+    for (int k = 0; k < 4; k++)
+    {
+      vertex->color[k] = static_cast<float>(color[k]) / kUNorm8Max;
+    }
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Decode all the vertices in parallel
+std::vector<MeshVertex> UnpackVertices(const PackedVertices& packed, uint32_t workerCount)
+{
+  std::vector<MeshVertex> vertices(packed.vertexCount);
+  ParallelFor(vertices.size(), workerCount, [&](size_t begin, size_t end) {
+    for (size_t v = begin; v < end; v++)
+    {
+      UnpackVertex(packed, v, &vertices[v]);
+    }
+  });
+  return vertices;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+bool ParsePositionFormat(const std::string& name, PositionFormat* format)
+{
+  if (name == "float")
+    *format = PositionFormat::Float3;
+  else if (name == "half")
+    *format = PositionFormat::Half4;
+  else if (name == "snorm16")
+    *format = PositionFormat::SNorm16x4;
+  else
+    return false;
+  return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+bool ParseColorFormat(const std::string& name, ColorFormat* format)
+{
+  if (name == "float")
+    *format = ColorFormat::Float4;
+  else if (name == "rgba8")
+    *format = ColorFormat::UNorm8x4;
+  else
+    return false;
+  return true;
+}
+
+} // namespace nv_helpers_dx12
@@ -0,0 +1,96 @@
+/*
+
+Compact vertex layouts, reducing the 28 bytes of the float position and color
+of MeshVertex down to 12 bytes per vertex. The positions can be stored as:
+- Float3: 3 floats, 12 bytes
+- Half4: 4 half floats, 8 bytes, the last one being 1
+- SNorm16x4: 4 16-bit signed normalized integers, 8 bytes. The positions are
+  normalized within the bounding box of the mesh, and decoded with a per-mesh
+  scale and offset: position = packed * positionScale + positionOffset
+and the colors as:
+- Float4: 4 floats, 16 bytes
+- UNorm8x4: 4 8-bit unsigned normalized integers, 4 bytes, as RGBA8_UNORM
+The positions come first, immediately followed by the colors. All the formats
+can be read by the input assembler, and the position formats are accepted as
+vertex formats by the raytracing acceleration structure builds (respectively
+DXGI_FORMAT_R32G32B32_FLOAT, R16G16B16A16_FLOAT and R16G16B16A16_SNORM), the
+decoding transform then being applied in the instance transforms.
+
+Example:
+
+nv_helpers_dx12::VertexLayout layout;
+layout.positionFormat = nv_helpers_dx12::PositionFormat::SNorm16x4;
+layout.colorFormat = nv_helpers_dx12::ColorFormat::UNorm8x4;
+nv_helpers_dx12::PackedVertices packed =
+    nv_helpers_dx12::PackVertices(mesh.vertices.data(), mesh.vertices.size(), layout);
+// Upload packed.data, with a stride of layout.GetStride()
+
+*/
+
+#pragma once
+
+#include "Mesh.h"
+
+#include <string>
+
+namespace nv_helpers_dx12
+{
+
+enum class PositionFormat
+{
+  Float3,
+  Half4,
+  SNorm16x4
+};
+
+enum class ColorFormat
+{
+  Float4,
+  UNorm8x4
+};
+
+/// Storage of the position and color of the vertices
+struct VertexLayout
+{
+  PositionFormat positionFormat = PositionFormat::Float3;
+  ColorFormat colorFormat = ColorFormat::Float4;
+
+  uint32_t GetPositionSize() const { return positionFormat == PositionFormat::Float3 ? 12 : 8; }
+  uint32_t GetColorOffset() const { return GetPositionSize(); }
+  uint32_t GetColorSize() const { return colorFormat == ColorFormat::Float4 ? 16 : 4; }
+  uint32_t GetStride() const { return GetPositionSize() + GetColorSize(); }
+};
+
+/// Vertices stored in a compact layout
+struct PackedVertices
+{
+  VertexLayout layout;
+  uint32_t vertexCount = 0;
+  /// Decoding of the positions, the identity for the floating-point formats
+  float positionScale[3] = {1.f, 1.f, 1.f};
+  float positionOffset[3] = {0.f, 0.f, 0.f};
+  std::vector<uint8_t> data;
+};
+
+/// Pack the vertices in the given layout, using workerCount threads (0 for the number of hardware
+/// threads)
+PackedVertices PackVertices(const MeshVertex* vertices, size_t vertexCount,
+                            const VertexLayout& layout, uint32_t workerCount = 0);
+
+/// Decode a packed vertex
+void UnpackVertex(const PackedVertices& packed, size_t index, MeshVertex* vertex);
+
+/// Decode all the packed vertices
+std::vector<MeshVertex> UnpackVertices(const PackedVertices& packed, uint32_t workerCount = 0);
+
+/// Parse a position format name (float, half or snorm16). Returns false for an unknown name
+bool ParsePositionFormat(const std::string& name, PositionFormat* format);
+
+/// Parse a color format name (float or rgba8). Returns false for an unknown name
+bool ParseColorFormat(const std::string& name, ColorFormat* format);
+
+/// IEEE 754 half-precision conversions, rounding to the nearest even value
+uint16_t FloatToHalf(float value);
+float HalfToFloat(uint16_t value);
+
+} // namespace nv_helpers_dx12
@@ -0,0 +1,202 @@
+/*
+
+Spatial hashing of vertices. See VertexWelder.h for details.
+
+*/
+
+#include "VertexWelder.h"
+
+#include "ParallelFor.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <unordered_set>
+
+namespace nv_helpers_dx12
+{
+
+namespace
+{
+const size_t kKeySize = 7;
+using WeldKey = std::array<int64_t, kKeySize>;
+
+/// Partitions per worker, so that uneven partitions still keep all the workers busy
+const uint32_t kPartitionsPerWorker = 4;
+
+//--------------------------------------------------------------------------------------------------
+//
+// Grid cell of a value, or its bits if the tolerance is 0. Adding 0 turns -0 into +0
+int64_t QuantizeValue(float value, float tolerance)
+{
+  if (tolerance > 0.f)
+  {
+    return static_cast<int64_t>(std::floor(value / tolerance));
+  }
+  const float normalized = value + 0.f;
+  uint32_t bits;
+  memcpy(&bits, &normalized, sizeof(bits));
+  return bits;
+}
+
+uint64_t HashKey(const WeldKey& key)
+{
+  uint64_t hash = 0xcbf29ce484222325ull;
+  for (int64_t value : key)
+  {
+    hash = (hash ^ static_cast<uint64_t>(value)) * 0x100000001b3ull;
+    hash ^= hash >> 29;
+  }
+  return hash;
+}
+
+/// Hash set of vertex indices, comparing the keys of the vertices
+struct KeyHash
+{
+  const std::vector<uint64_t>* hashes;
+  size_t operator()(uint32_t v) const { return static_cast<size_t>((*hashes)[v]); }
+};
+
+struct KeyEqual
+{
+  const std::vector<WeldKey>* keys;
+  bool operator()(uint32_t a, uint32_t b) const { return (*keys)[a] == (*keys)[b]; }
+};
+} // namespace
+
+//--------------------------------------------------------------------------------------------------
+//
+// The vertices are split into one block per worker. Each block counts its vertices per partition,
+// so that the vertices can be scattered in parallel into partitions sorted by vertex index. Each
+// partition then maps its vertices to the first one with the same key
+size_t GenerateWeldRemap(const MeshVertex* vertices, size_t vertexCount, uint32_t* remap,
+                         float positionTolerance, float colorTolerance, uint32_t workerCount)
+{
+  const uint32_t workers = GetWorkerCount(workerCount);
+  const size_t partitionCount = workers == 1 ? 1 : workers * kPartitionsPerWorker;
+
+  std::vector<WeldKey> keys(vertexCount);
+  std::vector<uint64_t> hashes(vertexCount);
+  ParallelFor(vertexCount, workers, [&](size_t begin, size_t end) {
+    for (size_t v = begin; v < end; v++)
+    {
+      for (int k = 0; k < 3; k++)
+      {
+        keys[v][k] = QuantizeValue(vertices[v].position[k], positionTolerance);
+      }
+      for (int k = 0; k < 4; k++)
+      {
+        keys[v][3 + k] = QuantizeValue(vertices[v].color[k], colorTolerance);
+      }
+      hashes[v] = HashKey(keys[v]);
+    }
+  });
+
+  // Scatter the vertices into the partitions
+  const size_t blockCount = workers;
+  const size_t blockSize = (vertexCount + blockCount - 1) / blockCount;
+  std::vector<size_t> offsets(blockCount * partitionCount + 1, 0);
+  ParallelFor(blockCount, workers, [&](size_t begin, size_t end) {
+    for (size_t b = begin; b < end; b++)
+    {
+      for (size_t v = b * blockSize; v < std::min(vertexCount, (b + 1) * blockSize); v++)
+      {
+        offsets[(hashes[v] % partitionCount) * blockCount + b + 1]++;
+      }
+    }
+  });
+  for (size_t i = 0; i < blockCount * partitionCount; i++)
+  {
+    offsets[i + 1] += offsets[i];
+  }
+  std::vector<uint32_t> partitioned(vertexCount);
+  ParallelFor(blockCount, workers, [&](size_t begin, size_t end) {
+    for (size_t b = begin; b < end; b++)
+    {
+      std::vector<size_t> cursors(partitionCount);
+      for (size_t p = 0; p < partitionCount; p++)
+      {
+        cursors[p] = offsets[p * blockCount + b];
+      }
+      for (size_t v = b * blockSize; v < std::min(vertexCount, (b + 1) * blockSize); v++)
+      {
+        partitioned[cursors[hashes[v] % partitionCount]++] = static_cast<uint32_t>(v);
+      }
+    }
+  });
+
+  // Weld each partition, remap temporarily receiving the first vertex of each key
+  ParallelFor(partitionCount, workers, [&](size_t begin, size_t end) {
+    for (size_t p = begin; p < end; p++)
+    {
+      const size_t first = offsets[p * blockCount];
+      const size_t last = offsets[(p + 1) * blockCount];
+      std::unordered_set<uint32_t, KeyHash, KeyEqual> welded(last - first, KeyHash{&hashes},
+                                                              KeyEqual{&keys});
+      for (size_t i = first; i < last; i++)
+      {
+        const uint32_t v = partitioned[i];
+        remap[v] = *welded.insert(v).first;
+      }
+    }
+  });
+
+  // Number the welded vertices in the order of their first occurrence. The first vertex of a key
+  // always precedes the other ones, and has already been renumbered when they are reached
+  size_t weldedCount = 0;
+  for (size_t v = 0; v < vertexCount; v++)
+  {
+    remap[v] = remap[v] == v ? static_cast<uint32_t>(weldedCount++) : remap[remap[v]];
+  }
+  return weldedCount;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// The welded vertices are copies of the first vertex of each key
+Mesh WeldVertices(const MeshVertex* vertices, size_t vertexCount, const uint32_t* indices,
+                  size_t indexCount, float positionTolerance, float colorTolerance,
+                  uint32_t workerCount)
+{
+  std::vector<uint32_t> remap(vertexCount);
+  const size_t weldedCount = GenerateWeldRemap(vertices, vertexCount, remap.data(),
+                                               positionTolerance, colorTolerance, workerCount);
+
+  Mesh mesh;
+  mesh.vertices.resize(weldedCount);
+  std::vector<bool> written(weldedCount, false);
+  for (size_t v = 0; v < vertexCount; v++)
+  {
+    if (!written[remap[v]])
+    {
+      mesh.vertices[remap[v]] = vertices[v];
+      written[remap[v]] = true;
+    }
+  }
+
+  if (indices == nullptr)
+  {
+    mesh.indices = std::move(remap);
+    return mesh;
+  }
+  mesh.indices.resize(indexCount);
+  ParallelFor(indexCount, workerCount, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++)
+    {
+      mesh.indices[i] = remap[indices[i]];
+    }
+  });
+  return mesh;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+void WeldMesh(Mesh* mesh, float positionTolerance, float colorTolerance, uint32_t workerCount)
+{
+  *mesh = WeldVertices(mesh->vertices.data(), mesh->vertices.size(), mesh->indices.data(),
+                       mesh->indices.size(), positionTolerance, colorTolerance, workerCount);
+}
+
+} // namespace nv_helpers_dx12
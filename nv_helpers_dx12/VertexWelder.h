@@ -0,0 +1,53 @@
+/*
+
+The vertex welder merges the vertices of a mesh sharing their position and
+attributes, turning triangle soups and meshes with duplicated vertices into
+compact indexed meshes. Fewer vertices reduce the memory of the vertex buffers,
+and let the AS builder see the connectivity of the triangles.
+
+The vertices are hashed on a grid: each position and color component is
+quantized by the corresponding tolerance, and vertices whose quantized values
+are all equal are merged into the first of them. A tolerance of 0 matches exact
+values, +0 and -0 being considered equal. Vertices closer than the tolerance
+but falling on both sides of a grid boundary are kept apart, which keeps the
+welding transitive and linear in the number of vertices.
+
+The hashing is spread across worker threads: the vertices are scattered into
+partitions according to their hash, and each partition is welded independently.
+Merged vertices are always in the same partition, and the output vertices keep
+the order of their first occurrence, hence the result does not depend on the
+number of threads.
+
+Example:
+
+// Six vertices describing two triangles become four vertices and six indices
+nv_helpers_dx12::Mesh mesh = nv_helpers_dx12::WeldVertices(vertices, 6, nullptr, 0);
+
+*/
+
+#pragma once
+
+#include "Mesh.h"
+
+#include <cstddef>
+
+namespace nv_helpers_dx12
+{
+
+/// Fill remap with the index of the welded vertex of each vertex, and return the number of
+/// welded vertices. The welded vertices are numbered in the order of their first occurrence
+size_t GenerateWeldRemap(const MeshVertex* vertices, size_t vertexCount, uint32_t* remap,
+                         float positionTolerance = 0.f, float colorTolerance = 0.f,
+                         uint32_t workerCount = 0);
+
+/// Weld the vertices of a triangle mesh, using workerCount threads (0 for the number of hardware
+/// threads). If indices is nullptr, the vertices are read as a triangle list
+Mesh WeldVertices(const MeshVertex* vertices, size_t vertexCount, const uint32_t* indices,
+                  size_t indexCount, float positionTolerance = 0.f, float colorTolerance = 0.f,
+                  uint32_t workerCount = 0);
+
+/// Weld the vertices of a mesh in place
+void WeldMesh(Mesh* mesh, float positionTolerance = 0.f, float colorTolerance = 0.f,
+              uint32_t workerCount = 0);
+
+} // namespace nv_helpers_dx12
@@ -17,6 +17,19 @@ cbuffer CameraParams : register(b0)
     float4x4 projection;
 }
 
+// # DXR Extra: Compact vertex formats
+// Decoding of the normalized positions, the identity for the floating-point formats
+cbuffer PositionDecode : register(b1)
+{
+    float4 positionScale;
+    float4 positionOffset;
+    // # DXR Extra: Parallel recording
+    // Rows of the object-to-world transform of the instance
+    float4 transformRow0;
+    float4 transformRow1;
+    float4 transformRow2;
+}
+
 struct PSInput
 {
 	float4 position : SV_POSITION;
@@ -27,7 +40,9 @@ PSInput VSMain(float4 position : POSITION, float4 color : COLOR)
 {
     PSInput result; 
     // #DXR Extra: Perspective Camera 
-    float4 pos = position; 
+    // # DXR Extra: Compact vertex formats
+    float4 pos = float4(position.xyz * positionScale.xyz + positionOffset.xyz, 1.f);
+    pos = float4(dot(transformRow0, pos), dot(transformRow1, pos), dot(transformRow2, pos), 1.f);
     pos = mul(view, pos);
     pos = mul(projection, pos); 
     result.position = pos; 
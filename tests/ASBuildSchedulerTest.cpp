@@ -0,0 +1,247 @@
+/*
+
+Tests of the schedules of ASBuildScheduler, replayed on a recorder which checks that the builds
+running concurrently never share scratch memory.
+
+*/
+
+#include "TestHarness.h"
+
+#include "ASBuildScheduler.h"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+using namespace nv_helpers_dx12;
+
+namespace
+{
+const uint64_t kAlignment = 256;
+
+uint64_t AlignUp(uint64_t size)
+{
+  return (size + kAlignment - 1) & ~(kAlignment - 1);
+}
+
+// Recorder keeping the calls, and the scratch ranges in use since the last barrier
+class MockRecorder : public ASBuildScheduler::Recorder
+{
+public:
+  struct Call
+  {
+    bool barrier;
+    size_t buildIndex;
+    uint64_t scratchOffsetInBytes;
+
+    bool operator==(const Call& other) const
+    {
+      return barrier == other.barrier && buildIndex == other.buildIndex &&
+             scratchOffsetInBytes == other.scratchOffsetInBytes;
+    }
+  };
+
+  explicit MockRecorder(const std::vector<uint64_t>& sizes) : m_sizes(sizes) {}
+
+  void RecordBuild(size_t buildIndex, uint64_t scratchOffsetInBytes) override
+  {
+    const uint64_t size = AlignUp(m_sizes[buildIndex]);
+    for (const Call& call : m_batch)
+    {
+      const uint64_t otherSize = AlignUp(m_sizes[call.buildIndex]);
+      if (scratchOffsetInBytes < call.scratchOffsetInBytes + otherSize &&
+          call.scratchOffsetInBytes < scratchOffsetInBytes + size)
+      {
+        m_overlapCount++;
+      }
+    }
+    if (scratchOffsetInBytes % kAlignment != 0)
+    {
+      m_misalignedCount++;
+    }
+    m_calls.push_back({false, buildIndex, scratchOffsetInBytes});
+    m_batch.push_back(m_calls.back());
+  }
+
+  void RecordBarrier() override
+  {
+    m_calls.push_back({true, 0, 0});
+    m_batch.clear();
+  }
+
+  const std::vector<Call>& GetCalls() const { return m_calls; }
+  int GetOverlapCount() const { return m_overlapCount; }
+  int GetMisalignedCount() const { return m_misalignedCount; }
+
+private:
+  std::vector<uint64_t> m_sizes;
+  std::vector<Call> m_calls;
+  std::vector<Call> m_batch;
+  int m_overlapCount = 0;
+  int m_misalignedCount = 0;
+};
+
+std::vector<uint64_t> MakeSizes(size_t count, uint64_t maxSize, uint32_t seed)
+{
+  std::mt19937 random(seed);
+  std::uniform_int_distribution<uint64_t> distribution(1, maxSize);
+  std::vector<uint64_t> sizes;
+  for (size_t i = 0; i < count; i++)
+  {
+    sizes.push_back(distribution(random));
+  }
+  return sizes;
+}
+} // namespace
+
+//--------------------------------------------------------------------------------------------------
+//
+// No batch exceeds the budget, the builds of a batch use disjoint and aligned ranges, and each
+// build is recorded once
+TEST_CASE(BatchesRespectTheBudget)
+{
+  const uint64_t budget = 1 << 20;
+  const std::vector<uint64_t> sizes = MakeSizes(500, budget / 3, 1);
+  ASBuildScheduler scheduler(budget, kAlignment);
+  for (size_t i = 0; i < sizes.size(); i++)
+  {
+    CHECK(scheduler.AddBuild(sizes[i]) == i);
+  }
+  scheduler.Schedule();
+
+  uint64_t largestBatch = 0;
+  for (const ASBuildScheduler::Batch& batch : scheduler.GetBatches())
+  {
+    CHECK(!batch.builds.empty());
+    CHECK(batch.scratchSizeInBytes <= budget);
+    uint64_t end = 0;
+    for (const ASBuildScheduler::Build& build : batch.builds)
+    {
+      CHECK(build.scratchOffsetInBytes == end);
+      CHECK(build.scratchSizeInBytes == AlignUp(sizes[build.buildIndex]));
+      end += build.scratchSizeInBytes;
+    }
+    CHECK(end == batch.scratchSizeInBytes);
+    largestBatch = std::max(largestBatch, batch.scratchSizeInBytes);
+  }
+  CHECK(scheduler.GetScratchPoolSize() == largestBatch);
+  CHECK(scheduler.GetScratchPoolSize() <= budget);
+  CHECK(scheduler.GetUnbatchedScratchSize() > budget);
+
+  MockRecorder recorder(sizes);
+  scheduler.Execute(recorder);
+  CHECK(recorder.GetOverlapCount() == 0);
+  CHECK(recorder.GetMisalignedCount() == 0);
+  std::vector<int> recordCounts(sizes.size(), 0);
+  for (const MockRecorder::Call& call : recorder.GetCalls())
+  {
+    if (!call.barrier)
+    {
+      recordCounts[call.buildIndex]++;
+    }
+  }
+  CHECK(recordCounts == std::vector<int>(sizes.size(), 1));
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Each batch is followed by exactly one barrier, including the last one
+TEST_CASE(EachBatchIsFollowedByOneBarrier)
+{
+  const std::vector<uint64_t> sizes = {600, 500, 400, 300, 200, 100};
+  ASBuildScheduler scheduler(1024, kAlignment);
+  for (uint64_t size : sizes)
+  {
+    scheduler.AddBuild(size);
+  }
+  scheduler.Schedule();
+  // First fit decreasing of the aligned sizes: 768 + 256, 512 + 512, then 512 + 256
+  CHECK(scheduler.GetBatches().size() == 3);
+
+  MockRecorder recorder(sizes);
+  scheduler.Execute(recorder);
+  const std::vector<MockRecorder::Call>& calls = recorder.GetCalls();
+  size_t barrierCount = 0;
+  size_t batch = 0;
+  size_t buildsInBatch = 0;
+  for (const MockRecorder::Call& call : calls)
+  {
+    if (call.barrier)
+    {
+      CHECK(batch < scheduler.GetBatches().size() &&
+            buildsInBatch == scheduler.GetBatches()[batch].builds.size());
+      barrierCount++;
+      batch++;
+      buildsInBatch = 0;
+    }
+    else
+    {
+      buildsInBatch++;
+    }
+  }
+  CHECK(barrierCount == scheduler.GetBatches().size());
+  CHECK(!calls.empty() && calls.back().barrier);
+
+  // Without builds, nothing is recorded
+  scheduler.Reset();
+  scheduler.Schedule();
+  MockRecorder empty(sizes);
+  scheduler.Execute(empty);
+  CHECK(empty.GetCalls().empty());
+  CHECK(scheduler.GetScratchPoolSize() == 0);
+  CHECK(scheduler.GetUnbatchedScratchSize() == 0);
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// The same builds always produce the same schedule, including between builds of equal sizes
+TEST_CASE(ScheduleIsDeterministic)
+{
+  const std::vector<uint64_t> sizes = MakeSizes(300, 4096, 2);
+  std::vector<std::vector<MockRecorder::Call>> schedules;
+  for (int run = 0; run < 3; run++)
+  {
+    ASBuildScheduler scheduler(16384, kAlignment);
+    for (uint64_t size : sizes)
+    {
+      scheduler.AddBuild(size);
+    }
+    scheduler.Schedule();
+    // Scheduling again gives the same result
+    scheduler.Schedule();
+    MockRecorder recorder(sizes);
+    scheduler.Execute(recorder);
+    schedules.push_back(recorder.GetCalls());
+  }
+  CHECK(schedules[0] == schedules[1]);
+  CHECK(schedules[0] == schedules[2]);
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// A build larger than the budget gets a batch of its own, and the pool grows to its size
+TEST_CASE(OversizedBuildsGetTheirOwnBatch)
+{
+  const std::vector<uint64_t> sizes = {100, 5000, 300, 2000};
+  ASBuildScheduler scheduler(1024, kAlignment);
+  for (uint64_t size : sizes)
+  {
+    scheduler.AddBuild(size);
+  }
+  scheduler.Schedule();
+
+  const std::vector<ASBuildScheduler::Batch>& batches = scheduler.GetBatches();
+  CHECK(batches.size() == 3);
+  if (batches.size() == 3)
+  {
+    CHECK(batches[0].builds.size() == 1 && batches[0].builds[0].buildIndex == 1);
+    CHECK(batches[1].builds.size() == 1 && batches[1].builds[0].buildIndex == 3);
+    CHECK(batches[2].builds.size() == 2);
+    CHECK(batches[2].scratchSizeInBytes <= 1024);
+  }
+  CHECK(scheduler.GetScratchPoolSize() == AlignUp(5000));
+
+  MockRecorder recorder(sizes);
+  scheduler.Execute(recorder);
+  CHECK(recorder.GetOverlapCount() == 0);
+}
@@ -0,0 +1,139 @@
+/*
+
+Tests of AsyncBuildScheduler, and of the schedules it produces on a MockQueueTimeline.
+
+*/
+
+#include "TestHarness.h"
+
+#include "AsyncBuildScheduler.h"
+
+#include <cmath>
+
+using namespace nv_helpers_dx12;
+
+namespace
+{
+bool IsNear(double a, double b)
+{
+  return std::abs(a - b) < 1e-9;
+}
+} // namespace
+
+//--------------------------------------------------------------------------------------------------
+//
+// The versions are built in turn, each build waiting for the last use of its version
+TEST_CASE(VersionsAreBuiltInTurn)
+{
+  AsyncBuildScheduler scheduler(2);
+  CHECK(scheduler.GetLatestVersion() == AsyncBuildScheduler::kNoVersion);
+
+  AsyncBuildScheduler::Build build = scheduler.BeginBuild(true);
+  CHECK(build.version == 0);
+  // Nothing to refit from yet
+  CHECK(build.sourceVersion == AsyncBuildScheduler::kNoVersion);
+  CHECK(build.directWaitValue == 0);
+  scheduler.EndBuild(1);
+  AsyncBuildScheduler::Use use = scheduler.BeginUse();
+  CHECK(use.version == 0 && use.computeWaitValue == 1);
+  scheduler.EndUse(1);
+
+  // The second version was never used
+  build = scheduler.BeginBuild(true);
+  CHECK(build.version == 1 && build.sourceVersion == 0 && build.directWaitValue == 0);
+  scheduler.EndBuild(2);
+  use = scheduler.BeginUse();
+  CHECK(use.version == 1 && use.computeWaitValue == 2);
+  scheduler.EndUse(2);
+
+  // The first version is rebuilt once the direct queue is done with its use
+  build = scheduler.BeginBuild(false);
+  CHECK(build.version == 0 && build.sourceVersion == AsyncBuildScheduler::kNoVersion);
+  CHECK(build.directWaitValue == 1);
+  scheduler.EndBuild(3);
+
+  const AsyncBuildStatistics& statistics = scheduler.GetStatistics();
+  CHECK(statistics.buildCount == 3);
+  CHECK(statistics.refitCount == 1);
+  CHECK(statistics.useCount == 2);
+  CHECK(statistics.computeWaitCount == 1);
+  CHECK(statistics.directWaitCount == 2);
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// A queue which already waited for a fence value does not wait again for a smaller one
+TEST_CASE(WaitsAreNotRepeated)
+{
+  AsyncBuildScheduler scheduler(2);
+  scheduler.BeginBuild(false);
+  scheduler.EndBuild(1);
+  CHECK(scheduler.BeginUse().computeWaitValue == 1);
+  scheduler.EndUse(1);
+  // Using the same version again
+  CHECK(scheduler.BeginUse().computeWaitValue == 0);
+  scheduler.EndUse(2);
+  CHECK(scheduler.GetStatistics().directWaitCount == 1);
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+TEST_CASE(MisuseThrows)
+{
+  CHECK_THROWS(AsyncBuildScheduler(0));
+  AsyncBuildScheduler scheduler;
+  CHECK_THROWS(scheduler.BeginUse());
+  CHECK_THROWS(scheduler.EndBuild(1));
+  CHECK_THROWS(scheduler.EndUse(1));
+  scheduler.BeginBuild(false);
+  CHECK_THROWS(scheduler.BeginBuild(false));
+  scheduler.EndBuild(1);
+  scheduler.BeginUse();
+  CHECK_THROWS(scheduler.BeginUse());
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Two queues executing work, the second one waiting for the first
+TEST_CASE(TimelineOrdersTheQueues)
+{
+  MockQueueTimeline timeline(2);
+  timeline.Execute(0, 2.);
+  const uint64_t value = timeline.Signal(0);
+  CHECK(value == 1);
+  timeline.Execute(0, 3.);
+  timeline.Execute(1, 1.);
+  timeline.Wait(1, 0, value);
+  timeline.Execute(1, 4.);
+  CHECK(IsNear(timeline.GetEndTime(), 6.));
+  CHECK(IsNear(timeline.GetBusyTime(0), 5.));
+  CHECK(IsNear(timeline.GetBusyTime(1), 5.));
+  // [0, 1] and [2, 5]
+  CHECK(IsNear(timeline.GetOverlapTime(), 4.));
+  CHECK_THROWS(timeline.Wait(1, 0, 2));
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// With two versions, the build of a frame overlaps the rendering of the previous one, and the
+// frame time is the rendering time. A single version, or serialized builds, do not overlap
+TEST_CASE(AsyncBuildsOverlapTheRendering)
+{
+  const uint32_t frameCount = 10;
+  const AsyncBuildSimulationResult async = RunAsyncBuildSimulation(frameCount, 2., 3., 2, true);
+  CHECK(IsNear(async.totalTime, 2. + 3. * frameCount));
+  CHECK(IsNear(async.overlapTime, 2. * (frameCount - 1)));
+  CHECK(async.GetOverlapRate() > 0.85);
+  CHECK(async.statistics.buildCount == frameCount);
+  CHECK(async.statistics.refitCount == frameCount - 1);
+
+  const AsyncBuildSimulationResult single = RunAsyncBuildSimulation(frameCount, 2., 3., 1, true);
+  CHECK(IsNear(single.totalTime, 5. * frameCount));
+  CHECK(IsNear(single.overlapTime, 0.));
+
+  const AsyncBuildSimulationResult serial = RunAsyncBuildSimulation(frameCount, 2., 3., 2, false);
+  CHECK(IsNear(serial.totalTime, 5. * frameCount));
+  CHECK(IsNear(serial.GetFrameTime(), 5.));
+  CHECK(IsNear(serial.overlapTime, 0.));
+}
@@ -0,0 +1,197 @@
+/*
+
+Tests of CommandRecorder, recording integer commands into a MockCommandBackend.
+
+*/
+
+#include "TestHarness.h"
+
+#include "CommandRecorder.h"
+
+#include <atomic>
+#include <cstdio>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using namespace nv_helpers_dx12;
+
+namespace
+{
+const uint32_t kFrameBegin = 1000000;
+const uint32_t kFrameEnd = 2000000;
+
+// Record a frame made of a serial list, drawCount draws recorded in parallel and a serial list,
+// and return the executed commands
+std::vector<uint32_t> RecordFrame(uint32_t workerCount, uint32_t drawCount,
+                                  uint32_t minItemsPerList)
+{
+  MockCommandBackend backend(workerCount + 2);
+  CommandRecorder recorder(&backend, workerCount, workerCount + 2);
+  recorder.BeginFrame(0);
+  backend.Record(recorder.OpenSerialList(), kFrameBegin);
+  recorder.RecordParallel(
+      drawCount,
+      [&](uint32_t list, uint32_t first, uint32_t count) {
+        for (uint32_t draw = first; draw < first + count; draw++)
+        {
+          backend.Record(list, draw);
+        }
+      },
+      minItemsPerList);
+  backend.Record(recorder.OpenSerialList(), kFrameEnd);
+  recorder.EndFrame();
+  CHECK(backend.GetExecuteCallCount() == 1);
+  return backend.GetExecutedCommands();
+}
+} // namespace
+
+//--------------------------------------------------------------------------------------------------
+//
+// The GPU sees the draws in their order whatever the number of workers and the split of the draws
+TEST_CASE(OrderDoesNotDependOnTheWorkerCount)
+{
+  std::vector<uint32_t> expected = {kFrameBegin};
+  for (uint32_t draw = 0; draw < 1000; draw++)
+  {
+    expected.push_back(draw);
+  }
+  expected.push_back(kFrameEnd);
+
+  for (uint32_t workerCount : {1u, 2u, 4u, 8u})
+  {
+    for (uint32_t minItemsPerList : {1u, 64u, 300u, 2000u})
+    {
+      CHECK(RecordFrame(workerCount, 1000, minItemsPerList) == expected);
+    }
+  }
+  // Fewer draws than workers
+  CHECK(RecordFrame(8, 3, 1) == std::vector<uint32_t>({kFrameBegin, 0, 1, 2, kFrameEnd}));
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Each frame executes all its lists with a single call, and the ranges use distinct lists
+TEST_CASE(OneExecutePerFrame)
+{
+  MockCommandBackend backend(6);
+  CommandRecorder recorder(&backend, 4, 6);
+  CHECK(recorder.GetWorkerCount() == 4);
+  for (uint32_t frame = 0; frame < 5; frame++)
+  {
+    recorder.BeginFrame(frame % 2);
+    recorder.OpenSerialList();
+    std::atomic<uint32_t> listMask(0);
+    const uint32_t rangeCount =
+        recorder.RecordParallel(400, [&](uint32_t list, uint32_t, uint32_t) {
+          listMask |= 1u << list;
+        });
+    CHECK(rangeCount == 4);
+    CHECK(listMask == 0x1eu);
+    recorder.OpenSerialList();
+    CHECK(recorder.EndFrame() == 6);
+    CHECK(backend.GetExecuteCallCount() == frame + 1);
+  }
+  // A frame without commands does not call Execute
+  recorder.BeginFrame(0);
+  CHECK(recorder.EndFrame() == 0);
+  CHECK(backend.GetExecuteCallCount() == 5);
+
+  const CommandRecordingStatistics& statistics = recorder.GetStatistics();
+  CHECK(statistics.frameCount == 6);
+  CHECK(statistics.listCount == 30);
+  CHECK(statistics.parallelListCount == 20);
+  CHECK(statistics.parallelItemCount == 2000);
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// An exception thrown while recording on a worker thread is rethrown by RecordParallel, once all
+// the ranges are done
+TEST_CASE(WorkerExceptionsAreRethrown)
+{
+  MockCommandBackend backend(4);
+  const std::thread::id caller = std::this_thread::get_id();
+  std::atomic<bool> thrownByWorker(false);
+  std::atomic<uint32_t> recordedRanges(0);
+  {
+    CommandRecorder recorder(&backend, 4, 4);
+    recorder.BeginFrame(0);
+    bool rethrown = false;
+    try
+    {
+      recorder.RecordParallel(4, [&](uint32_t, uint32_t first, uint32_t) {
+        recordedRanges++;
+        if (first == 3)
+        {
+          thrownByWorker = std::this_thread::get_id() != caller;
+          throw std::runtime_error("recording failed");
+        }
+      });
+    }
+    catch (const std::runtime_error&)
+    {
+      rethrown = true;
+    }
+    CHECK(rethrown);
+    CHECK(thrownByWorker);
+    CHECK(recordedRanges == 4);
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+TEST_CASE(TooManyListsThrow)
+{
+  MockCommandBackend backend(3);
+  CommandRecorder recorder(&backend, 2, 3);
+  recorder.BeginFrame(0);
+  recorder.OpenSerialList();
+  recorder.OpenSerialList();
+  recorder.OpenSerialList();
+  CHECK_THROWS(recorder.OpenSerialList());
+  CHECK_THROWS(recorder.RecordParallel(10, [](uint32_t, uint32_t, uint32_t) {}));
+  CHECK(recorder.EndFrame() == 3);
+
+  // The parallel ranges are limited by the lists left
+  recorder.BeginFrame(1);
+  recorder.OpenSerialList();
+  recorder.OpenSerialList();
+  CHECK(recorder.RecordParallel(10, [](uint32_t, uint32_t, uint32_t) {}) == 1);
+  CHECK_THROWS(recorder.OpenSerialList());
+  recorder.EndFrame();
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+TEST_CASE(InvalidUsesThrow)
+{
+  MockCommandBackend backend(2);
+  CHECK_THROWS(CommandRecorder(nullptr, 1, 2));
+  CHECK_THROWS(CommandRecorder(&backend, 0, 2));
+  CHECK_THROWS(CommandRecorder(&backend, 1, 0));
+  CommandRecorder recorder(&backend, 1, 2);
+  CHECK_THROWS(recorder.OpenSerialList());
+  CHECK_THROWS(recorder.EndFrame());
+  recorder.BeginFrame(0);
+  CHECK_THROWS(recorder.BeginFrame(1));
+  recorder.EndFrame();
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// The benchmark keeps the draws in order, and reports its throughput for each worker count
+TEST_CASE(RecordingBenchmark)
+{
+  for (uint32_t workerCount : {1u, 2u, 4u, 8u})
+  {
+    const CommandRecordingBenchmarkResult result =
+        RunCommandRecordingBenchmark(workerCount, 2000, 10);
+    CHECK(result.ordered);
+    CHECK(result.workerCount == workerCount);
+    CHECK(result.drawCount == 20000);
+    std::printf("%u workers: %.0f draws/s\n", workerCount, result.GetDrawsPerSecond());
+  }
+}
@@ -0,0 +1,210 @@
+/*
+
+Tests of DeferredReleaseQueue, driven by the fence of a MockFrameQueue.
+
+*/
+
+#include "TestHarness.h"
+
+#include "DeferredReleaseQueue.h"
+#include "FramePacer.h"
+
+#include <vector>
+
+using namespace nv_helpers_dx12;
+
+//--------------------------------------------------------------------------------------------------
+//
+// A release of the current frame waits for the end of the frame, then for its fence value
+TEST_CASE(ReleaseIsHeldUntilItsFenceCompletes)
+{
+  MockFrameQueue queue;
+  DeferredReleaseQueue releases;
+  int releasedCount = 0;
+  releases.Release([&]() { releasedCount++; });
+
+  // The frame is not ended, hence its fence value is unknown
+  CHECK(releases.Retire(queue.GetCompletedValue()) == 0);
+  CHECK(releasedCount == 0);
+
+  const uint64_t fenceValue = queue.Signal();
+  releases.EndFrame(fenceValue);
+  CHECK(releases.Retire(queue.GetCompletedValue()) == 0);
+  CHECK(releasedCount == 0);
+  CHECK(releases.GetPendingCount() == 1);
+
+  queue.Complete(fenceValue);
+  CHECK(releases.Retire(queue.GetCompletedValue()) == 1);
+  CHECK(releasedCount == 1);
+  CHECK(releases.GetPendingCount() == 0);
+
+  // A release is only invoked once
+  CHECK(releases.Retire(queue.GetCompletedValue()) == 0);
+  CHECK(releasedCount == 1);
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Frames paced by a FramePacer with 2 frames in flight, each replacing a resource. A resource is
+// released once the GPU completes the frame which replaced it, and never before
+TEST_CASE(ReleasesFollowThePacedFrames)
+{
+  MockFrameQueue queue;
+  FramePacer pacer(&queue, 2);
+  DeferredReleaseQueue releases;
+  std::vector<uint64_t> frameFenceValues;
+  std::vector<uint64_t> releasedFrames;
+
+  for (uint64_t frame = 0; frame < 8; frame++)
+  {
+    pacer.BeginFrame();
+    releases.Retire(queue.GetCompletedValue());
+    releases.Release([&releasedFrames, &queue, &frameFenceValues, frame]() {
+      // The GPU is done with the frame which replaced the resource
+      CHECK(queue.GetCompletedValue() >= frameFenceValues[frame]);
+      releasedFrames.push_back(frame);
+    });
+    frameFenceValues.push_back(pacer.EndFrame());
+    releases.EndFrame(frameFenceValues.back());
+    // The GPU completes the frames with a latency of one frame
+    if (frame > 0)
+    {
+      queue.Complete(frameFenceValues[frame - 1]);
+    }
+  }
+  // The last frames are still in flight
+  CHECK(releasedFrames.size() == 6);
+  for (size_t i = 0; i < releasedFrames.size(); i++)
+  {
+    CHECK(releasedFrames[i] == i);
+  }
+  CHECK(releases.GetPendingCount() == 2);
+
+  pacer.Flush();
+  CHECK(releases.Retire(queue.GetCompletedValue()) == 2);
+  CHECK(releasedFrames.size() == 8);
+  CHECK(releases.GetStatistics().releaseCount == 8);
+  CHECK(releases.GetStatistics().retiredCount == 8);
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Releases with explicit fence values may be made in any order. The completed value may skip
+// fence values, or go backwards when read from several fences, without releasing too early
+TEST_CASE(RetireWithOutOfOrderAndSkippedFenceValues)
+{
+  DeferredReleaseQueue releases;
+  std::vector<char> order;
+  releases.Release([&]() { order.push_back('a'); }, 5);
+  releases.Release([&]() { order.push_back('b'); }, 2);
+  releases.Release([&]() { order.push_back('c'); }, 8);
+  releases.Release([&]() { order.push_back('d'); }, 2);
+
+  CHECK(releases.Retire(1) == 0);
+  CHECK(releases.Retire(3) == 2);
+  CHECK((order == std::vector<char>{'b', 'd'}));
+
+  // Going backwards releases nothing
+  CHECK(releases.Retire(1) == 0);
+  CHECK(order.size() == 2);
+
+  // Skipping from 3 to 10 releases the remaining values in fence order
+  CHECK(releases.Retire(10) == 2);
+  CHECK((order == std::vector<char>{'b', 'd', 'a', 'c'}));
+  CHECK(releases.GetPendingCount() == 0);
+  CHECK(releases.GetStatistics().peakPendingCount == 4);
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// A frame ending with a value lower than explicit releases does not release them
+TEST_CASE(FrameReleasesAreOrderedWithExplicitReleases)
+{
+  DeferredReleaseQueue releases;
+  std::vector<char> order;
+  releases.Release([&]() { order.push_back('x'); }, 10);
+  releases.Release([&]() { order.push_back('f'); });
+  releases.EndFrame(4);
+
+  CHECK(releases.Retire(4) == 1);
+  CHECK((order == std::vector<char>{'f'}));
+  CHECK(releases.Retire(9) == 0);
+  CHECK(releases.Retire(10) == 1);
+  CHECK((order == std::vector<char>{'f', 'x'}));
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// On shutdown, the GPU being idle, all the releases are invoked, the ones of the current frame
+// included
+TEST_CASE(ReleaseAllOnShutdown)
+{
+  MockFrameQueue queue;
+  DeferredReleaseQueue releases;
+  int releasedCount = 0;
+  releases.Release([&]() { releasedCount++; });
+  releases.EndFrame(queue.Signal());
+  releases.Release([&]() { releasedCount++; }, 100);
+  releases.Release([&]() { releasedCount++; });
+  // An empty function is counted but not invoked
+  releases.Release(DeferredReleaseQueue::ReleaseFunction());
+
+  CHECK(releases.GetPendingCount() == 4);
+  CHECK(releases.ReleaseAll() == 4);
+  CHECK(releasedCount == 3);
+  CHECK(releases.GetPendingCount() == 0);
+  CHECK(releases.ReleaseAll() == 0);
+  CHECK(releases.GetStatistics().retiredCount == 4);
+
+  releases.ResetStatistics();
+  CHECK(releases.GetStatistics().releaseCount == 0);
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// A release may release another resource, such as the heap of the resource, which is then part
+// of the current frame and waits for its fence value
+TEST_CASE(ReleaseQueuingAnotherRelease)
+{
+  MockFrameQueue queue;
+  DeferredReleaseQueue releases;
+  std::vector<char> order;
+  releases.Release([&]() {
+    order.push_back('r');
+    releases.Release([&]() { order.push_back('h'); });
+  });
+  releases.EndFrame(queue.Signal());
+  queue.CompleteAll();
+
+  CHECK(releases.Retire(queue.GetCompletedValue()) == 1);
+  CHECK((order == std::vector<char>{'r'}));
+  CHECK(releases.GetPendingCount() == 1);
+
+  const uint64_t nextFenceValue = queue.Signal();
+  releases.EndFrame(nextFenceValue);
+  CHECK(releases.Retire(queue.GetCompletedValue()) == 0);
+  queue.Complete(nextFenceValue);
+  CHECK(releases.Retire(queue.GetCompletedValue()) == 1);
+  CHECK((order == std::vector<char>{'r', 'h'}));
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// ReleaseAll also invokes the releases queued by the releases it invokes
+TEST_CASE(ReleaseAllInvokesNestedReleases)
+{
+  DeferredReleaseQueue releases;
+  int depth = 0;
+  std::function<void()> release;
+  release = [&]() {
+    if (++depth < 3)
+    {
+      releases.Release(release, 50);
+    }
+  };
+  releases.Release(release);
+
+  CHECK(releases.ReleaseAll() == 3);
+  CHECK(depth == 3);
+  CHECK(releases.GetPendingCount() == 0);
+}
@@ -0,0 +1,90 @@
+/*
+
+Tests of DescriptorFreeList and DescriptorAllocator.
+
+*/
+
+#include "TestHarness.h"
+
+#include "DescriptorAllocator.h"
+#include "FramePacer.h"
+
+using namespace nv_helpers_dx12;
+
+//--------------------------------------------------------------------------------------------------
+//
+// The most recently freed slot is reused first
+TEST_CASE(FreeListReusesFreedSlots)
+{
+  DescriptorFreeList freeList(10, 3);
+  uint32_t a = 0, b = 0, c = 0, d = 0;
+  CHECK(freeList.Allocate(&a) && freeList.Allocate(&b) && freeList.Allocate(&c));
+  CHECK(a >= 10 && a < 13 && b >= 10 && b < 13 && c >= 10 && c < 13);
+  CHECK(a != b && b != c && a != c);
+  CHECK(!freeList.Allocate(&d));
+  CHECK(freeList.GetUsedCount() == 3);
+
+  freeList.Free(b);
+  CHECK(freeList.Allocate(&d) && d == b);
+  freeList.Free(a);
+  freeList.Free(c);
+  CHECK(freeList.GetUsedCount() == 1);
+  CHECK(freeList.GetPeakUsedCount() == 3);
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+TEST_CASE(FreeListRejectsInvalidFrees)
+{
+  DescriptorFreeList freeList(0, 2);
+  uint32_t slot = 0;
+  CHECK(freeList.Allocate(&slot));
+  freeList.Free(slot);
+  CHECK_THROWS(freeList.Free(slot));
+  CHECK_THROWS(freeList.Free(5));
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// The regions follow each other in the heap
+TEST_CASE(RegionsAreLaidOutInOrder)
+{
+  DescriptorAllocator allocator(4, 3, 8);
+  CHECK(allocator.GetCount() == 15);
+  uint32_t slot = 0;
+  CHECK(allocator.AllocateStatic(3, &slot) && slot == 0);
+  CHECK(allocator.AllocateStatic(1, &slot) && slot == 3);
+  CHECK(!allocator.AllocateStatic(1, &slot));
+
+  CHECK(allocator.AllocatePersistent(&slot) && slot >= 4 && slot < 7);
+  allocator.FreePersistent(slot);
+
+  CHECK(allocator.AllocateTransient(2, &slot) && slot == 7);
+  CHECK(allocator.AllocateTransient(2, &slot) && slot == 9);
+
+  const DescriptorStatistics statistics = allocator.GetStatistics();
+  CHECK(statistics.staticUsedCount == 4);
+  CHECK(statistics.persistentUsedCount == 0);
+  CHECK(statistics.persistentPeakUsedCount == 1);
+  CHECK(statistics.transientPeakUsedCount == 4);
+  CHECK(statistics.transientCount == 8);
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// The transient slots of a frame are reused once the GPU completes the frame
+TEST_CASE(TransientSlotsAreRecycledByTheFence)
+{
+  MockFrameQueue queue;
+  DescriptorAllocator allocator(0, 0, 8);
+  uint32_t slot = 0;
+  CHECK(allocator.AllocateTransient(6, &slot) && slot == 0);
+  allocator.EndFrame(queue.Signal());
+  CHECK(!allocator.AllocateTransient(4, &slot));
+  CHECK(!allocator.AllocateTransient(9, &slot));
+
+  queue.CompleteAll();
+  allocator.Retire(queue.GetCompletedValue());
+  CHECK(allocator.AllocateTransient(8, &slot) && slot == 0);
+}
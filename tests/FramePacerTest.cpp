@@ -0,0 +1,101 @@
+/*
+
+Tests of FramePacer, driven by a MockFrameQueue.
+
+*/
+
+#include "TestHarness.h"
+
+#include "FramePacer.h"
+
+#include <vector>
+
+using namespace nv_helpers_dx12;
+
+//--------------------------------------------------------------------------------------------------
+//
+// The slots are used in turn, and the fence values of the frames are the signaled ones
+TEST_CASE(SlotsRotateWithoutStallWhenTheGpuKeepsUp)
+{
+  MockFrameQueue queue;
+  FramePacer pacer(&queue, 3);
+  CHECK(pacer.GetFramesInFlight() == 3);
+  for (uint32_t frame = 0; frame < 9; frame++)
+  {
+    CHECK(pacer.BeginFrame() == frame % 3);
+    CHECK(pacer.GetFrameSlot() == frame % 3);
+    CHECK(pacer.EndFrame() == frame + 1);
+    queue.CompleteAll();
+  }
+  CHECK(queue.GetStalls().empty());
+  CHECK(pacer.GetStatistics().frameCount == 9);
+  CHECK(pacer.GetStatistics().stallCount == 0);
+  CHECK(pacer.GetPendingFrameCount() == 0);
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// With a stalled GPU, the CPU records framesInFlight frames ahead, then waits for the frame
+// which last used the slot, and never for the more recent ones
+TEST_CASE(BeginFrameWaitsForTheOldestFrameOfItsSlot)
+{
+  MockFrameQueue queue;
+  FramePacer pacer(&queue, 2);
+  pacer.BeginFrame();
+  pacer.EndFrame();
+  pacer.BeginFrame();
+  pacer.EndFrame();
+  CHECK(pacer.GetPendingFrameCount() == 2);
+  CHECK(!pacer.IsSlotAvailable(0));
+  CHECK(queue.GetStalls().empty());
+
+  CHECK(pacer.BeginFrame() == 0);
+  CHECK((queue.GetStalls() == std::vector<uint64_t>{1}));
+  CHECK(queue.GetCompletedValue() == 1);
+  CHECK(pacer.IsSlotAvailable(0));
+  CHECK(!pacer.IsSlotAvailable(1));
+  pacer.EndFrame();
+
+  // The GPU completed the second frame in the meantime: no stall
+  queue.Complete(2);
+  CHECK(pacer.BeginFrame() == 1);
+  CHECK(queue.GetStalls().size() == 1);
+  pacer.EndFrame();
+
+  CHECK(pacer.GetStatistics().stallCount == 1);
+  CHECK(pacer.GetStatistics().GetStallRate() == 0.25f);
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+TEST_CASE(FlushCompletesAllTheFrames)
+{
+  MockFrameQueue queue;
+  FramePacer pacer(&queue, 2);
+  pacer.BeginFrame();
+  pacer.EndFrame();
+  pacer.BeginFrame();
+  pacer.EndFrame();
+  pacer.Flush();
+  CHECK(queue.GetCompletedValue() == queue.GetSignaledValue());
+  CHECK(pacer.GetPendingFrameCount() == 0);
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+TEST_CASE(MisuseThrows)
+{
+  MockFrameQueue queue;
+  CHECK_THROWS(FramePacer(nullptr, 2));
+  CHECK_THROWS(FramePacer(&queue, 0));
+
+  FramePacer pacer(&queue, 2);
+  CHECK_THROWS(pacer.EndFrame());
+  pacer.BeginFrame();
+  CHECK_THROWS(pacer.BeginFrame());
+
+  CHECK_THROWS(queue.Wait(queue.GetSignaledValue() + 1));
+  CHECK_THROWS(queue.Complete(queue.GetSignaledValue() + 1));
+}
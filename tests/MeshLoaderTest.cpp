@@ -0,0 +1,322 @@
+/*
+
+Tests of the OBJ and PLY loaders. The fixtures are written to the working directory of the test,
+and a large generated mesh is loaded to report the parsing throughput.
+
+*/
+
+#include "TestHarness.h"
+
+#include "MeshLoader.h"
+#include "SceneGenerator.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace nv_helpers_dx12;
+
+namespace
+{
+void WriteFile(const std::string& fileName, const std::string& contents)
+{
+  std::ofstream file(fileName, std::ios::binary | std::ios::trunc);
+  file.write(contents.data(), contents.size());
+}
+
+// Append a value to a binary PLY body
+template <typename T>
+void AppendValue(std::string& body, T value, bool bigEndian)
+{
+  char bytes[sizeof(T)];
+  memcpy(bytes, &value, sizeof(T));
+  // The tests run on little endian hosts
+  if (bigEndian)
+  {
+    for (size_t i = 0; i < sizeof(T) / 2; i++)
+    {
+      std::swap(bytes[i], bytes[sizeof(T) - 1 - i]);
+    }
+  }
+  body.append(bytes, sizeof(T));
+}
+
+// Binary PLY file with float positions, 8-bit colors and polygons with 32-bit indices
+std::string MakePly(const std::vector<MeshVertex>& vertices,
+                    const std::vector<std::vector<uint32_t>>& faces, bool bigEndian = false)
+{
+  std::string ply = "ply\n";
+  ply += bigEndian ? "format binary_big_endian 1.0\n" : "format binary_little_endian 1.0\n";
+  ply += "comment written by MeshLoaderTest\n";
+  ply += "element vertex " + std::to_string(vertices.size()) + "\n";
+  ply += "property float x\nproperty float y\nproperty float z\n";
+  ply += "property uchar red\nproperty uchar green\nproperty uchar blue\n";
+  ply += "element face " + std::to_string(faces.size()) + "\n";
+  ply += "property list uchar int vertex_indices\n";
+  ply += "end_header\n";
+  for (const MeshVertex& vertex : vertices)
+  {
+    for (int k = 0; k < 3; k++)
+    {
+      AppendValue(ply, vertex.position[k], bigEndian);
+    }
+    for (int k = 0; k < 3; k++)
+    {
+      AppendValue(ply, static_cast<uint8_t>(std::lround(vertex.color[k] * 255.f)), bigEndian);
+    }
+  }
+  for (const std::vector<uint32_t>& face : faces)
+  {
+    AppendValue(ply, static_cast<uint8_t>(face.size()), bigEndian);
+    for (uint32_t index : face)
+    {
+      AppendValue(ply, static_cast<int32_t>(index), bigEndian);
+    }
+  }
+  return ply;
+}
+
+// OBJ text of a mesh, with relative indices if requested
+std::string MakeObj(const Mesh& mesh, bool relative)
+{
+  std::string obj = "# written by MeshLoaderTest\n";
+  char line[256];
+  for (const MeshVertex& vertex : mesh.vertices)
+  {
+    snprintf(line, sizeof(line), "v %.9g %.9g %.9g %.9g %.9g %.9g\n", vertex.position[0],
+             vertex.position[1], vertex.position[2], vertex.color[0], vertex.color[1],
+             vertex.color[2]);
+    obj += line;
+  }
+  const long long vertexCount = static_cast<long long>(mesh.vertices.size());
+  for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+  {
+    long long face[3];
+    for (int k = 0; k < 3; k++)
+    {
+      face[k] = relative ? mesh.indices[i + k] - vertexCount : mesh.indices[i + k] + 1;
+    }
+    snprintf(line, sizeof(line), "f %lld %lld %lld\n", face[0], face[1], face[2]);
+    obj += line;
+  }
+  return obj;
+}
+
+const std::vector<MeshVertex> kQuadVertices = {{{0.f, 0.f, 0.f}, {1.f, 0.f, 0.f, 1.f}},
+                                               {{1.f, 0.f, 0.f}, {0.f, 1.f, 0.f, 1.f}},
+                                               {{1.f, 1.f, 0.f}, {0.f, 0.f, 1.f, 1.f}},
+                                               {{0.f, 1.f, 0.f}, {1.f, 1.f, 1.f, 1.f}}};
+
+bool SamePositions(const Mesh& a, const Mesh& b)
+{
+  if (a.vertices.size() != b.vertices.size())
+  {
+    return false;
+  }
+  for (size_t v = 0; v < a.vertices.size(); v++)
+  {
+    for (int k = 0; k < 3; k++)
+    {
+      if (std::abs(a.vertices[v].position[k] - b.vertices[v].position[k]) > 1e-6f)
+      {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+} // namespace
+
+//--------------------------------------------------------------------------------------------------
+//
+// Relative indices refer to the vertices read so far, polygons are triangulated as fans, and
+// texture coordinates, normals and comments are ignored
+TEST_CASE(ObjRelativeIndicesAndPolygons)
+{
+  WriteFile("relative.obj", "# quad and triangle\n"
+                            "v 0 0 0 1 0 0\n"
+                            "v 1 0 0\n"
+                            "vt 0.5 0.5\n"
+                            "vn 0 0 1\n"
+                            "v 1 1 0\n"
+                            "f -3 -2 -1\n"
+                            "v 0 1 0\n"
+                            "f 1/1/1 3/1/1 4/1/1 2/1/1\n"
+                            "f -4//1 -2//1 -1//1\n");
+  Mesh mesh;
+  CHECK(LoadMesh("relative.obj", &mesh));
+  CHECK(mesh.vertices.size() == 4);
+  CHECK(mesh.indices == std::vector<uint32_t>({0, 1, 2, 0, 2, 3, 0, 3, 1, 0, 2, 3}));
+  CHECK(mesh.vertices[0].color[0] == 1.f && mesh.vertices[0].color[1] == 0.f);
+  CHECK(mesh.vertices[1].color[1] == 1.f && mesh.vertices[1].color[3] == 1.f);
+  CHECK(mesh.vertices[2].position[0] == 1.f && mesh.vertices[2].position[1] == 1.f);
+
+  // Relative indices pointing before the first vertex, and index 0, are invalid
+  WriteFile("before_first.obj", "v 0 0 0\nv 1 0 0\nv 1 1 0\nf -4 -3 -2\n");
+  CHECK(!LoadOBJ("before_first.obj", &mesh));
+  WriteFile("zero_index.obj", "v 0 0 0\nv 1 0 0\nv 1 1 0\nf 0 1 2\n");
+  CHECK(!LoadOBJ("zero_index.obj", &mesh));
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// A large file cut into chunks resolves the relative indices across the chunks, whatever the
+// number of workers
+TEST_CASE(ObjChunksResolveRelativeIndices)
+{
+  const Mesh generated = GenerateMesh(100000, 1);
+  WriteFile("absolute.obj", MakeObj(generated, false));
+  WriteFile("relative_large.obj", MakeObj(generated, true));
+  for (uint32_t workerCount : {1u, 3u, 8u})
+  {
+    Mesh absolute, relative;
+    CHECK(LoadOBJ("absolute.obj", &absolute, nullptr, workerCount));
+    CHECK(LoadOBJ("relative_large.obj", &relative, nullptr, workerCount));
+    CHECK(absolute.indices == generated.indices);
+    CHECK(relative.indices == generated.indices);
+    CHECK(SamePositions(absolute, generated));
+    CHECK(SamePositions(relative, generated));
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Triangles are decoded in parallel, and files with other polygons fall back to the sequential
+// decoding, in both byte orders
+TEST_CASE(PlyTrianglesAndQuadFallback)
+{
+  for (bool bigEndian : {false, true})
+  {
+    Mesh mesh;
+    WriteFile("triangles.ply", MakePly(kQuadVertices, {{0, 1, 2}, {0, 2, 3}}, bigEndian));
+    CHECK(LoadMesh("triangles.ply", &mesh));
+    CHECK(mesh.vertices.size() == 4);
+    CHECK(mesh.indices == std::vector<uint32_t>({0, 1, 2, 0, 2, 3}));
+    CHECK(mesh.vertices[2].position[0] == 1.f && mesh.vertices[2].position[1] == 1.f);
+    CHECK(mesh.vertices[2].color[2] == 1.f && mesh.vertices[2].color[0] == 0.f);
+    CHECK(mesh.vertices[2].color[3] == 1.f);
+
+    WriteFile("quads.ply", MakePly(kQuadVertices, {{0, 1, 2}, {0, 1, 2, 3}, {3, 2, 1}}, bigEndian));
+    CHECK(LoadPLY("quads.ply", &mesh, nullptr, 4));
+    CHECK(mesh.indices == std::vector<uint32_t>({0, 1, 2, 0, 1, 2, 0, 2, 3, 3, 2, 1}));
+
+    // Out-of-range indices are rejected on both paths
+    WriteFile("out_of_range.ply", MakePly(kQuadVertices, {{0, 1, 4}}, bigEndian));
+    CHECK(!LoadPLY("out_of_range.ply", &mesh));
+    WriteFile("out_of_range_quad.ply", MakePly(kQuadVertices, {{0, 1, 2, 4}}, bigEndian));
+    CHECK(!LoadPLY("out_of_range_quad.ply", &mesh));
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Files ending before the data announced by their header, or in the middle of a statement, are
+// malformed
+TEST_CASE(TruncatedFilesAreRejected)
+{
+  Mesh mesh;
+  const std::string ply = MakePly(kQuadVertices, {{0, 1, 2}, {0, 1, 2, 3}});
+  const size_t headerSize = ply.find("end_header\n") + strlen("end_header\n");
+  const size_t vertexDataSize = 4 * 15;
+  for (size_t size : {headerSize - 1, headerSize + vertexDataSize - 1, headerSize + vertexDataSize,
+                      ply.size() - 1})
+  {
+    WriteFile("truncated.ply", ply.substr(0, size));
+    CHECK(!LoadPLY("truncated.ply", &mesh));
+  }
+  WriteFile("complete.ply", ply);
+  CHECK(LoadPLY("complete.ply", &mesh));
+
+  WriteFile("truncated_vertex.obj", "v 0 0 0\nv 1 0 0\nv 1 1");
+  CHECK(!LoadOBJ("truncated_vertex.obj", &mesh));
+  WriteFile("truncated_face.obj", "v 0 0 0\nv 1 0 0\nv 1 1 0\nf 1 2");
+  CHECK(!LoadOBJ("truncated_face.obj", &mesh));
+  WriteFile("empty.ply", "");
+  CHECK(!LoadPLY("empty.ply", &mesh));
+  CHECK(!LoadMesh("missing.obj", &mesh));
+  CHECK(!LoadMesh("relative.stl", &mesh));
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// The parser reads the numbers written by printf
+TEST_CASE(ParseFloatFormats)
+{
+  const char* numbers[] = {"0", "-1.5", "+2", ".25", "3.", "1e3", "-2.5E-3", "123456789012345678901",
+                           "0.000001"};
+  for (const char* number : numbers)
+  {
+    float value = 0.f;
+    const char* end = number + strlen(number);
+    CHECK(ParseFloat(number, end, &value) == end);
+    const float expected = std::strtof(number, nullptr);
+    CHECK(std::abs(value - expected) <= 1e-6f * std::abs(expected));
+  }
+  float value = 0.f;
+  const char* notANumber = "-x";
+  CHECK(ParseFloat(notANumber, notANumber + 2, &value) == nullptr);
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Load a large generated mesh in both formats and report the parsing throughput
+TEST_CASE(LoadingThroughput)
+{
+  const Mesh generated = GenerateMesh(400000, 2);
+  std::vector<std::vector<uint32_t>> faces;
+  for (size_t i = 0; i + 2 < generated.indices.size(); i += 3)
+  {
+    faces.push_back({generated.indices[i], generated.indices[i + 1], generated.indices[i + 2]});
+  }
+  WriteFile("throughput.obj", MakeObj(generated, false));
+  WriteFile("throughput.ply", MakePly(generated.vertices, faces));
+
+  for (const char* fileName : {"throughput.obj", "throughput.ply"})
+  {
+    Mesh mesh;
+    MeshLoadStatistics statistics;
+    CHECK(LoadMesh(fileName, &mesh, &statistics));
+    CHECK(mesh.indices == generated.indices);
+    CHECK(SamePositions(mesh, generated));
+    CHECK(statistics.fileSizeInBytes > 0);
+    std::printf("%s: %.1f MB in %.3f s, %.1f MB/s\n", fileName,
+                statistics.fileSizeInBytes / (1024. * 1024.), statistics.seconds,
+                statistics.GetThroughput() / (1024. * 1024.));
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Malformed headers are rejected instead of throwing or dividing by zero
+TEST_CASE(MalformedPlyHeadersAreRejected)
+{
+  const std::string format = "ply\nformat binary_little_endian 1.0\n";
+  const std::string face = "element face 1\nproperty list uchar int vertex_indices\n";
+  const std::string body = "end_header\n" + std::string(64, '\0');
+  Mesh mesh;
+
+  // Element counts which are not plain decimal numbers, or overflow
+  const char* counts[] = {"abc", "12abc", "-1", "+3", "99999999999999999999999"};
+  for (const char* count : counts)
+  {
+    WriteFile("bad_count.ply", format + "element vertex " + count +
+                                   "\nproperty float x\nproperty float y\nproperty float z\n" +
+                                   face + body);
+    CHECK(!LoadPLY("bad_count.ply", &mesh));
+  }
+
+  // Vertices without properties have no size
+  WriteFile("no_vertex_property.ply", format + "element vertex 3\n" + face + body);
+  CHECK(!LoadPLY("no_vertex_property.ply", &mesh));
+
+  WriteFile("ascii.ply", "ply\nformat ascii 1.0\nelement vertex 0\nend_header\n");
+  CHECK(!LoadPLY("ascii.ply", &mesh));
+  WriteFile("no_format.ply", "ply\nelement vertex 0\nproperty float x\nend_header\n");
+  CHECK(!LoadPLY("no_format.ply", &mesh));
+  WriteFile("bad_type.ply", format + "element vertex 1\nproperty half x\nend_header\n");
+  CHECK(!LoadPLY("bad_type.ply", &mesh));
+}
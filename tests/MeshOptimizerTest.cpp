@@ -0,0 +1,187 @@
+/*
+
+Tests of the vertex cache, overdraw and vertex fetch optimizations, on generated meshes whose
+triangles and vertices are shuffled.
+
+*/
+
+#include "TestHarness.h"
+
+#include "MeshOptimizer.h"
+#include "SceneGenerator.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <numeric>
+#include <random>
+#include <vector>
+
+using namespace nv_helpers_dx12;
+
+namespace
+{
+using Triangle = std::array<float, 9>;
+
+// Shuffle the triangles and the vertices of a mesh, which ruins its vertex cache efficiency
+Mesh ShuffleMesh(const Mesh& mesh, uint32_t seed)
+{
+  std::mt19937 random(seed);
+  const size_t triangleCount = mesh.indices.size() / 3;
+  std::vector<size_t> triangleOrder(triangleCount);
+  std::iota(triangleOrder.begin(), triangleOrder.end(), size_t(0));
+  std::shuffle(triangleOrder.begin(), triangleOrder.end(), random);
+  std::vector<uint32_t> vertexOrder(mesh.vertices.size());
+  std::iota(vertexOrder.begin(), vertexOrder.end(), 0u);
+  std::shuffle(vertexOrder.begin(), vertexOrder.end(), random);
+
+  Mesh shuffled;
+  shuffled.vertices.resize(mesh.vertices.size());
+  for (size_t v = 0; v < mesh.vertices.size(); v++)
+  {
+    shuffled.vertices[vertexOrder[v]] = mesh.vertices[v];
+  }
+  for (size_t t : triangleOrder)
+  {
+    for (size_t k = 0; k < 3; k++)
+    {
+      shuffled.indices.push_back(vertexOrder[mesh.indices[3 * t + k]]);
+    }
+  }
+  return shuffled;
+}
+
+// Positions of the triangles, each rotated to start with its smallest vertex so that the
+// comparison keeps the winding, sorted
+std::vector<Triangle> GetTriangles(const Mesh& mesh)
+{
+  std::vector<Triangle> triangles;
+  for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+  {
+    std::array<Triangle, 3> rotations;
+    for (size_t r = 0; r < 3; r++)
+    {
+      for (size_t k = 0; k < 3; k++)
+      {
+        memcpy(&rotations[r][3 * k], mesh.vertices[mesh.indices[i + (r + k) % 3]].position,
+               3 * sizeof(float));
+      }
+    }
+    triangles.push_back(*std::min_element(rotations.begin(), rotations.end()));
+  }
+  std::sort(triangles.begin(), triangles.end());
+  return triangles;
+}
+
+VertexCacheStatistics Analyze(const Mesh& mesh)
+{
+  return AnalyzeVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.vertices.size());
+}
+} // namespace
+
+//--------------------------------------------------------------------------------------------------
+//
+// The optimized mesh draws the same triangles, with the same winding, at a lower ACMR, and only
+// keeps the referenced vertices
+TEST_CASE(OptimizeMeshKeepsTheTriangles)
+{
+  const Mesh shuffled = ShuffleMesh(GenerateMesh(5000, 1), 7);
+  Mesh mesh = shuffled;
+  OptimizeMesh(&mesh);
+
+  const VertexCacheStatistics before = Analyze(shuffled);
+  const VertexCacheStatistics after = Analyze(mesh);
+  CHECK(mesh.indices.size() == shuffled.indices.size());
+  CHECK(mesh.vertices.size() == before.referencedVertexCount);
+  CHECK(after.referencedVertexCount == before.referencedVertexCount);
+  CHECK(GetTriangles(mesh) == GetTriangles(shuffled));
+  CHECK(after.GetACMR() < before.GetACMR());
+  CHECK(after.GetACMR() < 1.f);
+  CHECK(after.GetHitRate() > before.GetHitRate());
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// The cache simulation counts a miss per new vertex, and a hit per reuse within the cache
+TEST_CASE(AnalyzeCountsTheCacheMisses)
+{
+  const uint32_t indices[] = {0, 1, 2, 2, 1, 3, 4, 5, 6};
+  const VertexCacheStatistics statistics = AnalyzeVertexCache(indices, 9, 8);
+  CHECK(statistics.indexCount == 9);
+  CHECK(statistics.referencedVertexCount == 7);
+  CHECK(statistics.transformedVertexCount == 7);
+  CHECK(statistics.GetACMR() == 7.f / 3.f);
+  CHECK(statistics.GetATVR() == 1.f);
+
+  // A cache of 3 entries has evicted vertex 0 by the time it is used again
+  const uint32_t reused[] = {0, 1, 2, 3, 4, 5, 0, 4, 5};
+  CHECK(AnalyzeVertexCache(reused, 9, 6, 3).transformedVertexCount == 7);
+  CHECK(AnalyzeVertexCache(reused, 9, 6, 16).transformedVertexCount == 6);
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// The vertices are renumbered in the order of their first use, and the unreferenced ones dropped
+TEST_CASE(OptimizeVertexFetchDropsUnreferencedVertices)
+{
+  std::vector<MeshVertex> vertices(6);
+  for (size_t v = 0; v < vertices.size(); v++)
+  {
+    vertices[v] = {{static_cast<float>(v), 0.f, 0.f}, {1.f, 1.f, 1.f, 1.f}};
+  }
+  uint32_t indices[] = {4, 2, 5, 5, 2, 0};
+  CHECK(OptimizeVertexFetch(&vertices, indices, 6) == 4);
+  CHECK(vertices.size() == 4);
+  const uint32_t expectedIndices[] = {0, 1, 2, 2, 1, 3};
+  CHECK(std::equal(indices, indices + 6, expectedIndices));
+  const float expectedPositions[] = {4.f, 2.f, 5.f, 0.f};
+  for (size_t v = 0; v < vertices.size(); v++)
+  {
+    CHECK(vertices[v].position[0] == expectedPositions[v]);
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// The meshes optimized in parallel match the ones optimized with a single worker
+TEST_CASE(ParallelOptimizationMatchesSerial)
+{
+  std::vector<Mesh> meshes;
+  for (uint32_t seed = 0; seed < 6; seed++)
+  {
+    meshes.push_back(ShuffleMesh(GenerateMesh(1000 + 300 * seed, seed), seed));
+  }
+  std::vector<Mesh> serial = meshes;
+  VertexCacheStatistics serialBefore, serialAfter;
+  OptimizeMeshes(&serial, 1, &serialBefore, &serialAfter);
+
+  for (uint32_t workerCount : {2u, 4u, 8u})
+  {
+    std::vector<Mesh> parallel = meshes;
+    VertexCacheStatistics before, after;
+    OptimizeMeshes(&parallel, workerCount, &before, &after);
+    for (size_t m = 0; m < meshes.size(); m++)
+    {
+      CHECK(parallel[m].indices == serial[m].indices);
+      CHECK(parallel[m].vertices.size() == serial[m].vertices.size());
+      CHECK(memcmp(parallel[m].vertices.data(), serial[m].vertices.data(),
+                   serial[m].vertices.size() * sizeof(MeshVertex)) == 0);
+    }
+    CHECK(before.transformedVertexCount == serialBefore.transformedVertexCount);
+    CHECK(after.transformedVertexCount == serialAfter.transformedVertexCount);
+  }
+  CHECK(serialAfter.GetACMR() < serialBefore.GetACMR());
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Meshes with out-of-range indices are left untouched
+TEST_CASE(InvalidMeshesAreLeftUntouched)
+{
+  Mesh mesh = GenerateMesh(100, 3);
+  mesh.indices[5] = static_cast<uint32_t>(mesh.vertices.size());
+  const Mesh original = mesh;
+  OptimizeMesh(&mesh);
+  CHECK(mesh.indices == original.indices);
+  CHECK(mesh.vertices.size() == original.vertices.size());
+}
@@ -0,0 +1,134 @@
+/*
+
+Tests of the mesh simplification and of the LOD chains, on generated meshes.
+
+*/
+
+#include "TestHarness.h"
+
+#include "MeshSimplifier.h"
+#include "SceneGenerator.h"
+
+#include <algorithm>
+
+using namespace nv_helpers_dx12;
+
+namespace
+{
+float GetExtent(const Mesh& mesh)
+{
+  float extent = 0.f;
+  for (int k = 0; k < 3; k++)
+  {
+    float lower = mesh.vertices[0].position[k];
+    float upper = lower;
+    for (const MeshVertex& vertex : mesh.vertices)
+    {
+      lower = std::min(lower, vertex.position[k]);
+      upper = std::max(upper, vertex.position[k]);
+    }
+    extent = std::max(extent, upper - lower);
+  }
+  return extent;
+}
+} // namespace
+
+//--------------------------------------------------------------------------------------------------
+//
+// The simplified indices reference the original vertices, and reach the target count when the
+// error allows it
+TEST_CASE(SimplifyReachesTheTarget)
+{
+  const Mesh mesh = GenerateMesh(2000, 1);
+  float error = -1.f;
+  const std::vector<uint32_t> indices =
+      SimplifyMesh(mesh.vertices.data(), mesh.vertices.size(), mesh.indices.data(),
+                   mesh.indices.size(), 1000 * 3, 1.f, 1.f, &error);
+  CHECK(indices.size() % 3 == 0);
+  CHECK(indices.size() <= 1000 * 3);
+  CHECK(indices.size() > 0);
+  CHECK(error >= 0.f && error <= 1.f);
+  for (uint32_t index : indices)
+  {
+    CHECK(index < mesh.vertices.size());
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// A zero error budget only allows the collapses which do not change the surface
+TEST_CASE(SimplifyRespectsTheMaximumError)
+{
+  const Mesh mesh = GenerateMesh(2000, 2);
+  float error = -1.f;
+  SimplifyMesh(mesh.vertices.data(), mesh.vertices.size(), mesh.indices.data(),
+               mesh.indices.size(), 3, 0.01f, 1.f, &error);
+  CHECK(error <= 0.01f);
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Each level reduces the triangle count, and the error of the coarsest level stays within the
+// budget of the description, even though the errors of the levels accumulate
+TEST_CASE(LodChainStaysWithinTheErrorBudget)
+{
+  const Mesh mesh = GenerateMesh(8000, 3);
+  const float extent = GetExtent(mesh);
+  for (float maxError : {0.01f, 0.05f, 0.1f, 0.5f})
+  {
+    LodChainDesc desc;
+    desc.maxError = maxError;
+    desc.maxLodCount = 8;
+    const LodChain chain = BuildLodChain(mesh, desc);
+    CHECK(!chain.lods.empty());
+    CHECK(chain.lods[0].indices == mesh.indices);
+    CHECK(chain.lods[0].error == 0.f);
+    for (size_t lod = 1; lod < chain.lods.size(); lod++)
+    {
+      CHECK(chain.lods[lod].GetTriangleCount() < chain.lods[lod - 1].GetTriangleCount());
+      CHECK(chain.lods[lod].error >= chain.lods[lod - 1].error);
+    }
+    CHECK(chain.lods.back().error <= maxError * extent * 1.0001f);
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// The chains built in parallel match the ones built one by one
+TEST_CASE(ParallelChainsMatchSerialOnes)
+{
+  std::vector<Mesh> meshes;
+  for (uint64_t seed = 0; seed < 4; seed++)
+  {
+    meshes.push_back(GenerateMesh(1000, seed));
+  }
+  const std::vector<LodChain> chains = BuildLodChains(meshes, 3);
+  CHECK(chains.size() == meshes.size());
+  for (size_t m = 0; m < meshes.size(); m++)
+  {
+    const LodChain chain = BuildLodChain(meshes[m]);
+    CHECK(chains[m].lods.size() == chain.lods.size());
+    for (size_t lod = 0; lod < std::min(chain.lods.size(), chains[m].lods.size()); lod++)
+    {
+      CHECK(chains[m].lods[lod].indices == chain.lods[lod].indices);
+    }
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Distant instances use coarser levels, and an instance containing the camera the full detail
+TEST_CASE(SelectLodDependsOnTheDistance)
+{
+  const LodChain chain = BuildLodChain(GenerateMesh(4000, 4));
+  CHECK(chain.lods.size() > 1);
+  const float identity[3][4] = {{1.f, 0.f, 0.f, 0.f}, {0.f, 1.f, 0.f, 0.f}, {0.f, 0.f, 1.f, 0.f}};
+  const float inside[3] = {chain.center[0], chain.center[1], chain.center[2]};
+  const float near[3] = {chain.center[0], chain.center[1], chain.center[2] + 2.f};
+  const float far[3] = {chain.center[0], chain.center[1], chain.center[2] + 1000.f};
+  CHECK(SelectLod(chain, identity, inside, 1080.f, 1.f) == 0);
+  const uint32_t nearLod = SelectLod(chain, identity, near, 1080.f, 1.f);
+  const uint32_t farLod = SelectLod(chain, identity, far, 1080.f, 1.f);
+  CHECK(nearLod <= farLod);
+  CHECK(farLod == chain.lods.size() - 1);
+}
@@ -0,0 +1,222 @@
+/*
+
+Tests of the meshlets and of their culling data, on generated meshes and on a flat grid.
+
+*/
+
+#include "TestHarness.h"
+
+#include "MeshletBuilder.h"
+#include "SceneGenerator.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <vector>
+
+using namespace nv_helpers_dx12;
+
+namespace
+{
+// Square grid of cellCount x cellCount cells in the z = 0 plane, spanning [-1, 1], whose
+// triangles face +z
+Mesh MakeGrid(uint32_t cellCount)
+{
+  Mesh mesh;
+  const float step = 2.f / cellCount;
+  for (uint32_t j = 0; j <= cellCount; j++)
+  {
+    for (uint32_t i = 0; i <= cellCount; i++)
+    {
+      mesh.vertices.push_back({{i * step - 1.f, j * step - 1.f, 0.f}, {1.f, 1.f, 1.f, 1.f}});
+    }
+  }
+  for (uint32_t j = 0; j < cellCount; j++)
+  {
+    for (uint32_t i = 0; i < cellCount; i++)
+    {
+      const uint32_t v00 = j * (cellCount + 1) + i;
+      const uint32_t v10 = v00 + 1;
+      const uint32_t v01 = v00 + cellCount + 1;
+      const uint32_t v11 = v01 + 1;
+      const uint32_t quad[6] = {v00, v10, v11, v00, v11, v01};
+      mesh.indices.insert(mesh.indices.end(), quad, quad + 6);
+    }
+  }
+  return mesh;
+}
+
+// Triangles of the meshlets, as indices into the vertices of the mesh
+std::vector<std::array<uint32_t, 3>> GetMeshletTriangles(const MeshletMesh& meshlets)
+{
+  std::vector<std::array<uint32_t, 3>> triangles;
+  for (const Meshlet& meshlet : meshlets.meshlets)
+  {
+    for (uint32_t t = 0; t < meshlet.triangleCount; t++)
+    {
+      std::array<uint32_t, 3> triangle;
+      for (uint32_t k = 0; k < 3; k++)
+      {
+        const uint8_t local = meshlets.triangles[meshlet.triangleOffset + 3 * t + k];
+        triangle[k] = meshlets.vertices[meshlet.vertexOffset + local];
+      }
+      triangles.push_back(triangle);
+    }
+  }
+  return triangles;
+}
+
+std::vector<std::array<uint32_t, 3>> GetMeshTriangles(const Mesh& mesh)
+{
+  std::vector<std::array<uint32_t, 3>> triangles;
+  for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+  {
+    triangles.push_back({{mesh.indices[i], mesh.indices[i + 1], mesh.indices[i + 2]}});
+  }
+  return triangles;
+}
+} // namespace
+
+//--------------------------------------------------------------------------------------------------
+//
+// The meshlets respect the limits, reference valid vertices, and together contain each triangle
+// of the mesh exactly once, with its winding
+TEST_CASE(MeshletsCoverTheMeshWithinTheLimits)
+{
+  for (uint64_t seed = 0; seed < 3; seed++)
+  {
+    const Mesh mesh = GenerateMesh(3000 + 1000 * static_cast<uint32_t>(seed), seed);
+    const MeshletMesh meshlets = BuildMeshlets(mesh);
+    CHECK(!meshlets.meshlets.empty());
+    for (const Meshlet& meshlet : meshlets.meshlets)
+    {
+      CHECK(meshlet.vertexCount > 0 && meshlet.vertexCount <= kMaxMeshletVertices);
+      CHECK(meshlet.triangleCount > 0 && meshlet.triangleCount <= kMaxMeshletTriangles);
+      CHECK(meshlet.vertexOffset + meshlet.vertexCount <= meshlets.vertices.size());
+      CHECK(meshlet.triangleOffset + 3 * meshlet.triangleCount <= meshlets.triangles.size());
+      for (uint32_t i = 0; i < 3 * meshlet.triangleCount; i++)
+      {
+        CHECK(meshlets.triangles[meshlet.triangleOffset + i] < meshlet.vertexCount);
+      }
+      for (uint32_t v = 0; v < meshlet.vertexCount; v++)
+      {
+        CHECK(meshlets.vertices[meshlet.vertexOffset + v] < mesh.vertices.size());
+      }
+    }
+    CHECK(meshlets.GetTriangleCount() == mesh.GetTriangleCount());
+
+    std::vector<std::array<uint32_t, 3>> expected = GetMeshTriangles(mesh);
+    std::vector<std::array<uint32_t, 3>> triangles = GetMeshletTriangles(meshlets);
+    std::sort(expected.begin(), expected.end());
+    std::sort(triangles.begin(), triangles.end());
+    CHECK(triangles == expected);
+  }
+
+  // Smaller limits are respected as well
+  const MeshletMesh small = BuildMeshlets(GenerateMesh(1000, 5), 32, 40);
+  for (const Meshlet& meshlet : small.meshlets)
+  {
+    CHECK(meshlet.vertexCount <= 32 && meshlet.triangleCount <= 40);
+  }
+  CHECK(small.GetTriangleCount() == 1000);
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Each vertex of a meshlet lies within its bounding sphere
+TEST_CASE(BoundingSpheresContainTheVertices)
+{
+  const Mesh mesh = GenerateMesh(5000, 9);
+  const MeshletMesh meshlets = BuildMeshlets(mesh);
+  for (const Meshlet& meshlet : meshlets.meshlets)
+  {
+    for (uint32_t v = 0; v < meshlet.vertexCount; v++)
+    {
+      const float* position = mesh.vertices[meshlets.vertices[meshlet.vertexOffset + v]].position;
+      const float d[3] = {position[0] - meshlet.center[0], position[1] - meshlet.center[1],
+                          position[2] - meshlet.center[2]};
+      CHECK(std::sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]) <= meshlet.radius * 1.0001f + 1e-6f);
+    }
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// The meshlets of a flat grid are all back-face culled from behind, and all visible from the front
+TEST_CASE(FlatGridIsConeCulledFromBehind)
+{
+  const Mesh grid = MakeGrid(64);
+  const MeshletMesh meshlets = BuildMeshlets(grid);
+  CHECK(meshlets.meshlets.size() > 1);
+  for (const Meshlet& meshlet : meshlets.meshlets)
+  {
+    CHECK(std::abs(meshlet.coneAxis[2] - 1.f) < 1e-4f);
+    CHECK(meshlet.coneCutoff < 1e-3f);
+  }
+
+  const float center[3] = {0.f, 0.f, 0.f};
+  const float up[3] = {0.f, 1.f, 0.f};
+  const float front[3] = {0.f, 0.f, 5.f};
+  const float behind[3] = {0.f, 0.f, -5.f};
+  const float fovY = 1.5707963f;
+
+  MeshletCullingStatistics statistics;
+  std::vector<uint32_t> visible;
+  CullMeshlets(meshlets, MakeCullingCamera(front, center, up, fovY, 1.f, 0.1f, 100.f), &visible,
+               &statistics);
+  CHECK(visible.size() == meshlets.meshlets.size());
+  CHECK(statistics.visibleTriangleCount == grid.GetTriangleCount());
+
+  visible.clear();
+  statistics = MeshletCullingStatistics();
+  CullMeshlets(meshlets, MakeCullingCamera(behind, center, up, fovY, 1.f, 0.1f, 100.f), &visible,
+               &statistics);
+  CHECK(visible.empty());
+  CHECK(statistics.meshletCount == meshlets.meshlets.size());
+  CHECK(statistics.GetCulledTriangleFraction() == 1.f);
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Meshlets outside of the frustum are culled whatever their orientation
+TEST_CASE(FrustumCulling)
+{
+  const MeshletMesh meshlets = BuildMeshlets(MakeGrid(16));
+  const float eye[3] = {0.f, 0.f, 5.f};
+  const float awayCenter[3] = {0.f, 0.f, 10.f};
+  const float up[3] = {0.f, 1.f, 0.f};
+  std::vector<uint32_t> visible;
+  CullMeshlets(meshlets, MakeCullingCamera(eye, awayCenter, up, 1.f, 1.f, 0.1f, 100.f), &visible);
+  CHECK(visible.empty());
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// The meshlets built in parallel match the ones built one by one
+TEST_CASE(ParallelMeshletsMatchSerialOnes)
+{
+  std::vector<Mesh> meshes;
+  for (uint64_t seed = 0; seed < 5; seed++)
+  {
+    meshes.push_back(GenerateMesh(2000, seed));
+  }
+  const std::vector<MeshletMesh> parallel = BuildMeshlets(meshes, 4);
+  CHECK(parallel.size() == meshes.size());
+  for (size_t m = 0; m < std::min(parallel.size(), meshes.size()); m++)
+  {
+    const MeshletMesh serial = BuildMeshlets(meshes[m]);
+    CHECK(parallel[m].vertices == serial.vertices);
+    CHECK(parallel[m].triangles == serial.triangles);
+    CHECK(parallel[m].meshlets.size() == serial.meshlets.size());
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+TEST_CASE(InvalidLimitsThrow)
+{
+  const Mesh mesh = GenerateMesh(10, 0);
+  CHECK_THROWS(BuildMeshlets(mesh, kMaxMeshletVertices + 1, kMaxMeshletTriangles));
+  CHECK_THROWS(BuildMeshlets(mesh, kMaxMeshletVertices, kMaxMeshletTriangles + 1));
+}
@@ -0,0 +1,173 @@
+/*
+
+Tests of PipelineDescription and PipelineCache. The cache entries are written to the working
+directory of the test.
+
+*/
+
+#include "TestHarness.h"
+
+#include "PipelineCache.h"
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace nv_helpers_dx12;
+
+namespace
+{
+const char* kCacheDirectory = "PipelineCacheTest_cache";
+
+PipelineDescription MakeRaytracingDescription()
+{
+  PipelineDescription description("raytracing");
+  description.AddLibrary("0123", {L"RayGen"});
+  description.AddLibrary("4567", {L"Miss", L"ShadowMiss"});
+  description.AddHitGroup(L"HitGroup", L"ClosestHit", L"", L"");
+  description.AddRootSignatureAssociation("89ab", {L"HitGroup", L"Miss"});
+  description.AddValue("maxRecursionDepth", 2);
+  return description;
+}
+} // namespace
+
+//--------------------------------------------------------------------------------------------------
+//
+// The description does not depend on the order of the records, nor of the symbols
+TEST_CASE(DescriptionIsCanonical)
+{
+  PipelineDescription reordered("raytracing");
+  reordered.AddValue("maxRecursionDepth", 2);
+  reordered.AddRootSignatureAssociation("89ab", {L"Miss", L"HitGroup"});
+  reordered.AddHitGroup(L"HitGroup", L"ClosestHit", L"", L"");
+  reordered.AddLibrary("4567", {L"ShadowMiss", L"Miss"});
+  reordered.AddLibrary("0123", {L"RayGen"});
+
+  const PipelineDescription description = MakeRaytracingDescription();
+  CHECK(description.GetText() == reordered.GetText());
+  CHECK(description.GetKey() == reordered.GetKey());
+  CHECK(description.GetKey().size() == 32);
+  CHECK(description.GetText().compare(0, 11, "raytracing\n") == 0);
+
+  // The type, a symbol or a value change the key
+  PipelineDescription graphics("graphics");
+  CHECK(graphics.GetKey() != PipelineDescription("raytracing").GetKey());
+  PipelineDescription deeper = MakeRaytracingDescription();
+  deeper.AddValue("maxRecursionDepth", 3);
+  CHECK(deeper.GetKey() != description.GetKey());
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// The separators are escaped, so that fields and symbols cannot merge
+TEST_CASE(FieldsAreEscaped)
+{
+  PipelineDescription a("graphics");
+  a.AddValue("name", "a b");
+  PipelineDescription b("graphics");
+  b.AddValue("name a", "b");
+  CHECK(a.GetText() != b.GetText());
+
+  PipelineDescription empty("graphics");
+  empty.AddValue("name", "");
+  PipelineDescription dash("graphics");
+  dash.AddValue("name", "-");
+  CHECK(empty.GetText() != dash.GetText());
+
+  PipelineDescription one("raytracing");
+  one.AddLibrary("0", {L"A B"});
+  PipelineDescription two("raytracing");
+  two.AddLibrary("0", {L"A", L"B"});
+  CHECK(one.GetText() != two.GetText());
+
+  const std::vector<uint8_t> bytes = {1, 2, 3};
+  PipelineDescription withBytes("graphics");
+  withBytes.AddBytes("vs", bytes.data(), bytes.size());
+  CHECK(withBytes.GetText().find(PipelineDescription::ComputeContentKey(bytes.data(), 3)) !=
+        std::string::npos);
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// A stored blob is found by an identical description, and a rejected one is removed
+TEST_CASE(StoreFindAndReject)
+{
+  PipelineCache cache(kCacheDirectory);
+  const PipelineDescription description = MakeRaytracingDescription();
+  std::remove(cache.GetEntryPath(description.GetKey()).c_str());
+
+  std::vector<uint8_t> blob = {9};
+  CHECK(!cache.Find(description, &blob));
+  CHECK(blob.empty());
+
+  const std::vector<uint8_t> stored = {1, 2, 3, 4, 5};
+  CHECK(cache.Store(description, stored));
+  CHECK(cache.Find(MakeRaytracingDescription(), &blob));
+  CHECK(blob == stored);
+
+  // The next launch finds the entry as well
+  PipelineCache nextCache(kCacheDirectory);
+  CHECK(nextCache.Find(description, &blob) && blob == stored);
+
+  // An empty blob is a valid entry
+  CHECK(cache.Store(description, std::vector<uint8_t>()));
+  CHECK(cache.Find(description, &blob) && blob.empty());
+
+  cache.Reject(description);
+  CHECK(!cache.Find(description, &blob));
+
+  const PipelineCacheStatistics& statistics = cache.GetStatistics();
+  CHECK(statistics.hitCount == 2);
+  CHECK(statistics.missCount == 2);
+  CHECK(statistics.rejectedCount == 1);
+  CHECK(statistics.storeFailureCount == 0);
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// An entry whose stored description differs from the one looked up, as with a hash collision,
+// or a truncated entry, is a miss
+TEST_CASE(MismatchingEntriesAreMisses)
+{
+  PipelineCache cache(kCacheDirectory);
+  PipelineDescription description("graphics");
+  description.AddValue("topology", 3);
+  PipelineDescription other("graphics");
+  other.AddValue("topology", 4);
+
+  // Store the entry of another description under the key of the description
+  CHECK(cache.Store(other, {1, 2, 3}));
+  std::remove(cache.GetEntryPath(description.GetKey()).c_str());
+  CHECK(std::rename(cache.GetEntryPath(other.GetKey()).c_str(),
+                    cache.GetEntryPath(description.GetKey()).c_str()) == 0);
+  std::vector<uint8_t> blob;
+  CHECK(!cache.Find(description, &blob));
+
+  // Truncate the entry
+  CHECK(cache.Store(description, {1, 2, 3}));
+  {
+    std::ifstream file(cache.GetEntryPath(description.GetKey()), std::ios::binary);
+    std::string contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    file.close();
+    std::ofstream truncated(cache.GetEntryPath(description.GetKey()),
+                            std::ios::binary | std::ios::trunc);
+    truncated.write(contents.data(), contents.size() - 1);
+  }
+  CHECK(!cache.Find(description, &blob));
+  CHECK(blob.empty());
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+TEST_CASE(DisabledCacheMisses)
+{
+  PipelineCache cache("");
+  CHECK(!cache.IsEnabled());
+  const PipelineDescription description = MakeRaytracingDescription();
+  CHECK(!cache.Store(description, {1}));
+  std::vector<uint8_t> blob;
+  CHECK(!cache.Find(description, &blob));
+  CHECK(cache.GetStatistics().missCount == 1);
+}
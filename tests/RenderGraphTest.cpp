@@ -0,0 +1,320 @@
+/*
+
+Tests of the culling, the aliasing and the barriers of RenderGraph. The barriers are collected
+from the ResourceStateTracker at each flush requested by the execution.
+
+*/
+
+#include "TestHarness.h"
+
+#include "RenderGraph.h"
+
+#include <string>
+#include <vector>
+
+using namespace nv_helpers_dx12;
+
+namespace
+{
+// Values of the D3D12_RESOURCE_STATES used by the tests
+const uint32_t kCommon = 0x0;
+const uint32_t kRenderTarget = 0x4;
+const uint32_t kUnorderedAccess = 0x8;
+const uint32_t kPixelShaderResource = 0x80;
+const uint32_t kCopyDest = 0x400;
+const uint32_t kCopySource = 0x800;
+
+const uint64_t kSize = 1 << 20;
+const uint64_t kAlignment = 65536;
+
+const uint32_t kAll = ResourceStateTracker::kAllSubresources;
+
+// Index of the first barrier matching the arguments in a batch, or -1
+int FindTransition(const std::vector<ResourceBarrierDesc>& barriers, void* resource,
+                   uint32_t stateBefore, uint32_t stateAfter, ResourceBarrierDesc::Split split)
+{
+  for (size_t i = 0; i < barriers.size(); i++)
+  {
+    const ResourceBarrierDesc& barrier = barriers[i];
+    if (barrier.type == ResourceBarrierDesc::Type::Transition && barrier.split == split &&
+        barrier.resource == resource && barrier.subresource == kAll &&
+        barrier.stateBefore == stateBefore && barrier.stateAfter == stateAfter)
+    {
+      return static_cast<int>(i);
+    }
+  }
+  return -1;
+}
+
+int FindAliasing(const std::vector<ResourceBarrierDesc>& barriers, void* resource)
+{
+  for (size_t i = 0; i < barriers.size(); i++)
+  {
+    if (barriers[i].type == ResourceBarrierDesc::Type::Aliasing && barriers[i].resource == resource)
+    {
+      return static_cast<int>(i);
+    }
+  }
+  return -1;
+}
+} // namespace
+
+//--------------------------------------------------------------------------------------------------
+//
+// A pass whose output is never read is culled, along with the resources only it uses, unless it
+// writes an imported resource or has side effects
+TEST_CASE(UnreadPassesAreCulled)
+{
+  RenderGraph graph;
+  const uint32_t backBuffer = graph.ImportResource("back buffer", nullptr);
+  const uint32_t output = graph.CreateTransientResource("output", kSize, kAlignment);
+  const uint32_t debug = graph.CreateTransientResource("debug", kSize, kAlignment);
+  const uint32_t readback = graph.CreateTransientResource("readback", kSize, kAlignment);
+
+  const uint32_t trace = graph.AddPass("raytracing", nullptr);
+  graph.Write(trace, output, kUnorderedAccess);
+  const uint32_t unread = graph.AddPass("debug view", nullptr);
+  graph.Read(unread, output, kPixelShaderResource);
+  graph.Write(unread, debug, kRenderTarget);
+  const uint32_t sideEffects = graph.AddPass("statistics readback", nullptr, true);
+  graph.Write(sideEffects, readback, kCopyDest);
+  const uint32_t copy = graph.AddPass("copy", nullptr);
+  graph.Read(copy, output, kCopySource);
+  graph.Write(copy, backBuffer, kCopyDest);
+  graph.Compile();
+
+  CHECK(!graph.IsPassCulled(trace));
+  CHECK(graph.IsPassCulled(unread));
+  CHECK(!graph.IsPassCulled(sideEffects));
+  CHECK(!graph.IsPassCulled(copy));
+  CHECK(graph.IsResourceUsed(output));
+  CHECK(!graph.IsResourceUsed(debug));
+  CHECK(graph.IsResourceUsed(readback));
+  CHECK(graph.IsResourceUsed(backBuffer));
+  // The culled pass does not contribute to the first state of the resources it reads
+  CHECK(graph.GetFirstState(output) == kUnorderedAccess);
+
+  const RenderGraphStatistics& statistics = graph.GetStatistics();
+  CHECK(statistics.passCount == 4);
+  CHECK(statistics.culledPassCount == 1);
+  CHECK(statistics.transientResourceCount == 2);
+  CHECK(statistics.culledResourceCount == 1);
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// A pass only kept by a later pass which is itself culled is culled as well
+TEST_CASE(CullingPropagatesToWriters)
+{
+  RenderGraph graph;
+  const uint32_t a = graph.CreateTransientResource("a", kSize, kAlignment);
+  const uint32_t b = graph.CreateTransientResource("b", kSize, kAlignment);
+  const uint32_t first = graph.AddPass("first", nullptr);
+  graph.Write(first, a, kRenderTarget);
+  const uint32_t second = graph.AddPass("second", nullptr);
+  graph.Read(second, a, kPixelShaderResource);
+  graph.Write(second, b, kRenderTarget);
+  graph.Compile();
+
+  CHECK(graph.IsPassCulled(first));
+  CHECK(graph.IsPassCulled(second));
+  CHECK(graph.GetHeapSize() == 0);
+
+  // Executing a graph without kept passes does nothing
+  ResourceStateTracker tracker;
+  int flushCount = 0;
+  graph.Execute(&tracker, [&]() { flushCount++; });
+  CHECK(flushCount == 0);
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Transient resources with disjoint lifetimes share their memory, and the others do not
+TEST_CASE(DisjointLifetimesAreAliased)
+{
+  RenderGraph graph;
+  const uint32_t backBuffer = graph.ImportResource("back buffer", nullptr);
+  const uint32_t gbuffer = graph.CreateTransientResource("gbuffer", kSize, kAlignment);
+  const uint32_t lighting = graph.CreateTransientResource("lighting", kSize, kAlignment);
+  const uint32_t post = graph.CreateTransientResource("post", kSize / 2, kAlignment);
+
+  const uint32_t geometry = graph.AddPass("geometry", nullptr);
+  graph.Write(geometry, gbuffer, kRenderTarget);
+  const uint32_t shading = graph.AddPass("shading", nullptr);
+  graph.Read(shading, gbuffer, kPixelShaderResource);
+  graph.Write(shading, lighting, kRenderTarget);
+  const uint32_t tonemap = graph.AddPass("tonemap", nullptr);
+  graph.Read(tonemap, lighting, kPixelShaderResource);
+  graph.Write(tonemap, post, kUnorderedAccess);
+  const uint32_t copy = graph.AddPass("copy", nullptr);
+  graph.Read(copy, post, kCopySource);
+  graph.Write(copy, backBuffer, kCopyDest);
+  graph.Compile();
+
+  // The gbuffer lives in [geometry, shading] and the post buffer in [tonemap, copy]
+  CHECK(graph.IsResourceAliased(gbuffer));
+  CHECK(graph.IsResourceAliased(post));
+  CHECK(!graph.IsResourceAliased(lighting));
+  CHECK(!graph.IsResourceAliased(backBuffer));
+  CHECK(graph.GetHeapOffset(post) == graph.GetHeapOffset(gbuffer));
+  CHECK(graph.GetHeapOffset(lighting) >= graph.GetHeapOffset(gbuffer) + kSize ||
+        graph.GetHeapOffset(lighting) + kSize <= graph.GetHeapOffset(gbuffer));
+  for (uint32_t resource : {gbuffer, lighting, post})
+  {
+    CHECK(graph.GetHeapOffset(resource) % kAlignment == 0);
+  }
+
+  const RenderGraphStatistics& statistics = graph.GetStatistics();
+  CHECK(statistics.transientSize == 2 * kSize + kSize / 2);
+  CHECK(statistics.heapSize == 2 * kSize);
+  CHECK(statistics.heapSize < statistics.transientSize);
+  CHECK(statistics.GetAliasingSavings() == kSize / 2);
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// The execution feeds the tracker with split barriers for the resources used later, which end at
+// their use, and with an aliasing barrier before the first use of an aliased resource
+TEST_CASE(ExecutionEmitsSplitAndAliasingBarriers)
+{
+  int backBufferResource, gbufferResource, lightingResource, postResource;
+  ResourceStateTracker tracker;
+  tracker.Register(&backBufferResource, kCommon);
+  tracker.Register(&gbufferResource, kCommon);
+  tracker.Register(&lightingResource, kCommon);
+  tracker.Register(&postResource, kCommon);
+
+  RenderGraph graph;
+  std::vector<std::string> executed;
+  const uint32_t backBuffer = graph.ImportResource("back buffer", &backBufferResource);
+  const uint32_t gbuffer = graph.CreateTransientResource("gbuffer", kSize, kAlignment);
+  const uint32_t lighting = graph.CreateTransientResource("lighting", kSize, kAlignment);
+  const uint32_t post = graph.CreateTransientResource("post", kSize, kAlignment);
+
+  const uint32_t geometry = graph.AddPass("geometry", [&]() { executed.push_back("geometry"); });
+  graph.Write(geometry, gbuffer, kRenderTarget);
+  const uint32_t unread = graph.AddPass("debug view", [&]() { executed.push_back("debug view"); });
+  graph.Read(unread, gbuffer, kCopySource);
+  const uint32_t shading = graph.AddPass("shading", [&]() { executed.push_back("shading"); });
+  graph.Read(shading, gbuffer, kPixelShaderResource);
+  graph.Write(shading, lighting, kRenderTarget);
+  const uint32_t tonemap = graph.AddPass("tonemap", [&]() { executed.push_back("tonemap"); });
+  graph.Read(tonemap, lighting, kPixelShaderResource);
+  graph.Write(tonemap, post, kUnorderedAccess);
+  const uint32_t copy = graph.AddPass("copy", [&]() { executed.push_back("copy"); });
+  graph.Read(copy, post, kCopySource);
+  graph.Write(copy, backBuffer, kCopyDest);
+
+  CHECK_THROWS(graph.Execute(&tracker, []() {}));
+  graph.Compile();
+  graph.SetResource(gbuffer, &gbufferResource);
+  graph.SetResource(lighting, &lightingResource);
+  graph.SetResource(post, &postResource);
+  CHECK(graph.IsPassCulled(unread));
+  CHECK(graph.IsResourceAliased(gbuffer) && graph.IsResourceAliased(post));
+
+  // One batch of barriers per kept pass, flushed before its commands
+  std::vector<std::vector<ResourceBarrierDesc>> batches;
+  graph.Execute(&tracker, [&]() {
+    batches.emplace_back();
+    tracker.Flush(&batches.back());
+    executed.push_back("flush");
+  });
+  CHECK(executed == std::vector<std::string>({"flush", "geometry", "flush", "shading", "flush",
+                                              "tonemap", "flush", "copy"}));
+  CHECK(batches.size() == 4);
+  if (batches.size() != 4)
+  {
+    return;
+  }
+  using Split = ResourceBarrierDesc::Split;
+
+  // The resources used after the first pass, and not aliased, start transitioning with it
+  CHECK(FindTransition(batches[0], &lightingResource, kCommon, kRenderTarget, Split::BeginOnly) >= 0);
+  CHECK(FindTransition(batches[0], &backBufferResource, kCommon, kCopyDest, Split::BeginOnly) >= 0);
+  // The aliased gbuffer gets an aliasing barrier before its first transition
+  const int gbufferAliasing = FindAliasing(batches[0], &gbufferResource);
+  const int gbufferTransition =
+      FindTransition(batches[0], &gbufferResource, kCommon, kRenderTarget, Split::None);
+  CHECK(gbufferAliasing >= 0 && gbufferTransition > gbufferAliasing);
+  CHECK(batches[0][gbufferAliasing].resourceBefore == nullptr);
+  CHECK(FindAliasing(batches[0], &postResource) < 0);
+  CHECK(batches[0].size() == 4);
+
+  // The split transition of the lighting buffer ends at its first use
+  CHECK(FindTransition(batches[1], &gbufferResource, kRenderTarget, kPixelShaderResource,
+                       Split::None) >= 0);
+  CHECK(FindTransition(batches[1], &lightingResource, kCommon, kRenderTarget, Split::EndOnly) >= 0);
+  CHECK(batches[1].size() == 2);
+
+  // The post buffer takes over the memory of the gbuffer
+  CHECK(FindTransition(batches[2], &lightingResource, kRenderTarget, kPixelShaderResource,
+                       Split::None) >= 0);
+  const int postAliasing = FindAliasing(batches[2], &postResource);
+  const int postTransition =
+      FindTransition(batches[2], &postResource, kCommon, kUnorderedAccess, Split::None);
+  CHECK(postAliasing >= 0 && postTransition > postAliasing);
+  CHECK(batches[2].size() == 3);
+
+  CHECK(FindTransition(batches[3], &postResource, kUnorderedAccess, kCopySource, Split::None) >= 0);
+  CHECK(FindTransition(batches[3], &backBufferResource, kCommon, kCopyDest, Split::EndOnly) >= 0);
+  CHECK(batches[3].size() == 2);
+  CHECK(tracker.GetState(&backBufferResource) == kCopyDest);
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// A resource used again after a pass which does not use it starts transitioning right after its
+// previous use
+TEST_CASE(NextStateIsBegunAfterTheLastUse)
+{
+  int resource, other;
+  ResourceStateTracker tracker;
+  tracker.Register(&resource, kCommon);
+  tracker.Register(&other, kCommon);
+
+  RenderGraph graph;
+  const uint32_t texture = graph.ImportResource("texture", &resource);
+  const uint32_t target = graph.ImportResource("target", &other);
+  const uint32_t upload = graph.AddPass("upload", nullptr);
+  graph.Write(upload, texture, kCopyDest);
+  const uint32_t clear = graph.AddPass("clear", nullptr);
+  graph.Write(clear, target, kRenderTarget);
+  const uint32_t draw = graph.AddPass("draw", nullptr);
+  graph.Read(draw, texture, kPixelShaderResource);
+  graph.Write(draw, target, kRenderTarget);
+  graph.Compile();
+
+  std::vector<std::vector<ResourceBarrierDesc>> batches;
+  graph.Execute(&tracker, [&]() {
+    batches.emplace_back();
+    tracker.Flush(&batches.back());
+  });
+  CHECK(batches.size() == 3);
+  if (batches.size() != 3)
+  {
+    return;
+  }
+  using Split = ResourceBarrierDesc::Split;
+  CHECK(FindTransition(batches[1], &resource, kCopyDest, kPixelShaderResource, Split::BeginOnly) >=
+        0);
+  CHECK(FindTransition(batches[2], &resource, kCopyDest, kPixelShaderResource, Split::EndOnly) >= 0);
+  CHECK(FindTransition(batches[2], &other, kRenderTarget, kRenderTarget, Split::None) < 0);
+  CHECK(batches[2].size() == 1);
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+TEST_CASE(InvalidDescriptionsThrow)
+{
+  RenderGraph graph;
+  CHECK_THROWS(graph.CreateTransientResource("odd", kSize, 3));
+  CHECK_THROWS(graph.CreateTransientResource("zero", kSize, 0));
+  const uint32_t resource = graph.CreateTransientResource("resource", kSize, kAlignment);
+  const uint32_t pass = graph.AddPass("pass", nullptr);
+  CHECK_THROWS(graph.Read(pass, resource + 1, kCopySource));
+  graph.Write(pass, resource, kUnorderedAccess);
+  graph.Read(pass, resource, kUnorderedAccess);
+  CHECK_THROWS(graph.Read(pass, resource, kCopySource));
+}
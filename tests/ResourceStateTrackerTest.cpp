@@ -0,0 +1,204 @@
+/*
+
+Tests of the barriers emitted by ResourceStateTracker.
+
+*/
+
+#include "TestHarness.h"
+
+#include "ResourceStateTracker.h"
+
+#include <vector>
+
+using namespace nv_helpers_dx12;
+
+namespace
+{
+// Values of the D3D12_RESOURCE_STATES used by the tests
+const uint32_t kCommon = 0x0;
+const uint32_t kRenderTarget = 0x4;
+const uint32_t kUnorderedAccess = 0x8;
+const uint32_t kPixelShaderResource = 0x80;
+const uint32_t kCopySource = 0x800;
+
+const uint32_t kAll = ResourceStateTracker::kAllSubresources;
+
+bool IsTransition(const ResourceBarrierDesc& barrier, void* resource, uint32_t subresource,
+                  uint32_t stateBefore, uint32_t stateAfter,
+                  ResourceBarrierDesc::Split split = ResourceBarrierDesc::Split::None)
+{
+  return barrier.type == ResourceBarrierDesc::Type::Transition && barrier.split == split &&
+         barrier.resource == resource && barrier.subresource == subresource &&
+         barrier.stateBefore == stateBefore && barrier.stateAfter == stateAfter;
+}
+} // namespace
+
+//--------------------------------------------------------------------------------------------------
+//
+// The transitions of a batch are emitted together, and the ones to the current state dropped
+TEST_CASE(TransitionsAreBatched)
+{
+  int output, target;
+  ResourceStateTracker tracker;
+  tracker.Register(&output, kCopySource);
+  tracker.Register(&target, kRenderTarget);
+  tracker.Transition(&output, kUnorderedAccess);
+  tracker.Transition(&target, kRenderTarget);
+  CHECK(tracker.GetPendingBarrierCount() == 1);
+
+  std::vector<ResourceBarrierDesc> barriers;
+  CHECK(tracker.Flush(&barriers) == 1);
+  CHECK(barriers.size() == 1);
+  CHECK(IsTransition(barriers[0], &output, kAll, kCopySource, kUnorderedAccess));
+  CHECK(tracker.GetState(&output) == kUnorderedAccess);
+
+  // Flushing an empty batch is not counted as a ResourceBarrier call
+  CHECK(tracker.Flush(&barriers) == 0);
+  CHECK(tracker.GetStatistics().batchCount == 1);
+  CHECK(tracker.GetStatistics().droppedTransitionCount == 1);
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Successive transitions of a resource within a batch are merged, and removed if they come back
+// to the initial state
+TEST_CASE(TransitionsWithinABatchAreMerged)
+{
+  int resource;
+  ResourceStateTracker tracker;
+  tracker.Register(&resource, kCommon);
+  tracker.Transition(&resource, kCopySource);
+  tracker.Transition(&resource, kPixelShaderResource);
+
+  std::vector<ResourceBarrierDesc> barriers;
+  tracker.Flush(&barriers);
+  CHECK(barriers.size() == 1);
+  CHECK(IsTransition(barriers[0], &resource, kAll, kCommon, kPixelShaderResource));
+  CHECK(tracker.GetStatistics().mergedTransitionCount == 1);
+
+  tracker.Transition(&resource, kUnorderedAccess);
+  tracker.Transition(&resource, kPixelShaderResource);
+  CHECK(tracker.GetPendingBarrierCount() == 0);
+  CHECK(tracker.GetState(&resource) == kPixelShaderResource);
+  CHECK(tracker.GetStatistics().droppedTransitionCount == 2);
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// A UAV barrier between two transitions keeps them apart
+TEST_CASE(UAVAndAliasingBarriers)
+{
+  int a, b;
+  ResourceStateTracker tracker;
+  tracker.Register(&a, kUnorderedAccess);
+  tracker.UAVBarrier(&a);
+  tracker.AliasingBarrier(&a, &b);
+
+  std::vector<ResourceBarrierDesc> barriers;
+  CHECK(tracker.Flush(&barriers) == 2);
+  CHECK(barriers[0].type == ResourceBarrierDesc::Type::UAV && barriers[0].resource == &a);
+  CHECK(barriers[1].type == ResourceBarrierDesc::Type::Aliasing);
+  CHECK(barriers[1].resourceBefore == &a && barriers[1].resource == &b);
+
+  tracker.Transition(&a, kCopySource);
+  tracker.UAVBarrier(&a);
+  tracker.Transition(&a, kUnorderedAccess);
+  CHECK(tracker.GetPendingBarrierCount() == 3);
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// A split barrier begun in a batch is ended by the use of the resource in a later batch
+TEST_CASE(SplitBarriers)
+{
+  int resource;
+  ResourceStateTracker tracker;
+  tracker.Register(&resource, kRenderTarget);
+  tracker.BeginTransition(&resource, kPixelShaderResource);
+  // The state only changes once the transition ends
+  CHECK(tracker.GetState(&resource) == kRenderTarget);
+
+  std::vector<ResourceBarrierDesc> barriers;
+  tracker.Flush(&barriers);
+  tracker.Transition(&resource, kPixelShaderResource);
+  tracker.Flush(&barriers);
+  CHECK(barriers.size() == 2);
+  CHECK(IsTransition(barriers[0], &resource, kAll, kRenderTarget, kPixelShaderResource,
+                     ResourceBarrierDesc::Split::BeginOnly));
+  CHECK(IsTransition(barriers[1], &resource, kAll, kRenderTarget, kPixelShaderResource,
+                     ResourceBarrierDesc::Split::EndOnly));
+  CHECK(tracker.GetState(&resource) == kPixelShaderResource);
+  CHECK(tracker.GetStatistics().splitBarrierCount == 1);
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// A split barrier ended in the batch it began in has nothing to overlap with
+TEST_CASE(SplitBarrierEndedInItsBatchIsPlain)
+{
+  int resource;
+  ResourceStateTracker tracker;
+  tracker.Register(&resource, kRenderTarget);
+  tracker.BeginTransition(&resource, kPixelShaderResource);
+  tracker.Transition(&resource, kPixelShaderResource);
+
+  std::vector<ResourceBarrierDesc> barriers;
+  tracker.Flush(&barriers);
+  CHECK(barriers.size() == 1);
+  CHECK(IsTransition(barriers[0], &resource, kAll, kRenderTarget, kPixelShaderResource));
+  CHECK(tracker.GetStatistics().splitBarrierCount == 0);
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// The subresources get their own states, and share a single one again once they agree
+TEST_CASE(SubresourceTransitions)
+{
+  int texture;
+  ResourceStateTracker tracker;
+  tracker.Register(&texture, kCommon, 3);
+  tracker.Transition(&texture, kCopySource, 1);
+  CHECK(tracker.GetState(&texture, 1) == kCopySource);
+  CHECK(tracker.GetState(&texture, 0) == kCommon);
+  CHECK_THROWS(tracker.GetState(&texture));
+
+  std::vector<ResourceBarrierDesc> barriers;
+  tracker.Flush(&barriers);
+  CHECK(barriers.size() == 1);
+  CHECK(IsTransition(barriers[0], &texture, 1, kCommon, kCopySource));
+
+  // Transitioning the whole resource emits one barrier per subresource not in the state
+  barriers.clear();
+  tracker.Transition(&texture, kCopySource);
+  tracker.Flush(&barriers);
+  CHECK(barriers.size() == 2);
+  CHECK(IsTransition(barriers[0], &texture, 0, kCommon, kCopySource));
+  CHECK(IsTransition(barriers[1], &texture, 2, kCommon, kCopySource));
+  CHECK(tracker.GetState(&texture) == kCopySource);
+
+  // Once collapsed, the whole resource is transitioned with a single barrier
+  barriers.clear();
+  tracker.Transition(&texture, kCommon);
+  tracker.Flush(&barriers);
+  CHECK(barriers.size() == 1);
+  CHECK(IsTransition(barriers[0], &texture, kAll, kCopySource, kCommon));
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+TEST_CASE(UntrackedResourcesThrow)
+{
+  int resource, other;
+  ResourceStateTracker tracker;
+  CHECK_THROWS(tracker.Register(&resource, kCommon, 0));
+  CHECK_THROWS(tracker.Transition(&resource, kCopySource));
+  CHECK_THROWS(tracker.GetState(&resource));
+
+  tracker.Register(&resource, kCommon, 2);
+  CHECK_THROWS(tracker.Transition(&resource, kCopySource, 2));
+  CHECK_THROWS(tracker.BeginTransition(&resource, kCopySource, 2));
+  tracker.Unregister(&resource);
+  CHECK_THROWS(tracker.Transition(&resource, kCopySource));
+  CHECK_THROWS(tracker.BeginTransition(&other, kCopySource));
+}
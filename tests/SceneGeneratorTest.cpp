@@ -0,0 +1,121 @@
+/*
+
+Tests of the generated meshes and scenes.
+
+*/
+
+#include "TestHarness.h"
+
+#include "SceneGenerator.h"
+
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <utility>
+
+using namespace nv_helpers_dx12;
+
+namespace
+{
+// Twice the area of a triangle
+float GetDoubleArea(const float* a, const float* b, const float* c)
+{
+  const float u[3] = {b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+  const float v[3] = {c[0] - a[0], c[1] - a[1], c[2] - a[2]};
+  const float n[3] = {u[1] * v[2] - u[2] * v[1], u[2] * v[0] - u[0] * v[2],
+                      u[0] * v[1] - u[1] * v[0]};
+  return std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+}
+} // namespace
+
+//--------------------------------------------------------------------------------------------------
+//
+// The meshes have the exact triangle count, without degenerate triangles, including at the poles
+TEST_CASE(MeshesHaveExactTriangleCounts)
+{
+  for (uint32_t triangleCount = 1; triangleCount < 600; triangleCount++)
+  {
+    const Mesh mesh = GenerateMesh(triangleCount, triangleCount);
+    CHECK(mesh.GetTriangleCount() == triangleCount);
+    for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+    {
+      const uint32_t a = mesh.indices[i], b = mesh.indices[i + 1], c = mesh.indices[i + 2];
+      CHECK(a < mesh.vertices.size() && b < mesh.vertices.size() && c < mesh.vertices.size());
+      CHECK(a != b && b != c && a != c);
+      CHECK(GetDoubleArea(mesh.vertices[a].position, mesh.vertices[b].position,
+                          mesh.vertices[c].position) > 0.f);
+    }
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// The triangles of a complete sphere are wound consistently: each directed edge is used at most
+// once, and the mesh is closed
+TEST_CASE(CompleteSphereIsClosedAndConsistent)
+{
+  // 2 rows of pole fans and 2 rows of quads, 8 columns
+  const Mesh mesh = GenerateMesh(2 * 8 + 2 * 2 * 8, 5);
+  std::map<std::pair<uint32_t, uint32_t>, int> edges;
+  for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+  {
+    for (int e = 0; e < 3; e++)
+    {
+      edges[{mesh.indices[i + e], mesh.indices[i + (e + 1) % 3]}]++;
+    }
+  }
+  for (const auto& edge : edges)
+  {
+    CHECK(edge.second == 1);
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// A description always produces the same scene, and the instances follow the description
+TEST_CASE(ScenesAreReproducible)
+{
+  for (SceneLayout layout : {SceneLayout::Grid, SceneLayout::Random, SceneLayout::Clustered})
+  {
+    SceneDesc desc;
+    desc.seed = 42;
+    desc.instanceCount = 100;
+    desc.meshCount = 3;
+    desc.trianglesPerMesh = 500;
+    desc.layout = layout;
+    const Scene scene = GenerateScene(desc);
+    const Scene again = GenerateScene(desc);
+
+    CHECK(scene.meshes.size() == 3);
+    CHECK(scene.instances.size() == 100);
+    for (const Mesh& mesh : scene.meshes)
+    {
+      CHECK(mesh.GetTriangleCount() == 500);
+    }
+    for (size_t i = 0; i < scene.instances.size(); i++)
+    {
+      CHECK(scene.instances[i].meshIndex == i % 3);
+      CHECK(memcmp(scene.instances[i].transform, again.instances[i].transform,
+                   sizeof(scene.instances[i].transform)) == 0);
+      if (layout != SceneLayout::Clustered)
+      {
+        for (int k = 0; k < 3; k++)
+        {
+          CHECK(std::abs(scene.instances[i].transform[k][3]) <= 0.5f * desc.extent);
+        }
+      }
+    }
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+TEST_CASE(ParseSceneLayoutNames)
+{
+  SceneLayout layout = SceneLayout::Grid;
+  CHECK(ParseSceneLayout("clustered", &layout) && layout == SceneLayout::Clustered);
+  CHECK(ParseSceneLayout("random", &layout) && layout == SceneLayout::Random);
+  CHECK(ParseSceneLayout("grid", &layout) && layout == SceneLayout::Grid);
+  CHECK(!ParseSceneLayout("sphere", &layout));
+}
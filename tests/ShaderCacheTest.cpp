@@ -0,0 +1,170 @@
+/*
+
+Tests of ShaderCache, with MockShaderCompiler as the compiler. The shader files and the cache
+entries are written to the working directory of the test.
+
+*/
+
+#include "TestHarness.h"
+
+#include "ShaderCache.h"
+#include "ShaderCompileQueue.h"
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace nv_helpers_dx12;
+
+namespace
+{
+const char* kCacheDirectory = "ShaderCacheTest_cache";
+
+void WriteFile(const std::string& fileName, const std::string& contents)
+{
+  std::ofstream file(fileName, std::ios::binary | std::ios::trunc);
+  file << contents;
+}
+
+// MockShaderCompiler counting its compilations
+class CountingCompiler : public MockShaderCompiler
+{
+public:
+  CountingCompiler() : MockShaderCompiler(0.) {}
+
+  bool Compile(const std::string& fileName, const std::string& entryPoint,
+               const std::string& target, uint32_t flags, std::vector<uint8_t>* bytecode,
+               std::string* errors) override
+  {
+    compileCount++;
+    return MockShaderCompiler::Compile(fileName, entryPoint, target, flags, bytecode, errors);
+  }
+
+  uint32_t compileCount = 0;
+};
+
+// Remove the entry left by a previous run of the test, if any
+void RemoveEntry(const ShaderCache& cache, const std::string& fileName,
+                 const std::string& entryPoint, const std::string& target, uint32_t flags = 0)
+{
+  const std::string key = ShaderCache::ComputeKey(ShaderCache::ExpandIncludes(fileName),
+                                                  entryPoint, target, flags, "mock");
+  std::remove(cache.GetEntryPath(key).c_str());
+}
+} // namespace
+
+//--------------------------------------------------------------------------------------------------
+//
+// The first compilation stores the bytecode, which the next ones load without compiling
+TEST_CASE(SecondCompilationIsAHit)
+{
+  const std::string fileName = "ShaderCacheTest_hit.hlsl";
+  WriteFile(fileName, "float4 VSMain() : SV_POSITION { return 0; }\n");
+  CountingCompiler compiler;
+  ShaderCache cache(&compiler, kCacheDirectory);
+  CHECK(cache.IsEnabled());
+  RemoveEntry(cache, fileName, "VSMain", "vs_5_0");
+
+  const std::vector<uint8_t> expected = MockShaderCompiler::GetBytecode(fileName, "VSMain", "vs_5_0");
+  CHECK(cache.Compile(fileName, "VSMain", "vs_5_0") == expected);
+  CHECK(compiler.compileCount == 1);
+  CHECK(cache.Compile(fileName, "VSMain", "vs_5_0") == expected);
+  CHECK(compiler.compileCount == 1);
+
+  // A new cache instance, as in the next launch, loads the entry as well
+  ShaderCache nextCache(&compiler, kCacheDirectory);
+  CHECK(nextCache.Compile(fileName, "VSMain", "vs_5_0") == expected);
+  CHECK(compiler.compileCount == 1);
+
+  const ShaderCacheStatistics statistics = cache.GetStatistics();
+  CHECK(statistics.hitCount == 1);
+  CHECK(statistics.missCount == 1);
+  CHECK(statistics.storeFailureCount == 0);
+  CHECK(statistics.GetHitRate() == 0.5f);
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Editing an included file, or changing the parameters of the compilation, changes the key
+TEST_CASE(KeyCoversIncludesAndParameters)
+{
+  const std::string fileName = "ShaderCacheTest_main.hlsl";
+  const std::string includeName = "ShaderCacheTest_common.hlsl";
+  WriteFile(includeName, "#define VALUE 1\n");
+  WriteFile(fileName, "#include \"" + includeName + "\"\n#include \"" + includeName +
+                          "\"\nfloat4 PSMain() : SV_TARGET { return VALUE; }\n");
+
+  const std::string expanded = ShaderCache::ExpandIncludes(fileName);
+  // The include is expanded once
+  CHECK(expanded.find("#define VALUE 1") != std::string::npos);
+  CHECK(expanded.find("#define VALUE 1") == expanded.rfind("#define VALUE 1"));
+  CHECK(expanded.find("PSMain") != std::string::npos);
+
+  const std::string key = ShaderCache::ComputeKey(expanded, "PSMain", "ps_5_0", 0, "mock");
+  CHECK(key.size() == 32);
+  CHECK(key.find_first_not_of("0123456789abcdef") == std::string::npos);
+  CHECK(key != ShaderCache::ComputeKey(expanded, "PSMain", "ps_6_0", 0, "mock"));
+  CHECK(key != ShaderCache::ComputeKey(expanded, "PSMain", "ps_5_0", 1, "mock"));
+  CHECK(key != ShaderCache::ComputeKey(expanded, "PSMain", "ps_5_0", 0, "mock 2"));
+  // Moving characters from a field to the next changes the key
+  CHECK(ShaderCache::ComputeKey(expanded, "PSMainp", "s_5_0", 0, "mock") != key);
+
+  WriteFile(includeName, "#define VALUE 2\n");
+  CHECK(ShaderCache::ComputeKey(ShaderCache::ExpandIncludes(fileName), "PSMain", "ps_5_0", 0,
+                                "mock") != key);
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Each compilation of a disabled cache runs the compiler, without reading the file
+TEST_CASE(DisabledCacheAlwaysCompiles)
+{
+  CountingCompiler compiler;
+  ShaderCache cache(&compiler, "");
+  CHECK(!cache.IsEnabled());
+  cache.Compile("ShaderCacheTest_missing.hlsl", "", "lib_6_3");
+  cache.Compile("ShaderCacheTest_missing.hlsl", "", "lib_6_3");
+  CHECK(compiler.compileCount == 2);
+  CHECK(cache.GetStatistics().missCount == 2);
+  CHECK(cache.GetStatistics().hitCount == 0);
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// A failed compilation throws and stores nothing
+TEST_CASE(CompilationErrorsThrow)
+{
+  const std::string fileName = "ShaderCacheTest_error.hlsl";
+  WriteFile(fileName, "syntax error\n");
+  CountingCompiler compiler;
+  ShaderCache cache(&compiler, kCacheDirectory);
+  CHECK_THROWS(cache.Compile(fileName, "", "lib_6_3"));
+  CHECK_THROWS(cache.Compile(fileName, "", "lib_6_3"));
+  CHECK(compiler.compileCount == 2);
+
+  CHECK_THROWS(ShaderCache::ExpandIncludes("ShaderCacheTest_missing.hlsl"));
+  CHECK_THROWS(cache.Compile("ShaderCacheTest_missing.hlsl", "", "lib_6_3"));
+  ShaderCache noCompiler(nullptr, kCacheDirectory);
+  CHECK_THROWS(noCompiler.Compile(fileName, "", "lib_6_3"));
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// A truncated entry is a miss, and is replaced by the compiled bytecode
+TEST_CASE(InvalidEntryIsRecompiled)
+{
+  const std::string fileName = "ShaderCacheTest_truncated.hlsl";
+  WriteFile(fileName, "float4 CSMain() { return 0; }\n");
+  CountingCompiler compiler;
+  ShaderCache cache(&compiler, kCacheDirectory);
+  const std::string key = ShaderCache::ComputeKey(ShaderCache::ExpandIncludes(fileName), "CSMain",
+                                                  "cs_5_0", 0, "mock");
+  WriteFile(cache.GetEntryPath(key), "NVSC");
+
+  const std::vector<uint8_t> expected = MockShaderCompiler::GetBytecode(fileName, "CSMain", "cs_5_0");
+  CHECK(cache.Compile(fileName, "CSMain", "cs_5_0") == expected);
+  CHECK(cache.Compile(fileName, "CSMain", "cs_5_0") == expected);
+  CHECK(compiler.compileCount == 1);
+  CHECK(cache.GetStatistics().hitCount == 1);
+}
@@ -0,0 +1,104 @@
+/*
+
+Tests of ShaderCompileQueue, with MockShaderCompiler instances on the workers.
+
+*/
+
+#include "TestHarness.h"
+
+#include "ShaderCompileQueue.h"
+
+#include <atomic>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace nv_helpers_dx12;
+
+//--------------------------------------------------------------------------------------------------
+//
+// Every future returns the bytecode of its own task, and the compilation errors are rethrown
+TEST_CASE(FuturesReturnTheirOwnBytecode)
+{
+  ShaderCache cache(nullptr, "");
+  std::atomic<uint32_t> createdCount(0);
+  ShaderCompileQueue queue(&cache, [&createdCount]() {
+    createdCount++;
+    return std::unique_ptr<ShaderCache::Compiler>(new MockShaderCompiler(0.001));
+  }, 4);
+  CHECK(queue.GetWorkerCount() == 4);
+
+  std::vector<ShaderCompileQueue::Result> results;
+  for (int i = 0; i < 16; i++)
+  {
+    results.push_back(queue.Submit("shader" + std::to_string(i) + ".hlsl", "main", "cs_6_0"));
+  }
+  ShaderCompileQueue::Result failure = queue.Submit("error.hlsl", "main", "cs_6_0");
+  queue.WaitForAll();
+
+  for (int i = 0; i < 16; i++)
+  {
+    CHECK(results[i].get() ==
+          MockShaderCompiler::GetBytecode("shader" + std::to_string(i) + ".hlsl", "main", "cs_6_0"));
+  }
+  CHECK_THROWS(failure.get());
+
+  const ShaderCompileStatistics statistics = queue.GetStatistics();
+  CHECK(statistics.taskCount == 17);
+  CHECK(statistics.failedTaskCount == 1);
+  // At most one compiler per worker
+  CHECK(statistics.compilerCount == createdCount);
+  CHECK(createdCount >= 1 && createdCount <= 4);
+  CHECK(statistics.peakRunningCount <= 4);
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// A failure to create the compiler fails the task like a compilation error
+TEST_CASE(CompilerCreationFailureFailsTheTask)
+{
+  ShaderCache cache(nullptr, "");
+  ShaderCompileQueue queue(&cache, []() -> std::unique_ptr<ShaderCache::Compiler> {
+    throw std::runtime_error("No compiler available");
+  }, 1);
+  ShaderCompileQueue::Result result = queue.Submit("shader.hlsl", "", "lib_6_3");
+  CHECK_THROWS(result.get());
+  queue.WaitForAll();
+  CHECK(queue.GetStatistics().failedTaskCount == 1);
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// The queue completes the submitted tasks before its destruction
+TEST_CASE(DestructionCompletesTheTasks)
+{
+  ShaderCache cache(nullptr, "");
+  std::vector<ShaderCompileQueue::Result> results;
+  {
+    ShaderCompileQueue queue(&cache, []() {
+      return std::unique_ptr<ShaderCache::Compiler>(new MockShaderCompiler(0.));
+    }, 2);
+    for (int i = 0; i < 8; i++)
+    {
+      results.push_back(queue.Submit("shader.hlsl", std::to_string(i), "vs_6_0"));
+    }
+  }
+  for (int i = 0; i < 8; i++)
+  {
+    CHECK(results[i].get() == MockShaderCompiler::GetBytecode("shader.hlsl", std::to_string(i), "vs_6_0"));
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// The compilations run concurrently on the workers. The speedup is only loosely bounded, as the
+// test machine may be loaded
+TEST_CASE(WorkersCompileConcurrently)
+{
+  const ShaderCompileBenchmarkResult result = RunShaderCompileBenchmark(4, 16, 0.01);
+  CHECK(result.matched);
+  CHECK(result.workerCount == 4);
+  CHECK(result.taskCount == 16);
+  CHECK(result.peakRunningCount > 1);
+  CHECK(result.GetSpeedup() > 1.5);
+}
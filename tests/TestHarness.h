@@ -0,0 +1,84 @@
+/*
+
+Minimal test harness of the CPU-only helpers of nv_helpers_dx12. Each test file
+defines its cases with TEST_CASE and is linked with TestMain.cpp into its own
+executable, registered with CTest. CHECK and CHECK_THROWS report the failed
+expression and keep running the case, so that a run lists all the failures of a
+case.
+
+Example:
+
+TEST_CASE(GeneratedMeshesHaveTheRequestedSize)
+{
+  nv_helpers_dx12::Mesh mesh = nv_helpers_dx12::GenerateMesh(100, 1);
+  CHECK(mesh.GetTriangleCount() == 100);
+  CHECK(mesh.vertices.size() < 3 * 100);
+}
+
+*/
+
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace nv_helpers_dx12_tests
+{
+
+/// Test case registered by TEST_CASE
+struct TestCase
+{
+  const char* name;
+  std::function<void()> run;
+};
+
+/// Cases of the executable, in definition order within each file
+std::vector<TestCase>& GetTestCases();
+
+/// Record a failed check of the running case
+void ReportFailure(const char* file, int line, const std::string& message);
+
+/// Registration of a case at static initialization time
+struct TestRegistration
+{
+  TestRegistration(const char* name, std::function<void()> run)
+  {
+    GetTestCases().push_back({name, std::move(run)});
+  }
+};
+
+} // namespace nv_helpers_dx12_tests
+
+#define TEST_CASE(name)                                                                            \
+  static void name();                                                                              \
+  static nv_helpers_dx12_tests::TestRegistration name##Registration(#name, name);                  \
+  static void name()
+
+#define CHECK(condition)                                                                           \
+  do                                                                                               \
+  {                                                                                                \
+    if (!(condition))                                                                              \
+    {                                                                                              \
+      nv_helpers_dx12_tests::ReportFailure(__FILE__, __LINE__, "CHECK(" #condition ")");           \
+    }                                                                                              \
+  } while (false)
+
+#define CHECK_THROWS(expression)                                                                   \
+  do                                                                                               \
+  {                                                                                                \
+    bool thrown = false;                                                                           \
+    try                                                                                            \
+    {                                                                                              \
+      expression;                                                                                  \
+    }                                                                                              \
+    catch (...)                                                                                    \
+    {                                                                                              \
+      thrown = true;                                                                               \
+    }                                                                                              \
+    if (!thrown)                                                                                   \
+    {                                                                                              \
+      nv_helpers_dx12_tests::ReportFailure(__FILE__, __LINE__,                                     \
+                                           "CHECK_THROWS(" #expression ") did not throw");         \
+    }                                                                                              \
+  } while (false)
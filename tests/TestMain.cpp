@@ -0,0 +1,68 @@
+/*
+
+Entry point of the test executables. See TestHarness.h for details.
+
+*/
+
+#include "TestHarness.h"
+
+#include <cstdio>
+#include <exception>
+
+namespace nv_helpers_dx12_tests
+{
+
+namespace
+{
+int g_failureCount = 0;
+} // namespace
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+std::vector<TestCase>& GetTestCases()
+{
+  static std::vector<TestCase> cases;
+  return cases;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+void ReportFailure(const char* file, int line, const std::string& message)
+{
+  std::printf("%s(%d): %s\n", file, line, message.c_str());
+  g_failureCount++;
+}
+
+} // namespace nv_helpers_dx12_tests
+
+//--------------------------------------------------------------------------------------------------
+//
+// A case throwing an unexpected exception fails, and the next cases still run
+int main()
+{
+  using namespace nv_helpers_dx12_tests;
+  int failedCaseCount = 0;
+  for (const TestCase& testCase : GetTestCases())
+  {
+    const int previousFailureCount = g_failureCount;
+    try
+    {
+      testCase.run();
+    }
+    catch (const std::exception& e)
+    {
+      ReportFailure(__FILE__, __LINE__, std::string("unexpected exception: ") + e.what());
+    }
+    catch (...)
+    {
+      ReportFailure(__FILE__, __LINE__, "unexpected exception");
+    }
+    const bool passed = g_failureCount == previousFailureCount;
+    failedCaseCount += passed ? 0 : 1;
+    std::printf("[%s] %s\n", passed ? "  OK  " : "FAILED", testCase.name);
+  }
+  std::printf("%d of %d cases failed\n", failedCaseCount, static_cast<int>(GetTestCases().size()));
+  return failedCaseCount == 0 ? 0 : 1;
+}
@@ -0,0 +1,94 @@
+/*
+
+Tests of TlsfAllocator.
+
+*/
+
+#include "TestHarness.h"
+
+#include "TlsfAllocator.h"
+
+#include <vector>
+
+using namespace nv_helpers_dx12;
+
+//--------------------------------------------------------------------------------------------------
+//
+// The allocations are rounded to the granularity, aligned, and do not overlap
+TEST_CASE(AllocationsAreAlignedAndDisjoint)
+{
+  TlsfAllocator allocator(1024 * 1024, 256);
+  const TlsfAllocation a = allocator.Allocate(100);
+  const TlsfAllocation b = allocator.Allocate(1000, 65536);
+  const TlsfAllocation c = allocator.Allocate(256);
+  CHECK(a.IsValid() && b.IsValid() && c.IsValid());
+  CHECK(a.size == 256);
+  CHECK(b.size == 1024 && b.offset % 65536 == 0);
+  CHECK(a.offset + a.size <= b.offset || b.offset + b.size <= a.offset);
+  CHECK(a.offset + a.size <= c.offset || c.offset + c.size <= a.offset);
+  CHECK(b.offset + b.size <= c.offset || c.offset + c.size <= b.offset);
+  CHECK(allocator.GetUsedSize() == 256 + 1024 + 256);
+  CHECK(allocator.GetStatistics().allocationCount == 3);
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Freed ranges are merged with their free neighbors, so that the whole block can be allocated
+// again
+TEST_CASE(FreedRangesAreMerged)
+{
+  TlsfAllocator allocator(4096, 256);
+  std::vector<TlsfAllocation> allocations;
+  for (int i = 0; i < 16; i++)
+  {
+    allocations.push_back(allocator.Allocate(256));
+    CHECK(allocations.back().IsValid());
+  }
+  CHECK(!allocator.Allocate(256).IsValid());
+
+  // Free every other range, then the remaining ones
+  for (size_t i = 0; i < allocations.size(); i += 2)
+  {
+    allocator.Free(allocations[i]);
+  }
+  CHECK(allocator.GetStatistics().freeRangeCount == 8);
+  CHECK(!allocator.Allocate(512).IsValid());
+  for (size_t i = 1; i < allocations.size(); i += 2)
+  {
+    allocator.Free(allocations[i]);
+  }
+  CHECK(allocator.IsEmpty());
+  CHECK(allocator.GetStatistics().freeRangeCount == 1);
+  CHECK(allocator.GetStatistics().GetFragmentation() == 0.f);
+
+  const TlsfAllocation all = allocator.Allocate(4096);
+  CHECK(all.IsValid() && all.offset == 0);
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// The random allocations of the stress benchmark leave the allocator consistent
+TEST_CASE(StressBenchmark)
+{
+  const TlsfStressResult result = RunTlsfStressBenchmark(64 * 1024 * 1024, 20000);
+  CHECK(result.operationCount == 20000);
+  CHECK(result.peakUsedSize <= 64 * 1024 * 1024);
+  CHECK(result.finalStatistics.usedSize <= result.finalStatistics.size);
+  CHECK(result.finalStatistics.largestFreeRange <=
+        result.finalStatistics.size - result.finalStatistics.usedSize);
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+TEST_CASE(InvalidParametersThrow)
+{
+  CHECK_THROWS(TlsfAllocator(4096, 100));
+  TlsfAllocator allocator(4096, 256);
+  CHECK_THROWS(allocator.Allocate(256, 3));
+  CHECK(!allocator.Allocate(8192).IsValid());
+  CHECK_THROWS(allocator.Free(TlsfAllocation()));
+  const TlsfAllocation allocation = allocator.Allocate(256);
+  allocator.Free(allocation);
+  CHECK_THROWS(allocator.Free(allocation));
+}
@@ -0,0 +1,215 @@
+/*
+
+Tests of UploadBatcher, through a backend copying into CPU memory. The copies of a batch are
+only executed when the fence of the MockFrameQueue reaches its value, as they would on the GPU,
+so that staging memory reused too early corrupts the destinations.
+
+*/
+
+#include "TestHarness.h"
+
+#include "FramePacer.h"
+#include "UploadBatcher.h"
+
+#include <cstring>
+#include <deque>
+#include <vector>
+
+using namespace nv_helpers_dx12;
+
+namespace
+{
+// Backend whose destinations are byte vectors, large enough for the uploads
+class MockUploadBackend : public UploadBatcher::Backend
+{
+public:
+  explicit MockUploadBackend(uint64_t stagingSize) : m_staging(stagingSize) {}
+
+  void WriteStaging(uint64_t stagingOffset, const void* data, uint64_t size) override
+  {
+    CHECK(stagingOffset + size <= m_staging.size());
+    memcpy(m_staging.data() + stagingOffset, data, size);
+  }
+
+  uint64_t Submit(const UploadCopy* copies, uint32_t count) override
+  {
+    Batch batch;
+    batch.copies.assign(copies, copies + count);
+    batch.fenceValue = m_queue.Signal();
+    m_batches.push_back(batch);
+    return batch.fenceValue;
+  }
+
+  uint64_t GetCompletedValue() override { return m_queue.GetCompletedValue(); }
+
+  void Wait(uint64_t value) override
+  {
+    m_queue.Wait(value);
+    Execute();
+  }
+
+  /// Let the GPU complete the batches up to the fence value
+  void Complete(uint64_t value)
+  {
+    m_queue.Complete(value);
+    Execute();
+  }
+
+  const MockFrameQueue& GetQueue() const { return m_queue; }
+  const std::vector<UploadCopy>& GetSubmittedCopies() const { return m_submittedCopies; }
+
+private:
+  struct Batch
+  {
+    std::vector<UploadCopy> copies;
+    uint64_t fenceValue;
+  };
+
+  void Execute()
+  {
+    while (!m_batches.empty() && m_batches.front().fenceValue <= m_queue.GetCompletedValue())
+    {
+      for (const UploadCopy& copy : m_batches.front().copies)
+      {
+        std::vector<uint8_t>* destination = static_cast<std::vector<uint8_t>*>(copy.destination);
+        CHECK(copy.destinationOffset + copy.size <= destination->size());
+        memcpy(destination->data() + copy.destinationOffset, m_staging.data() + copy.stagingOffset,
+               copy.size);
+        m_submittedCopies.push_back(copy);
+      }
+      m_batches.pop_front();
+    }
+  }
+
+  std::vector<uint8_t> m_staging;
+  MockFrameQueue m_queue;
+  std::deque<Batch> m_batches;
+  std::vector<UploadCopy> m_submittedCopies;
+};
+
+std::vector<uint8_t> MakeData(size_t size, uint8_t seed)
+{
+  std::vector<uint8_t> data(size);
+  for (size_t i = 0; i < size; i++)
+  {
+    data[i] = static_cast<uint8_t>(seed + i * 7);
+  }
+  return data;
+}
+} // namespace
+
+//--------------------------------------------------------------------------------------------------
+//
+// The uploads are written to the staging buffer at once, and copied when the batch completes
+TEST_CASE(UploadsAreCopiedInOneBatch)
+{
+  MockUploadBackend backend(1024);
+  UploadBatcher batcher(&backend, 1024);
+  const std::vector<uint8_t> vertices = MakeData(100, 1);
+  const std::vector<uint8_t> indices = MakeData(60, 2);
+  std::vector<uint8_t> vertexBuffer(100), indexBuffer(60);
+  batcher.Upload(&vertexBuffer, vertices.data(), vertices.size());
+  batcher.Upload(&indexBuffer, indices.data(), indices.size());
+
+  const uint64_t fenceValue = batcher.Flush();
+  CHECK(fenceValue == 1);
+  CHECK(batcher.Flush() == 0);
+  CHECK(batcher.GetPendingBatchCount() == 1);
+  CHECK(vertexBuffer != vertices);
+
+  backend.Complete(fenceValue);
+  CHECK(batcher.Retire() == 1);
+  CHECK(vertexBuffer == vertices);
+  CHECK(indexBuffer == indices);
+  CHECK(backend.GetSubmittedCopies().size() == 2);
+  CHECK(backend.GetSubmittedCopies()[0].last && backend.GetSubmittedCopies()[1].last);
+  // The staging data of the second upload is aligned
+  CHECK(backend.GetSubmittedCopies()[1].stagingOffset % UploadBatcher::kStagingAlignment == 0);
+
+  const UploadBatchStatistics& statistics = batcher.GetStatistics();
+  CHECK(statistics.uploadCount == 2);
+  CHECK(statistics.uploadedBytes == 160);
+  CHECK(statistics.batchCount == 1);
+  CHECK(statistics.copyCount == 2);
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Uploads larger than the staging buffer are split into chunks, each batch waiting for the
+// previous one to release the staging memory
+TEST_CASE(LargeUploadsAreSplit)
+{
+  MockUploadBackend backend(256);
+  UploadBatcher batcher(&backend, 256);
+  const std::vector<uint8_t> data = MakeData(1000, 3);
+  std::vector<uint8_t> buffer(1000);
+  batcher.Upload(&buffer, data.data(), data.size());
+  batcher.WaitForAll();
+
+  CHECK(buffer == data);
+  CHECK(batcher.GetPendingBatchCount() == 0);
+  CHECK(batcher.GetPeakStagingSize() <= 256);
+  const std::vector<UploadCopy>& copies = backend.GetSubmittedCopies();
+  CHECK(copies.size() == 4);
+  for (size_t i = 0; i < copies.size(); i++)
+  {
+    CHECK(copies[i].last == (i + 1 == copies.size()));
+  }
+  CHECK(batcher.GetStatistics().stallCount == 3);
+  CHECK(backend.GetQueue().GetStalls().size() == 4);
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Uploads to consecutive ranges of a destination are merged into a single copy
+TEST_CASE(ContiguousUploadsAreMerged)
+{
+  MockUploadBackend backend(1024);
+  UploadBatcher batcher(&backend, 1024);
+  const std::vector<uint8_t> data = MakeData(64, 4);
+  std::vector<uint8_t> buffer(64);
+  batcher.Upload(&buffer, data.data(), 32, 0);
+  batcher.Upload(&buffer, data.data() + 32, 32, 32);
+  batcher.WaitForAll();
+
+  CHECK(buffer == data);
+  CHECK(backend.GetSubmittedCopies().size() == 1);
+  CHECK(backend.GetSubmittedCopies()[0].size == 64);
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// The batches completed by the GPU are retired without blocking
+TEST_CASE(CompletedBatchesAreReusedWithoutStall)
+{
+  MockUploadBackend backend(256);
+  UploadBatcher batcher(&backend, 256);
+  std::vector<std::vector<uint8_t>> buffers(8, std::vector<uint8_t>(128));
+  for (size_t i = 0; i < buffers.size(); i++)
+  {
+    const std::vector<uint8_t> data = MakeData(128, static_cast<uint8_t>(i));
+    batcher.Upload(&buffers[i], data.data(), data.size());
+    backend.Complete(batcher.Flush());
+  }
+  batcher.WaitForAll();
+  for (size_t i = 0; i < buffers.size(); i++)
+  {
+    CHECK(buffers[i] == MakeData(128, static_cast<uint8_t>(i)));
+  }
+  CHECK(batcher.GetStatistics().stallCount == 0);
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+TEST_CASE(InvalidUploadsThrow)
+{
+  CHECK_THROWS(UploadBatcher(nullptr, 256));
+  MockUploadBackend backend(256);
+  UploadBatcher batcher(&backend, 256);
+  std::vector<uint8_t> buffer(4);
+  CHECK_THROWS(batcher.Upload(nullptr, buffer.data(), 4));
+  CHECK_THROWS(batcher.Upload(&buffer, nullptr, 4));
+  batcher.Upload(&buffer, nullptr, 0);
+  CHECK(batcher.Flush() == 0);
+}
@@ -0,0 +1,103 @@
+/*
+
+Tests of UploadRing, driven by the fence of a MockFrameQueue.
+
+*/
+
+#include "TestHarness.h"
+
+#include "FramePacer.h"
+#include "UploadRing.h"
+
+using namespace nv_helpers_dx12;
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+TEST_CASE(AllocationsAreAlignedAndLinear)
+{
+  UploadRing ring(1024);
+  uint64_t offset = 0;
+  CHECK(ring.Allocate(10, 1, &offset) && offset == 0);
+  CHECK(ring.Allocate(10, 256, &offset) && offset == 256);
+  CHECK(ring.Allocate(1, 4, &offset) && offset == 268);
+  CHECK(ring.GetUsedSize() == 269);
+  CHECK(ring.GetPeakUsedSize() == 269);
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// The memory of a frame is only reused once the GPU reaches the fence value of the frame
+TEST_CASE(FullRingIsReleasedByTheFence)
+{
+  MockFrameQueue queue;
+  UploadRing ring(1024);
+  uint64_t offset = 0;
+  CHECK(ring.Allocate(500, 256, &offset) && offset == 0);
+  ring.EndFrame(queue.Signal());
+  CHECK(ring.Allocate(200, 256, &offset) && offset == 512);
+  ring.EndFrame(queue.Signal());
+  CHECK(ring.GetPendingFrameCount() == 2);
+
+  // The next allocation does not fit at the end, and the start is still used by the first frame
+  CHECK(!ring.Allocate(400, 256, &offset));
+  ring.Retire(queue.GetCompletedValue());
+  CHECK(!ring.Allocate(400, 256, &offset));
+
+  queue.Complete(1);
+  ring.Retire(queue.GetCompletedValue());
+  CHECK(ring.GetPendingFrameCount() == 1);
+  // Wraps around to the start of the ring, the end of the ring being skipped
+  CHECK(ring.Allocate(400, 256, &offset) && offset == 0);
+  CHECK(ring.GetUsedSize() == 1024 - 500 + 400);
+
+  // The skipped bytes belong to the current frame
+  queue.CompleteAll();
+  ring.Retire(queue.GetCompletedValue());
+  CHECK(ring.GetUsedSize() == 1024 - 712 + 400);
+  ring.EndFrame(queue.Signal());
+  queue.CompleteAll();
+  ring.Retire(queue.GetCompletedValue());
+  CHECK(ring.GetUsedSize() == 0);
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// An empty ring restarts at offset 0, so that an allocation of the size of the ring succeeds
+TEST_CASE(EmptyRingRestartsAtTheStart)
+{
+  UploadRing ring(1024);
+  uint64_t offset = 0;
+  CHECK(ring.Allocate(100, 1, &offset));
+  ring.EndFrame(1);
+  ring.Retire(1);
+  CHECK(ring.GetUsedSize() == 0);
+  CHECK(ring.Allocate(1024, 1, &offset) && offset == 0);
+  CHECK(ring.GetPeakUsedSize() == 1024);
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Frames without allocations are retired as well
+TEST_CASE(EmptyFramesAreRetired)
+{
+  UploadRing ring(64);
+  ring.EndFrame(1);
+  ring.EndFrame(2);
+  ring.Retire(2);
+  CHECK(ring.GetPendingFrameCount() == 0);
+  CHECK(ring.GetUsedSize() == 0);
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+TEST_CASE(InvalidAllocationsThrow)
+{
+  CHECK_THROWS(UploadRing(0));
+  UploadRing ring(256);
+  uint64_t offset = 0;
+  CHECK_THROWS(ring.Allocate(257, 1, &offset));
+  CHECK_THROWS(ring.Allocate(16, 3, &offset));
+  CHECK_THROWS(ring.Allocate(16, 0, &offset));
+}
@@ -0,0 +1,126 @@
+/*
+
+Tests of the vertex welding, on the plane of the sample and on triangle soups built from
+generated meshes.
+
+*/
+
+#include "TestHarness.h"
+
+#include "SceneGenerator.h"
+#include "VertexWelder.h"
+
+#include <array>
+#include <cstring>
+#include <set>
+#include <vector>
+
+using namespace nv_helpers_dx12;
+
+namespace
+{
+// Vertices of the plane of CreatePlaneVB, two triangles sharing two of their vertices
+const MeshVertex kPlaneVertices[] = {
+    {{-1.5f, -.8f, 1.5f}, {1.f, 1.f, 1.f, 1.f}}, {{-1.5f, -.8f, -1.5f}, {1.f, 1.f, 1.f, 1.f}},
+    {{1.5f, -.8f, 1.5f}, {1.f, 1.f, 1.f, 1.f}},  {{1.5f, -.8f, 1.5f}, {1.f, 1.f, 1.f, 1.f}},
+    {{-1.5f, -.8f, -1.5f}, {1.f, 1.f, 1.f, 1.f}}, {{1.5f, -.8f, -1.5f}, {1.f, 1.f, 1.f, 1.f}}};
+
+// Expand the indexed mesh into a triangle list without sharing
+std::vector<MeshVertex> MakeSoup(const Mesh& mesh)
+{
+  std::vector<MeshVertex> soup;
+  for (uint32_t index : mesh.indices)
+  {
+    soup.push_back(mesh.vertices[index]);
+  }
+  return soup;
+}
+
+// Vertices with equal values, +0 and -0 being equal
+bool SameVertex(const MeshVertex& a, const MeshVertex& b)
+{
+  return a.position[0] == b.position[0] && a.position[1] == b.position[1] &&
+         a.position[2] == b.position[2] && a.color[0] == b.color[0] && a.color[1] == b.color[1] &&
+         a.color[2] == b.color[2] && a.color[3] == b.color[3];
+}
+
+size_t CountDistinctVertices(const std::vector<MeshVertex>& vertices)
+{
+  std::set<std::array<float, 7>> distinct;
+  for (const MeshVertex& vertex : vertices)
+  {
+    distinct.insert({{vertex.position[0], vertex.position[1], vertex.position[2], vertex.color[0],
+                      vertex.color[1], vertex.color[2], vertex.color[3]}});
+  }
+  return distinct.size();
+}
+} // namespace
+
+//--------------------------------------------------------------------------------------------------
+//
+// The 6 vertices of the plane become 4 vertices and 6 indices, in the order of first occurrence
+TEST_CASE(PlaneIsWeldedToFourVertices)
+{
+  const Mesh plane = WeldVertices(kPlaneVertices, 6, nullptr, 0);
+  CHECK(plane.vertices.size() == 4);
+  CHECK(plane.indices == std::vector<uint32_t>({0, 1, 2, 2, 1, 3}));
+  CHECK(SameVertex(plane.vertices[3], kPlaneVertices[5]));
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Welding the triangle soup of an indexed mesh gives its triangles back, on its distinct vertices
+TEST_CASE(SoupIsWeldedBackToTheMesh)
+{
+  const Mesh mesh = GenerateMesh(3000, 2);
+  const std::vector<MeshVertex> soup = MakeSoup(mesh);
+  const Mesh welded = WeldVertices(soup.data(), soup.size(), nullptr, 0);
+
+  CHECK(welded.indices.size() == mesh.indices.size());
+  CHECK(welded.vertices.size() == CountDistinctVertices(soup));
+  for (size_t i = 0; i < mesh.indices.size(); i++)
+  {
+    CHECK(SameVertex(welded.vertices[welded.indices[i]], mesh.vertices[mesh.indices[i]]));
+  }
+  // Welding again changes nothing
+  Mesh again = welded;
+  WeldMesh(&again);
+  CHECK(again.indices == welded.indices);
+  CHECK(again.vertices.size() == welded.vertices.size());
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// +0 and -0 are equal, and the tolerance merges the vertices within a cell of the grid
+TEST_CASE(SignedZerosAndTolerances)
+{
+  const MeshVertex vertices[] = {{{0.f, 1.f, 2.f}, {1.f, 1.f, 1.f, 1.f}},
+                                 {{-0.f, 1.f, 2.f}, {1.f, 1.f, 1.f, 1.f}},
+                                 {{0.f, 1.f, -0.f}, {1.f, 1.f, 1.f, -0.f}},
+                                 {{0.f, 1.f, 0.f}, {1.f, 1.f, 1.f, 0.f}},
+                                 {{0.0001f, 1.f, 2.f}, {1.f, 1.f, 1.f, 1.f}},
+                                 {{0.f, 1.f, 2.f}, {1.f, 1.f, 1.f, 1.0049f}}};
+  std::vector<uint32_t> remap(6);
+  CHECK(GenerateWeldRemap(vertices, 6, remap.data()) == 4);
+  CHECK(remap == std::vector<uint32_t>({0, 0, 1, 1, 2, 3}));
+
+  CHECK(GenerateWeldRemap(vertices, 6, remap.data(), 0.01f, 0.01f) == 2);
+  CHECK(remap == std::vector<uint32_t>({0, 0, 1, 1, 0, 0}));
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// The welded mesh does not depend on the number of workers
+TEST_CASE(ParallelWeldingMatchesSerial)
+{
+  const std::vector<MeshVertex> soup = MakeSoup(GenerateMesh(20000, 4));
+  const Mesh serial = WeldVertices(soup.data(), soup.size(), nullptr, 0, 0.f, 0.f, 1);
+  for (uint32_t workerCount : {2u, 3u, 4u, 8u})
+  {
+    const Mesh parallel = WeldVertices(soup.data(), soup.size(), nullptr, 0, 0.f, 0.f, workerCount);
+    CHECK(parallel.indices == serial.indices);
+    CHECK(parallel.vertices.size() == serial.vertices.size());
+    CHECK(memcmp(parallel.vertices.data(), serial.vertices.data(),
+                 serial.vertices.size() * sizeof(MeshVertex)) == 0);
+  }
+}